@@ -64,6 +64,18 @@ void trace_result(const bench_result_t& result){
 	std::cout << "\t%    : " << p << std::endl;
 }
 
+void trace_speedup(const bench_speedup_t& result){
+	const auto before_str = format_ns(result._before_ns);
+	const auto after_str = format_ns(result._after_ns);
+
+	double k = (double)result._before_ns / (double)result._after_ns;
+
+	std::cout << "Test: " << result._name << std::endl;
+	std::cout << "\tBefore :" << before_str << " ns" <<std::endl;
+	std::cout << "\tAfter  :" << after_str << " ns"  << std::endl;
+	std::cout << "\tSpeedup: " << k << std::endl;
+}
+
 int64_t measure_floyd_function_f(const std::string& floyd_program, int count){
 	const auto program = compile_to_bytecode(floyd_program, "");
 
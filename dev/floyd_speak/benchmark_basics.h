@@ -34,6 +34,16 @@ struct bench_result_t {
 
 void trace_result(const bench_result_t& result);
 
+
+//	Compares two C++ implementations of the same thing, like a scalar loop and its SIMD version.
+struct bench_speedup_t {
+	std::string _name;
+	std::int64_t _before_ns;
+	std::int64_t _after_ns;
+};
+
+void trace_speedup(const bench_speedup_t& result);
+
 int64_t measure_floyd_function_f(const std::string& floyd_program, int count);
 
 #endif
@@ -0,0 +1,294 @@
+//
+//  bc_memo.cpp
+//  FloydSpeak
+//
+//  Created by Marcus Zetterquist on 2018-10-29.
+//  Copyright © 2018 Marcus Zetterquist. All rights reserved.
+//
+
+#include "bc_memo.h"
+
+#include "floyd_interpreter.h"
+#include "json_support.h"
+#include "quark.h"
+
+
+namespace floyd {
+
+
+//////////////////////////////////////		bc_memo_stats_t
+
+
+json_t bc_memo_stats_to_json(const bc_memo_stats_t& stats){
+	return json_t::make_object({
+		{ "hits", json_t(static_cast<double>(stats._hits)) },
+		{ "misses", json_t(static_cast<double>(stats._misses)) },
+		{ "evictions", json_t(static_cast<double>(stats._evictions)) },
+		{ "entry_count", json_t(static_cast<double>(stats._entry_count)) }
+	});
+}
+
+
+//////////////////////////////////////		bc_memo_table_t
+
+
+bc_memo_table_t::bc_memo_table_t(const std::string& function_name, size_t max_entries) :
+	_function_name(function_name),
+	_max_entries(max_entries),
+	_stats{ 0, 0, 0, 0 }
+{
+	QUARK_ASSERT(max_entries > 0);
+	QUARK_ASSERT(check_invariant());
+}
+
+bool bc_memo_table_t::check_invariant() const {
+	QUARK_ASSERT(_max_entries > 0);
+	QUARK_ASSERT(_lru.size() <= _max_entries);
+	QUARK_ASSERT(_index.size() == _lru.size());
+	QUARK_ASSERT(_stats._entry_count == _lru.size());
+	return true;
+}
+
+static bool args_equal(const std::vector<bc_value_t>& stored, const bc_value_t args[], int arg_count){
+	QUARK_ASSERT(stored.size() == arg_count);
+
+	for(int i = 0 ; i < arg_count ; i++){
+		if(bc_values_equal(stored[i], args[i], args[i]._type) == false){
+			return false;
+		}
+	}
+	return true;
+}
+
+const bc_value_t* bc_memo_table_t::find(uint64_t hash, const bc_value_t args[], int arg_count){
+	QUARK_ASSERT(check_invariant());
+
+	const auto range = _index.equal_range(hash);
+	for(auto it = range.first ; it != range.second ; it++){
+		const auto entry_it = it->second;
+		if(args_equal(entry_it->_args, args, arg_count)){
+			//	Move to front, iterators stay valid.
+			_lru.splice(_lru.begin(), _lru, entry_it);
+			_stats._hits++;
+			return &entry_it->_result;
+		}
+	}
+	_stats._misses++;
+	return nullptr;
+}
+
+void bc_memo_table_t::insert(uint64_t hash, const bc_value_t args[], int arg_count, const bc_value_t& result){
+	QUARK_ASSERT(check_invariant());
+
+	if(_lru.size() == _max_entries){
+		const auto last_it = std::prev(_lru.end());
+		const auto range = _index.equal_range(last_it->_hash);
+		for(auto it = range.first ; it != range.second ; it++){
+			if(it->second == last_it){
+				_index.erase(it);
+				break;
+			}
+		}
+		_lru.pop_back();
+		_stats._evictions++;
+		_stats._entry_count--;
+	}
+
+	_lru.push_front(entry_t{ hash, std::vector<bc_value_t>(args, args + arg_count), result });
+	_index.insert({ hash, _lru.begin() });
+	_stats._entry_count++;
+
+	QUARK_ASSERT(check_invariant());
+}
+
+uint64_t bc_hash_args(const bc_value_t args[], int arg_count){
+	uint64_t acc = static_cast<uint64_t>(arg_count);
+	for(int i = 0 ; i < arg_count ; i++){
+		acc = acc * 0x100000001b3ULL ^ bc_hash_value(args[i], args[i]._type);
+	}
+	return acc;
+}
+
+
+//////////////////////////////////////		interpreter_t
+
+
+static int get_memoizable_function_id(const interpreter_t& vm, const std::string& function_name){
+	QUARK_ASSERT(vm.check_invariant());
+
+	const auto symbol = find_global_symbol2(vm, function_name);
+	if(symbol == nullptr){
+		quark::throw_runtime_error("Cannot memoize \"" + function_name + "\", there is no such global.");
+	}
+	const auto& type = symbol->_value._type;
+	if(type.is_function() == false){
+		quark::throw_runtime_error("Cannot memoize \"" + function_name + "\", it is not a function.");
+	}
+	if(type.get_function_pure() != epure::pure){
+		quark::throw_runtime_error("Cannot memoize \"" + function_name + "\", only pure functions can be memoized.");
+	}
+	if(type.get_function_return().is_void()){
+		quark::throw_runtime_error("Cannot memoize \"" + function_name + "\", it doesn't return a value.");
+	}
+
+	const auto function_id = symbol->_value.get_function_value();
+	const auto& function_def = vm._imm->_program._function_defs[function_id];
+	if(function_def._host_function_id != 0){
+		quark::throw_runtime_error("Cannot memoize \"" + function_name + "\", it is a host function.");
+	}
+	if(function_def._is_inlined){
+		quark::throw_runtime_error("Cannot memoize \"" + function_name + "\", calls to it were inlined. Pass it in memoized_functions when compiling.");
+	}
+	return function_id;
+}
+
+void enable_memoization(interpreter_t& vm, const std::string& function_name, size_t max_entries){
+	QUARK_ASSERT(vm.check_invariant());
+	QUARK_ASSERT(max_entries > 0);
+
+	const auto function_id = get_memoizable_function_id(vm, function_name);
+	if(vm._memo_tables.size() <= function_id){
+		vm._memo_tables.resize(function_id + 1);
+	}
+	vm._memo_tables[function_id] = std::make_shared<bc_memo_table_t>(function_name, max_entries);
+}
+
+void disable_memoization(interpreter_t& vm, const std::string& function_name){
+	QUARK_ASSERT(vm.check_invariant());
+
+	const auto function_id = get_memoizable_function_id(vm, function_name);
+	if(function_id < vm._memo_tables.size()){
+		vm._memo_tables[function_id] = nullptr;
+	}
+}
+
+const bc_memo_table_t* find_memo_table(const interpreter_t& vm, const std::string& function_name){
+	QUARK_ASSERT(vm.check_invariant());
+
+	for(const auto& e: vm._memo_tables){
+		if(e && e->_function_name == function_name){
+			return e.get();
+		}
+	}
+	return nullptr;
+}
+
+json_t memo_stats_to_json(const interpreter_t& vm){
+	QUARK_ASSERT(vm.check_invariant());
+
+	std::map<std::string, json_t> result;
+	for(const auto& e: vm._memo_tables){
+		if(e){
+			result.insert({ e->_function_name, bc_memo_stats_to_json(e->_stats) });
+		}
+	}
+	return json_t::make_object(result);
+}
+
+
+//////////////////////////////////////		TESTS
+
+
+QUARK_UNIT_TEST("bc_memo_table_t", "insert()", "more than max_entries", "least recently used is evicted"){
+	bc_memo_table_t table("f", 2);
+	const auto a = bc_value_t::make_int(1);
+	const auto b = bc_value_t::make_int(2);
+	const auto c = bc_value_t::make_int(3);
+
+	table.insert(bc_hash_args(&a, 1), &a, 1, bc_value_t::make_int(10));
+	table.insert(bc_hash_args(&b, 1), &b, 1, bc_value_t::make_int(20));
+
+	//	Touch a so b becomes the least recently used.
+	QUARK_UT_VERIFY(table.find(bc_hash_args(&a, 1), &a, 1) != nullptr);
+	table.insert(bc_hash_args(&c, 1), &c, 1, bc_value_t::make_int(30));
+
+	QUARK_UT_VERIFY(table.find(bc_hash_args(&b, 1), &b, 1) == nullptr);
+	QUARK_UT_VERIFY(table.find(bc_hash_args(&a, 1), &a, 1)->get_int_value() == 10);
+	QUARK_UT_VERIFY(table.find(bc_hash_args(&c, 1), &c, 1)->get_int_value() == 30);
+	QUARK_UT_VERIFY(table._stats._hits == 3);
+	QUARK_UT_VERIFY(table._stats._misses == 1);
+	QUARK_UT_VERIFY(table._stats._evictions == 1);
+	QUARK_UT_VERIFY(table._stats._entry_count == 2);
+}
+
+QUARK_UNIT_TEST("bc_memo", "enable_memoization()", "recursive fib", "subresults are reused"){
+	const auto vm = run_global(R"(
+		func int fib(int n){
+			if(n < 2){
+				return n
+			}
+			return fib(n - 1) + fib(n - 2)
+		}
+	)", "");
+	enable_memoization(*vm, "fib", 1000);
+
+	const auto f = find_global_symbol2(*vm, "fib")->_value;
+	const auto arg = bc_value_t::make_int(30);
+	const auto result = call_function_bc(*vm, f, &arg, 1);
+	QUARK_UT_VERIFY(result.get_int_value() == 832040);
+
+	const auto& stats = find_memo_table(*vm, "fib")->_stats;
+	QUARK_UT_VERIFY(stats._misses == 31);
+	QUARK_UT_VERIFY(stats._hits == 28);
+
+	const auto result2 = call_function_bc(*vm, f, &arg, 1);
+	QUARK_UT_VERIFY(result2.get_int_value() == 832040);
+	QUARK_UT_VERIFY(stats._hits == 29);
+}
+
+QUARK_UNIT_TEST("bc_memo", "enable_memoization()", "small pure function called from another function", "hits"){
+	const auto source = R"(
+		func int sq(int n){
+			return n * n
+		}
+		func int sum_sq(int n){
+			return sq(n) + sq(n)
+		}
+	)";
+	interpreter_t vm(compile_to_bytecode(source, "", { "sq" }));
+	enable_memoization(vm, "sq", 10);
+
+	const auto f = find_global_symbol2(vm, "sum_sq")->_value;
+	const auto arg = bc_value_t::make_int(3);
+	QUARK_UT_VERIFY(call_function_bc(vm, f, &arg, 1).get_int_value() == 18);
+
+	const auto& stats = find_memo_table(vm, "sq")->_stats;
+	QUARK_UT_VERIFY(stats._misses == 1);
+	QUARK_UT_VERIFY(stats._hits == 1);
+}
+
+QUARK_UNIT_TEST("bc_memo", "enable_memoization()", "inlined function", "throws"){
+	const auto vm = run_global(R"(
+		func int sq(int n){
+			return n * n
+		}
+		func int sum_sq(int n){
+			return sq(n) + sq(n)
+		}
+	)", "");
+	try{
+		enable_memoization(*vm, "sq", 10);
+		QUARK_UT_VERIFY(false);
+	}
+	catch(const std::runtime_error& e){
+		QUARK_UT_VERIFY(std::string(e.what()) == "Cannot memoize \"sq\", calls to it were inlined. Pass it in memoized_functions when compiling.");
+	}
+}
+
+QUARK_UNIT_TEST("bc_memo", "enable_memoization()", "impure function", "throws"){
+	const auto vm = run_global(R"(
+		func int f(int n) impure {
+			return n
+		}
+	)", "");
+	try{
+		enable_memoization(*vm, "f", 10);
+		QUARK_UT_VERIFY(false);
+	}
+	catch(const std::runtime_error& e){
+		QUARK_UT_VERIFY(std::string(e.what()) == "Cannot memoize \"f\", only pure functions can be memoized.");
+	}
+}
+
+
+}	//	floyd
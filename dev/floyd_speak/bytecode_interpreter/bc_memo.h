@@ -0,0 +1,104 @@
+//
+//  bc_memo.h
+//  FloydSpeak
+//
+//  Created by Marcus Zetterquist on 2018-10-29.
+//  Copyright © 2018 Marcus Zetterquist. All rights reserved.
+//
+
+#ifndef bc_memo_hpp
+#define bc_memo_hpp
+
+/*
+	Memoization of pure Floyd functions.
+
+	A pure function always returns the same result for the same arguments, so the interpreter can keep the results
+	of earlier calls and return them instead of running the function again. This is opt-in per function, see
+	enable_memoization().
+
+	Arguments are looked up using bc_hash_value() and then checked using bc_compare_value_true_deep().
+	Each table holds at most _max_entries results, the least recently used result is dropped first.
+*/
+
+#include "bytecode_interpreter.h"
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct json_t;
+
+namespace floyd {
+
+
+//////////////////////////////////////		bc_memo_stats_t
+
+
+struct bc_memo_stats_t {
+	int64_t _hits;
+	int64_t _misses;
+	int64_t _evictions;
+	int64_t _entry_count;
+};
+
+json_t bc_memo_stats_to_json(const bc_memo_stats_t& stats);
+
+
+//////////////////////////////////////		bc_memo_table_t
+
+/*
+	Results of one function. MUTABLE.
+*/
+
+struct bc_memo_table_t {
+	struct entry_t {
+		uint64_t _hash;
+		std::vector<bc_value_t> _args;
+		bc_value_t _result;
+	};
+
+	public: bc_memo_table_t(const std::string& function_name, size_t max_entries);
+	public: bool check_invariant() const;
+
+	//	Returns nullptr if there is no result for these arguments. Counts a hit or a miss.
+	//	The pointer is valid until the next call to insert().
+	public: const bc_value_t* find(uint64_t hash, const bc_value_t args[], int arg_count);
+
+	public: void insert(uint64_t hash, const bc_value_t args[], int arg_count, const bc_value_t& result);
+
+
+	////////////////////////		STATE
+	public: std::string _function_name;
+	public: size_t _max_entries;
+
+	//	Most recently used entry first.
+	public: std::list<entry_t> _lru;
+	public: std::unordered_multimap<uint64_t, std::list<entry_t>::iterator> _index;
+	public: bc_memo_stats_t _stats;
+};
+
+uint64_t bc_hash_args(const bc_value_t args[], int arg_count);
+
+
+//////////////////////////////////////		interpreter_t
+
+
+//	Throws if function_name isn't a global pure Floyd function that returns a value, or if calls to it were inlined:
+//	compile with it in memoized_functions, see compile_to_bytecode(). max_entries must be > 0.
+//	Calling again replaces the old table, dropping its results and stats.
+void enable_memoization(interpreter_t& vm, const std::string& function_name, size_t max_entries);
+
+void disable_memoization(interpreter_t& vm, const std::string& function_name);
+
+//	Returns nullptr if the function isn't memoized.
+const bc_memo_table_t* find_memo_table(const interpreter_t& vm, const std::string& function_name);
+
+//	{ "fib": { "hits": 10, ... }, ... }
+json_t memo_stats_to_json(const interpreter_t& vm);
+
+
+}	//	floyd
+
+#endif /* bc_memo_hpp */
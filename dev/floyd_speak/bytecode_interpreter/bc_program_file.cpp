@@ -0,0 +1,956 @@
+//
+//  bc_program_file.cpp
+//  FloydSpeak
+//
+//  Created by Marcus Zetterquist on 2019-03-02.
+//  Copyright © 2019 Marcus Zetterquist. All rights reserved.
+//
+
+#include "bc_program_file.h"
+
+#include "bytecode_interpreter.h"
+#include "floyd_interpreter.h"
+#include "ast_typeid_helpers.h"
+#include "ast_json.h"
+#include "ast_value.h"
+#include "json_support.h"
+#include "file_handling.h"
+#include "text_parser.h"
+#include "quark.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace floyd {
+
+
+static const char k_file_magic[8] = { 'F', 'L', 'O', 'Y', 'D', 'B', 'C', 0 };
+static const uint32_t k_byte_order_marker = 0x01020304;
+static const std::size_t k_header_size = 32;
+static const std::size_t k_instructions_alignment = 8;
+
+static_assert(sizeof(bc_instruction_t) == 8, "Instruction arrays are stored raw");
+static_assert(std::is_trivially_copyable<bc_instruction_t>::value, "Instruction arrays are stored raw");
+
+struct writer_t;
+struct reader_t;
+static void write_value(writer_t& w, const value_t& value);
+static value_t read_value(reader_t& r);
+
+
+//////////////////////////////////////		writer_t
+
+
+struct writer_t {
+	void write_u8(uint8_t v){
+		_data.push_back(v);
+	}
+	void write_u16(uint16_t v){
+		_data.push_back(static_cast<uint8_t>(v));
+		_data.push_back(static_cast<uint8_t>(v >> 8));
+	}
+	void write_u32(uint32_t v){
+		for(int i = 0 ; i < 4 ; i++){
+			_data.push_back(static_cast<uint8_t>(v >> (i * 8)));
+		}
+	}
+	void write_u64(uint64_t v){
+		for(int i = 0 ; i < 8 ; i++){
+			_data.push_back(static_cast<uint8_t>(v >> (i * 8)));
+		}
+	}
+	void write_i64(int64_t v){
+		write_u64(static_cast<uint64_t>(v));
+	}
+	void write_double(double v){
+		uint64_t bits = 0;
+		std::memcpy(&bits, &v, sizeof(bits));
+		write_u64(bits);
+	}
+	void write_string(const std::string& s){
+		write_u32(static_cast<uint32_t>(s.size()));
+		_data.insert(_data.end(), s.begin(), s.end());
+	}
+	void align(std::size_t alignment){
+		while(_data.size() % alignment != 0){
+			_data.push_back(0);
+		}
+	}
+
+	//	Writes the type's index in the type table, adding it if needed.
+	void write_type(const typeid_t& type){
+		const auto json = json_to_compact_string(typeid_to_ast_json(type, json_tags::k_tag_resolve_state)._value);
+		const auto it = _type_indexes.find(json);
+		if(it != _type_indexes.end()){
+			write_u32(it->second);
+		}
+		else{
+			const auto index = static_cast<uint32_t>(_type_table.size());
+			_type_indexes.insert({ json, index });
+			_type_table.push_back(json);
+			write_u32(index);
+		}
+	}
+
+	//	Writes the constant's index in the constant pool, adding it if needed. Equal constants share one entry.
+	void write_constant(const value_t& value){
+		std::vector<uint8_t> encoded;
+		std::swap(_data, encoded);
+		write_value(*this, value);
+		std::swap(_data, encoded);
+
+		const auto key = std::string(encoded.begin(), encoded.end());
+		const auto it = _constant_indexes.find(key);
+		if(it != _constant_indexes.end()){
+			write_u32(it->second);
+		}
+		else{
+			const auto index = static_cast<uint32_t>(_constant_indexes.size());
+			_constant_indexes.insert({ key, index });
+			_constant_pool.insert(_constant_pool.end(), encoded.begin(), encoded.end());
+			write_u32(index);
+		}
+	}
+
+
+	////////////////////////		STATE
+	std::vector<uint8_t> _data;
+
+	std::vector<std::string> _type_table;
+	std::map<std::string, uint32_t> _type_indexes;
+
+	std::vector<uint8_t> _constant_pool;
+	std::map<std::string, uint32_t> _constant_indexes;
+};
+
+
+//////////////////////////////////////		reader_t
+
+
+struct reader_t {
+	void need(std::size_t count) const {
+		if(static_cast<std::size_t>(_end - _p) < count){
+			quark::throw_runtime_error("Bytecode file is truncated.");
+		}
+	}
+
+	uint8_t read_u8(){
+		need(1);
+		return *_p++;
+	}
+	uint16_t read_u16(){
+		need(2);
+		const auto result = static_cast<uint16_t>(_p[0] | (_p[1] << 8));
+		_p += 2;
+		return result;
+	}
+	uint32_t read_u32(){
+		need(4);
+		uint32_t result = 0;
+		for(int i = 0 ; i < 4 ; i++){
+			result = result | (static_cast<uint32_t>(_p[i]) << (i * 8));
+		}
+		_p += 4;
+		return result;
+	}
+	uint64_t read_u64(){
+		need(8);
+		uint64_t result = 0;
+		for(int i = 0 ; i < 8 ; i++){
+			result = result | (static_cast<uint64_t>(_p[i]) << (i * 8));
+		}
+		_p += 8;
+		return result;
+	}
+	int64_t read_i64(){
+		return static_cast<int64_t>(read_u64());
+	}
+	double read_double(){
+		const auto bits = read_u64();
+		double result = 0.0;
+		std::memcpy(&result, &bits, sizeof(result));
+		return result;
+	}
+	//	Reads an item count. Each item takes at least min_item_size bytes, so a count the rest of the file can't hold is rejected before anything is reserved.
+	uint32_t read_count(std::size_t min_item_size){
+		const auto count = read_u32();
+		need(std::size_t(count) * min_item_size);
+		return count;
+	}
+	std::string read_string(){
+		const auto size = read_u32();
+		need(size);
+		const auto result = std::string(reinterpret_cast<const char*>(_p), size);
+		_p += size;
+		return result;
+	}
+	const typeid_t& read_type(){
+		const auto index = read_u32();
+		if(index >= _type_table.size()){
+			quark::throw_runtime_error("Bytecode file has a bad type index.");
+		}
+		return _type_table[index];
+	}
+	const bc_value_t& read_constant(){
+		const auto index = read_u32();
+		if(index >= _constant_pool.size()){
+			quark::throw_runtime_error("Bytecode file has a bad constant index.");
+		}
+		return _constant_pool[index];
+	}
+	void align(std::size_t alignment){
+		const auto pos = static_cast<std::size_t>(_p - _start);
+		const auto padding = (alignment - pos % alignment) % alignment;
+		need(padding);
+		_p += padding;
+	}
+
+
+	////////////////////////		STATE
+	const uint8_t* _start;
+	const uint8_t* _p;
+	const uint8_t* _end;
+	std::vector<typeid_t> _type_table;
+	std::vector<bc_value_t> _constant_pool;
+
+	//	One more than the largest function id in the constants. Checked once the function table is read.
+	std::size_t _function_id_end;
+};
+
+
+//////////////////////////////////////		VALUES
+
+
+static void write_value(writer_t& w, const value_t& value){
+	const auto type = value.get_type();
+	w.write_type(type);
+
+	const auto basetype = type.get_base_type();
+	if(basetype == base_type::k_internal_undefined || basetype == base_type::k_internal_dynamic || basetype == base_type::k_void){
+	}
+	else if(basetype == base_type::k_bool){
+		w.write_u8(value.get_bool_value() ? 1 : 0);
+	}
+	else if(basetype == base_type::k_int){
+		w.write_i64(value.get_int_value());
+	}
+	else if(basetype == base_type::k_double){
+		w.write_double(value.get_double_value());
+	}
+	else if(basetype == base_type::k_string){
+		w.write_string(value.get_string_value());
+	}
+	else if(basetype == base_type::k_json_value){
+		w.write_string(json_to_compact_string(value.get_json_value()));
+	}
+	else if(basetype == base_type::k_typeid){
+		w.write_type(value.get_typeid_value());
+	}
+	else if(basetype == base_type::k_struct){
+		const auto& members = value.get_struct_value()->_member_values;
+		w.write_u32(static_cast<uint32_t>(members.size()));
+		for(const auto& e: members){
+			write_value(w, e);
+		}
+	}
+	else if(basetype == base_type::k_vector){
+		const auto& elements = value.get_vector_value();
+		w.write_u32(static_cast<uint32_t>(elements.size()));
+		for(const auto& e: elements){
+			write_value(w, e);
+		}
+	}
+	else if(basetype == base_type::k_dict){
+		const auto& entries = value.get_dict_value();
+		w.write_u32(static_cast<uint32_t>(entries.size()));
+		for(const auto& e: entries){
+			write_value(w, e.first);
+			write_value(w, e.second);
+		}
+	}
+	else if(basetype == base_type::k_function){
+		w.write_u32(static_cast<uint32_t>(value.get_function_value()));
+	}
+	else{
+		QUARK_ASSERT(false);
+		quark::throw_exception();
+	}
+}
+
+static value_t read_value(reader_t& r){
+	const auto type = r.read_type();
+
+	const auto basetype = type.get_base_type();
+	if(basetype == base_type::k_internal_undefined){
+		return value_t::make_undefined();
+	}
+	else if(basetype == base_type::k_internal_dynamic){
+		return value_t::make_internal_dynamic();
+	}
+	else if(basetype == base_type::k_void){
+		return value_t::make_void();
+	}
+	else if(basetype == base_type::k_bool){
+		return value_t::make_bool(r.read_u8() != 0);
+	}
+	else if(basetype == base_type::k_int){
+		return value_t::make_int(r.read_i64());
+	}
+	else if(basetype == base_type::k_double){
+		return value_t::make_double(r.read_double());
+	}
+	else if(basetype == base_type::k_string){
+		return value_t::make_string(r.read_string());
+	}
+	else if(basetype == base_type::k_json_value){
+		return value_t::make_json_value(parse_json(seq_t(r.read_string())).first);
+	}
+	else if(basetype == base_type::k_typeid){
+		return value_t::make_typeid_value(r.read_type());
+	}
+	else if(basetype == base_type::k_struct){
+		const auto count = r.read_count(4);
+		std::vector<value_t> members;
+		for(uint32_t i = 0 ; i < count ; i++){
+			members.push_back(read_value(r));
+		}
+		return value_t::make_struct_value(type, members);
+	}
+	else if(basetype == base_type::k_vector){
+		const auto count = r.read_count(4);
+		std::vector<value_t> elements;
+		for(uint32_t i = 0 ; i < count ; i++){
+			elements.push_back(read_value(r));
+		}
+		return value_t::make_vector_value(type.get_vector_element_type(), elements);
+	}
+	else if(basetype == base_type::k_dict){
+		const auto count = r.read_count(8);
+		dict_entries_t entries;
+		for(uint32_t i = 0 ; i < count ; i++){
+			const auto key = read_value(r);
+			entries.insert({ key, read_value(r) });
+		}
+		return value_t::make_dict_value(type.get_dict_key_type(), type.get_dict_value_type(), entries);
+	}
+	else if(basetype == base_type::k_function){
+		const auto function_id = r.read_u32();
+		r._function_id_end = std::max(r._function_id_end, std::size_t(function_id) + 1);
+		return value_t::make_function_value(type, static_cast<int>(function_id));
+	}
+	else{
+		quark::throw_runtime_error("Bytecode file has a bad constant.");
+	}
+}
+
+
+//////////////////////////////////////		FRAMES
+
+
+static std::array<bool, 256> make_valid_opcodes(){
+	std::array<bool, 256> result;
+	result.fill(false);
+	for(const auto& e: k_opcode_info){
+		result[static_cast<uint8_t>(e.first)] = true;
+	}
+	return result;
+}
+
+//	The instructions are written as-is, aligned, so the reader can copy them in one go.
+static void write_frame(writer_t& w, const bc_static_frame_t& frame){
+	w.write_u32(static_cast<uint32_t>(frame._instructions.size()));
+	w.align(k_instructions_alignment);
+	if(frame._instructions.empty() == false){
+		const auto p = reinterpret_cast<const uint8_t*>(&frame._instructions[0]);
+		w._data.insert(w._data.end(), p, p + frame._instructions.size() * sizeof(bc_instruction_t));
+	}
+
+	w.write_u32(static_cast<uint32_t>(frame._symbols.size()));
+	for(const auto& e: frame._symbols){
+		w.write_string(e.first);
+		w.write_u8(e.second._symbol_type == bc_symbol_t::immutable_local ? 0 : 1);
+		w.write_type(e.second._value_type);
+		w.write_constant(bc_to_value(e.second._const_value));
+	}
+
+	w.write_u32(static_cast<uint32_t>(frame._args.size()));
+	for(const auto& e: frame._args){
+		w.write_type(e);
+	}
+}
+
+static bool is_branch(bc_opcode opcode){
+	return false
+		|| opcode == bc_opcode::k_branch_false_bool
+		|| opcode == bc_opcode::k_branch_true_bool
+		|| opcode == bc_opcode::k_branch_zero_int
+		|| opcode == bc_opcode::k_branch_notzero_int
+		|| opcode == bc_opcode::k_branch_smaller_int
+		|| opcode == bc_opcode::k_branch_smaller_or_equal_int
+		|| opcode == bc_opcode::k_branch_always;
+}
+
+static bool is_in_range(int16_t index, std::size_t count){
+	return index >= 0 && static_cast<std::size_t>(index) < count;
+}
+
+//	The interpreter trusts every operand, so check the ones that index something: registers, globals, types and branch targets.
+static void check_instructions(const std::vector<bc_instruction_t>& instructions, std::size_t symbol_count, std::size_t global_count, std::size_t type_count){
+	for(std::size_t pc = 0 ; pc < instructions.size() ; pc++){
+		const auto& e = instructions[pc];
+		const auto reg_flags = encoding_to_reg_flags(k_opcode_info.at(e._opcode)._encoding);
+		if(false
+			|| (reg_flags._a && is_in_range(e._a, symbol_count) == false)
+			|| (reg_flags._b && is_in_range(e._b, symbol_count) == false)
+			|| (reg_flags._c && is_in_range(e._c, symbol_count) == false)
+		){
+			quark::throw_runtime_error("Bytecode file has a bad register.");
+		}
+
+		const auto opcode = e._opcode;
+		const auto global_ok = [&]{
+			if(opcode == bc_opcode::k_load_global_external_value || opcode == bc_opcode::k_load_global_inplace_value){
+				return is_in_range(e._b, global_count);
+			}
+			else if(opcode == bc_opcode::k_store_global_external_value || opcode == bc_opcode::k_store_global_inplace_value){
+				return is_in_range(e._a, global_count);
+			}
+			else{
+				return true;
+			}
+		}();
+		if(global_ok == false){
+			quark::throw_runtime_error("Bytecode file has a bad global index.");
+		}
+
+		const auto type_ok = [&]{
+			if(opcode == bc_opcode::k_new_1){
+				return is_in_range(e._b, type_count) && is_in_range(e._c, type_count);
+			}
+			else if(opcode == bc_opcode::k_new_vector_w_inplace_elements){
+				return e._b == 0 && e._c >= 0;
+			}
+			else if(k_opcode_info.at(opcode)._encoding == opcode_info_t::encoding::k_t_0rii){
+				return is_in_range(e._b, type_count) && e._c >= 0;
+			}
+			else{
+				return true;
+			}
+		}();
+		if(type_ok == false){
+			quark::throw_runtime_error("Bytecode file has a bad type operand.");
+		}
+
+		if(opcode == bc_opcode::k_popn && (e._a < 0 || e._a > 32)){
+			quark::throw_runtime_error("Bytecode file has a bad popn.");
+		}
+
+		if(is_branch(opcode)){
+			const auto offset = opcode == bc_opcode::k_branch_always
+				? e._a
+				: k_opcode_info.at(opcode)._encoding == opcode_info_t::encoding::k_s_0rri ? e._c : e._b;
+			const auto target = static_cast<int64_t>(pc) + offset;
+			if(target < 0 || target >= static_cast<int64_t>(instructions.size())){
+				quark::throw_runtime_error("Bytecode file has a bad branch.");
+			}
+		}
+	}
+}
+
+//	global_count is the number of globals, or -1 when reading the global frame itself: then it's the frame's own symbol count.
+static bc_static_frame_t read_frame(reader_t& r, int64_t global_count, std::size_t type_count){
+	static const auto valid_opcodes = make_valid_opcodes();
+
+	const auto instruction_count = r.read_u32();
+	r.align(k_instructions_alignment);
+	r.need(std::size_t(instruction_count) * sizeof(bc_instruction_t));
+	const auto first = reinterpret_cast<const bc_instruction_t*>(r._p);
+	const auto instructions = std::vector<bc_instruction_t>(first, first + instruction_count);
+	r._p += instruction_count * sizeof(bc_instruction_t);
+	for(const auto& e: instructions){
+		if(valid_opcodes[static_cast<uint8_t>(e._opcode)] == false){
+			quark::throw_runtime_error("Bytecode file has a bad opcode.");
+		}
+	}
+
+	//	Name, mutability, type and constant.
+	const auto symbol_count = r.read_count(4 + 1 + 4 + 4);
+	std::vector<std::pair<std::string, bc_symbol_t>> symbols;
+	symbols.reserve(symbol_count);
+	for(uint32_t i = 0 ; i < symbol_count ; i++){
+		const auto name = r.read_string();
+		const auto symbol_type = r.read_u8() == 0 ? bc_symbol_t::immutable_local : bc_symbol_t::mutable_local;
+		const auto value_type = r.read_type();
+		const auto& const_value = r.read_constant();
+		symbols.push_back({ name, bc_symbol_t{ symbol_type, value_type, const_value } });
+	}
+
+	const auto arg_count = r.read_count(4);
+	std::vector<typeid_t> args;
+	for(uint32_t i = 0 ; i < arg_count ; i++){
+		args.push_back(r.read_type());
+	}
+
+	check_instructions(instructions, symbols.size(), global_count == -1 ? symbols.size() : static_cast<std::size_t>(global_count), type_count);
+	return bc_static_frame_t(instructions, symbols, args);
+}
+
+
+//////////////////////////////////////		SOFTWARE SYSTEM
+
+
+static void write_strings(writer_t& w, const std::vector<std::string>& strings){
+	w.write_u32(static_cast<uint32_t>(strings.size()));
+	for(const auto& e: strings){
+		w.write_string(e);
+	}
+}
+
+static std::vector<std::string> read_strings(reader_t& r){
+	const auto count = r.read_count(4);
+	std::vector<std::string> result;
+	for(uint32_t i = 0 ; i < count ; i++){
+		result.push_back(r.read_string());
+	}
+	return result;
+}
+
+static void write_connections(writer_t& w, const std::vector<connection_t>& connections){
+	w.write_u32(static_cast<uint32_t>(connections.size()));
+	for(const auto& e: connections){
+		w.write_string(e._source_key);
+		w.write_string(e._dest_key);
+		w.write_string(e._interaction_desc);
+		w.write_string(e._tech_desc);
+	}
+}
+
+static std::vector<connection_t> read_connections(reader_t& r){
+	const auto count = r.read_count(4 * 4);
+	std::vector<connection_t> result;
+	for(uint32_t i = 0 ; i < count ; i++){
+		const auto source_key = r.read_string();
+		const auto dest_key = r.read_string();
+		const auto interaction_desc = r.read_string();
+		const auto tech_desc = r.read_string();
+		result.push_back(connection_t{ source_key, dest_key, interaction_desc, tech_desc });
+	}
+	return result;
+}
+
+static void write_software_system(writer_t& w, const software_system_t& system){
+	w.write_string(system._name);
+	w.write_string(system._desc);
+	w.write_u32(static_cast<uint32_t>(system._people.size()));
+	for(const auto& e: system._people){
+		w.write_string(e._name_key);
+		w.write_string(e._desc);
+	}
+	write_connections(w, system._connections);
+	write_strings(w, system._containers);
+}
+
+static software_system_t read_software_system(reader_t& r){
+	software_system_t result;
+	result._name = r.read_string();
+	result._desc = r.read_string();
+	const auto people_count = r.read_count(4 * 2);
+	for(uint32_t i = 0 ; i < people_count ; i++){
+		const auto name_key = r.read_string();
+		const auto desc = r.read_string();
+		result._people.push_back(person_t{ name_key, desc });
+	}
+	result._connections = read_connections(r);
+	result._containers = read_strings(r);
+	return result;
+}
+
+static void write_container(writer_t& w, const container_t& container){
+	w.write_string(container._name);
+	w.write_string(container._desc);
+	w.write_string(container._tech);
+	w.write_u32(static_cast<uint32_t>(container._clock_busses.size()));
+	for(const auto& bus: container._clock_busses){
+		w.write_string(bus.first);
+		w.write_u32(static_cast<uint32_t>(bus.second._processes.size()));
+		for(const auto& process: bus.second._processes){
+			w.write_string(process.first);
+			w.write_string(process.second._function_key);
+			w.write_u32(static_cast<uint32_t>(process.second._batch_size));
+			w.write_u32(static_cast<uint32_t>(process.second._inbox_capacity));
+			w.write_string(inbox_policy_to_string(process.second._inbox_policy));
+			w.write_string(process.second._coalesce_key);
+		}
+	}
+	write_connections(w, container._connections);
+	write_strings(w, container._components);
+}
+
+static container_t read_container(reader_t& r){
+	container_t result;
+	result._name = r.read_string();
+	result._desc = r.read_string();
+	result._tech = r.read_string();
+	const auto bus_count = r.read_count(4 * 2);
+	for(uint32_t i = 0 ; i < bus_count ; i++){
+		const auto bus_key = r.read_string();
+		clock_bus_t bus;
+		const auto process_count = r.read_count(4 * 6);
+		for(uint32_t j = 0 ; j < process_count ; j++){
+			const auto process_key = r.read_string();
+			process_def_t process;
+			process._function_key = r.read_string();
+			process._batch_size = static_cast<int>(r.read_u32());
+			process._inbox_capacity = static_cast<int>(r.read_u32());
+			process._inbox_policy = string_to_inbox_policy(r.read_string());
+			process._coalesce_key = r.read_string();
+			bus._processes.insert({ process_key, process });
+		}
+		result._clock_busses.insert({ bus_key, bus });
+	}
+	result._connections = read_connections(r);
+	result._components = read_strings(r);
+	return result;
+}
+
+
+//////////////////////////////////////		PROGRAM
+
+
+std::vector<uint8_t> write_bc_program(const bc_program_t& program){
+	QUARK_ASSERT(program.check_invariant());
+
+	//	Body first, it collects the type table. The program's own types go first so their ids are unchanged.
+	writer_t body;
+	for(const auto& e: program._types){
+		body.write_type(e);
+	}
+
+	write_frame(body, program._globals);
+
+	body.write_u32(static_cast<uint32_t>(program._function_defs.size()));
+	for(const auto& e: program._function_defs){
+		body.write_type(e._function_type);
+		body.write_u32(static_cast<uint32_t>(e._args.size()));
+		for(const auto& arg: e._args){
+			body.write_type(arg._type);
+			body.write_string(arg._name);
+		}
+		body.write_u32(static_cast<uint32_t>(e._host_function_id));
+		body.write_u8(e._is_inlined ? 1 : 0);
+		body.write_u8(e._frame_ptr ? 1 : 0);
+		if(e._frame_ptr){
+			write_frame(body, *e._frame_ptr);
+		}
+	}
+
+	write_software_system(body, program._software_system);
+	write_container(body, program._container_def);
+
+	writer_t tables;
+	write_strings(tables, body._type_table);
+	tables.write_u32(static_cast<uint32_t>(body._constant_indexes.size()));
+	tables._data.insert(tables._data.end(), body._constant_pool.begin(), body._constant_pool.end());
+
+	//	The body's instruction arrays are aligned relative to its start, so it must start aligned too.
+	const auto body_offset = (k_header_size + tables._data.size() + k_instructions_alignment - 1) / k_instructions_alignment * k_instructions_alignment;
+
+	writer_t file;
+	file._data.insert(file._data.end(), std::begin(k_file_magic), std::end(k_file_magic));
+	file.write_u32(k_bc_program_file_version);
+	file.write_u32(static_cast<uint32_t>(sizeof(bc_instruction_t)));
+	const auto marker = reinterpret_cast<const uint8_t*>(&k_byte_order_marker);
+	file._data.insert(file._data.end(), marker, marker + sizeof(k_byte_order_marker));
+	file.write_u32(static_cast<uint32_t>(program._types.size()));
+	file.write_u32(static_cast<uint32_t>(body_offset));
+	file.write_u32(0);
+	QUARK_ASSERT(file._data.size() == k_header_size);
+
+	file._data.insert(file._data.end(), tables._data.begin(), tables._data.end());
+	file.align(k_instructions_alignment);
+	QUARK_ASSERT(file._data.size() == body_offset);
+	file._data.insert(file._data.end(), body._data.begin(), body._data.end());
+	return file._data;
+}
+
+bc_program_t read_bc_program(const uint8_t data[], std::size_t size){
+	QUARK_ASSERT(data != nullptr || size == 0);
+
+	if(reinterpret_cast<std::uintptr_t>(data) % k_instructions_alignment != 0){
+		quark::throw_runtime_error("Bytecode file data is not aligned.");
+	}
+
+	reader_t r{ data, data, data + size, {}, {}, 0 };
+	r.need(sizeof(k_file_magic));
+	if(std::memcmp(r._p, k_file_magic, sizeof(k_file_magic)) != 0){
+		quark::throw_runtime_error("Not a Floyd bytecode file.");
+	}
+	r._p += sizeof(k_file_magic);
+	if(r.read_u32() != k_bc_program_file_version){
+		quark::throw_runtime_error("Bytecode file has the wrong version.");
+	}
+	const auto instruction_size = r.read_u32();
+	r.need(sizeof(k_byte_order_marker));
+	const auto same_byte_order = std::memcmp(r._p, &k_byte_order_marker, sizeof(k_byte_order_marker)) == 0;
+	r._p += sizeof(k_byte_order_marker);
+	if(instruction_size != sizeof(bc_instruction_t) || same_byte_order == false){
+		quark::throw_runtime_error("Bytecode file was written for another kind of machine.");
+	}
+	const auto program_type_count = r.read_u32();
+	const auto body_offset = r.read_u32();
+	r.read_u32();
+
+	for(const auto& e: read_strings(r)){
+		r._type_table.push_back(typeid_from_ast_json(ast_json_t::make(parse_json(seq_t(e)).first)));
+	}
+
+	const auto constant_count = r.read_count(4);
+	r._constant_pool.reserve(constant_count);
+	for(uint32_t i = 0 ; i < constant_count ; i++){
+		r._constant_pool.push_back(value_to_bc(read_value(r)));
+	}
+
+	r.align(k_instructions_alignment);
+	if(static_cast<std::size_t>(r._p - r._start) != body_offset){
+		quark::throw_runtime_error("Bytecode file has a bad body offset.");
+	}
+
+	r.need(std::size_t(program_type_count) * 4);
+	std::vector<typeid_t> types;
+	types.reserve(program_type_count);
+	for(uint32_t i = 0 ; i < program_type_count ; i++){
+		types.push_back(r.read_type());
+	}
+
+	const auto globals = read_frame(r, -1, types.size());
+
+	//	Type, arg count, host function id and two flags.
+	const auto function_count = r.read_count(4 + 4 + 4 + 1 + 1);
+	std::vector<bc_function_definition_t> function_defs;
+	function_defs.reserve(function_count);
+	for(uint32_t i = 0 ; i < function_count ; i++){
+		const auto function_type = r.read_type();
+		const auto arg_count = r.read_count(4 + 4);
+		std::vector<member_t> args;
+		for(uint32_t a = 0 ; a < arg_count ; a++){
+			const auto arg_type = r.read_type();
+			args.push_back(member_t(arg_type, r.read_string()));
+		}
+		const auto host_function_id = static_cast<int>(r.read_u32());
+		const auto is_inlined = r.read_u8() != 0;
+		const auto frame = r.read_u8() != 0 ? std::make_shared<bc_static_frame_t>(read_frame(r, globals._symbols.size(), types.size())) : nullptr;
+		function_defs.push_back(bc_function_definition_t{ function_type, args, frame, host_function_id });
+		function_defs.back()._is_inlined = is_inlined;
+	}
+	if(r._function_id_end > function_defs.size()){
+		quark::throw_runtime_error("Bytecode file has a bad function id.");
+	}
+
+	const auto software_system = read_software_system(r);
+	const auto container_def = read_container(r);
+	if(r._p != r._end){
+		quark::throw_runtime_error("Bytecode file has trailing data.");
+	}
+
+	const auto result = bc_program_t{ globals, function_defs, types, software_system, container_def };
+	QUARK_ASSERT(result.check_invariant());
+	return result;
+}
+
+void save_bc_program_file(const std::string& path, const bc_program_t& program){
+	const auto data = write_bc_program(program);
+
+	FILE* file = std::fopen(path.c_str(), "wb");
+	if(file == nullptr){
+		quark::throw_runtime_error("Cannot create bytecode file \"" + path + "\".");
+	}
+	const auto write_count = std::fwrite(&data[0], data.size(), 1, file);
+	const auto close_result = std::fclose(file);
+	if(write_count != 1 || close_result != 0){
+		quark::throw_runtime_error("Cannot write bytecode file \"" + path + "\".");
+	}
+}
+
+bc_program_t load_bc_program_file(const std::string& path){
+	const auto fd = ::open(path.c_str(), O_RDONLY);
+	if(fd == -1){
+		quark::throw_runtime_error("Cannot open bytecode file \"" + path + "\".");
+	}
+
+	struct stat info;
+	if(::fstat(fd, &info) != 0 || info.st_size == 0){
+		::close(fd);
+		quark::throw_runtime_error("Cannot read bytecode file \"" + path + "\".");
+	}
+
+	const auto size = static_cast<std::size_t>(info.st_size);
+	void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if(mapped == MAP_FAILED){
+		quark::throw_runtime_error("Cannot read bytecode file \"" + path + "\".");
+	}
+
+	try {
+		auto result = read_bc_program(static_cast<const uint8_t*>(mapped), size);
+		::munmap(mapped, size);
+		return result;
+	}
+	catch(...){
+		::munmap(mapped, size);
+		throw;
+	}
+}
+
+
+//////////////////////////////////////		TESTS
+
+
+QUARK_UNIT_TEST("bc_program_file", "read_bc_program()", "written program", "same program, runs"){
+	const auto program = compile_to_bytecode(R"(
+		struct pixel_t { int x double y }
+		let pixels = [ pixel_t(1, 2.5), pixel_t(-3, 4.0) ]
+		let d = { "a": 1, "b": 2 }
+		let j = json_value({ "hello": [ 1, 2 ] })
+
+		func int f(int a, string s){
+			mutable sum = 0
+			for(i in 0 ..< a){
+				if(i > 0){
+					sum = sum + i
+				}
+			}
+			return sum + size(s) + d["b"]
+		}
+		let r = f(3, "abc")
+	)", "");
+
+	const auto data = write_bc_program(program);
+	const auto program2 = read_bc_program(&data[0], data.size());
+	QUARK_UT_VERIFY(bcprogram_to_json(program2) == bcprogram_to_json(program));
+
+	const interpreter_t vm(program2);
+	QUARK_UT_VERIFY(find_global_symbol(vm, "r") == value_t::make_int(1 + 2 + 3 + 2));
+	QUARK_UT_VERIFY(find_global_symbol(vm, "pixels").get_vector_value().size() == 2);
+}
+
+QUARK_UNIT_TEST("bc_program_file", "read_bc_program()", "truncated or wrong version", "exception"){
+	const auto data = write_bc_program(compile_to_bytecode("let a = 1", ""));
+
+	try{
+		read_bc_program(&data[0], data.size() - 1);
+		QUARK_UT_VERIFY(false);
+	}
+	catch(const std::runtime_error& e){
+		QUARK_UT_VERIFY(std::string(e.what()) == "Bytecode file is truncated.");
+	}
+
+	auto data2 = data;
+	data2[sizeof(k_file_magic)] = data2[sizeof(k_file_magic)] + 1;
+	try{
+		read_bc_program(&data2[0], data2.size());
+		QUARK_UT_VERIFY(false);
+	}
+	catch(const std::runtime_error& e){
+		QUARK_UT_VERIFY(std::string(e.what()) == "Bytecode file has the wrong version.");
+	}
+}
+
+//	Returns the file offset of the global frame's first instruction.
+static std::size_t find_global_instructions(const std::vector<uint8_t>& data){
+	reader_t r{ &data[0], &data[0] + 20, &data[0] + data.size(), {}, {}, 0 };
+	const auto program_type_count = r.read_u32();
+	const auto body_offset = r.read_u32();
+	r._p = r._start + body_offset + program_type_count * 4;
+	r.read_u32();
+	r.align(k_instructions_alignment);
+	return static_cast<std::size_t>(r._p - r._start);
+}
+
+static std::string read_error(const std::vector<uint8_t>& data){
+	try{
+		read_bc_program(&data[0], data.size());
+		return "";
+	}
+	catch(const std::runtime_error& e){
+		return e.what();
+	}
+}
+
+QUARK_UNIT_TEST("bc_program_file", "read_bc_program()", "corrupt register or count", "exception"){
+	const auto program = compile_to_bytecode(R"(
+		func int f(int x){
+			return x + 1
+		}
+		let b = f(2)
+	)", "");
+	const auto data = write_bc_program(program);
+	const auto first = find_global_instructions(data);
+	const auto instruction_count = program._globals._instructions.size();
+	QUARK_UT_VERIFY(instruction_count > 0);
+
+	//	Point the first register operand of each instruction outside the frame.
+	int corrupted = 0;
+	for(std::size_t i = 0 ; i < instruction_count ; i++){
+		const auto pos = first + i * sizeof(bc_instruction_t);
+		bc_instruction_t instruction = program._globals._instructions[i];
+		QUARK_UT_VERIFY(std::memcmp(&data[pos], &instruction, sizeof(instruction)) == 0);
+
+		const auto reg_flags = encoding_to_reg_flags(k_opcode_info.at(instruction._opcode)._encoding);
+		int16_t& reg = reg_flags._a ? instruction._a : reg_flags._b ? instruction._b : instruction._c;
+		if(reg_flags._a || reg_flags._b || reg_flags._c){
+			reg = static_cast<int16_t>(program._globals._symbols.size());
+			auto data2 = data;
+			std::memcpy(&data2[pos], &instruction, sizeof(instruction));
+			QUARK_UT_VERIFY(read_error(data2) == "Bytecode file has a bad register.");
+			corrupted++;
+		}
+	}
+	QUARK_UT_VERIFY(corrupted > 0);
+
+	//	A huge symbol count is reported as truncation, not as an allocation failure.
+	auto data3 = data;
+	const auto symbol_count_pos = first + instruction_count * sizeof(bc_instruction_t);
+	QUARK_UT_VERIFY(data3[symbol_count_pos] == program._globals._symbols.size());
+	std::memset(&data3[symbol_count_pos], 0xff, 4);
+	QUARK_UT_VERIFY(read_error(data3) == "Bytecode file is truncated.");
+}
+
+static int count_occurrences(const std::vector<uint8_t>& data, const std::string& s){
+	const auto str = std::string(data.begin(), data.end());
+	int count = 0;
+	for(auto pos = str.find(s) ; pos != std::string::npos ; pos = str.find(s, pos + 1)){
+		count++;
+	}
+	return count;
+}
+
+QUARK_UNIT_TEST("bc_program_file", "write_bc_program()", "same constant used twice", "one constant pool entry"){
+	const auto data = write_bc_program(compile_to_bytecode("let a = \"hello, world\"\nlet b = \"hello, world\"", ""));
+	QUARK_UT_VERIFY(count_occurrences(data, "hello, world") == 1);
+}
+
+QUARK_UNIT_TEST("bc_program_file", "load_bc_program_file()", "saved program", "same program"){
+	const auto path = std::string("/tmp/floyd_bc_program_file_test") + k_bc_program_file_suffix;
+	const auto program = compile_to_bytecode("func int f(int a){ return a + 1 }\nlet r = f(41)", "");
+	save_bc_program_file(path, program);
+
+	const auto program2 = load_bc_program_file(path);
+	QUARK_UT_VERIFY(bcprogram_to_json(program2) == bcprogram_to_json(program));
+
+	const interpreter_t vm(program2);
+	QUARK_UT_VERIFY(find_global_symbol(vm, "r") == value_t::make_int(42));
+
+	DeleteDeep(path);
+}
+
+
+}	//	floyd
@@ -0,0 +1,60 @@
+//
+//  bc_program_file.h
+//  FloydSpeak
+//
+//  Created by Marcus Zetterquist on 2019-03-02.
+//  Copyright © 2019 Marcus Zetterquist. All rights reserved.
+//
+
+#ifndef bc_program_file_hpp
+#define bc_program_file_hpp
+
+/*
+	Binary file format for a complete bc_program_t, so a compiled program can be stored and loaded again without
+	parsing, analysing or generating code. Files use the ".floydbc" suffix.
+
+	Header, 32 bytes:
+		"FLOYDBC" + 0			8 bytes
+		format version			uint32
+		sizeof(bc_instruction_t)	uint32
+		byte order marker		uint32, 0x01020304 written in host order
+		program type count		uint32
+		body offset				uint32, from start of file, multiple of 8
+		reserved				uint32
+
+	...followed by the type table (compact AST JSON strings) and the constant pool (each distinct constant once,
+	with its type). Then the body: the globals frame, the function definitions, the software-system and the
+	container. Frames refer to constants and types by index.
+
+	All integers are little endian, except the instruction arrays: they are stored as raw bc_instruction_t at
+	offsets that are a multiple of 8 so a loader can use them directly from an mmap:ed file. A file is only
+	readable on a host with the same instruction size and byte order as the writer.
+*/
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace floyd {
+struct bc_program_t;
+
+
+const std::string k_bc_program_file_suffix = ".floydbc";
+
+//	Bump when the file layout changes or when the bytecode generator changes what it emits: old files can't be used.
+const uint32_t k_bc_program_file_version = 5;
+
+std::vector<uint8_t> write_bc_program(const bc_program_t& program);
+
+//	Throws std::runtime_error if the data isn't a complete file of k_bc_program_file_version.
+//	data must be 8-byte aligned.
+bc_program_t read_bc_program(const uint8_t data[], std::size_t size);
+
+void save_bc_program_file(const std::string& path, const bc_program_t& program);
+
+//	mmap:s the file and reads it. Throws std::runtime_error if it can't be opened or isn't a valid file.
+bc_program_t load_bc_program_file(const std::string& path);
+
+}	//	floyd
+
+#endif /* bc_program_file_hpp */
@@ -0,0 +1,1671 @@
+//
+//  bc_simd.cpp
+//  FloydSpeak
+//
+//  Created by Marcus Zetterquist on 2018-10-22.
+//  Copyright © 2018 Marcus Zetterquist. All rights reserved.
+//
+
+#include "bc_simd.h"
+
+#include "immer/algorithm.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+	#define FLOYD_SIMD_X86 1
+	#include <immintrin.h>
+#else
+	#define FLOYD_SIMD_X86 0
+#endif
+
+
+namespace floyd {
+
+
+
+std::string simd_level_to_string(simd_level level){
+	if(level == simd_level::k_scalar){
+		return "scalar";
+	}
+	else if(level == simd_level::k_sse2){
+		return "sse2";
+	}
+	else if(level == simd_level::k_avx2){
+		return "avx2";
+	}
+	else{
+		QUARK_ASSERT(false);
+		throw std::exception();
+	}
+}
+
+static simd_level detect_simd_level(){
+#if FLOYD_SIMD_X86
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2")){
+		return simd_level::k_avx2;
+	}
+	else if(__builtin_cpu_supports("sse2")){
+		return simd_level::k_sse2;
+	}
+	else{
+		return simd_level::k_scalar;
+	}
+#else
+	return simd_level::k_scalar;
+#endif
+}
+
+simd_level get_simd_level(){
+	static const simd_level level = detect_simd_level();
+	return level;
+}
+
+
+
+//////////////////////////////////////		SCALAR KERNELS
+
+
+
+static size_t find_bool_scalar(const bc_inplace_value_t* p, size_t count, bool wanted){
+	for(size_t i = 0 ; i < count ; i++){
+		if(p[i]._bool == wanted){
+			return i;
+		}
+	}
+	return count;
+}
+static size_t find_int_scalar(const bc_inplace_value_t* p, size_t count, int64_t wanted){
+	for(size_t i = 0 ; i < count ; i++){
+		if(p[i]._int64 == wanted){
+			return i;
+		}
+	}
+	return count;
+}
+static size_t find_double_scalar(const bc_inplace_value_t* p, size_t count, double wanted){
+	for(size_t i = 0 ; i < count ; i++){
+		if(p[i]._double == wanted){
+			return i;
+		}
+	}
+	return count;
+}
+
+static size_t mismatch_bool_scalar(const bc_inplace_value_t* a, const bc_inplace_value_t* b, size_t count){
+	for(size_t i = 0 ; i < count ; i++){
+		if(a[i]._bool != b[i]._bool){
+			return i;
+		}
+	}
+	return count;
+}
+static size_t mismatch_int_scalar(const bc_inplace_value_t* a, const bc_inplace_value_t* b, size_t count){
+	for(size_t i = 0 ; i < count ; i++){
+		if(a[i]._int64 != b[i]._int64){
+			return i;
+		}
+	}
+	return count;
+}
+static size_t mismatch_double_scalar(const bc_inplace_value_t* a, const bc_inplace_value_t* b, size_t count){
+	for(size_t i = 0 ; i < count ; i++){
+		if(a[i]._double != b[i]._double){
+			return i;
+		}
+	}
+	return count;
+}
+
+static int64_t min_int_scalar(const bc_inplace_value_t* p, size_t count){
+	QUARK_ASSERT(count > 0);
+
+	int64_t result = p[0]._int64;
+	for(size_t i = 1 ; i < count ; i++){
+		result = p[i]._int64 < result ? p[i]._int64 : result;
+	}
+	return result;
+}
+static int64_t max_int_scalar(const bc_inplace_value_t* p, size_t count){
+	QUARK_ASSERT(count > 0);
+
+	int64_t result = p[0]._int64;
+	for(size_t i = 1 ; i < count ; i++){
+		result = p[i]._int64 > result ? p[i]._int64 : result;
+	}
+	return result;
+}
+static double min_double_scalar(const bc_inplace_value_t* p, size_t count){
+	QUARK_ASSERT(count > 0);
+
+	double result = p[0]._double;
+	for(size_t i = 1 ; i < count ; i++){
+		result = result < p[i]._double ? result : p[i]._double;
+	}
+	return result;
+}
+static double max_double_scalar(const bc_inplace_value_t* p, size_t count){
+	QUARK_ASSERT(count > 0);
+
+	double result = p[0]._double;
+	for(size_t i = 1 ; i < count ; i++){
+		result = result > p[i]._double ? result : p[i]._double;
+	}
+	return result;
+}
+
+
+//	Floyd ints wrap around on overflow, do the math unsigned to get that without undefined behaviour.
+static inline int64_t wrap_add(int64_t a, int64_t b){
+	return static_cast<int64_t>(static_cast<uint64_t>(a) + static_cast<uint64_t>(b));
+}
+static inline int64_t wrap_sub(int64_t a, int64_t b){
+	return static_cast<int64_t>(static_cast<uint64_t>(a) - static_cast<uint64_t>(b));
+}
+static inline int64_t wrap_mul(int64_t a, int64_t b){
+	return static_cast<int64_t>(static_cast<uint64_t>(a) * static_cast<uint64_t>(b));
+}
+
+static void add_int_scalar(const bc_inplace_value_t* a, const bc_inplace_value_t* b, bc_inplace_value_t* out, size_t count){
+	for(size_t i = 0 ; i < count ; i++){
+		out[i]._int64 = wrap_add(a[i]._int64, b[i]._int64);
+	}
+}
+static void sub_int_scalar(const bc_inplace_value_t* a, const bc_inplace_value_t* b, bc_inplace_value_t* out, size_t count){
+	for(size_t i = 0 ; i < count ; i++){
+		out[i]._int64 = wrap_sub(a[i]._int64, b[i]._int64);
+	}
+}
+static void mul_int_scalar(const bc_inplace_value_t* a, const bc_inplace_value_t* b, bc_inplace_value_t* out, size_t count){
+	for(size_t i = 0 ; i < count ; i++){
+		out[i]._int64 = wrap_mul(a[i]._int64, b[i]._int64);
+	}
+}
+static void add_double_scalar(const bc_inplace_value_t* a, const bc_inplace_value_t* b, bc_inplace_value_t* out, size_t count){
+	for(size_t i = 0 ; i < count ; i++){
+		out[i]._double = a[i]._double + b[i]._double;
+	}
+}
+static void sub_double_scalar(const bc_inplace_value_t* a, const bc_inplace_value_t* b, bc_inplace_value_t* out, size_t count){
+	for(size_t i = 0 ; i < count ; i++){
+		out[i]._double = a[i]._double - b[i]._double;
+	}
+}
+static void mul_double_scalar(const bc_inplace_value_t* a, const bc_inplace_value_t* b, bc_inplace_value_t* out, size_t count){
+	for(size_t i = 0 ; i < count ; i++){
+		out[i]._double = a[i]._double * b[i]._double;
+	}
+}
+
+static void scale_int_scalar(const bc_inplace_value_t* a, int64_t k, bc_inplace_value_t* out, size_t count){
+	for(size_t i = 0 ; i < count ; i++){
+		out[i]._int64 = wrap_mul(a[i]._int64, k);
+	}
+}
+static void scale_double_scalar(const bc_inplace_value_t* a, double k, bc_inplace_value_t* out, size_t count){
+	for(size_t i = 0 ; i < count ; i++){
+		out[i]._double = a[i]._double * k;
+	}
+}
+
+static int64_t sum_int_scalar(const bc_inplace_value_t* p, size_t count){
+	int64_t result = 0;
+	for(size_t i = 0 ; i < count ; i++){
+		result = wrap_add(result, p[i]._int64);
+	}
+	return result;
+}
+static double sum_double_scalar(const bc_inplace_value_t* p, size_t count){
+	double result = 0.0;
+	for(size_t i = 0 ; i < count ; i++){
+		result = result + p[i]._double;
+	}
+	return result;
+}
+
+static int64_t dot_int_scalar(const bc_inplace_value_t* a, const bc_inplace_value_t* b, size_t count){
+	int64_t result = 0;
+	for(size_t i = 0 ; i < count ; i++){
+		result = wrap_add(result, wrap_mul(a[i]._int64, b[i]._int64));
+	}
+	return result;
+}
+static double dot_double_scalar(const bc_inplace_value_t* a, const bc_inplace_value_t* b, size_t count){
+	double result = 0.0;
+	for(size_t i = 0 ; i < count ; i++){
+		result = result + a[i]._double * b[i]._double;
+	}
+	return result;
+}
+
+static int64_t prefix_sum_int_scalar(const bc_inplace_value_t* p, int64_t carry, bc_inplace_value_t* out, size_t count){
+	int64_t acc = carry;
+	for(size_t i = 0 ; i < count ; i++){
+		acc = wrap_add(acc, p[i]._int64);
+		out[i]._int64 = acc;
+	}
+	return acc;
+}
+static double prefix_sum_double_scalar(const bc_inplace_value_t* p, double carry, bc_inplace_value_t* out, size_t count){
+	double acc = carry;
+	for(size_t i = 0 ; i < count ; i++){
+		acc = acc + p[i]._double;
+		out[i]._double = acc;
+	}
+	return acc;
+}
+
+static const bc_simd_kernels_t k_scalar_kernels = {
+	find_bool_scalar,
+	find_int_scalar,
+	find_double_scalar,
+	mismatch_bool_scalar,
+	mismatch_int_scalar,
+	mismatch_double_scalar,
+	min_int_scalar,
+	max_int_scalar,
+	min_double_scalar,
+	max_double_scalar,
+	add_int_scalar,
+	sub_int_scalar,
+	mul_int_scalar,
+	add_double_scalar,
+	sub_double_scalar,
+	mul_double_scalar,
+	scale_int_scalar,
+	scale_double_scalar,
+	sum_int_scalar,
+	sum_double_scalar,
+	dot_int_scalar,
+	dot_double_scalar,
+	prefix_sum_int_scalar,
+	prefix_sum_double_scalar
+};
+
+
+
+#if FLOYD_SIMD_X86
+
+//	The kernels are compiled with target attributes so we don't need -mavx2 for the whole program.
+//	Each 64-bit lane holds one bc_inplace_value_t. A bool only uses the lowest byte of its lane, the other bytes
+//	are undefined so they are masked away.
+
+
+//////////////////////////////////////		SSE2 KERNELS
+
+
+//	SSE2 has no 64-bit compare: compare 32-bit halves and AND each half with its neighbour.
+__attribute__((target("sse2")))
+static inline int movemask_eq64_sse2(__m128i a, __m128i b){
+	const __m128i eq32 = _mm_cmpeq_epi32(a, b);
+	const __m128i eq64 = _mm_and_si128(eq32, _mm_shuffle_epi32(eq32, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_movemask_pd(_mm_castsi128_pd(eq64));
+}
+
+__attribute__((target("sse2")))
+static size_t find_bool_sse2(const bc_inplace_value_t* p, size_t count, bool wanted){
+	const __m128i byte_mask = _mm_set1_epi64x(0xff);
+	const __m128i w = _mm_set1_epi64x(wanted ? 1 : 0);
+	size_t i = 0;
+	for(; i + 2 <= count ; i += 2){
+		const __m128i v = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)), byte_mask);
+		const int mask = movemask_eq64_sse2(v, w);
+		if(mask != 0){
+			return i + __builtin_ctz(mask);
+		}
+	}
+	return i + find_bool_scalar(p + i, count - i, wanted);
+}
+
+__attribute__((target("sse2")))
+static size_t find_int_sse2(const bc_inplace_value_t* p, size_t count, int64_t wanted){
+	const __m128i w = _mm_set1_epi64x(wanted);
+	size_t i = 0;
+	for(; i + 4 <= count ; i += 4){
+		const __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i + 0));
+		const __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i + 2));
+		const int mask = movemask_eq64_sse2(v0, w) | (movemask_eq64_sse2(v1, w) << 2);
+		if(mask != 0){
+			return i + __builtin_ctz(mask);
+		}
+	}
+	return i + find_int_scalar(p + i, count - i, wanted);
+}
+
+__attribute__((target("sse2")))
+static size_t find_double_sse2(const bc_inplace_value_t* p, size_t count, double wanted){
+	const __m128d w = _mm_set1_pd(wanted);
+	size_t i = 0;
+	for(; i + 4 <= count ; i += 4){
+		const __m128d v0 = _mm_loadu_pd(reinterpret_cast<const double*>(p + i + 0));
+		const __m128d v1 = _mm_loadu_pd(reinterpret_cast<const double*>(p + i + 2));
+		const int mask = _mm_movemask_pd(_mm_cmpeq_pd(v0, w)) | (_mm_movemask_pd(_mm_cmpeq_pd(v1, w)) << 2);
+		if(mask != 0){
+			return i + __builtin_ctz(mask);
+		}
+	}
+	return i + find_double_scalar(p + i, count - i, wanted);
+}
+
+__attribute__((target("sse2")))
+static size_t mismatch_bool_sse2(const bc_inplace_value_t* a, const bc_inplace_value_t* b, size_t count){
+	const __m128i byte_mask = _mm_set1_epi64x(0xff);
+	size_t i = 0;
+	for(; i + 2 <= count ; i += 2){
+		const __m128i va = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)), byte_mask);
+		const __m128i vb = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)), byte_mask);
+		const int mask = movemask_eq64_sse2(va, vb) ^ 0x3;
+		if(mask != 0){
+			return i + __builtin_ctz(mask);
+		}
+	}
+	return i + mismatch_bool_scalar(a + i, b + i, count - i);
+}
+
+__attribute__((target("sse2")))
+static size_t mismatch_int_sse2(const bc_inplace_value_t* a, const bc_inplace_value_t* b, size_t count){
+	size_t i = 0;
+	for(; i + 2 <= count ; i += 2){
+		const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+		const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+		const int mask = movemask_eq64_sse2(va, vb) ^ 0x3;
+		if(mask != 0){
+			return i + __builtin_ctz(mask);
+		}
+	}
+	return i + mismatch_int_scalar(a + i, b + i, count - i);
+}
+
+__attribute__((target("sse2")))
+static size_t mismatch_double_sse2(const bc_inplace_value_t* a, const bc_inplace_value_t* b, size_t count){
+	size_t i = 0;
+	for(; i + 2 <= count ; i += 2){
+		const __m128d va = _mm_loadu_pd(reinterpret_cast<const double*>(a + i));
+		const __m128d vb = _mm_loadu_pd(reinterpret_cast<const double*>(b + i));
+		const int mask = _mm_movemask_pd(_mm_cmpeq_pd(va, vb)) ^ 0x3;
+		if(mask != 0){
+			return i + __builtin_ctz(mask);
+		}
+	}
+	return i + mismatch_double_scalar(a + i, b + i, count - i);
+}
+
+__attribute__((target("sse2")))
+static double min_double_sse2(const bc_inplace_value_t* p, size_t count){
+	QUARK_ASSERT(count > 0);
+	if(count < 2){
+		return min_double_scalar(p, count);
+	}
+
+	__m128d acc = _mm_loadu_pd(reinterpret_cast<const double*>(p));
+	size_t i = 2;
+	for(; i + 2 <= count ; i += 2){
+		acc = _mm_min_pd(acc, _mm_loadu_pd(reinterpret_cast<const double*>(p + i)));
+	}
+	double lanes[2];
+	_mm_storeu_pd(lanes, acc);
+	double result = lanes[0] < lanes[1] ? lanes[0] : lanes[1];
+	for(; i < count ; i++){
+		result = result < p[i]._double ? result : p[i]._double;
+	}
+	return result;
+}
+
+__attribute__((target("sse2")))
+static double max_double_sse2(const bc_inplace_value_t* p, size_t count){
+	QUARK_ASSERT(count > 0);
+	if(count < 2){
+		return max_double_scalar(p, count);
+	}
+
+	__m128d acc = _mm_loadu_pd(reinterpret_cast<const double*>(p));
+	size_t i = 2;
+	for(; i + 2 <= count ; i += 2){
+		acc = _mm_max_pd(acc, _mm_loadu_pd(reinterpret_cast<const double*>(p + i)));
+	}
+	double lanes[2];
+	_mm_storeu_pd(lanes, acc);
+	double result = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+	for(; i < count ; i++){
+		result = result > p[i]._double ? result : p[i]._double;
+	}
+	return result;
+}
+
+//	Low 64 bits of a 64 x 64 bit multiply, built from 32 x 32 -> 64 bit multiplies.
+__attribute__((target("sse2")))
+static inline __m128i mullo_epi64_sse2(__m128i a, __m128i b){
+	const __m128i a_hi = _mm_srli_epi64(a, 32);
+	const __m128i b_hi = _mm_srli_epi64(b, 32);
+	const __m128i lo = _mm_mul_epu32(a, b);
+	const __m128i cross = _mm_add_epi64(_mm_mul_epu32(a_hi, b), _mm_mul_epu32(a, b_hi));
+	return _mm_add_epi64(lo, _mm_slli_epi64(cross, 32));
+}
+
+__attribute__((target("sse2")))
+static void add_int_sse2(const bc_inplace_value_t* a, const bc_inplace_value_t* b, bc_inplace_value_t* out, size_t count){
+	size_t i = 0;
+	for(; i + 2 <= count ; i += 2){
+		const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+		const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_add_epi64(va, vb));
+	}
+	add_int_scalar(a + i, b + i, out + i, count - i);
+}
+__attribute__((target("sse2")))
+static void sub_int_sse2(const bc_inplace_value_t* a, const bc_inplace_value_t* b, bc_inplace_value_t* out, size_t count){
+	size_t i = 0;
+	for(; i + 2 <= count ; i += 2){
+		const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+		const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_sub_epi64(va, vb));
+	}
+	sub_int_scalar(a + i, b + i, out + i, count - i);
+}
+__attribute__((target("sse2")))
+static void mul_int_sse2(const bc_inplace_value_t* a, const bc_inplace_value_t* b, bc_inplace_value_t* out, size_t count){
+	size_t i = 0;
+	for(; i + 2 <= count ; i += 2){
+		const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+		const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), mullo_epi64_sse2(va, vb));
+	}
+	mul_int_scalar(a + i, b + i, out + i, count - i);
+}
+__attribute__((target("sse2")))
+static void add_double_sse2(const bc_inplace_value_t* a, const bc_inplace_value_t* b, bc_inplace_value_t* out, size_t count){
+	size_t i = 0;
+	for(; i + 2 <= count ; i += 2){
+		const __m128d va = _mm_loadu_pd(reinterpret_cast<const double*>(a + i));
+		const __m128d vb = _mm_loadu_pd(reinterpret_cast<const double*>(b + i));
+		_mm_storeu_pd(reinterpret_cast<double*>(out + i), _mm_add_pd(va, vb));
+	}
+	add_double_scalar(a + i, b + i, out + i, count - i);
+}
+__attribute__((target("sse2")))
+static void sub_double_sse2(const bc_inplace_value_t* a, const bc_inplace_value_t* b, bc_inplace_value_t* out, size_t count){
+	size_t i = 0;
+	for(; i + 2 <= count ; i += 2){
+		const __m128d va = _mm_loadu_pd(reinterpret_cast<const double*>(a + i));
+		const __m128d vb = _mm_loadu_pd(reinterpret_cast<const double*>(b + i));
+		_mm_storeu_pd(reinterpret_cast<double*>(out + i), _mm_sub_pd(va, vb));
+	}
+	sub_double_scalar(a + i, b + i, out + i, count - i);
+}
+__attribute__((target("sse2")))
+static void mul_double_sse2(const bc_inplace_value_t* a, const bc_inplace_value_t* b, bc_inplace_value_t* out, size_t count){
+	size_t i = 0;
+	for(; i + 2 <= count ; i += 2){
+		const __m128d va = _mm_loadu_pd(reinterpret_cast<const double*>(a + i));
+		const __m128d vb = _mm_loadu_pd(reinterpret_cast<const double*>(b + i));
+		_mm_storeu_pd(reinterpret_cast<double*>(out + i), _mm_mul_pd(va, vb));
+	}
+	mul_double_scalar(a + i, b + i, out + i, count - i);
+}
+
+__attribute__((target("sse2")))
+static void scale_int_sse2(const bc_inplace_value_t* a, int64_t k, bc_inplace_value_t* out, size_t count){
+	const __m128i vk = _mm_set1_epi64x(k);
+	size_t i = 0;
+	for(; i + 2 <= count ; i += 2){
+		const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), mullo_epi64_sse2(va, vk));
+	}
+	scale_int_scalar(a + i, k, out + i, count - i);
+}
+__attribute__((target("sse2")))
+static void scale_double_sse2(const bc_inplace_value_t* a, double k, bc_inplace_value_t* out, size_t count){
+	const __m128d vk = _mm_set1_pd(k);
+	size_t i = 0;
+	for(; i + 2 <= count ; i += 2){
+		const __m128d va = _mm_loadu_pd(reinterpret_cast<const double*>(a + i));
+		_mm_storeu_pd(reinterpret_cast<double*>(out + i), _mm_mul_pd(va, vk));
+	}
+	scale_double_scalar(a + i, k, out + i, count - i);
+}
+
+__attribute__((target("sse2")))
+static int64_t sum_int_sse2(const bc_inplace_value_t* p, size_t count){
+	__m128i acc = _mm_setzero_si128();
+	size_t i = 0;
+	for(; i + 2 <= count ; i += 2){
+		acc = _mm_add_epi64(acc, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)));
+	}
+	int64_t lanes[2];
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+	return wrap_add(wrap_add(lanes[0], lanes[1]), sum_int_scalar(p + i, count - i));
+}
+__attribute__((target("sse2")))
+static double sum_double_sse2(const bc_inplace_value_t* p, size_t count){
+	__m128d acc = _mm_setzero_pd();
+	size_t i = 0;
+	for(; i + 2 <= count ; i += 2){
+		acc = _mm_add_pd(acc, _mm_loadu_pd(reinterpret_cast<const double*>(p + i)));
+	}
+	double lanes[2];
+	_mm_storeu_pd(lanes, acc);
+	return (lanes[0] + lanes[1]) + sum_double_scalar(p + i, count - i);
+}
+
+__attribute__((target("sse2")))
+static int64_t dot_int_sse2(const bc_inplace_value_t* a, const bc_inplace_value_t* b, size_t count){
+	__m128i acc = _mm_setzero_si128();
+	size_t i = 0;
+	for(; i + 2 <= count ; i += 2){
+		const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+		const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+		acc = _mm_add_epi64(acc, mullo_epi64_sse2(va, vb));
+	}
+	int64_t lanes[2];
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+	return wrap_add(wrap_add(lanes[0], lanes[1]), dot_int_scalar(a + i, b + i, count - i));
+}
+__attribute__((target("sse2")))
+static double dot_double_sse2(const bc_inplace_value_t* a, const bc_inplace_value_t* b, size_t count){
+	__m128d acc = _mm_setzero_pd();
+	size_t i = 0;
+	for(; i + 2 <= count ; i += 2){
+		const __m128d va = _mm_loadu_pd(reinterpret_cast<const double*>(a + i));
+		const __m128d vb = _mm_loadu_pd(reinterpret_cast<const double*>(b + i));
+		acc = _mm_add_pd(acc, _mm_mul_pd(va, vb));
+	}
+	double lanes[2];
+	_mm_storeu_pd(lanes, acc);
+	return (lanes[0] + lanes[1]) + dot_double_scalar(a + i, b + i, count - i);
+}
+
+//	SSE2 has no 64-bit integer compare so min / max of ints use the scalar kernels.
+//	Prefix sums are a serial dependency chain, SSE2 is too narrow to win anything.
+static const bc_simd_kernels_t k_sse2_kernels = {
+	find_bool_sse2,
+	find_int_sse2,
+	find_double_sse2,
+	mismatch_bool_sse2,
+	mismatch_int_sse2,
+	mismatch_double_sse2,
+	min_int_scalar,
+	max_int_scalar,
+	min_double_sse2,
+	max_double_sse2,
+	add_int_sse2,
+	sub_int_sse2,
+	mul_int_sse2,
+	add_double_sse2,
+	sub_double_sse2,
+	mul_double_sse2,
+	scale_int_sse2,
+	scale_double_sse2,
+	sum_int_sse2,
+	sum_double_sse2,
+	dot_int_sse2,
+	dot_double_sse2,
+	prefix_sum_int_scalar,
+	prefix_sum_double_scalar
+};
+
+
+
+//////////////////////////////////////		AVX2 KERNELS
+
+
+
+__attribute__((target("avx2")))
+static size_t find_bool_avx2(const bc_inplace_value_t* p, size_t count, bool wanted){
+	const __m256i byte_mask = _mm256_set1_epi64x(0xff);
+	const __m256i w = _mm256_set1_epi64x(wanted ? 1 : 0);
+	size_t i = 0;
+	for(; i + 4 <= count ; i += 4){
+		const __m256i v = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)), byte_mask);
+		const int mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v, w)));
+		if(mask != 0){
+			return i + __builtin_ctz(mask);
+		}
+	}
+	return i + find_bool_scalar(p + i, count - i, wanted);
+}
+
+__attribute__((target("avx2")))
+static size_t find_int_avx2(const bc_inplace_value_t* p, size_t count, int64_t wanted){
+	const __m256i w = _mm256_set1_epi64x(wanted);
+	size_t i = 0;
+	for(; i + 8 <= count ; i += 8){
+		const __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i + 0));
+		const __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i + 4));
+		const int mask0 = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v0, w)));
+		const int mask1 = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v1, w)));
+		const int mask = mask0 | (mask1 << 4);
+		if(mask != 0){
+			return i + __builtin_ctz(mask);
+		}
+	}
+	return i + find_int_scalar(p + i, count - i, wanted);
+}
+
+__attribute__((target("avx2")))
+static size_t find_double_avx2(const bc_inplace_value_t* p, size_t count, double wanted){
+	const __m256d w = _mm256_set1_pd(wanted);
+	size_t i = 0;
+	for(; i + 8 <= count ; i += 8){
+		const __m256d v0 = _mm256_loadu_pd(reinterpret_cast<const double*>(p + i + 0));
+		const __m256d v1 = _mm256_loadu_pd(reinterpret_cast<const double*>(p + i + 4));
+		const int mask0 = _mm256_movemask_pd(_mm256_cmp_pd(v0, w, _CMP_EQ_OQ));
+		const int mask1 = _mm256_movemask_pd(_mm256_cmp_pd(v1, w, _CMP_EQ_OQ));
+		const int mask = mask0 | (mask1 << 4);
+		if(mask != 0){
+			return i + __builtin_ctz(mask);
+		}
+	}
+	return i + find_double_scalar(p + i, count - i, wanted);
+}
+
+__attribute__((target("avx2")))
+static size_t mismatch_bool_avx2(const bc_inplace_value_t* a, const bc_inplace_value_t* b, size_t count){
+	const __m256i byte_mask = _mm256_set1_epi64x(0xff);
+	size_t i = 0;
+	for(; i + 4 <= count ; i += 4){
+		const __m256i va = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)), byte_mask);
+		const __m256i vb = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)), byte_mask);
+		const int mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(va, vb))) ^ 0xf;
+		if(mask != 0){
+			return i + __builtin_ctz(mask);
+		}
+	}
+	return i + mismatch_bool_scalar(a + i, b + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static size_t mismatch_int_avx2(const bc_inplace_value_t* a, const bc_inplace_value_t* b, size_t count){
+	size_t i = 0;
+	for(; i + 4 <= count ; i += 4){
+		const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+		const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+		const int mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(va, vb))) ^ 0xf;
+		if(mask != 0){
+			return i + __builtin_ctz(mask);
+		}
+	}
+	return i + mismatch_int_scalar(a + i, b + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static size_t mismatch_double_avx2(const bc_inplace_value_t* a, const bc_inplace_value_t* b, size_t count){
+	size_t i = 0;
+	for(; i + 4 <= count ; i += 4){
+		const __m256d va = _mm256_loadu_pd(reinterpret_cast<const double*>(a + i));
+		const __m256d vb = _mm256_loadu_pd(reinterpret_cast<const double*>(b + i));
+		const int mask = _mm256_movemask_pd(_mm256_cmp_pd(va, vb, _CMP_EQ_OQ)) ^ 0xf;
+		if(mask != 0){
+			return i + __builtin_ctz(mask);
+		}
+	}
+	return i + mismatch_double_scalar(a + i, b + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static int64_t min_int_avx2(const bc_inplace_value_t* p, size_t count){
+	QUARK_ASSERT(count > 0);
+	if(count < 4){
+		return min_int_scalar(p, count);
+	}
+
+	__m256i acc = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+	size_t i = 4;
+	for(; i + 4 <= count ; i += 4){
+		const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+		acc = _mm256_blendv_epi8(acc, v, _mm256_cmpgt_epi64(acc, v));
+	}
+	int64_t lanes[4];
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc);
+	int64_t result = std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3]));
+	for(; i < count ; i++){
+		result = p[i]._int64 < result ? p[i]._int64 : result;
+	}
+	return result;
+}
+
+__attribute__((target("avx2")))
+static int64_t max_int_avx2(const bc_inplace_value_t* p, size_t count){
+	QUARK_ASSERT(count > 0);
+	if(count < 4){
+		return max_int_scalar(p, count);
+	}
+
+	__m256i acc = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+	size_t i = 4;
+	for(; i + 4 <= count ; i += 4){
+		const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+		acc = _mm256_blendv_epi8(acc, v, _mm256_cmpgt_epi64(v, acc));
+	}
+	int64_t lanes[4];
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc);
+	int64_t result = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+	for(; i < count ; i++){
+		result = p[i]._int64 > result ? p[i]._int64 : result;
+	}
+	return result;
+}
+
+__attribute__((target("avx2")))
+static double min_double_avx2(const bc_inplace_value_t* p, size_t count){
+	QUARK_ASSERT(count > 0);
+	if(count < 4){
+		return min_double_scalar(p, count);
+	}
+
+	__m256d acc = _mm256_loadu_pd(reinterpret_cast<const double*>(p));
+	size_t i = 4;
+	for(; i + 4 <= count ; i += 4){
+		acc = _mm256_min_pd(acc, _mm256_loadu_pd(reinterpret_cast<const double*>(p + i)));
+	}
+	double lanes[4];
+	_mm256_storeu_pd(lanes, acc);
+	double result = lanes[0];
+	for(int lane = 1 ; lane < 4 ; lane++){
+		result = result < lanes[lane] ? result : lanes[lane];
+	}
+	for(; i < count ; i++){
+		result = result < p[i]._double ? result : p[i]._double;
+	}
+	return result;
+}
+
+__attribute__((target("avx2")))
+static double max_double_avx2(const bc_inplace_value_t* p, size_t count){
+	QUARK_ASSERT(count > 0);
+	if(count < 4){
+		return max_double_scalar(p, count);
+	}
+
+	__m256d acc = _mm256_loadu_pd(reinterpret_cast<const double*>(p));
+	size_t i = 4;
+	for(; i + 4 <= count ; i += 4){
+		acc = _mm256_max_pd(acc, _mm256_loadu_pd(reinterpret_cast<const double*>(p + i)));
+	}
+	double lanes[4];
+	_mm256_storeu_pd(lanes, acc);
+	double result = lanes[0];
+	for(int lane = 1 ; lane < 4 ; lane++){
+		result = result > lanes[lane] ? result : lanes[lane];
+	}
+	for(; i < count ; i++){
+		result = result > p[i]._double ? result : p[i]._double;
+	}
+	return result;
+}
+
+__attribute__((target("avx2")))
+static inline __m256i mullo_epi64_avx2(__m256i a, __m256i b){
+	const __m256i a_hi = _mm256_srli_epi64(a, 32);
+	const __m256i b_hi = _mm256_srli_epi64(b, 32);
+	const __m256i lo = _mm256_mul_epu32(a, b);
+	const __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(a_hi, b), _mm256_mul_epu32(a, b_hi));
+	return _mm256_add_epi64(lo, _mm256_slli_epi64(cross, 32));
+}
+
+__attribute__((target("avx2")))
+static void add_int_avx2(const bc_inplace_value_t* a, const bc_inplace_value_t* b, bc_inplace_value_t* out, size_t count){
+	size_t i = 0;
+	for(; i + 4 <= count ; i += 4){
+		const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+		const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_add_epi64(va, vb));
+	}
+	add_int_scalar(a + i, b + i, out + i, count - i);
+}
+__attribute__((target("avx2")))
+static void sub_int_avx2(const bc_inplace_value_t* a, const bc_inplace_value_t* b, bc_inplace_value_t* out, size_t count){
+	size_t i = 0;
+	for(; i + 4 <= count ; i += 4){
+		const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+		const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_sub_epi64(va, vb));
+	}
+	sub_int_scalar(a + i, b + i, out + i, count - i);
+}
+__attribute__((target("avx2")))
+static void mul_int_avx2(const bc_inplace_value_t* a, const bc_inplace_value_t* b, bc_inplace_value_t* out, size_t count){
+	size_t i = 0;
+	for(; i + 4 <= count ; i += 4){
+		const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+		const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), mullo_epi64_avx2(va, vb));
+	}
+	mul_int_scalar(a + i, b + i, out + i, count - i);
+}
+__attribute__((target("avx2")))
+static void add_double_avx2(const bc_inplace_value_t* a, const bc_inplace_value_t* b, bc_inplace_value_t* out, size_t count){
+	size_t i = 0;
+	for(; i + 4 <= count ; i += 4){
+		const __m256d va = _mm256_loadu_pd(reinterpret_cast<const double*>(a + i));
+		const __m256d vb = _mm256_loadu_pd(reinterpret_cast<const double*>(b + i));
+		_mm256_storeu_pd(reinterpret_cast<double*>(out + i), _mm256_add_pd(va, vb));
+	}
+	add_double_scalar(a + i, b + i, out + i, count - i);
+}
+__attribute__((target("avx2")))
+static void sub_double_avx2(const bc_inplace_value_t* a, const bc_inplace_value_t* b, bc_inplace_value_t* out, size_t count){
+	size_t i = 0;
+	for(; i + 4 <= count ; i += 4){
+		const __m256d va = _mm256_loadu_pd(reinterpret_cast<const double*>(a + i));
+		const __m256d vb = _mm256_loadu_pd(reinterpret_cast<const double*>(b + i));
+		_mm256_storeu_pd(reinterpret_cast<double*>(out + i), _mm256_sub_pd(va, vb));
+	}
+	sub_double_scalar(a + i, b + i, out + i, count - i);
+}
+__attribute__((target("avx2")))
+static void mul_double_avx2(const bc_inplace_value_t* a, const bc_inplace_value_t* b, bc_inplace_value_t* out, size_t count){
+	size_t i = 0;
+	for(; i + 4 <= count ; i += 4){
+		const __m256d va = _mm256_loadu_pd(reinterpret_cast<const double*>(a + i));
+		const __m256d vb = _mm256_loadu_pd(reinterpret_cast<const double*>(b + i));
+		_mm256_storeu_pd(reinterpret_cast<double*>(out + i), _mm256_mul_pd(va, vb));
+	}
+	mul_double_scalar(a + i, b + i, out + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void scale_int_avx2(const bc_inplace_value_t* a, int64_t k, bc_inplace_value_t* out, size_t count){
+	const __m256i vk = _mm256_set1_epi64x(k);
+	size_t i = 0;
+	for(; i + 4 <= count ; i += 4){
+		const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), mullo_epi64_avx2(va, vk));
+	}
+	scale_int_scalar(a + i, k, out + i, count - i);
+}
+__attribute__((target("avx2")))
+static void scale_double_avx2(const bc_inplace_value_t* a, double k, bc_inplace_value_t* out, size_t count){
+	const __m256d vk = _mm256_set1_pd(k);
+	size_t i = 0;
+	for(; i + 4 <= count ; i += 4){
+		const __m256d va = _mm256_loadu_pd(reinterpret_cast<const double*>(a + i));
+		_mm256_storeu_pd(reinterpret_cast<double*>(out + i), _mm256_mul_pd(va, vk));
+	}
+	scale_double_scalar(a + i, k, out + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static int64_t sum_int_avx2(const bc_inplace_value_t* p, size_t count){
+	__m256i acc = _mm256_setzero_si256();
+	size_t i = 0;
+	for(; i + 4 <= count ; i += 4){
+		acc = _mm256_add_epi64(acc, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)));
+	}
+	int64_t lanes[4];
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc);
+	const int64_t lane_sum = wrap_add(wrap_add(lanes[0], lanes[1]), wrap_add(lanes[2], lanes[3]));
+	return wrap_add(lane_sum, sum_int_scalar(p + i, count - i));
+}
+__attribute__((target("avx2")))
+static double sum_double_avx2(const bc_inplace_value_t* p, size_t count){
+	__m256d acc = _mm256_setzero_pd();
+	size_t i = 0;
+	for(; i + 4 <= count ; i += 4){
+		acc = _mm256_add_pd(acc, _mm256_loadu_pd(reinterpret_cast<const double*>(p + i)));
+	}
+	double lanes[4];
+	_mm256_storeu_pd(lanes, acc);
+	return ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + sum_double_scalar(p + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static int64_t dot_int_avx2(const bc_inplace_value_t* a, const bc_inplace_value_t* b, size_t count){
+	__m256i acc = _mm256_setzero_si256();
+	size_t i = 0;
+	for(; i + 4 <= count ; i += 4){
+		const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+		const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+		acc = _mm256_add_epi64(acc, mullo_epi64_avx2(va, vb));
+	}
+	int64_t lanes[4];
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc);
+	const int64_t lane_sum = wrap_add(wrap_add(lanes[0], lanes[1]), wrap_add(lanes[2], lanes[3]));
+	return wrap_add(lane_sum, dot_int_scalar(a + i, b + i, count - i));
+}
+__attribute__((target("avx2")))
+static double dot_double_avx2(const bc_inplace_value_t* a, const bc_inplace_value_t* b, size_t count){
+	__m256d acc = _mm256_setzero_pd();
+	size_t i = 0;
+	for(; i + 4 <= count ; i += 4){
+		const __m256d va = _mm256_loadu_pd(reinterpret_cast<const double*>(a + i));
+		const __m256d vb = _mm256_loadu_pd(reinterpret_cast<const double*>(b + i));
+		acc = _mm256_add_pd(acc, _mm256_mul_pd(va, vb));
+	}
+	double lanes[4];
+	_mm256_storeu_pd(lanes, acc);
+	return ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + dot_double_scalar(a + i, b + i, count - i);
+}
+
+//	In-register scan of 4 lanes: add the vector shifted up 1 lane, then the result shifted up 2 lanes.
+__attribute__((target("avx2")))
+static int64_t prefix_sum_int_avx2(const bc_inplace_value_t* p, int64_t carry, bc_inplace_value_t* out, size_t count){
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i acc = _mm256_set1_epi64x(carry);
+	size_t i = 0;
+	for(; i + 4 <= count ; i += 4){
+		const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+		const __m256i x1 = _mm256_add_epi64(x, _mm256_blend_epi32(_mm256_permute4x64_epi64(x, _MM_SHUFFLE(2, 1, 0, 0)), zero, 0x03));
+		const __m256i x2 = _mm256_add_epi64(x1, _mm256_permute2x128_si256(x1, x1, 0x08));
+		const __m256i r = _mm256_add_epi64(x2, acc);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), r);
+		acc = _mm256_permute4x64_epi64(r, _MM_SHUFFLE(3, 3, 3, 3));
+	}
+	return prefix_sum_int_scalar(p + i, i == 0 ? carry : out[i - 1]._int64, out + i, count - i);
+}
+__attribute__((target("avx2")))
+static double prefix_sum_double_avx2(const bc_inplace_value_t* p, double carry, bc_inplace_value_t* out, size_t count){
+	const __m256d zero = _mm256_setzero_pd();
+	__m256d acc = _mm256_set1_pd(carry);
+	size_t i = 0;
+	for(; i + 4 <= count ; i += 4){
+		const __m256d x = _mm256_loadu_pd(reinterpret_cast<const double*>(p + i));
+		const __m256d x1 = _mm256_add_pd(x, _mm256_blend_pd(_mm256_permute4x64_pd(x, _MM_SHUFFLE(2, 1, 0, 0)), zero, 0x01));
+		const __m256d x2 = _mm256_add_pd(x1, _mm256_permute2f128_pd(x1, x1, 0x08));
+		const __m256d r = _mm256_add_pd(x2, acc);
+		_mm256_storeu_pd(reinterpret_cast<double*>(out + i), r);
+		acc = _mm256_permute4x64_pd(r, _MM_SHUFFLE(3, 3, 3, 3));
+	}
+	return prefix_sum_double_scalar(p + i, i == 0 ? carry : out[i - 1]._double, out + i, count - i);
+}
+
+static const bc_simd_kernels_t k_avx2_kernels = {
+	find_bool_avx2,
+	find_int_avx2,
+	find_double_avx2,
+	mismatch_bool_avx2,
+	mismatch_int_avx2,
+	mismatch_double_avx2,
+	min_int_avx2,
+	max_int_avx2,
+	min_double_avx2,
+	max_double_avx2,
+	add_int_avx2,
+	sub_int_avx2,
+	mul_int_avx2,
+	add_double_avx2,
+	sub_double_avx2,
+	mul_double_avx2,
+	scale_int_avx2,
+	scale_double_avx2,
+	sum_int_avx2,
+	sum_double_avx2,
+	dot_int_avx2,
+	dot_double_avx2,
+	prefix_sum_int_avx2,
+	prefix_sum_double_avx2
+};
+
+#endif
+
+
+
+const bc_simd_kernels_t& get_simd_kernels(simd_level level){
+	const auto best = get_simd_level();
+
+#if FLOYD_SIMD_X86
+	if(level == simd_level::k_avx2 && best == simd_level::k_avx2){
+		return k_avx2_kernels;
+	}
+	else if(level != simd_level::k_scalar && best != simd_level::k_scalar){
+		return k_sse2_kernels;
+	}
+#endif
+	return k_scalar_kernels;
+}
+
+const bc_simd_kernels_t& get_simd_kernels(){
+	static const bc_simd_kernels_t& kernels = get_simd_kernels(get_simd_level());
+	return kernels;
+}
+
+
+
+//////////////////////////////////////		IMMER VECTORS
+
+
+
+template <typename FIND_KERNEL, typename T>
+static int find_chunked(const immer::vector<bc_inplace_value_t>& vec, FIND_KERNEL kernel, const T& wanted){
+	size_t pos = 0;
+	const bool not_found = immer::for_each_chunk_p(vec, [&](const bc_inplace_value_t* first, const bc_inplace_value_t* last){
+		const size_t count = last - first;
+		const size_t index = kernel(first, count, wanted);
+		pos += index;
+		return index == count;
+	});
+	return not_found ? -1 : static_cast<int>(pos);
+}
+
+int bc_simd_find_bool(const immer::vector<bc_inplace_value_t>& vec, bool wanted){
+	return find_chunked(vec, get_simd_kernels()._find_bool, wanted);
+}
+int bc_simd_find_int(const immer::vector<bc_inplace_value_t>& vec, int64_t wanted){
+	return find_chunked(vec, get_simd_kernels()._find_int, wanted);
+}
+int bc_simd_find_double(const immer::vector<bc_inplace_value_t>& vec, double wanted){
+	return find_chunked(vec, get_simd_kernels()._find_double, wanted);
+}
+
+
+//	Calls f(first, count, pos) for each contiguous run of elements [start, end) of vec. pos is the index of first.
+template <typename F>
+static void for_each_chunk_in(const immer::vector<bc_inplace_value_t>& vec, size_t start, size_t end, F f){
+	QUARK_ASSERT(start <= end && end <= vec.size());
+
+	size_t pos = start;
+	immer::for_each_chunk(vec.begin() + start, vec.begin() + end, [&](const bc_inplace_value_t* first, const bc_inplace_value_t* last){
+		const size_t count = last - first;
+		f(first, count, pos);
+		pos += count;
+	});
+}
+
+//	Calls f(a_first, b_first, count, pos) for runs of elements [start, end) that are contiguous in both a and b,
+//	until f returns false. The leaves of a and b don't need to line up: for each leaf of a we walk the leaves of b
+//	that cover the same index range.
+template <typename F>
+static bool for_each_chunk_pair_p(const immer::vector<bc_inplace_value_t>& a, const immer::vector<bc_inplace_value_t>& b, size_t start, size_t end, F f){
+	QUARK_ASSERT(start <= end);
+	QUARK_ASSERT(end <= a.size() && end <= b.size());
+
+	size_t pos = start;
+	return immer::for_each_chunk_p(a.begin() + start, a.begin() + end, [&](const bc_inplace_value_t* a_first, const bc_inplace_value_t* a_last){
+		const size_t a_pos = pos;
+		const size_t a_count = a_last - a_first;
+		return immer::for_each_chunk_p(b.begin() + a_pos, b.begin() + a_pos + a_count, [&](const bc_inplace_value_t* b_first, const bc_inplace_value_t* b_last){
+			const size_t count = b_last - b_first;
+			const bool more = f(a_first + (pos - a_pos), b_first, count, pos);
+			pos += count;
+			return more;
+		});
+	});
+}
+
+template <typename MISMATCH_KERNEL>
+static size_t mismatch_chunked(const immer::vector<bc_inplace_value_t>& left, const immer::vector<bc_inplace_value_t>& right, size_t start, size_t end, MISMATCH_KERNEL kernel){
+	size_t result = end;
+	for_each_chunk_pair_p(left, right, start, end, [&](const bc_inplace_value_t* a, const bc_inplace_value_t* b, size_t count, size_t pos){
+		const size_t index = kernel(a, b, count);
+		if(index != count){
+			result = pos + index;
+			return false;
+		}
+		return true;
+	});
+	return result;
+}
+
+size_t bc_simd_mismatch_bool(const immer::vector<bc_inplace_value_t>& left, const immer::vector<bc_inplace_value_t>& right, size_t start, size_t end){
+	return mismatch_chunked(left, right, start, end, get_simd_kernels()._mismatch_bool);
+}
+size_t bc_simd_mismatch_int(const immer::vector<bc_inplace_value_t>& left, const immer::vector<bc_inplace_value_t>& right, size_t start, size_t end){
+	return mismatch_chunked(left, right, start, end, get_simd_kernels()._mismatch_int);
+}
+size_t bc_simd_mismatch_double(const immer::vector<bc_inplace_value_t>& left, const immer::vector<bc_inplace_value_t>& right, size_t start, size_t end){
+	return mismatch_chunked(left, right, start, end, get_simd_kernels()._mismatch_double);
+}
+
+
+
+//////////////////////////////////////		PARALLEL BLOCKS
+
+
+
+static size_t get_block_count(size_t count){
+	return (count + k_simd_parallel_block_size - 1) / k_simd_parallel_block_size;
+}
+
+static thread_local bool t_simd_serial = false;
+
+simd_serial_scope_t::simd_serial_scope_t() :
+	_prev_serial(t_simd_serial)
+{
+	t_simd_serial = true;
+}
+
+simd_serial_scope_t::~simd_serial_scope_t(){
+	t_simd_serial = _prev_serial;
+}
+
+/*
+	Helper threads that sleep until a caller hands out blocks. The caller works on its own blocks too. One caller at a
+	time: the others run their blocks on their own threads.
+*/
+struct block_pool_t {
+	block_pool_t(size_t thread_count){
+		for(size_t i = 0 ; i < thread_count ; i++){
+			_threads.push_back(std::thread([this](){ run_helper(); }));
+		}
+	}
+
+	~block_pool_t(){
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stop = true;
+		}
+		_wake.notify_all();
+		for(auto& t: _threads){
+			t.join();
+		}
+	}
+
+	//	Returns false without calling f if another caller is using the pool.
+	bool try_run(size_t block_count, const std::function<void (size_t block_index)>& f){
+		std::unique_lock<std::mutex> run_lock(_run_mutex, std::try_to_lock);
+		if(run_lock.owns_lock() == false){
+			return false;
+		}
+
+		std::unique_lock<std::mutex> lock(_mutex);
+		_job = &f;
+		_block_count = block_count;
+		_next_block = 0;
+		_blocks_done = 0;
+		_wake.notify_all();
+
+		run_blocks_locked(lock);
+		_done.wait(lock, [&]{ return _blocks_done == _block_count; });
+		_job = nullptr;
+		return true;
+	}
+
+	void run_helper(){
+		std::unique_lock<std::mutex> lock(_mutex);
+		while(true){
+			_wake.wait(lock, [&]{ return _stop || (_job != nullptr && _next_block < _block_count); });
+			if(_stop){
+				return;
+			}
+			run_blocks_locked(lock);
+		}
+	}
+
+	//	Blocks are big, so taking them one at a time under the mutex costs nothing measurable.
+	void run_blocks_locked(std::unique_lock<std::mutex>& lock){
+		while(_job != nullptr && _next_block < _block_count){
+			const auto& job = *_job;
+			const auto block_index = _next_block++;
+			lock.unlock();
+			job(block_index);
+			lock.lock();
+			_blocks_done++;
+			if(_blocks_done == _block_count){
+				_done.notify_all();
+			}
+		}
+	}
+
+
+	////////////////////////		STATE
+	std::mutex _run_mutex;
+
+	std::mutex _mutex;
+	std::condition_variable _wake;
+	std::condition_variable _done;
+	const std::function<void (size_t block_index)>* _job = nullptr;
+	size_t _block_count = 0;
+	size_t _next_block = 0;
+	size_t _blocks_done = 0;
+	bool _stop = false;
+
+	std::vector<std::thread> _threads;
+};
+
+//	Started on first use, one helper per hardware thread besides the caller's.
+static block_pool_t& get_block_pool(){
+	static block_pool_t pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+	return pool;
+}
+
+//	Calls f(block_index, start, end) once for each block of [0, count). Big enough vectors have their blocks handed
+//	out to the shared pool. Returns when all blocks are done.
+static void run_blocks(size_t count, const std::function<void (size_t block_index, size_t start, size_t end)>& f){
+	const auto block_count = get_block_count(count);
+	const auto run_block = [&](size_t block_index){
+		const auto start = block_index * k_simd_parallel_block_size;
+		const auto end = std::min(count, start + k_simd_parallel_block_size);
+		f(block_index, start, end);
+	};
+
+	if(block_count >= k_simd_parallel_min_blocks && t_simd_serial == false){
+		auto& pool = get_block_pool();
+		if(pool._threads.empty() == false && pool.try_run(block_count, run_block)){
+			return;
+		}
+	}
+	for(size_t block_index = 0 ; block_index < block_count ; block_index++){
+		run_block(block_index);
+	}
+}
+
+//	Reduces each block using kernel, then combines the block results left to right.
+template <typename T, typename REDUCE_KERNEL, typename COMBINE>
+static T reduce_blocks(const immer::vector<bc_inplace_value_t>& vec, REDUCE_KERNEL kernel, COMBINE combine){
+	QUARK_ASSERT(vec.size() > 0);
+
+	std::vector<T> partials(get_block_count(vec.size()));
+	run_blocks(vec.size(), [&](size_t block_index, size_t start, size_t end){
+		bool first_chunk = true;
+		T acc = T();
+		for_each_chunk_in(vec, start, end, [&](const bc_inplace_value_t* p, size_t count, size_t pos){
+			const T chunk_result = kernel(p, count);
+			acc = first_chunk ? chunk_result : combine(acc, chunk_result);
+			first_chunk = false;
+		});
+		partials[block_index] = acc;
+	});
+
+	T result = partials[0];
+	for(size_t i = 1 ; i < partials.size() ; i++){
+		result = combine(result, partials[i]);
+	}
+	return result;
+}
+
+template <typename T, typename REDUCE_KERNEL>
+static T reduce_pair_blocks(const immer::vector<bc_inplace_value_t>& a, const immer::vector<bc_inplace_value_t>& b, REDUCE_KERNEL kernel, T (*combine)(T, T)){
+	QUARK_ASSERT(a.size() == b.size());
+
+	std::vector<T> partials(get_block_count(a.size()), T());
+	run_blocks(a.size(), [&](size_t block_index, size_t start, size_t end){
+		T acc = T();
+		for_each_chunk_pair_p(a, b, start, end, [&](const bc_inplace_value_t* pa, const bc_inplace_value_t* pb, size_t count, size_t pos){
+			acc = combine(acc, kernel(pa, pb, count));
+			return true;
+		});
+		partials[block_index] = acc;
+	});
+
+	T result = T();
+	for(const auto& e: partials){
+		result = combine(result, e);
+	}
+	return result;
+}
+
+template <typename ELEMENTWISE_KERNEL>
+static immer::vector<bc_inplace_value_t> elementwise_blocks(const immer::vector<bc_inplace_value_t>& a, const immer::vector<bc_inplace_value_t>& b, ELEMENTWISE_KERNEL kernel){
+	QUARK_ASSERT(a.size() == b.size());
+
+	std::vector<bc_inplace_value_t> out(a.size());
+	run_blocks(a.size(), [&](size_t block_index, size_t start, size_t end){
+		for_each_chunk_pair_p(a, b, start, end, [&](const bc_inplace_value_t* pa, const bc_inplace_value_t* pb, size_t count, size_t pos){
+			kernel(pa, pb, &out[pos], count);
+			return true;
+		});
+	});
+	return immer::vector<bc_inplace_value_t>(out.begin(), out.end());
+}
+
+template <typename T, typename SCALE_KERNEL>
+static immer::vector<bc_inplace_value_t> scale_blocks(const immer::vector<bc_inplace_value_t>& a, T k, SCALE_KERNEL kernel){
+	std::vector<bc_inplace_value_t> out(a.size());
+	run_blocks(a.size(), [&](size_t block_index, size_t start, size_t end){
+		for_each_chunk_in(a, start, end, [&](const bc_inplace_value_t* p, size_t count, size_t pos){
+			kernel(p, k, &out[pos], count);
+		});
+	});
+	return immer::vector<bc_inplace_value_t>(out.begin(), out.end());
+}
+
+//	First sums each block, then scans each block starting with the sum of all blocks before it.
+template <typename T, typename SUM_KERNEL, typename PREFIX_SUM_KERNEL>
+static immer::vector<bc_inplace_value_t> prefix_sum_blocks(const immer::vector<bc_inplace_value_t>& vec, SUM_KERNEL sum_kernel, PREFIX_SUM_KERNEL prefix_sum_kernel, T (*combine)(T, T)){
+	const auto block_count = get_block_count(vec.size());
+
+	std::vector<T> carries(block_count, T());
+	if(block_count > 1){
+		std::vector<T> totals(block_count, T());
+		run_blocks(vec.size(), [&](size_t block_index, size_t start, size_t end){
+			T acc = T();
+			for_each_chunk_in(vec, start, end, [&](const bc_inplace_value_t* p, size_t count, size_t pos){
+				acc = combine(acc, sum_kernel(p, count));
+			});
+			totals[block_index] = acc;
+		});
+		for(size_t i = 1 ; i < block_count ; i++){
+			carries[i] = combine(carries[i - 1], totals[i - 1]);
+		}
+	}
+
+	std::vector<bc_inplace_value_t> out(vec.size());
+	run_blocks(vec.size(), [&](size_t block_index, size_t start, size_t end){
+		T carry = carries[block_index];
+		for_each_chunk_in(vec, start, end, [&](const bc_inplace_value_t* p, size_t count, size_t pos){
+			carry = prefix_sum_kernel(p, carry, &out[pos], count);
+		});
+	});
+	return immer::vector<bc_inplace_value_t>(out.begin(), out.end());
+}
+
+static double add_doubles(double a, double b){
+	return a + b;
+}
+
+
+
+int64_t bc_simd_min_int(const immer::vector<bc_inplace_value_t>& vec){
+	return reduce_blocks<int64_t>(vec, get_simd_kernels()._min_int, [](int64_t a, int64_t b){ return b < a ? b : a; });
+}
+int64_t bc_simd_max_int(const immer::vector<bc_inplace_value_t>& vec){
+	return reduce_blocks<int64_t>(vec, get_simd_kernels()._max_int, [](int64_t a, int64_t b){ return b > a ? b : a; });
+}
+double bc_simd_min_double(const immer::vector<bc_inplace_value_t>& vec){
+	return reduce_blocks<double>(vec, get_simd_kernels()._min_double, [](double a, double b){ return a < b ? a : b; });
+}
+double bc_simd_max_double(const immer::vector<bc_inplace_value_t>& vec){
+	return reduce_blocks<double>(vec, get_simd_kernels()._max_double, [](double a, double b){ return a > b ? a : b; });
+}
+
+
+immer::vector<bc_inplace_value_t> bc_simd_add_int(const immer::vector<bc_inplace_value_t>& a, const immer::vector<bc_inplace_value_t>& b){
+	return elementwise_blocks(a, b, get_simd_kernels()._add_int);
+}
+immer::vector<bc_inplace_value_t> bc_simd_sub_int(const immer::vector<bc_inplace_value_t>& a, const immer::vector<bc_inplace_value_t>& b){
+	return elementwise_blocks(a, b, get_simd_kernels()._sub_int);
+}
+immer::vector<bc_inplace_value_t> bc_simd_mul_int(const immer::vector<bc_inplace_value_t>& a, const immer::vector<bc_inplace_value_t>& b){
+	return elementwise_blocks(a, b, get_simd_kernels()._mul_int);
+}
+immer::vector<bc_inplace_value_t> bc_simd_add_double(const immer::vector<bc_inplace_value_t>& a, const immer::vector<bc_inplace_value_t>& b){
+	return elementwise_blocks(a, b, get_simd_kernels()._add_double);
+}
+immer::vector<bc_inplace_value_t> bc_simd_sub_double(const immer::vector<bc_inplace_value_t>& a, const immer::vector<bc_inplace_value_t>& b){
+	return elementwise_blocks(a, b, get_simd_kernels()._sub_double);
+}
+immer::vector<bc_inplace_value_t> bc_simd_mul_double(const immer::vector<bc_inplace_value_t>& a, const immer::vector<bc_inplace_value_t>& b){
+	return elementwise_blocks(a, b, get_simd_kernels()._mul_double);
+}
+
+immer::vector<bc_inplace_value_t> bc_simd_scale_int(const immer::vector<bc_inplace_value_t>& a, int64_t k){
+	return scale_blocks(a, k, get_simd_kernels()._scale_int);
+}
+immer::vector<bc_inplace_value_t> bc_simd_scale_double(const immer::vector<bc_inplace_value_t>& a, double k){
+	return scale_blocks(a, k, get_simd_kernels()._scale_double);
+}
+
+int64_t bc_simd_sum_int(const immer::vector<bc_inplace_value_t>& vec){
+	return vec.size() == 0 ? 0 : reduce_blocks<int64_t>(vec, get_simd_kernels()._sum_int, wrap_add);
+}
+double bc_simd_sum_double(const immer::vector<bc_inplace_value_t>& vec){
+	return vec.size() == 0 ? 0.0 : reduce_blocks<double>(vec, get_simd_kernels()._sum_double, add_doubles);
+}
+
+int64_t bc_simd_dot_int(const immer::vector<bc_inplace_value_t>& a, const immer::vector<bc_inplace_value_t>& b){
+	return reduce_pair_blocks<int64_t>(a, b, get_simd_kernels()._dot_int, wrap_add);
+}
+double bc_simd_dot_double(const immer::vector<bc_inplace_value_t>& a, const immer::vector<bc_inplace_value_t>& b){
+	return reduce_pair_blocks<double>(a, b, get_simd_kernels()._dot_double, add_doubles);
+}
+
+immer::vector<bc_inplace_value_t> bc_simd_prefix_sum_int(const immer::vector<bc_inplace_value_t>& vec){
+	const auto& kernels = get_simd_kernels();
+	return prefix_sum_blocks<int64_t>(vec, kernels._sum_int, kernels._prefix_sum_int, wrap_add);
+}
+immer::vector<bc_inplace_value_t> bc_simd_prefix_sum_double(const immer::vector<bc_inplace_value_t>& vec){
+	const auto& kernels = get_simd_kernels();
+	return prefix_sum_blocks<double>(vec, kernels._sum_double, kernels._prefix_sum_double, add_doubles);
+}
+
+
+
+//////////////////////////////////////		TESTS
+
+
+
+static immer::vector<bc_inplace_value_t> make_test_ints(int64_t count){
+	immer::vector<bc_inplace_value_t> result;
+	for(int64_t i = 0 ; i < count ; i++){
+		bc_inplace_value_t e;
+		e._int64 = i * 3 - 100;
+		result = result.push_back(e);
+	}
+	return result;
+}
+
+static immer::vector<bc_inplace_value_t> make_test_doubles(int64_t count){
+	immer::vector<bc_inplace_value_t> result;
+	for(int64_t i = 0 ; i < count ; i++){
+		bc_inplace_value_t e;
+		e._double = static_cast<double>(i) * 0.5 - 10.0;
+		result = result.push_back(e);
+	}
+	return result;
+}
+
+//	Fill the unused bytes of each bool with garbage, kernels must only look at the bool.
+static immer::vector<bc_inplace_value_t> make_test_bools(int64_t count, int64_t true_index){
+	immer::vector<bc_inplace_value_t> result;
+	for(int64_t i = 0 ; i < count ; i++){
+		bc_inplace_value_t e;
+		e._int64 = 0x5a5a5a5a5a5a5a00;
+		e._bool = i == true_index;
+		result = result.push_back(e);
+	}
+	return result;
+}
+
+
+QUARK_UNIT_TEST("bc_simd", "get_simd_kernels()", "All levels find the same index", ""){
+	const auto ints = make_test_ints(1000);
+	const auto doubles = make_test_doubles(1000);
+	const std::vector<bc_inplace_value_t> flat_ints(ints.begin(), ints.end());
+	const std::vector<bc_inplace_value_t> flat_doubles(doubles.begin(), doubles.end());
+	for(const auto level: { simd_level::k_scalar, simd_level::k_sse2, simd_level::k_avx2 }){
+		const auto& kernels = get_simd_kernels(level);
+		for(const size_t index: { 0, 1, 2, 3, 4, 7, 8, 9, 31, 32, 33, 998, 999 }){
+			QUARK_UT_VERIFY(kernels._find_int(&flat_ints[0], flat_ints.size(), flat_ints[index]._int64) == index);
+			QUARK_UT_VERIFY(kernels._find_double(&flat_doubles[0], flat_doubles.size(), flat_doubles[index]._double) == index);
+			QUARK_UT_VERIFY(kernels._mismatch_int(&flat_ints[0], &flat_ints[0], index) == index);
+		}
+		QUARK_UT_VERIFY(kernels._max_int(&flat_ints[0], flat_ints.size()) == 3 * 999 - 100);
+		QUARK_UT_VERIFY(kernels._min_double(&flat_doubles[0], flat_doubles.size()) == -10.0);
+	}
+}
+
+QUARK_UNIT_TEST("bc_simd", "bc_simd_find_int()", "Spans many leaves", ""){
+	const auto vec = make_test_ints(1000);
+	QUARK_UT_VERIFY(bc_simd_find_int(vec, -100) == 0);
+	QUARK_UT_VERIFY(bc_simd_find_int(vec, 3 * 500 - 100) == 500);
+	QUARK_UT_VERIFY(bc_simd_find_int(vec, 3 * 999 - 100) == 999);
+	QUARK_UT_VERIFY(bc_simd_find_int(vec, 1) == -1);
+	QUARK_UT_VERIFY(bc_simd_find_int(immer::vector<bc_inplace_value_t>(), 1) == -1);
+}
+
+QUARK_UNIT_TEST("bc_simd", "bc_simd_find_double()", "", ""){
+	const auto vec = make_test_doubles(333);
+	QUARK_UT_VERIFY(bc_simd_find_double(vec, -10.0) == 0);
+	QUARK_UT_VERIFY(bc_simd_find_double(vec, 0.5 * 200 - 10.0) == 200);
+	QUARK_UT_VERIFY(bc_simd_find_double(vec, 0.25) == -1);
+}
+
+QUARK_UNIT_TEST("bc_simd", "bc_simd_find_bool()", "Ignores garbage bytes", ""){
+	QUARK_UT_VERIFY(bc_simd_find_bool(make_test_bools(100, 77), true) == 77);
+	QUARK_UT_VERIFY(bc_simd_find_bool(make_test_bools(100, 0), false) == 1);
+	QUARK_UT_VERIFY(bc_simd_find_bool(make_test_bools(100, -1), true) == -1);
+}
+
+QUARK_UNIT_TEST("bc_simd", "bc_simd_mismatch_int()", "Leaves of left and right don't line up", ""){
+	const auto a = make_test_ints(1000);
+	auto b = make_test_ints(1000);
+	QUARK_UT_VERIFY(bc_simd_mismatch_int(a, b, 0, 1000) == 1000);
+
+	bc_inplace_value_t e;
+	e._int64 = 123456;
+	b = b.set(700, e);
+	QUARK_UT_VERIFY(bc_simd_mismatch_int(a, b, 0, 1000) == 700);
+	QUARK_UT_VERIFY(bc_simd_mismatch_int(a, b, 701, 1000) == 1000);
+	QUARK_UT_VERIFY(bc_simd_mismatch_int(a, b, 0, 700) == 700);
+}
+
+QUARK_UNIT_TEST("bc_simd", "bc_simd_mismatch_bool()", "Ignores garbage bytes", ""){
+	const auto a = make_test_bools(100, 50);
+	auto b = make_test_bools(100, 50);
+	bc_inplace_value_t e;
+	e._int64 = 0x1111111111111100;
+	e._bool = false;
+	b = b.set(3, e);
+	QUARK_UT_VERIFY(bc_simd_mismatch_bool(a, b, 0, 100) == 100);
+	QUARK_UT_VERIFY(bc_simd_mismatch_bool(a, make_test_bools(100, 51), 0, 100) == 50);
+}
+
+QUARK_UNIT_TEST("bc_simd", "bc_simd_mismatch_double()", "", ""){
+	const auto a = make_test_doubles(100);
+	bc_inplace_value_t e;
+	e._double = 0.1;
+	QUARK_UT_VERIFY(bc_simd_mismatch_double(a, a, 0, 100) == 100);
+	QUARK_UT_VERIFY(bc_simd_mismatch_double(a, a.set(99, e), 0, 100) == 99);
+}
+
+QUARK_UNIT_TEST("bc_simd", "bc_simd_min_int()", "", ""){
+	const auto a = make_test_ints(1000);
+	QUARK_UT_VERIFY(bc_simd_min_int(a) == -100);
+	QUARK_UT_VERIFY(bc_simd_max_int(a) == 3 * 999 - 100);
+
+	bc_inplace_value_t e;
+	e._int64 = std::numeric_limits<int64_t>::min();
+	QUARK_UT_VERIFY(bc_simd_min_int(a.set(517, e)) == std::numeric_limits<int64_t>::min());
+	QUARK_UT_VERIFY(bc_simd_max_int(make_test_ints(1)) == -100);
+}
+
+QUARK_UNIT_TEST("bc_simd", "bc_simd_min_double()", "", ""){
+	const auto a = make_test_doubles(1000);
+	QUARK_UT_VERIFY(bc_simd_min_double(a) == -10.0);
+	QUARK_UT_VERIFY(bc_simd_max_double(a) == 999 * 0.5 - 10.0);
+	QUARK_UT_VERIFY(bc_simd_min_double(make_test_doubles(3)) == -10.0);
+}
+
+QUARK_UNIT_TEST("bc_simd", "get_simd_kernels()", "All levels compute the same element-wise results", ""){
+	const auto ints = make_test_ints(37);
+	const auto doubles = make_test_doubles(37);
+	const std::vector<bc_inplace_value_t> a(ints.begin(), ints.end());
+	const std::vector<bc_inplace_value_t> d(doubles.begin(), doubles.end());
+
+	for(const auto level: { simd_level::k_sse2, simd_level::k_avx2 }){
+		const auto& scalar = get_simd_kernels(simd_level::k_scalar);
+		const auto& kernels = get_simd_kernels(level);
+
+		std::vector<bc_inplace_value_t> expected(a.size());
+		std::vector<bc_inplace_value_t> out(a.size());
+
+		scalar._mul_int(&a[0], &a[0], &expected[0], a.size());
+		kernels._mul_int(&a[0], &a[0], &out[0], a.size());
+		QUARK_UT_VERIFY(std::equal(out.begin(), out.end(), expected.begin(), [](const bc_inplace_value_t& x, const bc_inplace_value_t& y){ return x._int64 == y._int64; }));
+
+		scale_int_scalar(&a[0], -7, &expected[0], a.size());
+		kernels._scale_int(&a[0], -7, &out[0], a.size());
+		QUARK_UT_VERIFY(std::equal(out.begin(), out.end(), expected.begin(), [](const bc_inplace_value_t& x, const bc_inplace_value_t& y){ return x._int64 == y._int64; }));
+
+		scalar._prefix_sum_int(&a[0], 5, &expected[0], a.size());
+		kernels._prefix_sum_int(&a[0], 5, &out[0], a.size());
+		QUARK_UT_VERIFY(std::equal(out.begin(), out.end(), expected.begin(), [](const bc_inplace_value_t& x, const bc_inplace_value_t& y){ return x._int64 == y._int64; }));
+
+		//	All values are multiples of 0.5 so the sums are exact in any order.
+		scalar._prefix_sum_double(&d[0], 0.5, &expected[0], d.size());
+		kernels._prefix_sum_double(&d[0], 0.5, &out[0], d.size());
+		QUARK_UT_VERIFY(std::equal(out.begin(), out.end(), expected.begin(), [](const bc_inplace_value_t& x, const bc_inplace_value_t& y){ return x._double == y._double; }));
+
+		QUARK_UT_VERIFY(kernels._dot_int(&a[0], &a[0], a.size()) == scalar._dot_int(&a[0], &a[0], a.size()));
+		QUARK_UT_VERIFY(kernels._sum_double(&d[0], d.size()) == scalar._sum_double(&d[0], d.size()));
+	}
+}
+
+QUARK_UNIT_TEST("bc_simd", "get_simd_kernels()", "Int multiply wraps around", ""){
+	bc_inplace_value_t a[2];
+	a[0]._int64 = std::numeric_limits<int64_t>::max();
+	a[1]._int64 = -3;
+	for(const auto level: { simd_level::k_scalar, simd_level::k_sse2, simd_level::k_avx2 }){
+		bc_inplace_value_t out[2];
+		get_simd_kernels(level)._mul_int(a, a, out, 2);
+		QUARK_UT_VERIFY(out[0]._int64 == 1);
+		QUARK_UT_VERIFY(out[1]._int64 == 9);
+	}
+}
+
+QUARK_UNIT_TEST("bc_simd", "bc_simd_add_int()", "", ""){
+	const auto a = make_test_ints(100);
+	const auto r = bc_simd_sub_int(bc_simd_add_int(a, a), a);
+	QUARK_UT_VERIFY(bc_simd_mismatch_int(a, r, 0, 100) == 100);
+	QUARK_UT_VERIFY(bc_simd_add_int(immer::vector<bc_inplace_value_t>(), immer::vector<bc_inplace_value_t>()).size() == 0);
+}
+
+QUARK_UNIT_TEST("bc_simd", "bc_simd_mul_double()", "", ""){
+	const auto a = make_test_doubles(10);
+	const auto r = bc_simd_mul_double(a, a);
+	QUARK_UT_VERIFY(r.size() == 10);
+	QUARK_UT_VERIFY(r[3]._double == 8.5 * 8.5);
+	QUARK_UT_VERIFY(bc_simd_scale_double(a, 2.0)[9]._double == -11.0);
+	QUARK_UT_VERIFY(bc_simd_dot_double(a, a) == bc_simd_sum_double(r));
+}
+
+QUARK_UNIT_TEST("bc_simd", "bc_simd_sum_int()", "", ""){
+	QUARK_UT_VERIFY(bc_simd_sum_int(immer::vector<bc_inplace_value_t>()) == 0);
+	QUARK_UT_VERIFY(bc_simd_sum_int(make_test_ints(4)) == -100 + -97 + -94 + -91);
+	QUARK_UT_VERIFY(bc_simd_sum_double(make_test_doubles(3)) == -10.0 + -9.5 + -9.0);
+}
+
+QUARK_UNIT_TEST("bc_simd", "bc_simd_prefix_sum_int()", "", ""){
+	const auto r = bc_simd_prefix_sum_int(make_test_ints(5));
+	QUARK_UT_VERIFY(r.size() == 5);
+	QUARK_UT_VERIFY(r[0]._int64 == -100);
+	QUARK_UT_VERIFY(r[1]._int64 == -197);
+	QUARK_UT_VERIFY(r[4]._int64 == -100 + -97 + -94 + -91 + -88);
+}
+
+QUARK_UNIT_TEST("bc_simd", "bc_simd_prefix_sum_int()", "Many blocks, runs on several threads", ""){
+	const int64_t count = k_simd_parallel_block_size * 3 + 17;
+	const auto a = make_test_ints(count);
+	const auto r = bc_simd_prefix_sum_int(a);
+
+	int64_t acc = 0;
+	bool ok = true;
+	for(int64_t i = 0 ; i < count ; i++){
+		acc = acc + a[i]._int64;
+		ok = ok && r[i]._int64 == acc;
+	}
+	QUARK_UT_VERIFY(ok);
+	QUARK_UT_VERIFY(bc_simd_sum_int(a) == acc);
+
+	const std::vector<bc_inplace_value_t> flat(a.begin(), a.end());
+	QUARK_UT_VERIFY(bc_simd_dot_int(a, make_test_ints(count)) == dot_int_scalar(&flat[0], &flat[0], flat.size()));
+	QUARK_UT_VERIFY(bc_simd_max_int(a) == 3 * (count - 1) - 100);
+
+	const auto b = bc_simd_sub_int(bc_simd_scale_int(a, 2), a);
+	QUARK_UT_VERIFY(bc_simd_mismatch_int(a, b, 0, count) == count);
+}
+
+QUARK_UNIT_TEST("bc_simd", "bc_simd_sum_int()", "Many blocks, several callers and a serial caller", "same sums"){
+	const int64_t count = k_simd_parallel_block_size * k_simd_parallel_min_blocks + 5;
+	const auto a = make_test_ints(count);
+	const auto expected = bc_simd_sum_int(a);
+
+	std::vector<int64_t> sums(4);
+	std::vector<std::thread> threads;
+	for(size_t i = 0 ; i < sums.size() ; i++){
+		threads.push_back(std::thread([&, i](){
+			if(i == 0){
+				const simd_serial_scope_t serial;
+				sums[i] = bc_simd_sum_int(a);
+			}
+			else{
+				sums[i] = bc_simd_sum_int(a);
+			}
+		}));
+	}
+	for(auto& t: threads){
+		t.join();
+	}
+	for(const auto& e: sums){
+		QUARK_UT_VERIFY(e == expected);
+	}
+}
+
+
+}	//	floyd
@@ -0,0 +1,168 @@
+//
+//  bc_simd.h
+//  FloydSpeak
+//
+//  Created by Marcus Zetterquist on 2018-10-22.
+//  Copyright © 2018 Marcus Zetterquist. All rights reserved.
+//
+
+#ifndef bc_simd_hpp
+#define bc_simd_hpp
+
+/*
+	Vectorized kernels for vectors of inplace values: [bool], [int] and [double].
+
+	The kernels work on a contiguous range of bc_inplace_value_t. immer::vector stores its elements in leaf chunks
+	so the bc_simd_*() functions that take an immer vector walk the leaves using immer::for_each_chunk_p() and run
+	the kernel on each leaf.
+
+	The best implementation for the CPU is picked at runtime: AVX2, SSE2 or plain C++.
+	Non-x86 targets (ARM, emscripten) always use the plain C++ kernels.
+
+	Doubles are compared with IEEE semantics, just like the scalar code: NaN != NaN and 0.0 == -0.0.
+	min / max of a vector containing NaN is unspecified.
+*/
+
+#include "bytecode_interpreter.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+namespace floyd {
+
+
+//////////////////////////////////////		simd_level
+
+
+enum class simd_level {
+	k_scalar,
+	k_sse2,
+	k_avx2
+};
+
+std::string simd_level_to_string(simd_level level);
+
+//	Returns the best level supported by the CPU we are running on.
+simd_level get_simd_level();
+
+
+//////////////////////////////////////		bc_simd_kernels_t
+
+
+struct bc_simd_kernels_t {
+	//	Returns index of first element that equals wanted, or count if there is none.
+	size_t (*_find_bool)(const bc_inplace_value_t* p, size_t count, bool wanted);
+	size_t (*_find_int)(const bc_inplace_value_t* p, size_t count, int64_t wanted);
+	size_t (*_find_double)(const bc_inplace_value_t* p, size_t count, double wanted);
+
+	//	Returns index of first element where a and b differ, or count if they are all equal.
+	size_t (*_mismatch_bool)(const bc_inplace_value_t* a, const bc_inplace_value_t* b, size_t count);
+	size_t (*_mismatch_int)(const bc_inplace_value_t* a, const bc_inplace_value_t* b, size_t count);
+	size_t (*_mismatch_double)(const bc_inplace_value_t* a, const bc_inplace_value_t* b, size_t count);
+
+	//	count must be > 0.
+	int64_t (*_min_int)(const bc_inplace_value_t* p, size_t count);
+	int64_t (*_max_int)(const bc_inplace_value_t* p, size_t count);
+	double (*_min_double)(const bc_inplace_value_t* p, size_t count);
+	double (*_max_double)(const bc_inplace_value_t* p, size_t count);
+
+	//	out[i] = a[i] op b[i]. out may be the same as a or b. Ints wrap around on overflow.
+	void (*_add_int)(const bc_inplace_value_t* a, const bc_inplace_value_t* b, bc_inplace_value_t* out, size_t count);
+	void (*_sub_int)(const bc_inplace_value_t* a, const bc_inplace_value_t* b, bc_inplace_value_t* out, size_t count);
+	void (*_mul_int)(const bc_inplace_value_t* a, const bc_inplace_value_t* b, bc_inplace_value_t* out, size_t count);
+	void (*_add_double)(const bc_inplace_value_t* a, const bc_inplace_value_t* b, bc_inplace_value_t* out, size_t count);
+	void (*_sub_double)(const bc_inplace_value_t* a, const bc_inplace_value_t* b, bc_inplace_value_t* out, size_t count);
+	void (*_mul_double)(const bc_inplace_value_t* a, const bc_inplace_value_t* b, bc_inplace_value_t* out, size_t count);
+
+	//	out[i] = a[i] * k
+	void (*_scale_int)(const bc_inplace_value_t* a, int64_t k, bc_inplace_value_t* out, size_t count);
+	void (*_scale_double)(const bc_inplace_value_t* a, double k, bc_inplace_value_t* out, size_t count);
+
+	int64_t (*_sum_int)(const bc_inplace_value_t* p, size_t count);
+	double (*_sum_double)(const bc_inplace_value_t* p, size_t count);
+	int64_t (*_dot_int)(const bc_inplace_value_t* a, const bc_inplace_value_t* b, size_t count);
+	double (*_dot_double)(const bc_inplace_value_t* a, const bc_inplace_value_t* b, size_t count);
+
+	//	Inclusive scan: out[i] = carry + p[0] + ... + p[i]. Returns the last sum, to use as carry for the next range.
+	int64_t (*_prefix_sum_int)(const bc_inplace_value_t* p, int64_t carry, bc_inplace_value_t* out, size_t count);
+	double (*_prefix_sum_double)(const bc_inplace_value_t* p, double carry, bc_inplace_value_t* out, size_t count);
+};
+
+//	If the CPU doesn't support level, you get the best level it does support.
+const bc_simd_kernels_t& get_simd_kernels(simd_level level);
+
+//	Kernels for get_simd_level().
+const bc_simd_kernels_t& get_simd_kernels();
+
+
+//////////////////////////////////////		IMMER VECTORS
+
+
+//	Returns -1 if not found.
+int bc_simd_find_bool(const immer::vector<bc_inplace_value_t>& vec, bool wanted);
+int bc_simd_find_int(const immer::vector<bc_inplace_value_t>& vec, int64_t wanted);
+int bc_simd_find_double(const immer::vector<bc_inplace_value_t>& vec, double wanted);
+
+//	Scans elements [start, end) of both vectors. Returns index of first element that differs, or end if all are equal.
+size_t bc_simd_mismatch_bool(const immer::vector<bc_inplace_value_t>& left, const immer::vector<bc_inplace_value_t>& right, size_t start, size_t end);
+size_t bc_simd_mismatch_int(const immer::vector<bc_inplace_value_t>& left, const immer::vector<bc_inplace_value_t>& right, size_t start, size_t end);
+size_t bc_simd_mismatch_double(const immer::vector<bc_inplace_value_t>& left, const immer::vector<bc_inplace_value_t>& right, size_t start, size_t end);
+
+
+/*
+	The functions below split vectors bigger than k_simd_parallel_block_size elements into blocks. Vectors of at least
+	k_simd_parallel_min_blocks blocks have their blocks spread over one pool of threads shared by all callers. The
+	blocks are always the same for a given size, so results don't depend on the number of cores or threads. Sums of
+	doubles are not added strictly left to right, they can differ in the last bits from a plain loop.
+*/
+const size_t k_simd_parallel_block_size = 65536;
+const size_t k_simd_parallel_min_blocks = 4;
+
+/*
+	While one of these is alive, the functions below only use the calling thread. The process runtime's workers
+	already keep every core busy.
+*/
+struct simd_serial_scope_t {
+	simd_serial_scope_t();
+	~simd_serial_scope_t();
+
+	simd_serial_scope_t(const simd_serial_scope_t& other) = delete;
+	simd_serial_scope_t& operator=(const simd_serial_scope_t& other) = delete;
+
+	private: bool _prev_serial;
+};
+
+//	vec must not be empty.
+int64_t bc_simd_min_int(const immer::vector<bc_inplace_value_t>& vec);
+int64_t bc_simd_max_int(const immer::vector<bc_inplace_value_t>& vec);
+double bc_simd_min_double(const immer::vector<bc_inplace_value_t>& vec);
+double bc_simd_max_double(const immer::vector<bc_inplace_value_t>& vec);
+
+//	a and b must have the same size.
+immer::vector<bc_inplace_value_t> bc_simd_add_int(const immer::vector<bc_inplace_value_t>& a, const immer::vector<bc_inplace_value_t>& b);
+immer::vector<bc_inplace_value_t> bc_simd_sub_int(const immer::vector<bc_inplace_value_t>& a, const immer::vector<bc_inplace_value_t>& b);
+immer::vector<bc_inplace_value_t> bc_simd_mul_int(const immer::vector<bc_inplace_value_t>& a, const immer::vector<bc_inplace_value_t>& b);
+immer::vector<bc_inplace_value_t> bc_simd_add_double(const immer::vector<bc_inplace_value_t>& a, const immer::vector<bc_inplace_value_t>& b);
+immer::vector<bc_inplace_value_t> bc_simd_sub_double(const immer::vector<bc_inplace_value_t>& a, const immer::vector<bc_inplace_value_t>& b);
+immer::vector<bc_inplace_value_t> bc_simd_mul_double(const immer::vector<bc_inplace_value_t>& a, const immer::vector<bc_inplace_value_t>& b);
+
+immer::vector<bc_inplace_value_t> bc_simd_scale_int(const immer::vector<bc_inplace_value_t>& a, int64_t k);
+immer::vector<bc_inplace_value_t> bc_simd_scale_double(const immer::vector<bc_inplace_value_t>& a, double k);
+
+//	Sum of an empty vector is 0.
+int64_t bc_simd_sum_int(const immer::vector<bc_inplace_value_t>& vec);
+double bc_simd_sum_double(const immer::vector<bc_inplace_value_t>& vec);
+
+//	a and b must have the same size.
+int64_t bc_simd_dot_int(const immer::vector<bc_inplace_value_t>& a, const immer::vector<bc_inplace_value_t>& b);
+double bc_simd_dot_double(const immer::vector<bc_inplace_value_t>& a, const immer::vector<bc_inplace_value_t>& b);
+
+immer::vector<bc_inplace_value_t> bc_simd_prefix_sum_int(const immer::vector<bc_inplace_value_t>& vec);
+immer::vector<bc_inplace_value_t> bc_simd_prefix_sum_double(const immer::vector<bc_inplace_value_t>& vec);
+
+
+}	//	floyd
+
+#endif /* bc_simd_hpp */
@@ -14,6 +14,12 @@
 #include <cmath>
 #include <algorithm>
 #include <cstdint>
+#include <atomic>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
 
 
 namespace floyd {
@@ -63,18 +69,22 @@ struct bcgen_body_t {
 		_instrs(s),
 		_symbols{}
 	{
-		QUARK_ASSERT(check_invariant());
+		QUARK_ASSERT(check_all());
 	}
 
 	bcgen_body_t(const std::vector<bcgen_instruction_t>& instructions, const symbol_table_t& symbols) :
 		_instrs(instructions),
 		_symbols(symbols)
 	{
-		QUARK_ASSERT(check_invariant());
+		QUARK_ASSERT(check_all());
 	}
 
+	//	Only checks the last instruction and symbol, codegen calls this after every step.
 	public: bool check_invariant() const;
 
+	//	Checks every instruction and symbol. Use on finished bodies.
+	public: bool check_all() const;
+
 
 	////////////////////////		STATE
 	symbol_table_t _symbols;
@@ -122,18 +132,35 @@ struct bcgenerator_t {
 	public: std::vector<bcgen_environment_t> _call_stack;
 
 	public: std::vector<typeid_t> _types;
+
+	//	When true, _types already holds every type the generator will need and intern_type() only looks them up.
+	//	This lets several generators, each with its own copy of the same table, produce function bodies in parallel.
+	public: bool _types_frozen;
+
+	//	Global index -> function id, for immutable globals bound to a function literal by a global statement.
+	public: std::map<int, int> _static_functions;
+
+	//	See k_default_inline_budget.
+	public: int _inline_budget;
+
+	//	Function id -> inline size, or -1 if the function can't be inlined. Filled in on demand.
+	public: std::map<int, int> _inline_sizes;
+
+	//	Function ids of the memoized functions, these are never inlined.
+	public: std::set<int> _no_inline;
+
+	//	Function ids of every function whose body was inlined into a caller.
+	public: std::set<int> _inlined;
 };
 
 
 //////////////////////////////////////		bcgenerator_t
 
-//	Why: needed to return from codegen functions that process expressions. Any new instructions have been recorded into _body.
+//	Why: needed to return from codegen functions that process expressions. Any new instructions have been appended to the body_acc passed in.
 
 struct expression_gen_t {
 
 	//////////////////////////////////////		STATE
-	bcgen_body_t _body;
-
 	variable_address_t _out;
 
 	//	Output type.
@@ -145,7 +172,7 @@ struct expression_gen_t {
 	target_reg: if defined, this is where the output value will be stored. If undefined, then the expression allocates (or redirect to existing register).
 	expression_gen_t._out: always holds the output register, no matter who decided it.
 */
-expression_gen_t bcgen_expression(bcgenerator_t& vm, const variable_address_t& target_reg, const expression_t& e, const bcgen_body_t& body);
+expression_gen_t bcgen_expression(bcgenerator_t& vm, const variable_address_t& target_reg, const expression_t& e, bcgen_body_t& body_acc);
 bcgen_body_t bcgen_body_top(bcgenerator_t& vm, const body_t& body);
 bcgen_body_t bcgen_body_block(bcgenerator_t& vm, const body_t& body);
 
@@ -177,6 +204,11 @@ bc_typeid_t intern_type(bcgenerator_t& vm, const typeid_t& type){
 		return pos;
 	}
 	else{
+		//	All types must have been interned by intern_body_types() before freezing.
+		QUARK_ASSERT(vm._types_frozen == false);
+		if(vm._types_frozen){
+			quark::throw_exception();
+		}
 		vm._types.push_back(type);
 		return static_cast<bc_typeid_t>(vm._types.size() - 1);
 	}
@@ -237,22 +269,35 @@ bool check_register__local(const reg_t& reg, bool is_reg){
 //////////////////////////////////////		bcgen_body_t
 
 
- bool bcgen_body_t::check_invariant() const {
-	for(int i = 0 ; i < _instrs.size() ; i++){
-		const auto instruction = _instrs[i];
-		QUARK_ASSERT(instruction.check_invariant());
-	}
-	for(const auto& e: _instrs){
-		const auto encoding = k_opcode_info.at(e._opcode)._encoding;
-		const auto reg_flags = encoding_to_reg_flags(encoding);
+static bool check_body_instruction(const bcgen_instruction_t& instruction){
+	QUARK_ASSERT(instruction.check_invariant());
+
+	const auto encoding = k_opcode_info.at(instruction._opcode)._encoding;
+	const auto reg_flags = encoding_to_reg_flags(encoding);
+	QUARK_ASSERT(check_register_nonlocal(instruction._reg_a, reg_flags._a));
+	QUARK_ASSERT(check_register_nonlocal(instruction._reg_b, reg_flags._b));
+	QUARK_ASSERT(check_register_nonlocal(instruction._reg_c, reg_flags._c));
+	return true;
+}
+
+static bool check_body_symbol(const std::pair<std::string, symbol_t>& symbol){
+	QUARK_ASSERT(symbol.first != "");
+	QUARK_ASSERT(symbol.second.check_invariant());
+	return true;
+}
 
-		QUARK_ASSERT(check_register_nonlocal(e._reg_a, reg_flags._a));
-		QUARK_ASSERT(check_register_nonlocal(e._reg_b, reg_flags._b));
-		QUARK_ASSERT(check_register_nonlocal(e._reg_c, reg_flags._c));
+bool bcgen_body_t::check_invariant() const {
+	QUARK_ASSERT(_instrs.empty() || check_body_instruction(_instrs.back()));
+	QUARK_ASSERT(_symbols._symbols.empty() || check_body_symbol(_symbols._symbols.back()));
+	return true;
+}
+
+bool bcgen_body_t::check_all() const {
+	for(const auto& e: _instrs){
+		QUARK_ASSERT(check_body_instruction(e));
 	}
 	for(const auto& e: _symbols._symbols){
-		QUARK_ASSERT(e.first != "");
-		QUARK_ASSERT(e.second.check_invariant());
+		QUARK_ASSERT(check_body_symbol(e));
 	}
 	return true;
 }
@@ -277,13 +322,14 @@ bool bcgen_instruction_t::check_invariant() const {
 //////////////////////////////////////		Free functions
 
 
-bcgen_body_t flatten_body(bcgenerator_t& vm, const bcgen_body_t& dest, const bcgen_body_t& source){
+//	Appends source's instructions and symbols to body_acc.
+void flatten_body(bcgenerator_t& vm, bcgen_body_t& body_acc, const bcgen_body_t& source){
 	QUARK_ASSERT(vm.check_invariant());
-	QUARK_ASSERT(dest.check_invariant());
-	QUARK_ASSERT(source.check_invariant());
+	QUARK_ASSERT(body_acc.check_invariant());
+	QUARK_ASSERT(source.check_all());
 
-	std::vector<bcgen_instruction_t> instructions;
-	int offset = static_cast<int>(dest._symbols._symbols.size());
+	int offset = static_cast<int>(body_acc._symbols._symbols.size());
+	body_acc._instrs.reserve(body_acc._instrs.size() + source._instrs.size());
 	for(int i = 0 ; i < source._instrs.size() ; i++){
 		//	Decrese parent-step for all local register accesses.
 		auto s = source._instrs[i];
@@ -298,25 +344,20 @@ bcgen_body_t flatten_body(bcgenerator_t& vm, const bcgen_body_t& dest, const bcg
 			reg_flags._b ? flatten_reg(s._reg_b, offset) : s._reg_b,
 			reg_flags._c ? flatten_reg(s._reg_c, offset) : s._reg_c
 		);
-		instructions.push_back(s2);
+		body_acc._instrs.push_back(s2);
 	}
-
-	auto body_acc = dest;
-	body_acc._instrs.insert(body_acc._instrs.end(), instructions.begin(), instructions.end());
 	body_acc._symbols._symbols.insert(body_acc._symbols._symbols.end(), source._symbols._symbols.begin(), source._symbols._symbols.end());
-	return body_acc;
 }
 
 
 
 //	Supports globals & locals both as dest and sources.
-bcgen_body_t copy_value(bcgenerator_t& vm, const typeid_t& type, const reg_t& dest_reg, const reg_t& source_reg, const bcgen_body_t& body){
+void copy_value(bcgenerator_t& vm, const typeid_t& type, const reg_t& dest_reg, const reg_t& source_reg, bcgen_body_t& body_acc){
 	QUARK_ASSERT(vm.check_invariant());
 	QUARK_ASSERT(type.check_invariant());
 	QUARK_ASSERT(dest_reg.check_invariant());
 	QUARK_ASSERT(source_reg.check_invariant());
 
-	auto body_acc = body;
 	bool is_ext = encode_as_external(type);
 
 	//	If this asserts, we should special-case and do nothing.
@@ -344,7 +385,6 @@ bcgen_body_t copy_value(bcgenerator_t& vm, const typeid_t& type, const reg_t& de
 	}
 
 	QUARK_ASSERT(body_acc.check_invariant());
-	return body_acc;
 }
 
 
@@ -353,54 +393,43 @@ bcgen_body_t copy_value(bcgenerator_t& vm, const typeid_t& type, const reg_t& de
 
 //??? need logic that knows that globals can be treated as locals for instructions in global scope.
 
-bcgen_body_t bcgen_store2_statement(bcgenerator_t& vm, const statement_t::store2_t& statement, const bcgen_body_t& body){
+void bcgen_store2_statement(bcgenerator_t& vm, const statement_t::store2_t& statement, bcgen_body_t& body_acc){
 	QUARK_ASSERT(vm.check_invariant());
-	QUARK_ASSERT(body.check_invariant());
-
-	auto body_acc = body;
+	QUARK_ASSERT(body_acc.check_invariant());
 
 	//	Shortcut: if destinatio is a local variable, have the expression write directly to that register.
 	if(statement._dest_variable._parent_steps != -1){
-		const auto expr = bcgen_expression(vm, statement._dest_variable, statement._expression, body_acc);
-		body_acc = expr._body;
+		bcgen_expression(vm, statement._dest_variable, statement._expression, body_acc);
 		QUARK_ASSERT(body_acc.check_invariant());
 	}
 	else{
 		const auto expr = bcgen_expression(vm, {}, statement._expression, body_acc);
-		body_acc = expr._body;
-		body_acc = copy_value(vm, statement._expression.get_output_type(), statement._dest_variable, expr._out, body_acc);
+		copy_value(vm, statement._expression.get_output_type(), statement._dest_variable, expr._out, body_acc);
 		QUARK_ASSERT(body_acc.check_invariant());
 	}
-	return body_acc;
 }
 
-bcgen_body_t bcgen_block_statement(bcgenerator_t& vm, const statement_t::block_statement_t& statement, const bcgen_body_t& body){
+void bcgen_block_statement(bcgenerator_t& vm, const statement_t::block_statement_t& statement, bcgen_body_t& body_acc){
 	QUARK_ASSERT(vm.check_invariant());
-	QUARK_ASSERT(body.check_invariant());
+	QUARK_ASSERT(body_acc.check_invariant());
 
-	const auto body_acc = bcgen_body_block(vm, statement._body);
-	return flatten_body(vm, body, body_acc);
+	const auto block = bcgen_body_block(vm, statement._body);
+	flatten_body(vm, body_acc, block);
 }
 
-bcgen_body_t bcgen_return_statement(bcgenerator_t& vm, const statement_t::return_statement_t& statement, const bcgen_body_t& body){
+void bcgen_return_statement(bcgenerator_t& vm, const statement_t::return_statement_t& statement, bcgen_body_t& body_acc){
 	QUARK_ASSERT(vm.check_invariant());
-	QUARK_ASSERT(body.check_invariant());
+	QUARK_ASSERT(body_acc.check_invariant());
 
-	auto body_acc = body;
-	const auto expr = bcgen_expression(vm, {}, statement._expression, body);
-	body_acc = expr._body;
+	const auto expr = bcgen_expression(vm, {}, statement._expression, body_acc);
 	body_acc._instrs.push_back(bcgen_instruction_t(bc_opcode::k_return, expr._out, {}, {}));
-	return body_acc;
 }
 
-bcgen_body_t bcgen_ifelse_statement(bcgenerator_t& vm, const statement_t::ifelse_statement_t& statement, const bcgen_body_t& body){
+void bcgen_ifelse_statement(bcgenerator_t& vm, const statement_t::ifelse_statement_t& statement, bcgen_body_t& body_acc){
 	QUARK_ASSERT(vm.check_invariant());
-	QUARK_ASSERT(body.check_invariant());
-
-	auto body_acc = body;
+	QUARK_ASSERT(body_acc.check_invariant());
 
 	const auto condition_expr = bcgen_expression(vm, {}, statement._condition, body_acc);
-	body_acc = condition_expr._body;
 	QUARK_ASSERT(statement._condition.get_output_type().is_bool());
 
 	const auto& then_expr = bcgen_body_block(vm, statement._then_body);
@@ -414,7 +443,7 @@ bcgen_body_t bcgen_ifelse_statement(bcgenerator_t& vm, const statement_t::ifelse
 			{}
 		)
 	);
-	body_acc = flatten_body(vm, body_acc, then_expr);
+	flatten_body(vm, body_acc, then_expr);
 	body_acc._instrs.push_back(
 		bcgen_instruction_t(
 			bc_opcode::k_branch_always,
@@ -423,8 +452,7 @@ bcgen_body_t bcgen_ifelse_statement(bcgenerator_t& vm, const statement_t::ifelse
 			{}
 		)
 	);
-	body_acc = flatten_body(vm, body_acc, else_expr);
-	return body_acc;
+	flatten_body(vm, body_acc, else_expr);
 }
 
 /*
@@ -444,17 +472,13 @@ int get_count(const std::vector<bcgen_instruction_t>& instructions){
 	return static_cast<int>(instructions.size());
 }
 
-bcgen_body_t bcgen_for_statement(bcgenerator_t& vm, const statement_t::for_statement_t& statement, const bcgen_body_t& body){
+void bcgen_for_statement(bcgenerator_t& vm, const statement_t::for_statement_t& statement, bcgen_body_t& body_acc){
 	QUARK_ASSERT(vm.check_invariant());
-	QUARK_ASSERT(body.check_invariant());
-
-	auto body_acc = body;
+	QUARK_ASSERT(body_acc.check_invariant());
 
 	const auto start_expr = bcgen_expression(vm, {}, statement._start_expression, body_acc);
-	body_acc = start_expr._body;
 
 	const auto end_expr = bcgen_expression(vm, {}, statement._end_expression, body_acc);
-	body_acc = end_expr._body;
 
 	const auto const1_reg = add_local_const(body_acc, value_t::make_int(1), "integer 1, to decrement with");
 
@@ -478,115 +502,111 @@ bcgen_body_t bcgen_for_statement(bcgenerator_t& vm, const statement_t::for_state
 
 	int body_start_pc = get_count(body_acc._instrs);
 
-	body_acc = flatten_body(vm, body_acc, loop_body);
+	flatten_body(vm, body_acc, loop_body);
 	body_acc._instrs.push_back(bcgen_instruction_t(bc_opcode::k_add_int, counter_reg, counter_reg, const1_reg));
 	body_acc._instrs.push_back(bcgen_instruction_t(condition_opcode, counter_reg, end_expr._out, make_imm_int(body_start_pc - get_count(body_acc._instrs))));
 
 	QUARK_ASSERT(body_acc.check_invariant());
-	return body_acc;
 }
 
-bcgen_body_t bcgen_while_statement(bcgenerator_t& vm, const statement_t::while_statement_t& statement, const bcgen_body_t& body){
+void bcgen_while_statement(bcgenerator_t& vm, const statement_t::while_statement_t& statement, bcgen_body_t& body_acc){
 	QUARK_ASSERT(vm.check_invariant());
-	QUARK_ASSERT(body.check_invariant());
-
-	auto body_acc = body;
+	QUARK_ASSERT(body_acc.check_invariant());
 
 	const auto& loop_body = bcgen_body_block(vm, statement._body);
 	int body_instr_count = static_cast<int>(loop_body._instrs.size());
 	const auto condition_pc = static_cast<int>(body_acc._instrs.size());
 
 	const auto condition_expr = bcgen_expression(vm, {}, statement._condition, body_acc);
-	body_acc = condition_expr._body;
 	body_acc._instrs.push_back(bcgen_instruction_t(bc_opcode::k_branch_false_bool, condition_expr._out, make_imm_int(body_instr_count + 2), {}));
-	body_acc = flatten_body(vm, body_acc, loop_body);
+	flatten_body(vm, body_acc, loop_body);
 	const auto body_end_pc = static_cast<int>(body_acc._instrs.size());
 	body_acc._instrs.push_back(bcgen_instruction_t(bc_opcode::k_branch_always, make_imm_int(condition_pc - body_end_pc), {}, {} ));
-	return body_acc;
 }
 
-bcgen_body_t bcgen_expression_statement(bcgenerator_t& vm, const statement_t::expression_statement_t& statement, const bcgen_body_t& body){
+void bcgen_expression_statement(bcgenerator_t& vm, const statement_t::expression_statement_t& statement, bcgen_body_t& body_acc){
 	QUARK_ASSERT(vm.check_invariant());
-	QUARK_ASSERT(body.check_invariant());
+	QUARK_ASSERT(body_acc.check_invariant());
 
-	auto body_acc = body;
-	const auto& expr = bcgen_expression(vm, {}, statement._expression, body);
-	body_acc = expr._body;
-	return body_acc;
+	bcgen_expression(vm, {}, statement._expression, body_acc);
 }
 
-bcgen_body_t bcgen_body_block(bcgenerator_t& vm, const body_t& body){
+//	Appends the statements' instructions, and any temporaries they need, to body_acc.
+static void bcgen_statements(bcgenerator_t& vm, const std::vector<statement_t>& statements, bcgen_body_t& body_acc){
 	QUARK_ASSERT(vm.check_invariant());
-	QUARK_ASSERT(body.check_invariant());
+	QUARK_ASSERT(body_acc.check_invariant());
 
-	auto body_acc = bcgen_body_t({}, body._symbols);
-	if(body._statements.empty() == false){
-		vm._call_stack.push_back(bcgen_environment_t{ &body_acc });
+	for(const auto& statement: statements){
+		QUARK_ASSERT(statement.check_invariant());
 
-		for(const auto& statement: body._statements){
-			QUARK_ASSERT(statement.check_invariant());
+		struct visitor_t {
+			bcgenerator_t& vm;
+			bcgen_body_t& body_acc;
 
-			struct visitor_t {
-				bcgenerator_t& vm;
-				const bcgen_body_t body_acc;
+			void operator()(const statement_t::return_statement_t& s) const{
+				bcgen_return_statement(vm, s, body_acc);
+			}
+			void operator()(const statement_t::define_struct_statement_t& s) const{
+				QUARK_ASSERT(false);
+				quark::throw_exception();
+			}
+			void operator()(const statement_t::define_protocol_statement_t& s) const{
+				QUARK_ASSERT(false);
+				quark::throw_exception();
+			}
+			void operator()(const statement_t::define_function_statement_t& s) const{
+				QUARK_ASSERT(false);
+				quark::throw_exception();
+			}
 
-				bcgen_body_t operator()(const statement_t::return_statement_t& s) const{
-					return bcgen_return_statement(vm, s, body_acc);
-				}
-				bcgen_body_t operator()(const statement_t::define_struct_statement_t& s) const{
-					QUARK_ASSERT(false);
-					quark::throw_exception();
-				}
-				bcgen_body_t operator()(const statement_t::define_protocol_statement_t& s) const{
-					QUARK_ASSERT(false);
-					quark::throw_exception();
-				}
-				bcgen_body_t operator()(const statement_t::define_function_statement_t& s) const{
-					QUARK_ASSERT(false);
-					quark::throw_exception();
-				}
+			void operator()(const statement_t::bind_local_t& s) const{
+				QUARK_ASSERT(false);
+				quark::throw_exception();
+			}
+			void operator()(const statement_t::store_t& s) const{
+				QUARK_ASSERT(false);
+				quark::throw_exception();
+			}
+			void operator()(const statement_t::store2_t& s) const{
+				bcgen_store2_statement(vm, s, body_acc);
+			}
+			void operator()(const statement_t::block_statement_t& s) const{
+				bcgen_block_statement(vm, s, body_acc);
+			}
 
-				bcgen_body_t operator()(const statement_t::bind_local_t& s) const{
-					QUARK_ASSERT(false);
-					quark::throw_exception();
-				}
-				bcgen_body_t operator()(const statement_t::store_t& s) const{
-					QUARK_ASSERT(false);
-					quark::throw_exception();
-				}
-				bcgen_body_t operator()(const statement_t::store2_t& s) const{
-					return bcgen_store2_statement(vm, s, body_acc);
-				}
-				bcgen_body_t operator()(const statement_t::block_statement_t& s) const{
-					return bcgen_block_statement(vm, s, body_acc);
-				}
+			void operator()(const statement_t::ifelse_statement_t& s) const{
+				bcgen_ifelse_statement(vm, s, body_acc);
+			}
+			void operator()(const statement_t::for_statement_t& s) const{
+				bcgen_for_statement(vm, s, body_acc);
+			}
+			void operator()(const statement_t::while_statement_t& s) const{
+				bcgen_while_statement(vm, s, body_acc);
+			}
 
-				bcgen_body_t operator()(const statement_t::ifelse_statement_t& s) const{
-					return bcgen_ifelse_statement(vm, s, body_acc);
-				}
-				bcgen_body_t operator()(const statement_t::for_statement_t& s) const{
-					return bcgen_for_statement(vm, s, body_acc);
-				}
-				bcgen_body_t operator()(const statement_t::while_statement_t& s) const{
-					return bcgen_while_statement(vm, s, body_acc);
-				}
 
+			void operator()(const statement_t::expression_statement_t& s) const{
+				bcgen_expression_statement(vm, s, body_acc);
+			}
+			void operator()(const statement_t::software_system_statement_t& s) const{
+			}
+			void operator()(const statement_t::container_def_statement_t& s) const{
+			}
+		};
 
-				bcgen_body_t operator()(const statement_t::expression_statement_t& s) const{
-					return bcgen_expression_statement(vm, s, body_acc);
-				}
-				bcgen_body_t operator()(const statement_t::software_system_statement_t& s) const{
-					return body_acc;
-				}
-				bcgen_body_t operator()(const statement_t::container_def_statement_t& s) const{
-					return body_acc;
-				}
-			};
+		std::visit(visitor_t{ vm, body_acc }, statement._contents);
+		QUARK_ASSERT(body_acc.check_invariant());
+	}
+}
 
-			body_acc = std::visit(visitor_t{vm, body_acc}, statement._contents);
-			QUARK_ASSERT(body_acc.check_invariant());
-		}
+bcgen_body_t bcgen_body_block(bcgenerator_t& vm, const body_t& body){
+	QUARK_ASSERT(vm.check_invariant());
+	QUARK_ASSERT(body.check_invariant());
 
+	auto body_acc = bcgen_body_t({}, body._symbols);
+	if(body._statements.empty() == false){
+		vm._call_stack.push_back(bcgen_environment_t{ &body_acc });
+		bcgen_statements(vm, body._statements, body_acc);
 		vm._call_stack.pop_back();
 	}
 
@@ -615,15 +635,12 @@ bcgen_body_t bcgen_body_top(bcgenerator_t& vm, const body_t& body){
 //////////////////////////////////////		PROCESS EXPRESSIONS
 
 
-expression_gen_t bcgen_resolve_member_expression(bcgenerator_t& vm, const variable_address_t& target_reg, const expression_t& e, const bcgen_body_t& body){
+expression_gen_t bcgen_resolve_member_expression(bcgenerator_t& vm, const variable_address_t& target_reg, const expression_t& e, bcgen_body_t& body_acc){
 	QUARK_ASSERT(vm.check_invariant());
 	QUARK_ASSERT(e._input_exprs[0].get_output_type().is_struct());
-	QUARK_ASSERT(body.check_invariant());
-
-	auto body_acc = body;
+	QUARK_ASSERT(body_acc.check_invariant());
 
-	const auto& parent_expr = bcgen_expression(vm, {}, e._input_exprs[0], body);
-	body_acc = parent_expr._body;
+	const auto& parent_expr = bcgen_expression(vm, {}, e._input_exprs[0], body_acc);
 
 	const auto& struct_def = e._input_exprs[0].get_output_type().get_struct();
 	int index = find_struct_member_index(struct_def, e._variable_name);
@@ -637,21 +654,17 @@ expression_gen_t bcgen_resolve_member_expression(bcgenerator_t& vm, const variab
 	));
 
 	QUARK_ASSERT(body_acc.check_invariant());
-	return { body_acc, target_reg2, intern_type(vm, *e._output_type) };
+	return { target_reg2, intern_type(vm, *e._output_type) };
 }
 
-expression_gen_t bcgen_lookup_element_expression(bcgenerator_t& vm, const variable_address_t& target_reg, const expression_t& e, const bcgen_body_t& body){
+expression_gen_t bcgen_lookup_element_expression(bcgenerator_t& vm, const variable_address_t& target_reg, const expression_t& e, bcgen_body_t& body_acc){
 	QUARK_ASSERT(vm.check_invariant());
 	QUARK_ASSERT(e.check_invariant());
-	QUARK_ASSERT(body.check_invariant());
-
-	auto body_acc = body;
+	QUARK_ASSERT(body_acc.check_invariant());
 
 	const auto& parent_expr = bcgen_expression(vm, {}, e._input_exprs[0], body_acc);
-	body_acc = parent_expr._body;
 
 	const auto& key_expr = bcgen_expression(vm, {}, e._input_exprs[1], body_acc);
-	body_acc = key_expr._body;
 
 	const auto parent_type = vm._types[parent_expr._type];
 	const auto opcode = [&parent_type]{
@@ -692,29 +705,28 @@ expression_gen_t bcgen_lookup_element_expression(bcgenerator_t& vm, const variab
 		key_expr._out
 	));
 	QUARK_ASSERT(body_acc.check_invariant());
-	return { body_acc, target_reg2, intern_type(vm, e.get_output_type()) };
+	return { target_reg2, intern_type(vm, e.get_output_type()) };
 }
 
 //??? Value already sits in a register / global -- no need to generate code to copy it in most cases!
-expression_gen_t bcgen_load2_expression(bcgenerator_t& vm, const variable_address_t& target_reg, const expression_t& e, const bcgen_body_t& body){
+expression_gen_t bcgen_load2_expression(bcgenerator_t& vm, const variable_address_t& target_reg, const expression_t& e, bcgen_body_t& body_acc){
 	QUARK_ASSERT(vm.check_invariant());
 	QUARK_ASSERT(e.check_invariant());
-	QUARK_ASSERT(body.check_invariant());
+	QUARK_ASSERT(body_acc.check_invariant());
 
-	auto body_acc = body;
 	const auto result_type = e.get_output_type();
 
 	//	Shortcut: If we're loading a local-variable and are free from putting it in target_reg -- just acces the register where it sits = no instruction!
 	if(target_reg.is_empty() && e._address._parent_steps != -1){
 		QUARK_ASSERT(body_acc.check_invariant());
-		return { body_acc, e._address, intern_type(vm, result_type) };
+		return { e._address, intern_type(vm, result_type) };
 	}
 	else{
 		const auto target_reg2 = target_reg.is_empty() ? add_local_temp(body_acc, e.get_output_type(), "temp: load2") : target_reg;
-		body_acc = copy_value(vm, result_type, target_reg2, e._address, body_acc);
+		copy_value(vm, result_type, target_reg2, e._address, body_acc);
 
 		QUARK_ASSERT(body_acc.check_invariant());
-		return { body_acc, target_reg2, intern_type(vm, result_type) };
+		return { target_reg2, intern_type(vm, result_type) };
 	}
 }
 
@@ -741,7 +753,6 @@ uint32_t pack_bools(const std::vector<bool>& bools){
 	Supports DYN-arguments.
 */
 struct call_setup_t {
-	bcgen_body_t _body;
 	std::vector<bool> _exts;
 	int _stack_count;
 };
@@ -751,14 +762,12 @@ struct call_setup_t {
 //??? make different types for register vs stack-pos.
 
 //	NOTICE: extbits are generated for every value on callstack, even for DYN-types.
-call_setup_t gen_call_setup(bcgenerator_t& vm, const std::vector<typeid_t>& function_def_arg_type, const expression_t* args, int callee_arg_count, const bcgen_body_t& body){
+call_setup_t gen_call_setup(bcgenerator_t& vm, const std::vector<typeid_t>& function_def_arg_type, const expression_t* args, int callee_arg_count, bcgen_body_t& body_acc){
 	QUARK_ASSERT(vm.check_invariant());
 	QUARK_ASSERT(args != nullptr || callee_arg_count == 0);
-	QUARK_ASSERT(body.check_invariant());
+	QUARK_ASSERT(body_acc.check_invariant());
 	QUARK_ASSERT(callee_arg_count == function_def_arg_type.size());
 
-	auto body_acc = body;
-
 	int dynamic_arg_count = count_function_dynamic_args(function_def_arg_type);
 	const auto arg_count = callee_arg_count;
 
@@ -767,7 +776,6 @@ call_setup_t gen_call_setup(bcgenerator_t& vm, const std::vector<typeid_t>& func
 	std::vector<std::pair<reg_t, bc_typeid_t>> argument_regs;
 	for(int i = 0 ; i < arg_count ; i++){
 		const auto& m2 = bcgen_expression(vm, {}, args[i], body_acc);
-		body_acc = m2._body;
 		argument_regs.push_back(std::pair<reg_t, bc_typeid_t>(m2._out, m2._type));
 	}
 
@@ -807,20 +815,21 @@ call_setup_t gen_call_setup(bcgenerator_t& vm, const std::vector<typeid_t>& func
 
 	QUARK_ASSERT(vm.check_invariant());
 	QUARK_ASSERT(body_acc.check_invariant());
-	return { body_acc, exts, stack_count };
+	return { exts, stack_count };
 }
 
-int get_host_function_id(bcgenerator_t& vm, const expression_t& e){
-	if(e._input_exprs[0]._operation == expression_type::k_load2 && e._input_exprs[0]._address._parent_steps == -1){
-		const auto global_index = e._input_exprs[0]._address._index;
+//	Returns the function id if e loads a global that always holds the same function: a host function constant or a
+//	function bound by a global statement. Else -1.
+static int get_static_function_id(const bcgenerator_t& vm, const expression_t& e){
+	if(e._operation == expression_type::k_load2 && e._address._parent_steps == -1){
+		const auto global_index = e._address._index;
 		const auto& global_symbol = vm._call_stack[0]._body_ptr->_symbols._symbols[global_index];
 		if(global_symbol.second._const_value.is_function()){
-			const auto function_id = global_symbol.second._const_value.get_function_value();
-			const auto& function_def = vm._ast_imm->_checked_ast._function_defs[function_id];
-			return function_def->_host_function_id;
+			return global_symbol.second._const_value.get_function_value();
 		}
 		else{
-			return -1;
+			const auto it = vm._static_functions.find(global_index);
+			return it != vm._static_functions.end() ? it->second : -1;
 		}
 	}
 	else{
@@ -828,6 +837,34 @@ int get_host_function_id(bcgenerator_t& vm, const expression_t& e){
 	}
 }
 
+int get_host_function_id(bcgenerator_t& vm, const expression_t& e){
+	const auto function_id = get_static_function_id(vm, e._input_exprs[0]);
+	if(function_id != -1){
+		const auto& function_def = vm._ast_imm->_checked_ast._function_defs[function_id];
+		return function_def->_host_function_id;
+	}
+	else{
+		return -1;
+	}
+}
+
+//	Records the globals that statements bind to a function literal.
+static void record_static_functions(bcgenerator_t& vm, const symbol_table_t& globals, const std::vector<statement_t>& statements){
+	for(const auto& statement: statements){
+		const auto store = std::get_if<statement_t::store2_t>(&statement._contents);
+		if(store != nullptr
+			&& store->_dest_variable._parent_steps <= 0
+			&& store->_expression.get_operation() == expression_type::k_literal
+			&& store->_expression.get_literal().is_function()
+		){
+			const auto global_index = store->_dest_variable._index;
+			if(globals._symbols[global_index].second._symbol_type == symbol_t::immutable_local){
+				vm._static_functions[global_index] = store->_expression.get_literal().get_function_value();
+			}
+		}
+	}
+}
+
 //	a = size(b)
 bc_opcode convert_call_to_size_opcode(const typeid_t& arg1_type){
 	QUARK_ASSERT(arg1_type.check_invariant());
@@ -878,12 +915,253 @@ bc_opcode convert_call_to_pushback_opcode(const typeid_t& arg1_type){
 	}
 }
 
-expression_gen_t bcgen_call_expression(bcgenerator_t& vm, const variable_address_t& target_reg, const expression_t& e, const bcgen_body_t& body){
+//////////////////////////////////////		INLINING
+
+/*
+	A call to an inlinable function is replaced by the function's body, generated as a block and flattened into the
+	caller's frame, the same way as a block statement. The callee's arguments are its first symbols, so the argument
+	values are copied into those registers before the body runs. The value of the final return statement is then
+	copied to the call's output register.
+*/
+
+struct inline_scan_t {
+	//	Number of statements and expression nodes.
+	int _size;
+
+	bool _inlinable;
+
+	//	Every function the body refers to through a global, except host functions.
+	std::vector<int> _function_ids;
+};
+
+static void scan_inline_expression(const bcgenerator_t& vm, const expression_t& e, int depth, inline_scan_t& acc){
+	acc._size++;
+	if(e._operation == expression_type::k_load2){
+		//	Locals of the caller can't be reached from the caller's frame.
+		if(e._address._parent_steps > depth){
+			acc._inlinable = false;
+		}
+
+		const auto function_id = get_static_function_id(vm, e);
+		if(function_id != -1 && vm._ast_imm->_checked_ast._function_defs[function_id]->_host_function_id == k_no_host_function_id){
+			acc._function_ids.push_back(function_id);
+		}
+	}
+	for(const auto& m: e._input_exprs){
+		scan_inline_expression(vm, m, depth, acc);
+	}
+}
+
+static void scan_inline_statements(const bcgenerator_t& vm, const std::vector<statement_t>& statements, int depth, inline_scan_t& acc);
+
+//	depth: how many blocks the statement is nested in, inside the function body.
+static void scan_inline_statement(const bcgenerator_t& vm, const statement_t& statement, int depth, inline_scan_t& acc){
+	acc._size++;
+
+	struct visitor_t {
+		const bcgenerator_t& vm;
+		int depth;
+		inline_scan_t& acc;
+
+		//	Only the final return statement of the body can be inlined, scan_inline_function() handles that one.
+		void operator()(const statement_t::return_statement_t& s) const{
+			acc._inlinable = false;
+			scan_inline_expression(vm, s._expression, depth, acc);
+		}
+		void operator()(const statement_t::define_struct_statement_t& s) const{
+			acc._inlinable = false;
+		}
+		void operator()(const statement_t::define_protocol_statement_t& s) const{
+			acc._inlinable = false;
+		}
+		void operator()(const statement_t::define_function_statement_t& s) const{
+			acc._inlinable = false;
+		}
+		void operator()(const statement_t::bind_local_t& s) const{
+			acc._inlinable = false;
+		}
+		void operator()(const statement_t::store_t& s) const{
+			acc._inlinable = false;
+		}
+		void operator()(const statement_t::store2_t& s) const{
+			if(s._dest_variable._parent_steps > depth){
+				acc._inlinable = false;
+			}
+			scan_inline_expression(vm, s._expression, depth, acc);
+		}
+		void operator()(const statement_t::block_statement_t& s) const{
+			scan_inline_statements(vm, s._body._statements, depth + 1, acc);
+		}
+		void operator()(const statement_t::ifelse_statement_t& s) const{
+			scan_inline_expression(vm, s._condition, depth, acc);
+			scan_inline_statements(vm, s._then_body._statements, depth + 1, acc);
+			scan_inline_statements(vm, s._else_body._statements, depth + 1, acc);
+		}
+		void operator()(const statement_t::for_statement_t& s) const{
+			scan_inline_expression(vm, s._start_expression, depth, acc);
+			scan_inline_expression(vm, s._end_expression, depth, acc);
+			scan_inline_statements(vm, s._body._statements, depth + 1, acc);
+		}
+		void operator()(const statement_t::while_statement_t& s) const{
+			scan_inline_expression(vm, s._condition, depth, acc);
+			scan_inline_statements(vm, s._body._statements, depth + 1, acc);
+		}
+		void operator()(const statement_t::expression_statement_t& s) const{
+			scan_inline_expression(vm, s._expression, depth, acc);
+		}
+		void operator()(const statement_t::software_system_statement_t& s) const{
+			acc._inlinable = false;
+		}
+		void operator()(const statement_t::container_def_statement_t& s) const{
+			acc._inlinable = false;
+		}
+	};
+	std::visit(visitor_t{ vm, depth, acc }, statement._contents);
+}
+
+static void scan_inline_statements(const bcgenerator_t& vm, const std::vector<statement_t>& statements, int depth, inline_scan_t& acc){
+	for(const auto& statement: statements){
+		scan_inline_statement(vm, statement, depth, acc);
+	}
+}
+
+static inline_scan_t scan_inline_function(const bcgenerator_t& vm, int function_id){
+	const auto& function_def = *vm._ast_imm->_checked_ast._function_defs[function_id];
+	if(function_def._host_function_id != k_no_host_function_id || function_def._body == nullptr){
+		return inline_scan_t{ 0, false, {} };
+	}
+
+	const auto& function_type = function_def._function_type;
+	const auto& args = function_type.get_function_args();
+	const auto& statements = function_def._body->_statements;
+	const auto last_return = statements.empty() ? nullptr : std::get_if<statement_t::return_statement_t>(&statements.back()._contents);
+
+	auto acc = inline_scan_t{ 0, true, {} };
+	if(false
+		|| function_type.get_function_pure() != epure::pure
+		|| last_return == nullptr
+		|| std::any_of(args.begin(), args.end(), [](const typeid_t& e){ return e.is_internal_dynamic(); })
+	){
+		acc._inlinable = false;
+	}
+	for(int i = 0 ; i < statements.size() ; i++){
+		if(last_return != nullptr && i == statements.size() - 1){
+			acc._size++;
+			scan_inline_expression(vm, last_return->_expression, 0, acc);
+		}
+		else{
+			scan_inline_statement(vm, statements[i], 0, acc);
+		}
+	}
+	return acc;
+}
+
+//	True if the function can reach itself through the functions it refers to.
+static bool is_recursive_function(const bcgenerator_t& vm, int function_id, const std::vector<int>& function_ids){
+	std::vector<int> stack = function_ids;
+	std::set<int> visited;
+	while(stack.empty() == false){
+		const auto id = stack.back();
+		stack.pop_back();
+		if(id == function_id){
+			return true;
+		}
+		if(visited.insert(id).second){
+			const auto scan = scan_inline_function(vm, id);
+			stack.insert(stack.end(), scan._function_ids.begin(), scan._function_ids.end());
+		}
+	}
+	return false;
+}
+
+//	Returns the size of the function's body once inlined, or -1 if it can't be inlined.
+static int get_inline_size(bcgenerator_t& vm, int function_id){
+	if(vm._no_inline.count(function_id) > 0){
+		return -1;
+	}
+	const auto it = vm._inline_sizes.find(function_id);
+	if(it != vm._inline_sizes.end()){
+		return it->second;
+	}
+
+	const auto scan = scan_inline_function(vm, function_id);
+	int size = -1;
+	if(scan._inlinable && is_recursive_function(vm, function_id, scan._function_ids) == false){
+		//	Callees can't refer back to this function, so this recursion ends.
+		size = scan._size;
+		for(const auto id: scan._function_ids){
+			const auto callee_size = get_inline_size(vm, id);
+			if(callee_size != -1 && callee_size <= vm._inline_budget){
+				size = size + callee_size;
+			}
+		}
+	}
+	vm._inline_sizes.insert({ function_id, size });
+	return size;
+}
+
+static bool is_inlinable(bcgenerator_t& vm, int function_id){
+	if(vm._inline_budget <= 0){
+		return false;
+	}
+	const auto size = get_inline_size(vm, function_id);
+	return size != -1 && size <= vm._inline_budget;
+}
+
+static expression_gen_t bcgen_inlined_call_expression(bcgenerator_t& vm, const variable_address_t& target_reg, const expression_t& e, int function_id, bcgen_body_t& body_acc){
 	QUARK_ASSERT(vm.check_invariant());
 	QUARK_ASSERT(e.check_invariant());
-	QUARK_ASSERT(body.check_invariant());
+	QUARK_ASSERT(body_acc.check_invariant());
+
+	vm._inlined.insert(function_id);
+	const auto& function_def = *vm._ast_imm->_checked_ast._function_defs[function_id];
+	const auto& body = *function_def._body;
+	const auto& args = function_def._function_type.get_function_args();
+	const auto arg_count = static_cast<int>(args.size());
+	const auto return_type = e.get_output_type();
+	QUARK_ASSERT(arg_count == e._input_exprs.size() - 1);
+	QUARK_ASSERT(body._symbols._symbols.size() >= arg_count);
+	QUARK_ASSERT(arg_count == 0 || body._symbols._symbols[arg_count - 1].first == function_def._args[arg_count - 1]._name);
+
+	std::vector<reg_t> argument_regs;
+	for(int i = 0 ; i < arg_count ; i++){
+		const auto& m2 = bcgen_expression(vm, {}, e._input_exprs[i + 1], body_acc);
+		argument_regs.push_back(m2._out);
+	}
+	const auto target_reg2 = target_reg.is_empty() ? add_local_temp(body_acc, return_type, "temp: inlined call return") : target_reg;
 
-	auto body_acc = body;
+	auto block = bcgen_body_t({}, body._symbols);
+	vm._call_stack.push_back(bcgen_environment_t{ &block });
+	const auto& statements = body._statements;
+	bcgen_statements(vm, { statements.begin(), statements.end() - 1 }, block);
+	const auto& return_statement = std::get<statement_t::return_statement_t>(statements.back()._contents);
+	const auto result = bcgen_expression(vm, {}, return_statement._expression, block);
+	vm._call_stack.pop_back();
+
+	//	Keep the callee's symbol names apart from the caller's, flattening into the global frame makes them globals.
+	for(auto& symbol: block._symbols._symbols){
+		symbol.first = "inlined: " + symbol.first;
+	}
+
+	const auto offset = static_cast<int>(body_acc._symbols._symbols.size());
+	for(int i = 0 ; i < arg_count ; i++){
+		copy_value(vm, args[i], reg_t::make_variable_address(0, offset + i), argument_regs[i], body_acc);
+	}
+	flatten_body(vm, body_acc, block);
+
+	const auto result_reg = flatten_reg(result._out, offset);
+	if((result_reg == target_reg2) == false){
+		copy_value(vm, return_type, target_reg2, result_reg, body_acc);
+	}
+
+	QUARK_ASSERT(body_acc.check_invariant());
+	return { target_reg2, intern_type(vm, return_type) };
+}
+
+expression_gen_t bcgen_call_expression(bcgenerator_t& vm, const variable_address_t& target_reg, const expression_t& e, bcgen_body_t& body_acc){
+	QUARK_ASSERT(vm.check_invariant());
+	QUARK_ASSERT(e.check_invariant());
+	QUARK_ASSERT(body_acc.check_invariant());
 
 	//	_input_exprs[0] is callee, rest are arguments.
 	const auto callee_arg_count = static_cast<int>(e._input_exprs.size()) - 1;
@@ -905,12 +1183,11 @@ expression_gen_t bcgen_call_expression(bcgenerator_t& vm, const variable_address
 		bc_opcode opcode = convert_call_to_size_opcode(arg1_type);
 		if(opcode != bc_opcode::k_nop){
 			const auto& arg1_expr = bcgen_expression(vm, {}, e._input_exprs[1], body_acc);
-			body_acc = arg1_expr._body;
 
 			const auto target_reg2 = target_reg.is_empty() ? add_local_temp(body_acc, e.get_output_type(), "temp: result for k_get_size_vector_x") : target_reg;
 			body_acc._instrs.push_back(bcgen_instruction_t(opcode, target_reg2, arg1_expr._out, make_imm_int(0)));
 			QUARK_ASSERT(body_acc.check_invariant());
-			return { body_acc, target_reg2, intern_type(vm, return_type) };
+			return { target_reg2, intern_type(vm, return_type) };
 		}
 		else{
 		}
@@ -929,31 +1206,32 @@ expression_gen_t bcgen_call_expression(bcgenerator_t& vm, const variable_address
 			}
 
 			const auto& arg1_expr = bcgen_expression(vm, {}, e._input_exprs[1], body_acc);
-			body_acc = arg1_expr._body;
 
 			const auto& arg2_expr = bcgen_expression(vm, {}, e._input_exprs[2], body_acc);
-			body_acc = arg2_expr._body;
 
 			const auto target_reg2 = target_reg.is_empty() ? add_local_temp(body_acc, e.get_output_type(), "temp: result for k_pushback_x") : target_reg;
 
 			body_acc._instrs.push_back(bcgen_instruction_t(opcode, target_reg2, arg1_expr._out, arg2_expr._out));
 			QUARK_ASSERT(body_acc.check_invariant());
-			return { body_acc, target_reg2, intern_type(vm, return_type) };
+			return { target_reg2, intern_type(vm, return_type) };
 		}
 		else{
 		}
 	}
 
 
+	const auto function_id = get_static_function_id(vm, e._input_exprs[0]);
+	if(function_id != -1 && is_inlinable(vm, function_id)){
+		return bcgen_inlined_call_expression(vm, target_reg, e, function_id, body_acc);
+	}
+
 	//	Normal function call.
 	{
 		body_acc._instrs.push_back(bcgen_instruction_t(bc_opcode::k_push_frame_ptr, {}, {}, {} ));
 
 		const auto& callee_expr = bcgen_expression(vm, {}, e._input_exprs[0], body_acc);
-		body_acc = callee_expr._body;
 
 		const auto call_setup = gen_call_setup(vm, function_def_arg_types, &e._input_exprs[1], callee_arg_count, body_acc);
-		body_acc = call_setup._body;
 
 		const auto target_reg2 = target_reg.is_empty() ? add_local_temp(body_acc, e.get_output_type(), "temp: call return") : target_reg;
 
@@ -971,19 +1249,17 @@ expression_gen_t bcgen_call_expression(bcgenerator_t& vm, const variable_address
 		body_acc._instrs.push_back(bcgen_instruction_t(bc_opcode::k_pop_frame_ptr, {}, {}, {} ));
 
 		QUARK_ASSERT(body_acc.check_invariant());
-		return { body_acc, target_reg2, intern_type(vm, return_type) };
+		return { target_reg2, intern_type(vm, return_type) };
 	}
 }
 
 //??? Submit dest-register to all gen-functions = minimize temps.
 //??? Wrap itype in struct to make it typesafe.
 
-expression_gen_t bcgen_construct_value_expression(bcgenerator_t& vm, const variable_address_t& target_reg, const expression_t& e, const bcgen_body_t& body){
+expression_gen_t bcgen_construct_value_expression(bcgenerator_t& vm, const variable_address_t& target_reg, const expression_t& e, bcgen_body_t& body_acc){
 	QUARK_ASSERT(vm.check_invariant());
 	QUARK_ASSERT(e.check_invariant());
-	QUARK_ASSERT(body.check_invariant());
-
-	auto body_acc = body;
+	QUARK_ASSERT(body_acc.check_invariant());
 
 	const auto target_type = e.get_output_type();
 	const auto target_itype = intern_type(vm, target_type);
@@ -996,7 +1272,6 @@ expression_gen_t bcgen_construct_value_expression(bcgenerator_t& vm, const varia
 	const auto arg_count = callee_arg_count;
 
 	const auto call_setup = gen_call_setup(vm, arg_types, &e._input_exprs[0], arg_count, body_acc);
-	body_acc = call_setup._body;
 
 	const auto source_itype = arg_count == 0 ? -1 : intern_type(vm, e._input_exprs[0].get_output_type());
 
@@ -1061,23 +1336,23 @@ expression_gen_t bcgen_construct_value_expression(bcgenerator_t& vm, const varia
 	body_acc._instrs.push_back(bcgen_instruction_t(bc_opcode::k_popn, make_imm_int(call_setup._stack_count), make_imm_int(extbits), {} ));
 
 	QUARK_ASSERT(body_acc.check_invariant());
-	return { body_acc, target_reg2, target_itype };
+	return { target_reg2, target_itype };
 }
 
-expression_gen_t bcgen_arithmetic_unary_minus_expression(bcgenerator_t& vm, const variable_address_t& target_reg, const expression_t& e, const bcgen_body_t& body){
+expression_gen_t bcgen_arithmetic_unary_minus_expression(bcgenerator_t& vm, const variable_address_t& target_reg, const expression_t& e, bcgen_body_t& body_acc){
 	QUARK_ASSERT(vm.check_invariant());
 	QUARK_ASSERT(e.check_invariant());
-	QUARK_ASSERT(body.check_invariant());
+	QUARK_ASSERT(body_acc.check_invariant());
 
 	const auto type = e._input_exprs[0].get_output_type();
 
 	if(type.is_int()){
 		const auto e2 = expression_t::make_simple_expression__2(expression_type::k_arithmetic_subtract__2, expression_t::make_literal_int(0), e._input_exprs[0], e._output_type);
-		return bcgen_expression(vm, target_reg, e2, body);
+		return bcgen_expression(vm, target_reg, e2, body_acc);
 	}
 	else if(type.is_double()){
 		const auto e2 = expression_t::make_simple_expression__2(expression_type::k_arithmetic_subtract__2, expression_t::make_literal_double(0), e._input_exprs[0], e._output_type);
-		return bcgen_expression(vm, target_reg, e2, body);
+		return bcgen_expression(vm, target_reg, e2, body_acc);
 	}
 	else{
 		QUARK_ASSERT(false);
@@ -1098,15 +1373,12 @@ expression_gen_t bcgen_arithmetic_unary_minus_expression(bcgenerator_t& vm, cons
 		temp = c
 	}
 */
-expression_gen_t bcgen_conditional_operator_expression(bcgenerator_t& vm, const variable_address_t& target_reg, const expression_t& e, const bcgen_body_t& body){
+expression_gen_t bcgen_conditional_operator_expression(bcgenerator_t& vm, const variable_address_t& target_reg, const expression_t& e, bcgen_body_t& body_acc){
 	QUARK_ASSERT(vm.check_invariant());
 	QUARK_ASSERT(e.check_invariant());
-	QUARK_ASSERT(body.check_invariant());
-
-	auto body_acc = body;
+	QUARK_ASSERT(body_acc.check_invariant());
 
 	const auto& condition_expr = bcgen_expression(vm, {}, e._input_exprs[0], body_acc);
-	body_acc = condition_expr._body;
 
 	const auto result_type = e.get_output_type();
 	const auto result_itype = intern_type(vm, result_type);
@@ -1126,7 +1398,6 @@ expression_gen_t bcgen_conditional_operator_expression(bcgenerator_t& vm, const
 	////////	A expression
 
 	const auto& a_expr = bcgen_expression(vm, target_reg2, e._input_exprs[1], body_acc);
-	body_acc = a_expr._body;
 
 	int jump2_pc = static_cast<int>(body_acc._instrs.size());
 	body_acc._instrs.push_back(
@@ -1142,7 +1413,6 @@ expression_gen_t bcgen_conditional_operator_expression(bcgenerator_t& vm, const
 
 	int b_pc = static_cast<int>(body_acc._instrs.size());
 	const auto& b_expr = bcgen_expression(vm, target_reg2, e._input_exprs[2], body_acc);
-	body_acc = b_expr._body;
 
 	int end_pc = static_cast<int>(body_acc._instrs.size());
 
@@ -1152,22 +1422,18 @@ expression_gen_t bcgen_conditional_operator_expression(bcgenerator_t& vm, const
 	body_acc._instrs[jump2_pc]._reg_a._index = end_pc - jump2_pc;
 
 	QUARK_ASSERT(body_acc.check_invariant());
-	return { body_acc, target_reg2, result_itype };
+	return { target_reg2, result_itype };
 }
 
-expression_gen_t bcgen_comparison_expression(bcgenerator_t& vm, const variable_address_t& target_reg, expression_type op, const expression_t& e, const bcgen_body_t& body){
+expression_gen_t bcgen_comparison_expression(bcgenerator_t& vm, const variable_address_t& target_reg, expression_type op, const expression_t& e, bcgen_body_t& body_acc){
 	QUARK_ASSERT(vm.check_invariant());
 	QUARK_ASSERT(e.check_invariant());
-	QUARK_ASSERT(body.check_invariant());
-
-	auto body_acc = body;
+	QUARK_ASSERT(body_acc.check_invariant());
 
 	const auto& left_expr = bcgen_expression(vm, {}, e._input_exprs[0], body_acc);
-	body_acc = left_expr._body;
 
 //	const auto right_value_reg = add_local_temp(body_acc, e._input_exprs[1].get_output_type(), "temp: left value");
 	const auto& right_expr = bcgen_expression(vm, {}, e._input_exprs[1], body_acc);
-	body_acc = right_expr._body;
 
 	//	Type is the data the opcode works on -- comparing two ints, comparing two strings etc.
 	const auto type = e._input_exprs[0].get_output_type();
@@ -1220,21 +1486,17 @@ expression_gen_t bcgen_comparison_expression(bcgenerator_t& vm, const variable_a
 	}
 
 	QUARK_ASSERT(body_acc.check_invariant());
-	return { body_acc, target_reg2, intern_type(vm, typeid_t::make_bool()) };
+	return { target_reg2, intern_type(vm, typeid_t::make_bool()) };
 }
 
-expression_gen_t bcgen_arithmetic_expression(bcgenerator_t& vm, const variable_address_t& target_reg, expression_type op, const expression_t& e, const bcgen_body_t& body){
+expression_gen_t bcgen_arithmetic_expression(bcgenerator_t& vm, const variable_address_t& target_reg, expression_type op, const expression_t& e, bcgen_body_t& body_acc){
 	QUARK_ASSERT(vm.check_invariant());
 	QUARK_ASSERT(e.check_invariant());
-	QUARK_ASSERT(body.check_invariant());
-
-	auto body_acc = body;
+	QUARK_ASSERT(body_acc.check_invariant());
 
 	const auto& left_expr = bcgen_expression(vm, {}, e._input_exprs[0], body_acc);
-	body_acc = left_expr._body;
 
 	const auto& right_expr = bcgen_expression(vm, {}, e._input_exprs[1], body_acc);
-	body_acc = right_expr._body;
 
 	const auto type = e._input_exprs[0].get_output_type();
 	const auto itype = intern_type(vm, type);
@@ -1332,67 +1594,65 @@ expression_gen_t bcgen_arithmetic_expression(bcgenerator_t& vm, const variable_a
 	body_acc._instrs.push_back(bcgen_instruction_t(opcode, target_reg2, left_expr._out, right_expr._out));
 
 	QUARK_ASSERT(body_acc.check_invariant());
-	return { body_acc, target_reg2, itype };
+	return { target_reg2, itype };
 }
 
-expression_gen_t bcgen_literal_expression(bcgenerator_t& vm, const variable_address_t& target_reg, const expression_t& e, const bcgen_body_t& body){
+expression_gen_t bcgen_literal_expression(bcgenerator_t& vm, const variable_address_t& target_reg, const expression_t& e, bcgen_body_t& body_acc){
 	QUARK_ASSERT(vm.check_invariant());
-	QUARK_ASSERT(body.check_invariant());
-
-	auto body_acc = body;
+	QUARK_ASSERT(body_acc.check_invariant());
 
 	const auto const_temp = add_local_const(body_acc, e.get_literal(), "literal constant");
 	if(target_reg.is_empty()){
 		QUARK_ASSERT(body_acc.check_invariant());
-		return { body_acc, const_temp, intern_type(vm, *e._output_type) };
+		return { const_temp, intern_type(vm, *e._output_type) };
 	}
 
 	//	We need to copy the value to the target reg...
 	else{
 		const auto result_type = e.get_output_type();
-		body_acc = copy_value(vm, result_type, target_reg, const_temp, body_acc);
+		copy_value(vm, result_type, target_reg, const_temp, body_acc);
 
 		QUARK_ASSERT(body_acc.check_invariant());
-		return { body_acc, target_reg, intern_type(vm, result_type) };
+		return { target_reg, intern_type(vm, result_type) };
 	}
 }
 
-expression_gen_t bcgen_expression(bcgenerator_t& vm, const variable_address_t& target_reg, const expression_t& e, const bcgen_body_t& body){
+expression_gen_t bcgen_expression(bcgenerator_t& vm, const variable_address_t& target_reg, const expression_t& e, bcgen_body_t& body_acc){
 	QUARK_ASSERT(vm.check_invariant());
 	QUARK_ASSERT(target_reg.check_invariant());
 	QUARK_ASSERT(e.check_invariant());
-	QUARK_ASSERT(body.check_invariant());
+	QUARK_ASSERT(body_acc.check_invariant());
 
 	const auto op = e.get_operation();
 	if(op == expression_type::k_literal){
-		return bcgen_literal_expression(vm, target_reg, e, body);
+		return bcgen_literal_expression(vm, target_reg, e, body_acc);
 	}
 	else if(op == expression_type::k_resolve_member){
-		return bcgen_resolve_member_expression(vm, target_reg, e, body);
+		return bcgen_resolve_member_expression(vm, target_reg, e, body_acc);
 	}
 	else if(op == expression_type::k_lookup_element){
-		return bcgen_lookup_element_expression(vm, target_reg, e, body);
+		return bcgen_lookup_element_expression(vm, target_reg, e, body_acc);
 	}
 	else if(op == expression_type::k_load2){
-		return bcgen_load2_expression(vm, target_reg, e, body);
+		return bcgen_load2_expression(vm, target_reg, e, body_acc);
 	}
 	else if(op == expression_type::k_call){
-		return bcgen_call_expression(vm, target_reg, e, body);
+		return bcgen_call_expression(vm, target_reg, e, body_acc);
 	}
 	else if(op == expression_type::k_value_constructor){
-		return bcgen_construct_value_expression(vm, target_reg, e, body);
+		return bcgen_construct_value_expression(vm, target_reg, e, body_acc);
 	}
 	else if(op == expression_type::k_arithmetic_unary_minus__1){
-		return bcgen_arithmetic_unary_minus_expression(vm, target_reg, e, body);
+		return bcgen_arithmetic_unary_minus_expression(vm, target_reg, e, body_acc);
 	}
 	else if(op == expression_type::k_conditional_operator3){
-		return bcgen_conditional_operator_expression(vm, target_reg, e, body);
+		return bcgen_conditional_operator_expression(vm, target_reg, e, body_acc);
 	}
 	else if (is_arithmetic_expression(op)){
-		return bcgen_arithmetic_expression(vm, target_reg, op, e, body);
+		return bcgen_arithmetic_expression(vm, target_reg, op, e, body_acc);
 	}
 	else if (is_comparison_expression(op)){
-		return bcgen_comparison_expression(vm, target_reg, op, e, body);
+		return bcgen_comparison_expression(vm, target_reg, op, e, body_acc);
 	}
 	else{
 		QUARK_ASSERT(false);
@@ -1404,7 +1664,10 @@ expression_gen_t bcgen_expression(bcgenerator_t& vm, const variable_address_t& t
 //////////////////////////////////////		bcgenerator_t
 
 
-bcgenerator_t::bcgenerator_t(const semantic_ast_t& ast){
+bcgenerator_t::bcgenerator_t(const semantic_ast_t& ast) :
+	_types_frozen(false),
+	_inline_budget(k_default_inline_budget)
+{
 	QUARK_ASSERT(ast.check_invariant());
 
 	_ast_imm = std::make_shared<semantic_ast_t>(ast);
@@ -1414,7 +1677,13 @@ bcgenerator_t::bcgenerator_t(const semantic_ast_t& ast){
 bcgenerator_t::bcgenerator_t(const bcgenerator_t& other) :
 	_ast_imm(other._ast_imm),
 	_call_stack(other._call_stack),
-	_types(other._types)
+	_types(other._types),
+	_types_frozen(other._types_frozen),
+	_static_functions(other._static_functions),
+	_inline_budget(other._inline_budget),
+	_inline_sizes(other._inline_sizes),
+	_no_inline(other._no_inline),
+	_inlined(other._inlined)
 {
 	QUARK_ASSERT(other.check_invariant());
 	QUARK_ASSERT(check_invariant());
@@ -1424,6 +1693,12 @@ void bcgenerator_t::swap(bcgenerator_t& other) throw(){
 	other._ast_imm.swap(this->_ast_imm);
 	_call_stack.swap(this->_call_stack);
 	_types.swap(this->_types);
+	std::swap(other._types_frozen, this->_types_frozen);
+	_static_functions.swap(other._static_functions);
+	std::swap(other._inline_budget, this->_inline_budget);
+	_inline_sizes.swap(other._inline_sizes);
+	_no_inline.swap(other._no_inline);
+	_inlined.swap(other._inlined);
 }
 
 const bcgenerator_t& bcgenerator_t::operator=(const bcgenerator_t& other){
@@ -1433,8 +1708,10 @@ const bcgenerator_t& bcgenerator_t::operator=(const bcgenerator_t& other){
 }
 
 #if DEBUG
+//	The AST is immutable and was checked by the constructor. Checking it again here made each codegen step walk the
+//	whole program.
 bool bcgenerator_t::check_invariant() const {
-	QUARK_ASSERT(_ast_imm->check_invariant());
+	QUARK_ASSERT(_ast_imm);
 	return true;
 }
 #endif
@@ -1468,8 +1745,19 @@ bc_instruction_t squeeze_instruction(const bcgen_instruction_t& instruction){
 	return result;
 }
 
+static std::pair<std::string, bc_symbol_t> make_bc_symbol(const std::pair<std::string, symbol_t>& symbol){
+	return {
+		symbol.first,
+		bc_symbol_t{
+			symbol.second._symbol_type == symbol_t::immutable_local ? bc_symbol_t::immutable_local : bc_symbol_t::mutable_local,
+			symbol.second._value_type,
+			value_to_bc(symbol.second._const_value)
+		}
+	};
+}
+
 bc_static_frame_t make_frame(const bcgen_body_t& body, const std::vector<typeid_t>& args){
-	QUARK_ASSERT(body.check_invariant());
+	QUARK_ASSERT(body.check_all());
 
 	std::vector<bc_instruction_t> instrs2;
 	for(const auto& e: body._instrs){
@@ -1478,58 +1766,209 @@ bc_static_frame_t make_frame(const bcgen_body_t& body, const std::vector<typeid_
 
 	std::vector<std::pair<std::string, bc_symbol_t>> symbols2;
 	for(const auto& e: body._symbols._symbols){
-		const auto e2 = std::pair<std::string, bc_symbol_t>{
-			e.first,
-			bc_symbol_t{
-				e.second._symbol_type == symbol_t::immutable_local ? bc_symbol_t::immutable_local : bc_symbol_t::mutable_local,
-				e.second._value_type,
-				value_to_bc(e.second._const_value)
-			}
-		};
-		symbols2.push_back(e2);
+		symbols2.push_back(make_bc_symbol(e));
 	}
 
 	return bc_static_frame_t(instrs2, symbols2, args);
 }
 
+//	Interns the output type of every expression in body, in statement order. Codegen only ever interns expression
+//	output types (and bool, which is the output type of comparisons), so after this the body can be generated with a
+//	frozen type table.
+static void intern_expression_types(bcgenerator_t& vm, const expression_t& e){
+	for(const auto& m: e._input_exprs){
+		intern_expression_types(vm, m);
+	}
+	intern_type(vm, e.get_output_type());
+}
+
+static void intern_body_types(bcgenerator_t& vm, const body_t& body){
+	for(const auto& statement: body._statements){
+		struct visitor_t {
+			bcgenerator_t& vm;
+
+			void operator()(const statement_t::return_statement_t& s) const{
+				intern_expression_types(vm, s._expression);
+			}
+			void operator()(const statement_t::define_struct_statement_t& s) const{
+			}
+			void operator()(const statement_t::define_protocol_statement_t& s) const{
+			}
+			void operator()(const statement_t::define_function_statement_t& s) const{
+			}
+			void operator()(const statement_t::bind_local_t& s) const{
+				intern_expression_types(vm, s._expression);
+			}
+			void operator()(const statement_t::store_t& s) const{
+				intern_expression_types(vm, s._expression);
+			}
+			void operator()(const statement_t::store2_t& s) const{
+				intern_expression_types(vm, s._expression);
+			}
+			void operator()(const statement_t::block_statement_t& s) const{
+				intern_body_types(vm, s._body);
+			}
+			void operator()(const statement_t::ifelse_statement_t& s) const{
+				intern_expression_types(vm, s._condition);
+				intern_body_types(vm, s._then_body);
+				intern_body_types(vm, s._else_body);
+			}
+			void operator()(const statement_t::for_statement_t& s) const{
+				intern_expression_types(vm, s._start_expression);
+				intern_expression_types(vm, s._end_expression);
+				intern_body_types(vm, s._body);
+			}
+			void operator()(const statement_t::while_statement_t& s) const{
+				intern_expression_types(vm, s._condition);
+				intern_body_types(vm, s._body);
+			}
+			void operator()(const statement_t::expression_statement_t& s) const{
+				intern_expression_types(vm, s._expression);
+			}
+			void operator()(const statement_t::software_system_statement_t& s) const{
+			}
+			void operator()(const statement_t::container_def_statement_t& s) const{
+			}
+		};
+		std::visit(visitor_t{ vm }, statement._contents);
+	}
+}
+
+//	Each codegen thread copies the whole generator, so it needs this many function bodies to be worth starting.
+static const size_t k_bodies_per_codegen_thread = 8;
+
+/*
+	The globals are generated first, on the calling thread. Function bodies only read the globals and the types, so
+	they are then generated in parallel, one function at a time per thread. Only functions with a body count: the
+	prelude's host functions have none. Programs with few bodies are generated serially on the calling thread.
+
+	Output is the same as generating everything serially on one thread:
+	- All types the function bodies use are interned up front in function order, then the table is frozen.
+	- Each function's frame is stored at its function id.
+	- If several functions fail, the error of the one with the lowest id is thrown.
+*/
 bc_program_t generate_bytecode(const semantic_ast_t& ast){
+	return generate_bytecode(ast, k_default_inline_budget);
+}
+
+bc_program_t generate_bytecode(const semantic_ast_t& ast, int inline_budget){
+	return generate_bytecode(ast, inline_budget, {});
+}
+
+bc_program_t generate_bytecode(const semantic_ast_t& ast, int inline_budget, const std::vector<std::string>& memoized_functions){
 	QUARK_ASSERT(ast.check_invariant());
 
 //	QUARK_SCOPED_TRACE("generate_bytecode");
 //	QUARK_TRACE_SS("INPUT:  " << json_to_pretty_string(ast_to_json(ast._checked_ast)._value));
 
 	bcgenerator_t a(ast._checked_ast);
+	a._inline_budget = inline_budget;
+	record_static_functions(a, a._ast_imm->_checked_ast._globals._symbols, a._ast_imm->_checked_ast._globals._statements);
+	for(const auto& e: a._static_functions){
+		const auto& name = a._ast_imm->_checked_ast._globals._symbols._symbols[e.first].first;
+		if(std::find(memoized_functions.begin(), memoized_functions.end(), name) != memoized_functions.end()){
+			a._no_inline.insert(e.second);
+		}
+	}
 
 	const auto global_body = bcgen_body_top(a, a._ast_imm->_checked_ast._globals);
 	const auto globals2 = make_frame(global_body, {});
 	a._call_stack.push_back(bcgen_environment_t{ &global_body });
 
-	std::vector<bc_function_definition_t> function_defs2;
-	for(int function_id = 0 ; function_id < ast._checked_ast._function_defs.size() ; function_id++){
-		const auto& function_def = *ast._checked_ast._function_defs[function_id];
-
-		if(function_def._host_function_id != k_no_host_function_id){
-			const auto function_def2 = bc_function_definition_t{
-				function_def._function_type,
-				function_def._args,
-				nullptr,
-				function_def._host_function_id
-			};
-			function_defs2.push_back(function_def2);
+	const auto& function_defs = ast._checked_ast._function_defs;
+	for(const auto& function_def: function_defs){
+		if(function_def->_host_function_id == k_no_host_function_id && function_def->_body){
+			intern_body_types(a, *function_def->_body);
 		}
-		else{
-			const auto body2 = function_def._body ? bcgen_body_top(a, *function_def._body) : bcgen_body_t({});
-			const auto frame = make_frame(body2, function_def._function_type.get_function_args());
-			const auto function_def2 = bc_function_definition_t{
-				function_def._function_type,
-				function_def._args,
-				std::make_shared<bc_static_frame_t>(frame),
-				function_def._host_function_id
-			};
-			function_defs2.push_back(function_def2);
+	}
+	intern_type(a, typeid_t::make_bool());
+	a._types_frozen = true;
+
+	const auto function_count = function_defs.size();
+	std::vector<std::shared_ptr<bc_static_frame_t>> frames(function_count);
+	std::vector<size_t> body_ids;
+	for(size_t function_id = 0 ; function_id < function_count ; function_id++){
+		const auto& function_def = *function_defs[function_id];
+		if(function_def._host_function_id == k_no_host_function_id){
+			if(function_def._body){
+				body_ids.push_back(function_id);
+			}
+			else{
+				frames[function_id] = std::make_shared<bc_static_frame_t>(make_frame(bcgen_body_t({}), function_def._function_type.get_function_args()));
+			}
 		}
 	}
 
+	const auto generate_function = [&](bcgenerator_t& vm, size_t function_id){
+		const auto& function_def = *function_defs[function_id];
+		const auto body2 = bcgen_body_top(vm, *function_def._body);
+		frames[function_id] = std::make_shared<bc_static_frame_t>(make_frame(body2, function_def._function_type.get_function_args()));
+	};
+
+	const auto hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+	const auto thread_count = std::min(body_ids.size() / k_bodies_per_codegen_thread, static_cast<size_t>(hardware_threads));
+	std::set<int> inlined;
+	if(thread_count < 2){
+		//	Bodies are generated in function id order, so the first error is the one with the lowest id.
+		for(const auto function_id: body_ids){
+			generate_function(a, function_id);
+		}
+		inlined = a._inlined;
+	}
+	else{
+		std::vector<std::exception_ptr> errors(function_count);
+		std::atomic<size_t> next_body(0);
+		inlined = a._inlined;
+		std::mutex inlined_mutex;
+		const auto worker = [&](){
+			auto vm = a;
+			while(true){
+				const size_t body_index = next_body++;
+				if(body_index >= body_ids.size()){
+					std::lock_guard<std::mutex> lock(inlined_mutex);
+					inlined.insert(vm._inlined.begin(), vm._inlined.end());
+					return;
+				}
+				const auto function_id = body_ids[body_index];
+				try {
+					generate_function(vm, function_id);
+				}
+				catch(...){
+					errors[function_id] = std::current_exception();
+					vm = a;
+				}
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for(size_t i = 1 ; i < thread_count ; i++){
+			threads.push_back(std::thread(worker));
+		}
+		worker();
+		for(auto& t: threads){
+			t.join();
+		}
+
+		for(const auto& e: errors){
+			if(e){
+				std::rethrow_exception(e);
+			}
+		}
+	}
+
+	std::vector<bc_function_definition_t> function_defs2;
+	for(int function_id = 0 ; function_id < function_count ; function_id++){
+		const auto& function_def = *function_defs[function_id];
+		const auto function_def2 = bc_function_definition_t{
+			function_def._function_type,
+			function_def._args,
+			frames[function_id],
+			function_def._host_function_id
+		};
+		function_defs2.push_back(function_def2);
+		function_defs2.back()._is_inlined = inlined.count(function_id) > 0;
+	}
+
 	const auto result = bc_program_t{ globals2, function_defs2, a._types, ast._checked_ast._software_system, ast._checked_ast._container_def };
 
 //	QUARK_TRACE_SS("OUTPUT: " << json_to_pretty_string(bcprogram_to_json(result)));
@@ -1538,4 +1977,203 @@ bc_program_t generate_bytecode(const semantic_ast_t& ast){
 }
 
 
+//////////////////////////////////////		incremental_bcgenerator_t
+
+
+incremental_bcgenerator_t::incremental_bcgenerator_t() :
+	_generator(std::make_unique<bcgenerator_t>(semantic_ast_t(ast_t{ body_t{}, {}, {}, {} }))),
+	_globals(std::make_unique<bcgen_body_t>(std::vector<bcgen_instruction_t>{}))
+{
+	_generator->_call_stack.push_back(bcgen_environment_t{ _globals.get() });
+}
+
+incremental_bcgenerator_t::~incremental_bcgenerator_t(){
+}
+
+//	Keeps the first symbol_count globals, function_count functions and type_count types, drops the rest.
+static void truncate_increments(incremental_bcgenerator_t& g, size_t symbol_count, size_t function_count, size_t type_count){
+	auto& vm = *g._generator;
+	auto& globals = *g._globals;
+	auto& function_defs = vm._ast_imm->_checked_ast._function_defs;
+
+	globals._instrs.clear();
+	globals._symbols._symbols.erase(globals._symbols._symbols.begin() + symbol_count, globals._symbols._symbols.end());
+	function_defs.erase(function_defs.begin() + function_count, function_defs.end());
+	vm._types.erase(vm._types.begin() + type_count, vm._types.end());
+	vm._static_functions.erase(vm._static_functions.lower_bound(static_cast<int>(symbol_count)), vm._static_functions.end());
+	vm._inline_sizes.erase(vm._inline_sizes.lower_bound(static_cast<int>(function_count)), vm._inline_sizes.end());
+	vm._inlined.erase(vm._inlined.lower_bound(static_cast<int>(function_count)), vm._inlined.end());
+	vm._call_stack.erase(vm._call_stack.begin() + 1, vm._call_stack.end());
+}
+
+/*
+	The statements are generated straight into the kept global body, so temporaries get global indexes after the
+	increment's globals. Functions are generated serially with an open type table: an increment is small.
+*/
+bcgen_increment_t generate_bytecode_increment(incremental_bcgenerator_t& g, const semantic_increment_t& increment){
+	auto& vm = *g._generator;
+	auto& globals = *g._globals;
+	auto& function_defs = vm._ast_imm->_checked_ast._function_defs;
+	QUARK_ASSERT(vm.check_invariant());
+	QUARK_ASSERT(globals._instrs.empty());
+	QUARK_ASSERT(vm._call_stack.size() == 1);
+
+	const auto symbol_count = globals._symbols._symbols.size();
+	const auto function_count = function_defs.size();
+	const auto type_count = vm._types.size();
+	try {
+		globals._symbols._symbols.insert(globals._symbols._symbols.end(), increment._globals.begin(), increment._globals.end());
+		function_defs.insert(function_defs.end(), increment._function_defs.begin(), increment._function_defs.end());
+		record_static_functions(vm, globals._symbols, increment._statements);
+
+		//	The value of a trailing expression statement is kept in its output register, for the REPL to show.
+		const auto& statements = increment._statements;
+		const auto last_expression = statements.empty() ? nullptr : std::get_if<statement_t::expression_statement_t>(&statements.back()._contents);
+		int result_global_index = -1;
+		if(last_expression != nullptr){
+			bcgen_statements(vm, { statements.begin(), statements.end() - 1 }, globals);
+			const auto expr = bcgen_expression(vm, {}, last_expression->_expression, globals);
+			if(last_expression->_expression.get_output_type().is_void() == false){
+				result_global_index = expr._out._index;
+			}
+		}
+		else{
+			bcgen_statements(vm, statements, globals);
+		}
+		globals._instrs.push_back(bcgen_instruction_t(bc_opcode::k_stop, {}, {}, {}));
+		QUARK_ASSERT(globals.check_all());
+
+		bcgen_increment_t result;
+		for(const auto& e: globals._instrs){
+			result._instructions.push_back(squeeze_instruction(e));
+		}
+		for(auto i = symbol_count ; i < globals._symbols._symbols.size() ; i++){
+			result._globals.push_back(make_bc_symbol(globals._symbols._symbols[i]));
+		}
+		result._hidden_globals = { globals._symbols._symbols.begin() + symbol_count + increment._globals.size(), globals._symbols._symbols.end() };
+
+		for(const auto& function_def: increment._function_defs){
+			const auto frame = [&]() -> std::shared_ptr<bc_static_frame_t> {
+				if(function_def->_host_function_id != k_no_host_function_id){
+					return nullptr;
+				}
+				const auto body = function_def->_body ? bcgen_body_top(vm, *function_def->_body) : bcgen_body_t({});
+				return std::make_shared<bc_static_frame_t>(make_frame(body, function_def->_function_type.get_function_args()));
+			}();
+			result._function_defs.push_back(
+				bc_function_definition_t{ function_def->_function_type, function_def->_args, frame, function_def->_host_function_id }
+			);
+		}
+
+		result._types = { vm._types.begin() + type_count, vm._types.end() };
+		result._result_global_index = result_global_index;
+
+		globals._instrs.clear();
+		return result;
+	}
+	catch(...){
+		truncate_increments(g, symbol_count, function_count, type_count);
+		throw;
+	}
+}
+
+void undo_bytecode_increment(incremental_bcgenerator_t& g, const bcgen_increment_t& code){
+	const auto& vm = *g._generator;
+	const auto symbol_count = g._globals->_symbols._symbols.size();
+	const auto function_count = vm._ast_imm->_checked_ast._function_defs.size();
+	QUARK_ASSERT(symbol_count >= code._globals.size());
+	QUARK_ASSERT(function_count >= code._function_defs.size());
+	QUARK_ASSERT(vm._types.size() >= code._types.size());
+
+	truncate_increments(
+		g,
+		symbol_count - code._globals.size(),
+		function_count - code._function_defs.size(),
+		vm._types.size() - code._types.size()
+	);
+}
+
+
+//////////////////////////////////////		TESTS
+
+
+static int count_calls(const bc_static_frame_t& frame){
+	return static_cast<int>(std::count_if(
+		frame._instructions.begin(),
+		frame._instructions.end(),
+		[](const bc_instruction_t& e){ return e._opcode == bc_opcode::k_call; }
+	));
+}
+
+static value_t run_global_r(const bc_program_t& program){
+	const interpreter_t vm(program);
+	return find_global_symbol(vm, "r");
+}
+
+QUARK_UNIT_TEST("generate_bytecode()", "inlining", "small pure function", "no call"){
+	const auto ast = compile_to_sematic_ast("func int f(int a){ let b = a * 2 return b + 1 }\nlet r = f(20)", "");
+
+	const auto program = generate_bytecode(ast);
+	QUARK_UT_VERIFY(count_calls(program._globals) == 0);
+	QUARK_UT_VERIFY(run_global_r(program) == value_t::make_int(41));
+
+	const auto program2 = generate_bytecode(ast, 0);
+	QUARK_UT_VERIFY(count_calls(program2._globals) == 1);
+	QUARK_UT_VERIFY(run_global_r(program2) == value_t::make_int(41));
+}
+
+QUARK_UNIT_TEST("generate_bytecode()", "inlining", "callee with loop and blocks, inside loop", "same result, no call"){
+	const auto program = generate_bytecode(compile_to_sematic_ast(R"(
+		func int sum(int n){
+			mutable acc = 0
+			for(i in 0 ..< n){
+				if(i > 0){
+					acc = acc + i
+				}
+			}
+			return acc
+		}
+		func int g(){
+			mutable t = 0
+			for(j in 0 ..< 3){
+				t = t + sum(j + 2)
+			}
+			return t
+		}
+		let r = g()
+	)", ""));
+	QUARK_UT_VERIFY(count_calls(program._globals) == 0);
+	QUARK_UT_VERIFY(run_global_r(program) == value_t::make_int(1 + 3 + 6));
+}
+
+QUARK_UNIT_TEST("generate_bytecode()", "inlining", "string arguments, nested inlining", "same result, no call"){
+	const auto program = generate_bytecode(compile_to_sematic_ast(R"(
+		func string f(string a, string b){ return a + b }
+		func string g(string a){ return f(a, "-") + f("<", a) }
+		let r = g("x") + g("y")
+	)", ""));
+	QUARK_UT_VERIFY(count_calls(program._globals) == 0);
+	QUARK_UT_VERIFY(run_global_r(program) == value_t::make_string("x-<xy-<y"));
+}
+
+QUARK_UNIT_TEST("generate_bytecode()", "inlining", "recursive, impure, several returns, over budget", "called"){
+	const auto recursive = generate_bytecode(compile_to_sematic_ast(R"(
+		func int fib(int n){ return n <= 1 ? n : fib(n - 2) + fib(n - 1) }
+		let r = fib(10)
+	)", ""));
+	QUARK_UT_VERIFY(count_calls(recursive._globals) == 1);
+	QUARK_UT_VERIFY(run_global_r(recursive) == value_t::make_int(55));
+
+	const auto impure = generate_bytecode(compile_to_sematic_ast("func int f(int a) impure { return a + 1 }\nlet r = f(1)", ""));
+	QUARK_UT_VERIFY(count_calls(impure._globals) == 1);
+
+	const auto returns = generate_bytecode(compile_to_sematic_ast("func int f(int a){ if(a > 0){ return 1 } return 2 }\nlet r = f(1)", ""));
+	QUARK_UT_VERIFY(count_calls(returns._globals) == 1);
+	QUARK_UT_VERIFY(run_global_r(returns) == value_t::make_int(1));
+
+	const auto big = generate_bytecode(compile_to_sematic_ast("func int f(int a){ return a + a + a + a + a }\nlet r = f(1)", ""), 5);
+	QUARK_UT_VERIFY(count_calls(big._globals) == 1);
+	QUARK_UT_VERIFY(run_global_r(big) == value_t::make_int(5));
+}
+
 }	//	floyd
@@ -15,17 +15,81 @@
 
 #include "quark.h"
 
+#include "bytecode_interpreter.h"
+#include "statement.h"
+#include <memory>
+
 namespace floyd {
 struct semantic_ast_t;
+struct semantic_increment_t;
 struct bc_program_t;
+struct bcgenerator_t;
+struct bcgen_body_t;
 
 
 //////////////////////////		generate_bytecode()
 
+/*
+	Calls to small functions are replaced by the function's body when the callee is known at compile time, is pure,
+	is not recursive and ends with its only return statement. A function's size is its statements plus expression
+	nodes, including the bodies of the calls it inlines in turn. Functions bigger than the inline budget are called.
+	A budget of 0 turns inlining off.
+
+	Functions listed in memoized_functions are never inlined: enable_memoization() only sees calls that go through
+	the interpreter. bc_function_definition_t::_is_inlined tells if a function was inlined somewhere.
+*/
+const int k_default_inline_budget = 32;
+
 /*
 	Compiles the ast to Floyd byte code.
 */
 bc_program_t generate_bytecode(const semantic_ast_t& ast);
+bc_program_t generate_bytecode(const semantic_ast_t& ast, int inline_budget);
+bc_program_t generate_bytecode(const semantic_ast_t& ast, int inline_budget, const std::vector<std::string>& memoized_functions);
+
+
+//////////////////////////		incremental_bcgenerator_t
+
+/*
+	Generates byte code a few global statements at a time, for the REPL, from the increments of an
+	incremental_analyser_t. The global frame's symbols, the function definitions and the type table are kept between
+	calls, so a call only generates code for its own statements and functions.
+*/
+
+struct bcgen_increment_t {
+	//	Runs in the global frame, once _globals have been appended to it. Ends with k_stop.
+	std::vector<bc_instruction_t> _instructions;
+
+	//	Append to the global frame: the increment's globals followed by the temporaries _instructions use.
+	std::vector<std::pair<std::string, bc_symbol_t>> _globals;
+
+	//	The temporaries at the end of _globals. Add them to the analyser with add_hidden_globals().
+	std::vector<std::pair<std::string, symbol_t>> _hidden_globals;
+
+	std::vector<bc_function_definition_t> _function_defs;
+
+	//	Append to the program's type table.
+	std::vector<typeid_t> _types;
+
+	//	If the last statement is an expression statement with a value, this is the global that holds it, else -1.
+	int _result_global_index;
+};
+
+struct incremental_bcgenerator_t {
+	public: incremental_bcgenerator_t();
+	public: ~incremental_bcgenerator_t();
+
+
+	//////////////////////////		STATE
+	public: std::unique_ptr<bcgenerator_t> _generator;
+	public: std::unique_ptr<bcgen_body_t> _globals;
+};
+
+//	If generation fails, the generator is left as it was before the call.
+bcgen_increment_t generate_bytecode_increment(incremental_bcgenerator_t& g, const semantic_increment_t& increment);
+
+//	Removes the increment returned by the latest generate_bytecode_increment(), for when it cannot be used after all.
+void undo_bytecode_increment(incremental_bcgenerator_t& g, const bcgen_increment_t& code);
 
 
 } //	floyd
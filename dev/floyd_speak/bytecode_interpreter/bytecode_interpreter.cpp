@@ -9,11 +9,14 @@
 #include "bytecode_interpreter.h"
 
 #include "host_functions.h"
+#include "bc_simd.h"
+#include "bc_memo.h"
 #include "text_parser.h"
 #include "ast_value.h"
 #include "ast_json.h"
 #include <sys/time.h>
 #include <algorithm>
+#include <cstring>
 
 
 namespace floyd {
@@ -421,6 +424,75 @@ bool bc_external_handle_t::check_invariant() const {
 }
 
 
+
+////////////////////////////////////////////			bc_dict_key_t
+
+
+
+bc_dict_key_t::bc_dict_key_t(const bc_value_t& key) :
+	_key(key),
+	_hash(bc_hash_value(key, key._type))
+{
+	QUARK_ASSERT(check_invariant());
+}
+
+bc_dict_key_t::bc_dict_key_t(const std::string& key) :
+	bc_dict_key_t(bc_value_t::make_string(key))
+{
+}
+
+bool bc_dict_key_t::check_invariant() const {
+	QUARK_ASSERT(_key.check_invariant());
+	QUARK_ASSERT(_key._type.is_undefined() == false);
+	return true;
+}
+
+bool bc_dict_key_t::operator==(const bc_dict_key_t& other) const {
+	return _hash == other._hash && _key._type == other._key._type && bc_values_equal(_key, other._key, _key._type);
+}
+
+std::string bc_dict_key_t::get_string() const {
+	QUARK_ASSERT(_key._type.is_string());
+
+	return _key.get_string_value();
+}
+
+int bc_compare_dict_keys(const bc_dict_key_t& left, const bc_dict_key_t& right){
+	QUARK_ASSERT(left._key._type == right._key._type);
+
+	return bc_compare_value_true_deep(left._key, right._key, left._key._type);
+}
+
+QUARK_UNIT_TEST("bc_dict_key_t", "bc_dict_key_t()", "same string from two values", "equal keys, same hash"){
+	const auto a = bc_dict_key_t(bc_value_t::make_string("routing-table-entry"));
+	const auto b = bc_dict_key_t(std::string("routing-table-entry"));
+	QUARK_UT_VERIFY(a._hash == b._hash);
+	QUARK_UT_VERIFY(a == b);
+	QUARK_UT_VERIFY((a == bc_dict_key_t(std::string("other"))) == false);
+}
+
+QUARK_UNIT_TEST("bc_dict_key_t", "bc_dict_key_t()", "string value", "hash is cached in the string"){
+	const auto s = bc_value_t::make_string("hello");
+	const auto a = bc_dict_key_t(s);
+	QUARK_UT_VERIFY(s._pod._external->_hash == a._hash);
+}
+
+QUARK_UNIT_TEST("bc_dict_key_t", "immer::map", "int and struct keys", "lookup works"){
+	const auto point_type = typeid_t::make_struct2({ member_t(typeid_t::make_int(), "x"), member_t(typeid_t::make_int(), "y") });
+	const auto p1 = bc_value_t::make_struct_value(point_type, { bc_value_t::make_int(1), bc_value_t::make_int(2) });
+	const auto p2 = bc_value_t::make_struct_value(point_type, { bc_value_t::make_int(1), bc_value_t::make_int(2) });
+	const auto p3 = bc_value_t::make_struct_value(point_type, { bc_value_t::make_int(2), bc_value_t::make_int(1) });
+
+	bc_dict_w_inplace_values_t entries;
+	entries = entries.set(bc_dict_key_t(p1), bc_value_t::make_int(100)._pod._inplace);
+	entries = entries.set(bc_dict_key_t(bc_value_t::make_int(7)), bc_value_t::make_int(200)._pod._inplace);
+
+	QUARK_UT_VERIFY(entries.find(bc_dict_key_t(p2))->_int64 == 100);
+	QUARK_UT_VERIFY(entries.find(bc_dict_key_t(p3)) == nullptr);
+	QUARK_UT_VERIFY(entries.find(bc_dict_key_t(bc_value_t::make_int(7)))->_int64 == 200);
+}
+
+
 bool encode_as_inplace(const typeid_t& type){
 	return type.is_bool() || type.is_int() || type.is_double();
 }
@@ -688,7 +760,7 @@ bc_external_value_t::bc_external_value_t(const typeid_t& type, const immer::vect
 	QUARK_ASSERT(type.check_invariant());
 	QUARK_ASSERT(check_invariant());
 }
-bc_external_value_t::bc_external_value_t(const typeid_t& type, const immer::map<std::string, bc_external_handle_t>& s) :
+bc_external_value_t::bc_external_value_t(const typeid_t& type, const bc_dict_w_external_values_t& s) :
 	_rc(1),
 #if DEBUG
 	_debug_type(type),
@@ -698,13 +770,13 @@ bc_external_value_t::bc_external_value_t(const typeid_t& type, const immer::map<
 	QUARK_ASSERT(type.check_invariant());
 	#if QUARK_ASSERT_ON
 		for(const auto& e: s){
-			QUARK_ASSERT(e.first.size() > 0);
+			QUARK_ASSERT(e.first.check_invariant());
 			QUARK_ASSERT(e.second.check_invariant());
 		}
 	#endif
 	QUARK_ASSERT(check_invariant());
 }
-bc_external_value_t::bc_external_value_t(const typeid_t& type, const immer::map<std::string, bc_inplace_value_t>& s) :
+bc_external_value_t::bc_external_value_t(const typeid_t& type, const bc_dict_w_inplace_values_t& s) :
 	_rc(1),
 #if DEBUG
 	_debug_type(type),
@@ -714,7 +786,7 @@ bc_external_value_t::bc_external_value_t(const typeid_t& type, const immer::map<
 	QUARK_ASSERT(type.check_invariant());
 	#if QUARK_ASSERT_ON
 		for(const auto& e: s){
-			QUARK_ASSERT(e.first.size() > 0);
+			QUARK_ASSERT(e.first.check_invariant());
 		}
 	#endif
 	QUARK_ASSERT(check_invariant());
@@ -891,34 +963,36 @@ bc_value_t make_vector(const typeid_t& element_type, const immer::vector<bc_inpl
 
 
 
-const immer::map<std::string, bc_external_handle_t>& get_dict_value(const bc_value_t& value){
+const bc_dict_w_external_values_t& get_dict_value(const bc_value_t& value){
 	QUARK_ASSERT(value.check_invariant());
 
 	return value._pod._external->_dict_w_external_values;
 }
 
-bc_value_t make_dict(const typeid_t& value_type, const immer::map<std::string, bc_external_handle_t>& entries){
-	QUARK_ASSERT(value_type.check_invariant());
+bc_value_t make_dict(const typeid_t& dict_type, const bc_dict_w_external_values_t& entries){
+	QUARK_ASSERT(dict_type.check_invariant());
+	QUARK_ASSERT(dict_type.is_dict());
 #if QUARK_ASSERT_ON
 	for(const auto& e: entries) {
-		QUARK_ASSERT(e.first.size() > 0);
+		QUARK_ASSERT(e.first.check_invariant());
 		QUARK_ASSERT(e.second.check_invariant());
 	}
 #endif
 
 	bc_value_t temp;
-	temp._type = typeid_t::make_dict(value_type);
-	temp._pod._external = new bc_external_value_t{typeid_t::make_dict(value_type), entries};
+	temp._type = dict_type;
+	temp._pod._external = new bc_external_value_t{dict_type, entries};
 	QUARK_ASSERT(temp.check_invariant());
 	return temp;
 }
 
-bc_value_t make_dict(const typeid_t& value_type, const immer::map<std::string, bc_inplace_value_t>& entries){
-	QUARK_ASSERT(value_type.check_invariant());
+bc_value_t make_dict(const typeid_t& dict_type, const bc_dict_w_inplace_values_t& entries){
+	QUARK_ASSERT(dict_type.check_invariant());
+	QUARK_ASSERT(dict_type.is_dict());
 
 	bc_value_t temp;
-	temp._type = typeid_t::make_dict(value_type);
-	temp._pod._external = new bc_external_value_t{typeid_t::make_dict(value_type), entries};
+	temp._type = dict_type;
+	temp._pod._external = new bc_external_value_t{dict_type, entries};
 	QUARK_ASSERT(temp.check_invariant());
 	return temp;
 }
@@ -1112,27 +1186,27 @@ bc_value_t update_vector_element(interpreter_t& vm, const bc_value_t vec, int64_
 	}
 }
 
-bc_value_t update_dict_entry(interpreter_t& vm, const bc_value_t dict, const std::string& key, const bc_value_t& value){
+bc_value_t update_dict_entry(interpreter_t& vm, const bc_value_t dict, const bc_dict_key_t& key, const bc_value_t& value){
 	QUARK_ASSERT(vm.check_invariant());
 	QUARK_ASSERT(dict.check_invariant());
 	QUARK_ASSERT(dict._type.is_dict());
-	QUARK_ASSERT(key.empty() == false);
+	QUARK_ASSERT(key.check_invariant());
 	QUARK_ASSERT(value.check_invariant());
 	QUARK_ASSERT(dict._type.get_dict_value_type() == value._type);
 
 //	QUARK_TRACE(json_to_pretty_string(interpreter_to_json(vm)));
 
-	const auto value_type = dict._type.get_dict_value_type();
+	QUARK_ASSERT(dict._type.get_dict_key_type() == key._key._type);
 
 	if(encode_as_dict_w_inplace_values(dict._type)){
 		auto entries2 = dict._pod._external->_dict_w_inplace_values.set(key, value._pod._inplace);
-		const auto value2 = make_dict(value_type, entries2);
+		const auto value2 = make_dict(dict._type, entries2);
 		return value2;
 	}
 	else{
 		const auto entries = get_dict_value(dict);
 		auto entries2 = entries.set(key, bc_external_handle_t(value));
-		const auto value2 = make_dict(value_type, entries2);
+		const auto value2 = make_dict(dict._type, entries2);
 		return value2;
 	}
 }
@@ -1198,8 +1272,8 @@ bc_value_t update_element(interpreter_t& vm, const bc_value_t& obj1, const bc_va
 		}
 	}
 	else if(obj1._type.is_dict()){
-		if(lookup_key._type.is_string() == false){
-			quark::throw_runtime_error("Dict lookup using string key only.");
+		if(lookup_key._type != obj1._type.get_dict_key_type()){
+			quark::throw_runtime_error("Dict lookup using key of wrong type.");
 		}
 		else{
 			const auto obj = obj1;
@@ -1208,8 +1282,7 @@ bc_value_t update_element(interpreter_t& vm, const bc_value_t& obj1, const bc_va
 				quark::throw_runtime_error("Update element must match dict value type.");
 			}
 			else{
-				const std::string key = lookup_key.get_string_value();
-				return update_dict_entry(vm, obj1, key, new_value);
+				return update_dict_entry(vm, obj1, bc_dict_key_t(lookup_key), new_value);
 			}
 		}
 	}
@@ -1280,7 +1353,7 @@ int bc_compare_struct_true_deep(const std::vector<bc_value_t>& left, const std::
 int bc_compare_vectors_obj(const immer::vector<bc_external_handle_t>& left, const immer::vector<bc_external_handle_t>& right, const typeid_t& type){
 	QUARK_ASSERT(type.is_vector());
 
-	const auto& shared_count = std::min(left.size(), right.size());
+	const auto shared_count = std::min(left.size(), right.size());
 	const auto& element_type = typeid_t(type.get_vector_element_type());
 	for(int i = 0 ; i < shared_count ; i++){
 		const auto element_result = bc_compare_value_true_deep(bc_value_t(element_type, left[i]), bc_value_t(element_type, right[i]), element_type);
@@ -1337,12 +1410,10 @@ int compare_doubles(const bc_inplace_value_t& left, const bc_inplace_value_t& ri
 }
 
 int bc_compare_vectors_bool(const immer::vector<bc_inplace_value_t>& left, const immer::vector<bc_inplace_value_t>& right){
-	const auto& shared_count = std::min(left.size(), right.size());
-	for(int i = 0 ; i < shared_count ; i++){
-		int result = compare_bools(left[i], right[i]);
-		if(result != 0){
-			return result;
-		}
+	const auto shared_count = std::min(left.size(), right.size());
+	const auto index = bc_simd_mismatch_bool(left, right, 0, shared_count);
+	if(index != shared_count){
+		return compare_bools(left[index], right[index]);
 	}
 	if(left.size() == right.size()){
 		return 0;
@@ -1355,12 +1426,10 @@ int bc_compare_vectors_bool(const immer::vector<bc_inplace_value_t>& left, const
 	}
 }
 int bc_compare_vectors_int(const immer::vector<bc_inplace_value_t>& left, const immer::vector<bc_inplace_value_t>& right){
-	const auto& shared_count = std::min(left.size(), right.size());
-	for(int i = 0 ; i < shared_count ; i++){
-		int result = compare_ints(left[i], right[i]);
-		if(result != 0){
-			return result;
-		}
+	const auto shared_count = std::min(left.size(), right.size());
+	const auto index = bc_simd_mismatch_int(left, right, 0, shared_count);
+	if(index != shared_count){
+		return compare_ints(left[index], right[index]);
 	}
 	if(left.size() == right.size()){
 		return 0;
@@ -1372,13 +1441,16 @@ int bc_compare_vectors_int(const immer::vector<bc_inplace_value_t>& left, const
 		return +1;
 	}
 }
+//	NaN != NaN for the SIMD kernel but compare_doubles() treats them as equal, so keep scanning after such a mismatch.
 int bc_compare_vectors_double(const immer::vector<bc_inplace_value_t>& left, const immer::vector<bc_inplace_value_t>& right){
-	const auto& shared_count = std::min(left.size(), right.size());
-	for(int i = 0 ; i < shared_count ; i++){
-		int result = compare_doubles(left[i], right[i]);
+	const auto shared_count = std::min(left.size(), right.size());
+	auto index = bc_simd_mismatch_double(left, right, 0, shared_count);
+	while(index != shared_count){
+		int result = compare_doubles(left[index], right[index]);
 		if(result != 0){
 			return result;
 		}
+		index = bc_simd_mismatch_double(left, right, index + 1, shared_count);
 	}
 	if(left.size() == right.size()){
 		return 0;
@@ -1398,7 +1470,7 @@ template <typename Map> bool bc_map_compare(Map const &lhs, Map const &rhs) {
 	return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
 }
 
-int bc_compare_dicts_obj(const immer::map<std::string, bc_external_handle_t>& left, const immer::map<std::string, bc_external_handle_t>& right, const typeid_t& type){
+int bc_compare_dicts_obj(const bc_dict_w_external_values_t& left, const bc_dict_w_external_values_t& right, const typeid_t& type){
 	const auto& element_type = typeid_t(type.get_dict_value_type());
 
 	auto left_it = left.begin();
@@ -1408,10 +1480,10 @@ int bc_compare_dicts_obj(const immer::map<std::string, bc_external_handle_t>& le
 	auto right_end_it = right.end();
 
 	while(left_it != left_end_it && right_it != right_end_it){
-		auto left_key = (*left_it).first;
-		auto right_key = (*right_it).first;
+		const auto& left_key = (*left_it).first;
+		const auto& right_key = (*right_it).first;
 
-		const auto key_result = bc_compare_string(left_key, right_key);
+		const auto key_result = bc_compare_dict_keys(left_key, right_key);
 		if(key_result != 0){
 			return key_result;
 		}
@@ -1439,7 +1511,7 @@ int bc_compare_dicts_obj(const immer::map<std::string, bc_external_handle_t>& le
 }
 
 //??? make template.
-int bc_compare_dicts_bool(const immer::map<std::string, bc_inplace_value_t>& left, const immer::map<std::string, bc_inplace_value_t>& right){
+int bc_compare_dicts_bool(const bc_dict_w_inplace_values_t& left, const bc_dict_w_inplace_values_t& right){
 	auto left_it = left.begin();
 	auto left_end_it = left.end();
 
@@ -1447,10 +1519,10 @@ int bc_compare_dicts_bool(const immer::map<std::string, bc_inplace_value_t>& lef
 	auto right_end_it = right.end();
 
 	while(left_it != left_end_it && right_it != right_end_it){
-		auto left_key = (*left_it).first;
-		auto right_key = (*right_it).first;
+		const auto& left_key = (*left_it).first;
+		const auto& right_key = (*right_it).first;
 
-		const auto key_result = bc_compare_string(left_key, right_key);
+		const auto key_result = bc_compare_dict_keys(left_key, right_key);
 		if(key_result != 0){
 			return key_result;
 		}
@@ -1477,7 +1549,7 @@ int bc_compare_dicts_bool(const immer::map<std::string, bc_inplace_value_t>& lef
 	quark::throw_exception();
 }
 
-int bc_compare_dicts_int(const immer::map<std::string, bc_inplace_value_t>& left, const immer::map<std::string, bc_inplace_value_t>& right){
+int bc_compare_dicts_int(const bc_dict_w_inplace_values_t& left, const bc_dict_w_inplace_values_t& right){
 	auto left_it = left.begin();
 	auto left_end_it = left.end();
 
@@ -1485,10 +1557,10 @@ int bc_compare_dicts_int(const immer::map<std::string, bc_inplace_value_t>& left
 	auto right_end_it = right.end();
 
 	while(left_it != left_end_it && right_it != right_end_it){
-		auto left_key = (*left_it).first;
-		auto right_key = (*right_it).first;
+		const auto& left_key = (*left_it).first;
+		const auto& right_key = (*right_it).first;
 
-		const auto key_result = bc_compare_string(left_key, right_key);
+		const auto key_result = bc_compare_dict_keys(left_key, right_key);
 		if(key_result != 0){
 			return key_result;
 		}
@@ -1515,7 +1587,7 @@ int bc_compare_dicts_int(const immer::map<std::string, bc_inplace_value_t>& left
 	quark::throw_exception();
 }
 
-int bc_compare_dicts_double(const immer::map<std::string, bc_inplace_value_t>& left, const immer::map<std::string, bc_inplace_value_t>& right){
+int bc_compare_dicts_double(const bc_dict_w_inplace_values_t& left, const bc_dict_w_inplace_values_t& right){
 	auto left_it = left.begin();
 	auto left_end_it = left.end();
 
@@ -1523,10 +1595,10 @@ int bc_compare_dicts_double(const immer::map<std::string, bc_inplace_value_t>& l
 	auto right_end_it = right.end();
 
 	while(left_it != left_end_it && right_it != right_end_it){
-		auto left_key = (*left_it).first;
-		auto right_key = (*right_it).first;
+		const auto& left_key = (*left_it).first;
+		const auto& right_key = (*right_it).first;
 
-		const auto key_result = bc_compare_string(left_key, right_key);
+		const auto key_result = bc_compare_dict_keys(left_key, right_key);
 		if(key_result != 0){
 			return key_result;
 		}
@@ -1646,6 +1718,10 @@ int bc_compare_value_true_deep(const bc_value_t& left, const bc_value_t& right,
 	if(type.is_undefined()){
 		return 0;
 	}
+	else if(encode_as_external(type) && left._pod._external == right._pod._external){
+		//	Both refer to the same immutable value.
+		return 0;
+	}
 	else if(type.is_bool()){
 		return (left.get_bool_value() ? 1 : 0) - (right.get_bool_value() ? 1 : 0);
 	}
@@ -1729,6 +1805,240 @@ int bc_compare_value_true_deep(const bc_value_t& left, const bc_value_t& right,
 	}
 }
 
+
+//////////////////////////////////////////		HASH
+
+
+//	splitmix64 finalizer.
+static uint64_t mix_hash(uint64_t x){
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+static uint64_t combine_hash(uint64_t acc, uint64_t h){
+	return mix_hash(acc ^ (h + 0x9e3779b97f4a7c15ULL + (acc << 6) + (acc >> 2)));
+}
+
+static uint64_t hash_string(const std::string& s){
+	return mix_hash(static_cast<uint64_t>(std::hash<std::string>()(s)));
+}
+
+static uint64_t hash_inplace(const bc_inplace_value_t& value, const typeid_t& type){
+	if(type.is_bool()){
+		return mix_hash(value._bool ? 1 : 2);
+	}
+	else if(type.is_int()){
+		return mix_hash(static_cast<uint64_t>(value._int64));
+	}
+	else if(type.is_double()){
+		//	0.0 == -0.0 so they must hash the same. All NaNs hash the same.
+		const auto d = value._double;
+		if(d == 0.0){
+			return mix_hash(0);
+		}
+		else if(d != d){
+			return mix_hash(0x7ff8000000000000ULL);
+		}
+		else{
+			uint64_t bits = 0;
+			std::memcpy(&bits, &d, sizeof(bits));
+			return mix_hash(bits);
+		}
+	}
+	else if(type.is_function()){
+		return mix_hash(static_cast<uint64_t>(value._function_id));
+	}
+	else{
+		QUARK_ASSERT(false);
+		quark::throw_exception();
+	}
+}
+
+static uint64_t hash_external(const bc_external_value_t* ext, const typeid_t& type);
+
+static uint64_t compute_external_hash(const bc_external_value_t* ext, const typeid_t& type){
+	if(type.is_string()){
+		return hash_string(ext->_string);
+	}
+	else if(type.is_json_value()){
+		return hash_string(json_to_compact_string(*ext->_json_value));
+	}
+	else if(type.is_typeid()){
+		return hash_string(typeid_to_compact_string(ext->_typeid_value));
+	}
+	else if(type.is_struct()){
+		const auto& struct_def = type.get_struct();
+		uint64_t acc = mix_hash(struct_def._members.size());
+		for(int i = 0 ; i < struct_def._members.size() ; i++){
+			acc = combine_hash(acc, bc_hash_value(ext->_struct_members[i], struct_def._members[i]._type));
+		}
+		return acc;
+	}
+	else if(type.is_vector()){
+		const auto& element_type = type.get_vector_element_type();
+		if(encode_as_inplace(element_type)){
+			const auto& vec = ext->_vector_w_inplace_elements;
+			uint64_t acc = mix_hash(vec.size());
+			for(const auto& e: vec){
+				acc = combine_hash(acc, hash_inplace(e, element_type));
+			}
+			return acc;
+		}
+		else{
+			const auto& vec = ext->_vector_w_external_elements;
+			uint64_t acc = mix_hash(vec.size());
+			for(const auto& e: vec){
+				acc = combine_hash(acc, hash_external(e._external, element_type));
+			}
+			return acc;
+		}
+	}
+	else if(type.is_dict()){
+		//	Entries are combined with + so the result doesn't depend on iteration order.
+		const auto& value_type = type.get_dict_value_type();
+		uint64_t sum = 0;
+		size_t count = 0;
+		if(encode_as_inplace(value_type)){
+			for(const auto& e: ext->_dict_w_inplace_values){
+				sum += combine_hash(e.first._hash, hash_inplace(e.second, value_type));
+				count++;
+			}
+		}
+		else{
+			for(const auto& e: ext->_dict_w_external_values){
+				sum += combine_hash(e.first._hash, hash_external(e.second._external, value_type));
+				count++;
+			}
+		}
+		return combine_hash(mix_hash(count), sum);
+	}
+	else{
+		QUARK_ASSERT(false);
+		quark::throw_exception();
+	}
+}
+
+//	External values are immutable so the hash never needs to be recomputed. Two threads may race to compute
+//	the same hash, they will store the same number.
+static uint64_t hash_external(const bc_external_value_t* ext, const typeid_t& type){
+	QUARK_ASSERT(ext != nullptr);
+
+	const auto cached = ext->_hash.load(std::memory_order_relaxed);
+	if(cached != k_hash_not_computed){
+		return cached;
+	}
+	else{
+		const auto h = compute_external_hash(ext, type);
+		const auto h2 = h == k_hash_not_computed ? 1 : h;
+		ext->_hash.store(h2, std::memory_order_relaxed);
+		return h2;
+	}
+}
+
+uint64_t bc_hash_value(const bc_value_t& value, const typeid_t& type){
+	QUARK_ASSERT(value.check_invariant());
+
+	if(type.is_undefined()){
+		return mix_hash(0);
+	}
+	else if(type.is_bool() || type.is_int() || type.is_double() || type.is_function()){
+		return hash_inplace(value._pod._inplace, type);
+	}
+	else{
+		return hash_external(value._pod._external, type);
+	}
+}
+
+//	bc_compare_value_true_deep() treats NaN as equal to any double and json numbers 0 and -0 print differently,
+//	so for these types different hashes does NOT prove that the values are different.
+static bool hash_proves_inequality(const typeid_t& type){
+	if(type.is_double() || type.is_json_value()){
+		return false;
+	}
+	else if(type.is_struct()){
+		for(const auto& e: type.get_struct()._members){
+			if(hash_proves_inequality(e._type) == false){
+				return false;
+			}
+		}
+		return true;
+	}
+	else if(type.is_vector()){
+		return hash_proves_inequality(type.get_vector_element_type());
+	}
+	else if(type.is_dict()){
+		return hash_proves_inequality(type.get_dict_key_type()) && hash_proves_inequality(type.get_dict_value_type());
+	}
+	else{
+		return true;
+	}
+}
+
+bool bc_values_equal(const bc_value_t& left, const bc_value_t& right, const typeid_t& type){
+	QUARK_ASSERT(left._type == right._type);
+
+	if(encode_as_external(type)){
+		const auto a = left._pod._external;
+		const auto b = right._pod._external;
+		if(a == b){
+			return true;
+		}
+
+		const auto a_hash = a->_hash.load(std::memory_order_relaxed);
+		const auto b_hash = b->_hash.load(std::memory_order_relaxed);
+		if(a_hash != k_hash_not_computed && b_hash != k_hash_not_computed && a_hash != b_hash && hash_proves_inequality(type)){
+			return false;
+		}
+	}
+	return bc_compare_value_true_deep(left, right, type) == 0;
+}
+
+QUARK_UNIT_TEST("bytecode_interpreter", "bc_hash_value()", "equal values", "same hash"){
+	const auto a = make_vector(typeid_t::make_string(), immer::vector<bc_value_t>{ bc_value_t::make_string("one"), bc_value_t::make_string("two") });
+	const auto b = make_vector(typeid_t::make_string(), immer::vector<bc_value_t>{ bc_value_t::make_string("one"), bc_value_t::make_string("two") });
+	QUARK_UT_VERIFY(bc_hash_value(a, a._type) == bc_hash_value(b, b._type));
+}
+
+QUARK_UNIT_TEST("bytecode_interpreter", "bc_hash_value()", "different order", "different hash"){
+	const auto a = make_vector(typeid_t::make_int(), immer::vector<bc_value_t>{ bc_value_t::make_int(1), bc_value_t::make_int(2) });
+	const auto b = make_vector(typeid_t::make_int(), immer::vector<bc_value_t>{ bc_value_t::make_int(2), bc_value_t::make_int(1) });
+	QUARK_UT_VERIFY(bc_hash_value(a, a._type) != bc_hash_value(b, b._type));
+}
+
+QUARK_UNIT_TEST("bytecode_interpreter", "bc_hash_value()", "vector", "hash is cached in external values"){
+	const auto a = make_vector(typeid_t::make_string(), immer::vector<bc_value_t>{ bc_value_t::make_string("one") });
+	QUARK_UT_VERIFY(a._pod._external->_hash == k_hash_not_computed);
+	const auto h = bc_hash_value(a, a._type);
+	QUARK_UT_VERIFY(a._pod._external->_hash == h);
+	QUARK_UT_VERIFY(a._pod._external->_vector_w_external_elements[0]._external->_hash != k_hash_not_computed);
+}
+
+QUARK_UNIT_TEST("bytecode_interpreter", "bc_values_equal()", "same external value", "true"){
+	const auto a = bc_value_t::make_string("hello");
+	const auto b = a;
+	QUARK_UT_VERIFY(bc_values_equal(a, b, a._type));
+}
+
+QUARK_UNIT_TEST("bytecode_interpreter", "bc_values_equal()", "cached hashes differ", "false"){
+	const auto a = bc_value_t::make_string("hello");
+	const auto b = bc_value_t::make_string("world");
+	bc_hash_value(a, a._type);
+	bc_hash_value(b, b._type);
+	QUARK_UT_VERIFY(bc_values_equal(a, b, a._type) == false);
+	QUARK_UT_VERIFY(bc_values_equal(a, bc_value_t::make_string("hello"), a._type) == true);
+}
+
+QUARK_UNIT_TEST("bytecode_interpreter", "bc_hash_value()", "0.0 and -0.0", "same hash"){
+	const auto a = bc_value_t::make_double(0.0);
+	const auto b = bc_value_t::make_double(-0.0);
+	QUARK_UT_VERIFY(bc_hash_value(a, a._type) == bc_hash_value(b, b._type));
+}
+
+
 extern const std::map<bc_opcode, opcode_info_t> k_opcode_info = {
 	{ bc_opcode::k_nop, { "nop", opcode_info_t::encoding::k_e_0000 }},
 
@@ -1902,22 +2212,22 @@ bool bc_instruction_t::check_invariant() const {
 
 bc_static_frame_t::bc_static_frame_t(const std::vector<bc_instruction_t>& instrs2, const std::vector<std::pair<std::string, bc_symbol_t>>& symbols, const std::vector<typeid_t>& args) :
 	_instructions(instrs2),
-	_symbols(symbols),
 	_args(args)
 {
-	const auto parameter_count = static_cast<int>(_args.size());
-
-	for(int i = 0 ; i < _symbols.size() ; i++){
-		const auto type = _symbols[i].second._value_type;
-		const bool ext = encode_as_external(type);
-		_exts.push_back(ext);
+	for(const auto& symbol: symbols){
+		append_symbol(symbol);
 	}
+	QUARK_ASSERT(check_invariant());
+}
 
-	//	Process the locals & temps. They go after any parameters, which already sits on stack.
-	for(std::vector<bc_value_t>::size_type i = parameter_count ; i < _symbols.size() ; i++){
-		const auto& symbol = _symbols[i];
-		bool is_ext = _exts[i];
+void bc_static_frame_t::append_symbol(const std::pair<std::string, bc_symbol_t>& symbol){
+	const auto parameter_count = _args.size();
+	const bool is_ext = encode_as_external(symbol.second._value_type);
+	_symbols.push_back(symbol);
+	_exts.push_back(is_ext);
 
+	//	Parameters already sit on the stack, only the locals & temps that go after them need a value.
+	if(_symbols.size() > parameter_count){
 		_locals_exts.push_back(is_ext);
 
 		//	Variable slot.
@@ -1941,8 +2251,16 @@ bc_static_frame_t::bc_static_frame_t(const std::vector<bc_instruction_t>& instrs
 			_locals.push_back(symbol.second._const_value);
 		}
 	}
+}
 
-	QUARK_ASSERT(check_invariant());
+void bc_static_frame_t::truncate_symbols(size_t count){
+	QUARK_ASSERT(count >= _args.size() && count <= _symbols.size());
+
+	const auto local_count = count - _args.size();
+	_symbols.erase(_symbols.begin() + count, _symbols.end());
+	_exts.erase(_exts.begin() + count, _exts.end());
+	_locals_exts.erase(_locals_exts.begin() + local_count, _locals_exts.end());
+	_locals.erase(_locals.begin() + local_count, _locals.end());
 }
 
 bool bc_static_frame_t::check_invariant() const {
@@ -1978,7 +2296,8 @@ bc_function_definition_t::bc_function_definition_t(
 	_frame_ptr(frame),
 	_host_function_id(host_function_id),
 	_dyn_arg_count(-1),
-	_return_is_ext(encode_as_external(_function_type.get_function_return()))
+	_return_is_ext(encode_as_external(_function_type.get_function_return())),
+	_is_inlined(false)
 {
 	_dyn_arg_count = count_function_dynamic_args(function_type);
 }
@@ -2160,6 +2479,15 @@ bc_value_t call_function_bc(interpreter_t& vm, const bc_value_t& f, const bc_val
 		}
 #endif
 
+		bc_memo_table_t* memo = f.get_function_value() < vm._memo_tables.size() ? vm._memo_tables[f.get_function_value()].get() : nullptr;
+		const auto hash = memo != nullptr ? bc_hash_args(args, arg_count) : 0;
+		if(memo != nullptr){
+			const auto hit = memo->find(hash, args, arg_count);
+			if(hit != nullptr){
+				return *hit;
+			}
+		}
+
 		vm._stack.save_frame();
 
 		//??? use exts-info inside function_def.
@@ -2183,6 +2511,10 @@ bc_value_t call_function_bc(interpreter_t& vm, const bc_value_t& f, const bc_val
 		vm._stack.pop_batch(exts);
 		vm._stack.restore_frame();
 
+		if(memo != nullptr){
+			memo->insert(hash, args, arg_count, result.second);
+		}
+
 		if(vm._imm->_program._types[result.first].is_void() == false){
 			return result.second;
 		}
@@ -2265,16 +2597,26 @@ json_t bcvalue_to_json(const bc_value_t& v){
 		}
 		return result;
 	}
+	//	JSON objects only have string keys: dicts with other keys become an array of [key, value] pairs.
 	else if(v._type.is_dict()){
 		const auto value_type = v._type.get_dict_value_type();
 		const auto entries = get_dict_value(v);
-		std::map<std::string, json_t> result;
-		for(const auto& e: entries){
-			const auto value2 = e.second;
-			//??? works for all types? Use that technique in all thunking! Slower but less code.
-			result[e.first] = bcvalue_to_json(bc_value_t(value_type, value2));
+		if(v._type.get_dict_key_type().is_string()){
+			std::map<std::string, json_t> result;
+			for(const auto& e: entries){
+				const auto value2 = e.second;
+				//??? works for all types? Use that technique in all thunking! Slower but less code.
+				result[e.first.get_string()] = bcvalue_to_json(bc_value_t(value_type, value2));
+			}
+			return result;
+		}
+		else{
+			std::vector<json_t> result;
+			for(const auto& e: entries){
+				result.push_back(json_t::make_array({ bcvalue_to_json(e.first._key), bcvalue_to_json(bc_value_t(value_type, e.second)) }));
+			}
+			return json_t::make_array(result);
 		}
-		return result;
 	}
 	else if(v._type.is_function()){
 		return json_t::make_object(
@@ -2302,10 +2644,7 @@ json_t bcvalue_and_type_to_json(const bc_value_t& v){
 
 
 
-interpreter_t::interpreter_t(const bc_program_t& program, interpreter_handler_i* handler) :
-	_stack(nullptr),
-	_handler(handler)
-{
+std::shared_ptr<interpreter_imm_t> make_interpreter_imm(const bc_program_t& program){
 	QUARK_ASSERT(program.check_invariant());
 
 	//	Make lookup table from host-function ID to an implementation of that host function in the interpreter.
@@ -2318,7 +2657,15 @@ interpreter_t::interpreter_t(const bc_program_t& program, interpreter_handler_i*
 	}
 
 	const auto start_time = std::chrono::high_resolution_clock::now();
-	_imm = std::make_shared<interpreter_imm_t>(interpreter_imm_t{start_time, program, host_functions2});
+	return std::make_shared<interpreter_imm_t>(interpreter_imm_t{start_time, program, host_functions2});
+}
+
+interpreter_t::interpreter_t(const std::shared_ptr<interpreter_imm_t>& imm, interpreter_handler_i* handler) :
+	_imm(imm),
+	_handler(handler),
+	_stack(nullptr)
+{
+	QUARK_ASSERT(imm != nullptr);
 
 	interpreter_stack_t temp(&_imm->_program._globals);
 	temp.swap(_stack);
@@ -2329,6 +2676,37 @@ interpreter_t::interpreter_t(const bc_program_t& program, interpreter_handler_i*
 	/*const auto& r =*/ execute_instructions(*this, _imm->_program._globals._instructions);
 	QUARK_ASSERT(check_invariant());
 }
+
+interpreter_t::interpreter_t(const std::shared_ptr<interpreter_imm_t>& imm, const std::vector<bc_value_t>& globals, interpreter_handler_i* handler) :
+	_imm(imm),
+	_handler(handler),
+	_stack(nullptr)
+{
+	QUARK_ASSERT(imm != nullptr);
+
+	const auto& frame = _imm->_program._globals;
+	QUARK_ASSERT(globals.size() <= frame._locals.size());
+
+	interpreter_stack_t temp(&frame);
+	temp.swap(_stack);
+	_stack.save_frame();
+	_stack.open_frame(frame, 0);
+
+	for(int i = 0 ; i < globals.size() ; i++){
+		if(frame._exts[i]){
+			_stack.replace_external_value(get_global_n_pos(i), globals[i]);
+		}
+		else{
+			_stack.replace_inplace_value(get_global_n_pos(i), globals[i]);
+		}
+	}
+	QUARK_ASSERT(check_invariant());
+}
+
+interpreter_t::interpreter_t(const bc_program_t& program, interpreter_handler_i* handler) :
+	interpreter_t(make_interpreter_imm(program), handler)
+{
+}
 interpreter_t::interpreter_t(const bc_program_t& program) : interpreter_t(program, nullptr) {}
 
 void interpreter_t::swap(interpreter_t& other) throw(){
@@ -2336,6 +2714,7 @@ void interpreter_t::swap(interpreter_t& other) throw(){
 	std::swap(other._handler, this->_handler);
 	other._stack.swap(this->_stack);
 	other._print_output.swap(this->_print_output);
+	other._memo_tables.swap(this->_memo_tables);
 }
 
 #if DEBUG
@@ -2451,18 +2830,17 @@ void execute_new_dict_obj(interpreter_t& vm, int16_t dest_reg, int16_t target_it
 	QUARK_ASSERT(target_type.is_undefined() == false);
 	QUARK_ASSERT(element_type.is_undefined() == false);
 
-	const auto string_type = typeid_t::make_string();
+	const auto key_type = target_type.get_dict_key_type();
 
-	immer::map<std::string, bc_external_handle_t> elements2;
+	bc_dict_w_external_values_t elements2;
 	int dict_element_count = arg_count / 2;
 	for(auto i = 0 ; i < dict_element_count ; i++){
-		const auto key = vm._stack.load_value(arg0_stack_pos + i * 2 + 0, string_type);
+		const auto key = vm._stack.load_value(arg0_stack_pos + i * 2 + 0, key_type);
 		const auto value = vm._stack.load_value(arg0_stack_pos + i * 2 + 1, element_type);
-		const auto key2 = key.get_string_value();
-		elements2 = elements2.insert({ key2, bc_external_handle_t(value) });
+		elements2 = elements2.insert({ bc_dict_key_t(key), bc_external_handle_t(value) });
 	}
 
-	const auto result = make_dict(element_type, elements2);
+	const auto result = make_dict(target_type, elements2);
 	vm._stack.write_register__external_value(dest_reg, result);
 }
 void execute_new_dict_pod64(interpreter_t& vm, int16_t dest_reg, int16_t target_itype, int16_t arg_count){
@@ -2477,18 +2855,17 @@ void execute_new_dict_pod64(interpreter_t& vm, int16_t dest_reg, int16_t target_
 	QUARK_ASSERT(target_type.is_undefined() == false);
 	QUARK_ASSERT(element_type.is_undefined() == false);
 
-	const auto string_type = typeid_t::make_string();
+	const auto key_type = target_type.get_dict_key_type();
 
-	immer::map<std::string, bc_inplace_value_t> elements2;
+	bc_dict_w_inplace_values_t elements2;
 	int dict_element_count = arg_count / 2;
 	for(auto i = 0 ; i < dict_element_count ; i++){
-		const auto key = vm._stack.load_value(arg0_stack_pos + i * 2 + 0, string_type);
+		const auto key = vm._stack.load_value(arg0_stack_pos + i * 2 + 0, key_type);
 		const auto value = vm._stack.load_value(arg0_stack_pos + i * 2 + 1, element_type);
-		const auto key2 = key.get_string_value();
-		elements2 = elements2.insert({ key2, value._pod._inplace });
+		elements2 = elements2.insert({ bc_dict_key_t(key), value._pod._inplace });
 	}
 
-	const auto result = make_dict(element_type, elements2);
+	const auto result = make_dict(target_type, elements2);
 	vm._stack.write_register__external_value(dest_reg, result);
 }
 
@@ -2515,6 +2892,34 @@ void execute_new_struct(interpreter_t& vm, int16_t dest_reg, int16_t target_ityp
 }
 
 
+//	The arguments are already pushed to the stack.
+static std::pair<bc_typeid_t, bc_value_t> execute_function(interpreter_t& vm, const bc_function_definition_t& function_def, int arg_count){
+	vm._stack.open_frame(*function_def._frame_ptr, arg_count);
+	const auto& result = execute_instructions(vm, function_def._frame_ptr->_instructions);
+	vm._stack.close_frame(*function_def._frame_ptr);
+	return result;
+}
+
+//	The arguments are already pushed to the stack. On a hit the function isn't executed at all.
+static std::pair<bc_typeid_t, bc_value_t> call_memoized_function(interpreter_t& vm, bc_memo_table_t& memo, const bc_function_definition_t& function_def, int arg_count){
+	std::vector<bc_value_t> args;
+	const auto arg0_stack_pos = vm._stack.size() - arg_count;
+	for(int a = 0 ; a < arg_count ; a++){
+		args.push_back(vm._stack.load_value(arg0_stack_pos + a, function_def._args[a]._type));
+	}
+
+	const auto hash = bc_hash_args(args.data(), arg_count);
+	const auto hit = memo.find(hash, args.data(), arg_count);
+	if(hit != nullptr){
+		return { 0, *hit };
+	}
+	else{
+		const auto result = execute_function(vm, function_def, arg_count);
+		memo.insert(hash, args.data(), arg_count, result.second);
+		return result;
+	}
+}
+
 std::pair<bc_typeid_t, bc_value_t> execute_instructions(interpreter_t& vm, const std::vector<bc_instruction_t>& instructions){
 	QUARK_ASSERT(vm.check_invariant());
 	QUARK_ASSERT(instructions.empty() == true || (instructions.back()._opcode == bc_opcode::k_return || instructions.back()._opcode == bc_opcode::k_stop));
@@ -2916,11 +3321,10 @@ std::pair<bc_typeid_t, bc_value_t> execute_instructions(interpreter_t& vm, const
 		case bc_opcode::k_lookup_element_dict_w_external_values: {
 			QUARK_ASSERT(stack.check_reg__external_value(i._a));
 			QUARK_ASSERT(stack.check_reg_dict_w_external_values(i._b));
-			QUARK_ASSERT(stack.check_reg_string(i._c));
+			QUARK_ASSERT(stack.check_reg(i._c));
 
 			const auto& entries = regs[i._b]._external->_dict_w_external_values;
-			const auto& lookup_key = regs[i._c]._external->_string;
-			const auto found_ptr = entries.find(lookup_key);
+			const auto found_ptr = entries.find(bc_dict_key_t(stack.read_register(i._c)));
 			if(found_ptr == nullptr){
 				quark::throw_runtime_error("Lookup in dict: key not found.");
 			}
@@ -2935,11 +3339,10 @@ std::pair<bc_typeid_t, bc_value_t> execute_instructions(interpreter_t& vm, const
 		case bc_opcode::k_lookup_element_dict_w_inplace_values: {
 			QUARK_ASSERT(stack.check_reg_any(i._a));
 			QUARK_ASSERT(stack.check_reg_dict_w_inplace_values(i._b));
-			QUARK_ASSERT(stack.check_reg_string(i._c));
+			QUARK_ASSERT(stack.check_reg(i._c));
 
 			const auto& entries = regs[i._b]._external->_dict_w_inplace_values;
-			const auto& lookup_key = regs[i._c]._external->_string;
-			const auto found_ptr = entries.find(lookup_key);
+			const auto found_ptr = entries.find(bc_dict_key_t(stack.read_register(i._c)));
 			if(found_ptr == nullptr){
 				quark::throw_runtime_error("Lookup in dict: key not found.");
 			}
@@ -3146,9 +3549,10 @@ std::pair<bc_typeid_t, bc_value_t> execute_instructions(interpreter_t& vm, const
 				//	We need to remember the global pos where to store return value, since we're switching frame to call function.
 				int result_reg_pos = static_cast<int>(stack._current_frame_entry_ptr - &stack._entries[0]) + i._a;
 
-				stack.open_frame(*function_def._frame_ptr, callee_arg_count);
-				const auto& result = execute_instructions(vm, function_def._frame_ptr->_instructions);
-				stack.close_frame(*function_def._frame_ptr);
+				bc_memo_table_t* memo = function_id < vm._memo_tables.size() ? vm._memo_tables[function_id].get() : nullptr;
+				const auto& result = memo != nullptr
+					? call_memoized_function(vm, *memo, function_def, callee_arg_count)
+					: execute_function(vm, function_def, callee_arg_count);
 
 				//	Update our cached pointers.
 				frame_ptr = stack._current_frame_ptr;
@@ -3313,9 +3717,7 @@ std::pair<bc_typeid_t, bc_value_t> execute_instructions(interpreter_t& vm, const
 			QUARK_ASSERT(type.is_int() == false);
 			const auto left = stack.read_register(i._b);
 			const auto right = stack.read_register(i._c);
-			long diff = bc_compare_value_true_deep(left, right, type);
-
-			regs[i._a]._inplace._bool = diff == 0;
+			regs[i._a]._inplace._bool = bc_values_equal(left, right, type);
 			break;
 		}
 		case bc_opcode::k_logical_equal_int: {
@@ -3336,9 +3738,7 @@ std::pair<bc_typeid_t, bc_value_t> execute_instructions(interpreter_t& vm, const
 			QUARK_ASSERT(type.is_int() == false);
 			const auto left = stack.read_register(i._b);
 			const auto right = stack.read_register(i._c);
-			long diff = bc_compare_value_true_deep(left, right, type);
-
-			regs[i._a]._inplace._bool = diff != 0;
+			regs[i._a]._inplace._bool = !bc_values_equal(left, right, type);
 			break;
 		}
 		case bc_opcode::k_logical_nonequal_int: {
@@ -3601,6 +4001,94 @@ std::shared_ptr<value_entry_t> find_global_symbol2(const interpreter_t& vm, cons
 	}
 }
 
+std::vector<bc_value_t> snapshot_globals(const interpreter_t& vm){
+	QUARK_ASSERT(vm.check_invariant());
+
+	//	Use the types of the frame's locals: for constants they can be more specific than the symbol's _value_type.
+	const auto& frame = vm._imm->_program._globals;
+	QUARK_ASSERT(frame._args.empty());
+
+	std::vector<bc_value_t> result;
+	for(int i = 0 ; i < frame._locals.size() ; i++){
+		result.push_back(vm._stack.load_value(get_global_n_pos(i), frame._locals[i]._type));
+	}
+	return result;
+}
+
+
+bc_program_extent_t extend_program(
+	interpreter_t& vm,
+	const std::vector<std::pair<std::string, bc_symbol_t>>& globals,
+	const std::vector<bc_function_definition_t>& function_defs,
+	const std::vector<typeid_t>& types
+){
+	QUARK_ASSERT(vm.check_invariant());
+	QUARK_ASSERT(vm._imm.use_count() == 1);
+
+	auto& program = vm._imm->_program;
+	auto& frame = program._globals;
+	auto& stack = vm._stack;
+	QUARK_ASSERT(stack._current_frame_ptr == &frame);
+	QUARK_ASSERT(stack._stack_size == k_frame_overhead + frame._symbols.size());
+
+	const auto extent = bc_program_extent_t{ frame._symbols.size(), program._function_defs.size(), program._types.size() };
+	if(stack._stack_size + globals.size() > stack._allocated_count){
+		quark::throw_runtime_error("Too many globals.");
+	}
+
+	program._function_defs.insert(program._function_defs.end(), function_defs.begin(), function_defs.end());
+	program._types.insert(program._types.end(), types.begin(), types.end());
+	for(const auto& e: globals){
+		frame.append_symbol(e);
+		const auto& local = frame._locals.back();
+		if(frame._locals_exts.back()){
+			stack.push_external_value(local);
+		}
+		else{
+			stack.push_inplace_value(local);
+		}
+	}
+
+	QUARK_ASSERT(vm.check_invariant());
+	return extent;
+}
+
+void truncate_program(interpreter_t& vm, const bc_program_extent_t& extent){
+	QUARK_ASSERT(vm.check_invariant());
+	QUARK_ASSERT(vm._imm.use_count() == 1);
+
+	auto& program = vm._imm->_program;
+	auto& frame = program._globals;
+	QUARK_ASSERT(vm._stack._current_frame_ptr == &frame);
+	QUARK_ASSERT(vm._stack._stack_size == k_frame_overhead + frame._symbols.size());
+	QUARK_ASSERT(extent._global_count <= frame._symbols.size());
+
+	vm._stack.pop_batch({ frame._locals_exts.begin() + extent._global_count, frame._locals_exts.end() });
+	frame.truncate_symbols(extent._global_count);
+	program._function_defs.erase(program._function_defs.begin() + extent._function_count, program._function_defs.end());
+	program._types.erase(program._types.begin() + extent._type_count, program._types.end());
+	if(vm._memo_tables.size() > extent._function_count){
+		vm._memo_tables.resize(extent._function_count);
+	}
+
+	QUARK_ASSERT(vm.check_invariant());
+}
+
+void unwind_to_global_frame(interpreter_t& vm){
+	auto& stack = vm._stack;
+	const auto& frame = vm._imm->_program._globals;
+	const auto global_end = k_frame_overhead + frame._symbols.size();
+	QUARK_ASSERT(stack._stack_size >= global_end);
+
+	stack._stack_size = global_end;
+#if DEBUG
+	stack._debug_types.erase(stack._debug_types.begin() + global_end, stack._debug_types.end());
+#endif
+	stack._current_frame_ptr = &frame;
+	stack._current_frame_entry_ptr = &stack._entries[k_frame_overhead];
+	QUARK_ASSERT(vm.check_invariant());
+}
+
 
 std::string opcode_to_string(bc_opcode opcode){
 	return k_opcode_info.at(opcode)._as_text;
@@ -46,6 +46,7 @@ struct bc_value_t;
 union bc_pod_value_t;
 struct bc_external_value_t;
 struct bc_external_handle_t;
+struct bc_memo_table_t;
 
 
 typedef bc_value_t (*HOST_FUNCTION_PTR)(interpreter_t& vm, const bc_value_t args[], int arg_count);
@@ -244,6 +245,44 @@ struct bc_external_handle_t {
 bool check_external_deep(const typeid_t& type, const bc_external_value_t* ext);
 
 
+//////////////////////////////////////		bc_dict_key_t
+
+/*
+	Key of a dictionary. Holds the key as a bc_value_t so the dictionary backend can use any type of value as key.
+	All keys of a dictionary have the dictionary's key type, see typeid_t::get_dict_key_type().
+
+	The hash is computed once, when the key is made, using bc_hash_value(). For a string key that hash is cached inside
+	the string's bc_external_value_t, so looking up using the same string value again doesn't rehash the characters.
+*/
+
+struct bc_dict_key_t {
+	public: explicit bc_dict_key_t(const bc_value_t& key);
+	public: explicit bc_dict_key_t(const std::string& key);
+	public: bool check_invariant() const;
+	public: bool operator==(const bc_dict_key_t& other) const;
+
+	//	Key must be a string.
+	public: std::string get_string() const;
+
+
+	//////////////////////////////////////		STATE
+	public: bc_value_t _key;
+	public: uint64_t _hash;
+};
+
+struct bc_dict_key_hash_t {
+	size_t operator()(const bc_dict_key_t& key) const {
+		return static_cast<size_t>(key._hash);
+	}
+};
+
+typedef immer::map<bc_dict_key_t, bc_external_handle_t, bc_dict_key_hash_t> bc_dict_w_external_values_t;
+typedef immer::map<bc_dict_key_t, bc_inplace_value_t, bc_dict_key_hash_t> bc_dict_w_inplace_values_t;
+
+int bc_compare_dict_keys(const bc_dict_key_t& left, const bc_dict_key_t& right);
+
+
+
 //////////////////////////////////////		bc_external_value_t
 
 /*
@@ -253,6 +292,20 @@ bool check_external_deep(const typeid_t& type, const bc_external_value_t* ext);
 	TODO: Right now wastes resouces by containing *all* types of external values! Should use std::variant.
 */
 
+const uint64_t k_hash_not_computed = 0;
+
+//	Counts the bc_external_value_t:s allocated and freed by the current thread. Plain ints, no atomics: cheap enough
+//	to always be on. Take the difference before and after some work to see what it allocated.
+struct bc_alloc_counters_t {
+	int64_t _allocations;
+	int64_t _frees;
+};
+
+inline bc_alloc_counters_t& get_thread_alloc_counters(){
+	static thread_local bc_alloc_counters_t counters = { 0, 0 };
+	return counters;
+}
+
 struct bc_external_value_t {
 	public: bc_external_value_t(const std::string& s);
 	public: bc_external_value_t(const std::shared_ptr<json_t>& s);
@@ -260,17 +313,29 @@ struct bc_external_value_t {
 	public: bc_external_value_t(const typeid_t& type, const std::vector<bc_value_t>& s, bool struct_tag);
 	public: bc_external_value_t(const typeid_t& type, const immer::vector<bc_external_handle_t>& s);
 	public: bc_external_value_t(const typeid_t& type, const immer::vector<bc_inplace_value_t>& s);
-	public: bc_external_value_t(const typeid_t& type, const immer::map<std::string, bc_external_handle_t>& s);
-	public: bc_external_value_t(const typeid_t& type, const immer::map<std::string, bc_inplace_value_t>& s);
+	public: bc_external_value_t(const typeid_t& type, const bc_dict_w_external_values_t& s);
+	public: bc_external_value_t(const typeid_t& type, const bc_dict_w_inplace_values_t& s);
 
 #if DEBUG
 	public: bool check_invariant() const;
 #endif
 	public: bool operator==(const bc_external_value_t& other) const;
 
+	public: static void* operator new(std::size_t size){
+		get_thread_alloc_counters()._allocations++;
+		return ::operator new(size);
+	}
+	public: static void operator delete(void* p){
+		get_thread_alloc_counters()._frees++;
+		::operator delete(p);
+	}
+
 
 	//////////////////////////////////////		STATE
 	public: mutable std::atomic<int> _rc;
+
+	//	Structural hash, see bc_hash_value(). Computed the first time it's needed. k_hash_not_computed = not yet computed.
+	public: mutable std::atomic<uint64_t> _hash { 0 };
 #if DEBUG
 	public: bool _debug__is_unwritten_external_value = false;
 #endif
@@ -283,8 +348,8 @@ struct bc_external_value_t {
 	public: std::vector<bc_value_t> _struct_members;
 	public: immer::vector<bc_external_handle_t> _vector_w_external_elements;
 	public: immer::vector<bc_inplace_value_t> _vector_w_inplace_elements;
-	public: immer::map<std::string, bc_external_handle_t> _dict_w_external_values;
-	public: immer::map<std::string, bc_inplace_value_t> _dict_w_inplace_values;
+	public: bc_dict_w_external_values_t _dict_w_external_values;
+	public: bc_dict_w_inplace_values_t _dict_w_inplace_values;
 };
 
 
@@ -299,14 +364,22 @@ bc_value_t make_vector(const typeid_t& element_type, const immer::vector<bc_valu
 bc_value_t make_vector(const typeid_t& element_type, const immer::vector<bc_external_handle_t>& elements);
 bc_value_t make_vector(const typeid_t& element_type, const immer::vector<bc_inplace_value_t>& elements);
 
-const immer::map<std::string, bc_external_handle_t>& get_dict_value(const bc_value_t& value);
-bc_value_t make_dict(const typeid_t& value_type, const immer::map<std::string, bc_external_handle_t>& entries);
-bc_value_t make_dict(const typeid_t& value_type, const immer::map<std::string, bc_inplace_value_t>& entries);
+const bc_dict_w_external_values_t& get_dict_value(const bc_value_t& value);
+bc_value_t make_dict(const typeid_t& dict_type, const bc_dict_w_external_values_t& entries);
+bc_value_t make_dict(const typeid_t& dict_type, const bc_dict_w_inplace_values_t& entries);
 
 json_t bcvalue_to_json(const bc_value_t& v);
 int bc_compare_value_true_deep(const bc_value_t& left, const bc_value_t& right, const typeid_t& type);
 int bc_compare_value_exts(const bc_external_handle_t& left, const bc_external_handle_t& right, const typeid_t& type);
 
+//	Values that are equal according to bc_compare_value_true_deep() get the same hash.
+//	The hash of an external value is cached inside it, so hashing the same value again is O(1).
+uint64_t bc_hash_value(const bc_value_t& value, const typeid_t& type);
+
+//	Same result as bc_compare_value_true_deep() == 0, but O(1) when both values share the same external value or
+//	already have cached hashes that differ.
+bool bc_values_equal(const bc_value_t& left, const bc_value_t& right, const typeid_t& type);
+
 
 
 //////////////////////////////////////		bc_symbol_t
@@ -738,6 +811,12 @@ struct bc_static_frame_t {
 	);
 	bool check_invariant() const;
 
+	//	Adds a symbol after the existing ones, with its local.
+	void append_symbol(const std::pair<std::string, bc_symbol_t>& symbol);
+
+	//	Keeps the first count symbols. count must not be less than the number of args.
+	void truncate_symbols(size_t count);
+
 
 	//////////////////////////////////////		STATE
 	std::vector<bc_instruction_t> _instructions;
@@ -785,6 +864,10 @@ struct bc_function_definition_t {
 
 	int _dyn_arg_count;
 	bool _return_is_ext;
+
+	//	True if the generator replaced calls to this function by its body somewhere. Those calls never reach the
+	//	interpreter, so the function can't be memoized.
+	bool _is_inlined;
 };
 
 
@@ -804,7 +887,7 @@ struct bc_program_t {
 
 
 	//////////////////////////////////////		STATE
-	public: const bc_static_frame_t _globals;
+	public: bc_static_frame_t _globals;
 	public: std::vector<bc_function_definition_t> _function_defs;
 	public: std::vector<typeid_t> _types;
 	public: software_system_t _software_system;
@@ -1340,7 +1423,18 @@ struct interpreter_stack_t {
 */
 struct interpreter_handler_i {
 	virtual ~interpreter_handler_i(){};
-	virtual void on_send(const std::string& process_id, const json_t& message) = 0;
+	//	message is shared with the receiver, not copied.
+	virtual void on_send(const std::string& process_id, const bc_value_t& message) = 0;
+
+	//	process_index is the position in get_process_keys(), resolved by the compiler.
+	virtual void on_send(int process_index, const bc_value_t& message) = 0;
+
+	//	See process_inbox_t.
+	virtual double on_get_inbox_pressure(const std::string& process_id) = 0;
+	virtual json_t on_get_inbox_stats(const std::string& process_id) = 0;
+
+	//	time_us is on the get_monotonic_time_us() clock.
+	virtual void on_post_at_time(const std::string& process_id, int64_t time_us, const bc_value_t& message) = 0;
 };
 
 
@@ -1348,12 +1442,21 @@ struct interpreter_handler_i {
 
 //	Holds static = immutable state the interpreter wants to keep around.
 
+/*
+	The compiled program and everything else that never changes while it runs. Any number of interpreters, like
+	the interpreters of all processes in a container, can share the same interpreter_imm_t.
+
+	The one exception is extend_program(), which appends to _program between two runs of an interpreter that is the
+	only user of its interpreter_imm_t.
+*/
 struct interpreter_imm_t {
 	public: const std::chrono::time_point<std::chrono::high_resolution_clock> _start_time;
-	public: const bc_program_t _program;
+	public: bc_program_t _program;
 	public: const std::map<int, HOST_FUNCTION_PTR> _host_functions;
 };
 
+std::shared_ptr<interpreter_imm_t> make_interpreter_imm(const bc_program_t& program);
+
 
 //////////////////////////////////////		value_entry_t
 
@@ -1378,6 +1481,13 @@ struct value_entry_t {
 struct interpreter_t {
 	public: explicit interpreter_t(const bc_program_t& program);
 	public: explicit interpreter_t(const bc_program_t& program, interpreter_handler_i* handler);
+
+	//	Runs static initialization.
+	public: explicit interpreter_t(const std::shared_ptr<interpreter_imm_t>& imm, interpreter_handler_i* handler);
+
+	//	Doesn't run static initialization, the globals get the values from snapshot_globals() instead. If the program
+	//	has more globals than that, the extra ones get their initial values.
+	public: explicit interpreter_t(const std::shared_ptr<interpreter_imm_t>& imm, const std::vector<bc_value_t>& globals, interpreter_handler_i* handler);
 	public: interpreter_t(const interpreter_t& other) = delete;
 	public: const interpreter_t& operator=(const interpreter_t& other)= delete;
 #if DEBUG
@@ -1394,6 +1504,9 @@ struct interpreter_t {
 	//	Notice: stack holds refs to RC-counted objects!
 	public: interpreter_stack_t _stack;
 	public: std::vector<std::string> _print_output;
+
+	//	Indexed by function ID. nullptr = the function isn't memoized. See bc_memo.h.
+	public: std::vector<std::shared_ptr<bc_memo_table_t>> _memo_tables;
 };
 
 
@@ -1408,6 +1521,37 @@ std::pair<bc_typeid_t, bc_value_t> execute_instructions(interpreter_t& vm, const
 
 std::shared_ptr<value_entry_t> find_global_symbol2(const interpreter_t& vm, const std::string& s);
 
+//	Values of all globals, one per symbol in the program's global frame. Values are shared, not copied.
+std::vector<bc_value_t> snapshot_globals(const interpreter_t& vm);
+
+//	The number of globals, functions and types of a program. See extend_program().
+struct bc_program_extent_t {
+	size_t _global_count;
+	size_t _function_count;
+	size_t _type_count;
+};
+
+/*
+	Appends globals, functions and types to the program of an idle interpreter, for the REPL. The new globals get
+	their initial values, the values of the existing globals are kept. The cost only depends on what is appended.
+
+	The interpreter must be the only user of its interpreter_imm_t and only have the global frame open. Returns the
+	extent from before the call, for truncate_program().
+*/
+bc_program_extent_t extend_program(
+	interpreter_t& vm,
+	const std::vector<std::pair<std::string, bc_symbol_t>>& globals,
+	const std::vector<bc_function_definition_t>& function_defs,
+	const std::vector<typeid_t>& types
+);
+
+//	Undoes extend_program(): drops the globals, functions and types after extent and releases the globals' values.
+void truncate_program(interpreter_t& vm, const bc_program_extent_t& extent);
+
+//	After an exception from execute_instructions() in the global frame: closes every frame but the global frame.
+//	Like when an interpreter is destroyed, the values of the closed frames are not released.
+void unwind_to_global_frame(interpreter_t& vm);
+
 bc_value_t update_element(interpreter_t& vm, const bc_value_t& obj1, const bc_value_t& lookup_key, const bc_value_t& new_value);
 
 
@@ -0,0 +1,217 @@
+//
+//  compilation_cache.cpp
+//  FloydSpeak
+//
+//  Created by Marcus Zetterquist on 2019-03-02.
+//  Copyright © 2019 Marcus Zetterquist. All rights reserved.
+//
+
+#include "compilation_cache.h"
+
+#include "bc_program_file.h"
+#include "bytecode_interpreter.h"
+#include "floyd_interpreter.h"
+#include "host_functions.h"
+#include "ast_value.h"
+#include "file_handling.h"
+#include "sha1_class.h"
+#include "quark.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <unistd.h>
+#include <utime.h>
+
+
+namespace floyd {
+
+
+static const std::int64_t k_default_cache_max_bytes = 64 * 1024 * 1024;
+
+
+compilation_cache_t make_default_compilation_cache(const std::string& compiler_version){
+	std::string dir;
+	const auto dir_env = std::getenv("FLOYD_CACHE_DIR");
+	if(dir_env != nullptr){
+		dir = dir_env;
+	}
+	else{
+		const auto home = std::getenv("HOME");
+		if(home != nullptr && std::string(home).empty() == false){
+#ifdef __APPLE__
+			dir = std::string(home) + "/Library/Caches/floyd";
+#else
+			dir = std::string(home) + "/.cache/floyd";
+#endif
+		}
+	}
+
+	std::int64_t max_bytes = k_default_cache_max_bytes;
+	const auto max_env = std::getenv("FLOYD_CACHE_MAX_BYTES");
+	if(max_env != nullptr){
+		const auto value = std::strtoll(max_env, nullptr, 10);
+		if(value > 0){
+			max_bytes = value;
+		}
+	}
+	return compilation_cache_t{ dir, max_bytes, compiler_version };
+}
+
+std::string make_compilation_cache_key(const compilation_cache_t& cache, const std::string& program){
+	const auto header = cache._compiler_version + "\n" + std::to_string(k_compiler_codegen_version) + "\n" + std::to_string(k_bc_program_file_version) + "\n";
+	return SHA1ToStringPlain(CalcSHA1(header + k_builtin_types_and_constants + "\n" + program));
+}
+
+static std::string get_cache_file_path(const compilation_cache_t& cache, const std::string& key){
+	return cache._dir + "/" + key + k_bc_program_file_suffix;
+}
+
+static bool is_cache_file(const TDirEntry& e){
+	const auto& name = e.fNameOnly;
+	return e.fType == TDirEntry::kFile
+		&& name.size() > k_bc_program_file_suffix.size()
+		&& name.compare(name.size() - k_bc_program_file_suffix.size(), k_bc_program_file_suffix.size(), k_bc_program_file_suffix) == 0;
+}
+
+//	Deletes the least recently used entries until the cache fits in _max_bytes. Never deletes keep_path.
+static void evict_cache_entries(const compilation_cache_t& cache, const std::string& keep_path){
+	struct entry_t {
+		std::string _path;
+		std::uint64_t _date;
+		std::uint64_t _size;
+	};
+
+	std::vector<entry_t> entries;
+	std::uint64_t total = 0;
+	for(const auto& e: GetDirItems(cache._dir)){
+		if(is_cache_file(e)){
+			const auto path = cache._dir + "/" + e.fNameOnly;
+			TFileInfo info;
+			if(GetFileInfo(path, info)){
+				entries.push_back(entry_t{ path, info.fModificationDate, info.fFileSize });
+				total += info.fFileSize;
+			}
+		}
+	}
+
+	std::sort(entries.begin(), entries.end(), [](const entry_t& a, const entry_t& b){ return a._date < b._date; });
+	for(const auto& e: entries){
+		if(total <= static_cast<std::uint64_t>(cache._max_bytes)){
+			return;
+		}
+		if(e._path != keep_path && std::remove(e._path.c_str()) == 0){
+			total -= e._size;
+		}
+	}
+}
+
+static std::shared_ptr<bc_program_t> load_cached_program(const std::string& path){
+	try {
+		TFileInfo info;
+		if(GetFileInfo(path, info) == false || info.fDirFlag){
+			return nullptr;
+		}
+		const auto program = std::make_shared<bc_program_t>(load_bc_program_file(path));
+
+		//	Mark as recently used.
+		::utime(path.c_str(), nullptr);
+		return program;
+	}
+	catch(...){
+		return nullptr;
+	}
+}
+
+static void save_cached_program(const compilation_cache_t& cache, const std::string& path, const bc_program_t& program){
+	try {
+		//	Write to a temporary file first so other processes never see a partial entry.
+		const auto data = write_bc_program(program);
+		const auto temp_path = path + ".tmp" + std::to_string(::getpid());
+		SaveFile(temp_path, &data[0], data.size());
+		if(std::rename(temp_path.c_str(), path.c_str()) != 0){
+			std::remove(temp_path.c_str());
+			return;
+		}
+		evict_cache_entries(cache, path);
+	}
+	catch(...){
+	}
+}
+
+bc_program_t compile_to_bytecode_cached(const compilation_cache_t& cache, const std::string& program, const std::string& file){
+	if(cache.is_enabled() == false){
+		return compile_to_bytecode(program, file);
+	}
+
+	const auto path = get_cache_file_path(cache, make_compilation_cache_key(cache, program));
+	const auto cached = load_cached_program(path);
+	if(cached){
+		return *cached;
+	}
+
+	const auto result = compile_to_bytecode(program, file);
+	save_cached_program(cache, path, result);
+	return result;
+}
+
+
+//////////////////////////////////////		TESTS
+
+
+static std::vector<std::string> get_cache_file_names(const std::string& dir){
+	std::vector<std::string> result;
+	for(const auto& e: GetDirItems(dir)){
+		result.push_back(e.fNameOnly);
+	}
+	return result;
+}
+
+QUARK_UNIT_TEST("compilation_cache", "make_compilation_cache_key()", "", ""){
+	const auto a = compilation_cache_t{ "dir", 1000, "1.0" };
+	const auto b = compilation_cache_t{ "dir", 1000, "1.1" };
+
+	QUARK_UT_VERIFY(make_compilation_cache_key(a, "let a = 1").size() == 40);
+	QUARK_UT_VERIFY(make_compilation_cache_key(a, "let a = 1") == make_compilation_cache_key(a, "let a = 1"));
+	QUARK_UT_VERIFY(make_compilation_cache_key(a, "let a = 1") != make_compilation_cache_key(a, "let a = 2"));
+	QUARK_UT_VERIFY(make_compilation_cache_key(a, "let a = 1") != make_compilation_cache_key(b, "let a = 1"));
+}
+
+QUARK_UNIT_TEST("compilation_cache", "compile_to_bytecode_cached()", "miss, hit, corrupt entry", "same program"){
+	const auto dir = std::string("/tmp/floyd_compilation_cache_test");
+	DeleteDeep(dir);
+	const auto cache = compilation_cache_t{ dir, k_default_cache_max_bytes, "test" };
+	const auto source = "func int f(int a){ return a * 2 }\nlet r = f(21)";
+
+	const auto a = compile_to_bytecode_cached(cache, source, "");
+	QUARK_UT_VERIFY(get_cache_file_names(dir) == std::vector<std::string>{ make_compilation_cache_key(cache, source) + k_bc_program_file_suffix });
+
+	const auto b = compile_to_bytecode_cached(cache, source, "");
+	QUARK_UT_VERIFY(bcprogram_to_json(b) == bcprogram_to_json(a));
+
+	const std::string garbage = "garbage";
+	SaveFile(get_cache_file_path(cache, make_compilation_cache_key(cache, source)), reinterpret_cast<const std::uint8_t*>(garbage.c_str()), garbage.size());
+	const auto c = compile_to_bytecode_cached(cache, source, "");
+	QUARK_UT_VERIFY(bcprogram_to_json(c) == bcprogram_to_json(a));
+
+	const interpreter_t vm(c);
+	QUARK_UT_VERIFY(find_global_symbol(vm, "r") == value_t::make_int(42));
+
+	DeleteDeep(dir);
+}
+
+QUARK_UNIT_TEST("compilation_cache", "compile_to_bytecode_cached()", "cache over size limit", "only newest entry kept"){
+	const auto dir = std::string("/tmp/floyd_compilation_cache_test");
+	DeleteDeep(dir);
+	const auto cache = compilation_cache_t{ dir, 1, "test" };
+
+	compile_to_bytecode_cached(cache, "let a = 1", "");
+	compile_to_bytecode_cached(cache, "let a = 2", "");
+	QUARK_UT_VERIFY(get_cache_file_names(dir) == std::vector<std::string>{ make_compilation_cache_key(cache, "let a = 2") + k_bc_program_file_suffix });
+
+	DeleteDeep(dir);
+}
+
+
+}	//	floyd
@@ -0,0 +1,71 @@
+//
+//  compilation_cache.h
+//  FloydSpeak
+//
+//  Created by Marcus Zetterquist on 2019-03-02.
+//  Copyright © 2019 Marcus Zetterquist. All rights reserved.
+//
+
+#ifndef compilation_cache_hpp
+#define compilation_cache_hpp
+
+/*
+	On-disk cache of compiled programs. Each entry is a bc_program_file stored as "<key>.floydbc" where key is the
+	SHA-1 of the compiler version, k_compiler_codegen_version, the bytecode file version, the prelude and the program
+	source. A hit skips parsing, semantic analysis and code generation.
+
+	The cache is best effort: any problem reading or writing it falls back to a normal compile.
+	Entries are touched when used. When the directory grows above _max_bytes the least recently used entries are
+	deleted.
+*/
+
+#include <cstdint>
+#include <string>
+
+namespace floyd {
+struct bc_program_t;
+
+
+/*
+	Identifies what the compiler emits. It's part of every cache key so a changed compiler never gets bytecode made
+	by an older one from the cache.
+
+	MUST be bumped with EVERY change that can change the compiled program: the parser, pass3, pass4, the bytecode
+	generator or the meaning of any opcode. floyd_version_string alone is not enough, it rarely changes.
+*/
+const int k_compiler_codegen_version = 3;
+
+
+//////////////////////////////////////		compilation_cache_t
+
+
+struct compilation_cache_t {
+	public: bool is_enabled() const {
+		return _dir.empty() == false;
+	}
+
+
+	////////////////////////		STATE
+
+	//	Empty = cache is off.
+	std::string _dir;
+	std::int64_t _max_bytes;
+	std::string _compiler_version;
+};
+
+/*
+	Uses the environment:
+		FLOYD_CACHE_DIR			Cache directory. Set to "" to turn the cache off. Default is ~/.cache/floyd
+								(~/Library/Caches/floyd on macOS).
+		FLOYD_CACHE_MAX_BYTES	Size limit of the cache directory. Default is 64 MB.
+*/
+compilation_cache_t make_default_compilation_cache(const std::string& compiler_version);
+
+std::string make_compilation_cache_key(const compilation_cache_t& cache, const std::string& program);
+
+//	Same as compile_to_bytecode() but uses the cache, if enabled.
+bc_program_t compile_to_bytecode_cached(const compilation_cache_t& cache, const std::string& program, const std::string& file);
+
+}	//	floyd
+
+#endif /* compilation_cache_hpp */
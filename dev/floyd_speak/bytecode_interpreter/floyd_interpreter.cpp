@@ -12,15 +12,25 @@
 #include "floyd_parser.h"
 
 #include "pass3.h"
+#include "pass4.h"
 #include "host_functions.h"
 #include "bytecode_generator.h"
+#include "hardware_caps.h"
+#include "process_inbox.h"
+#include "timer_wheel.h"
+#include "process_metrics.h"
+#include "bc_simd.h"
 
 #include <thread>
 #include <deque>
 #include <future>
 
 #include <pthread.h>
+#include <atomic>
 #include <condition_variable>
+#include <exception>
+#include <fstream>
+#include <unordered_map>
 
 namespace floyd {
 
@@ -113,29 +123,30 @@ value_t bc_to_value(const bc_value_t& value){
 		return value_t::make_vector_value(element_type, vec2);
 	}
 	else if(basetype == base_type::k_dict){
+		const auto key_type  = type.get_dict_key_type();
 		const auto& value_type  = type.get_dict_value_type();
-		std::map<std::string, value_t> entries2;
+		dict_entries_t entries2;
 		if(value_type.is_bool()){
 			for(const auto& e: value._pod._external->_dict_w_inplace_values){
-				entries2.insert({ e.first, value_t::make_bool(e.second._bool) });
+				entries2.insert({ bc_to_value(e.first._key), value_t::make_bool(e.second._bool) });
 			}
 		}
 		else if(value_type.is_int()){
 			for(const auto& e: value._pod._external->_dict_w_inplace_values){
-				entries2.insert({ e.first, value_t::make_int(e.second._int64) });
+				entries2.insert({ bc_to_value(e.first._key), value_t::make_int(e.second._int64) });
 			}
 		}
 		else if(value_type.is_double()){
 			for(const auto& e: value._pod._external->_dict_w_inplace_values){
-				entries2.insert({ e.first, value_t::make_double(e.second._double) });
+				entries2.insert({ bc_to_value(e.first._key), value_t::make_double(e.second._double) });
 			}
 		}
 		else{
 			for(const auto& e: value._pod._external->_dict_w_external_values){
-				entries2.insert({ e.first, bc_to_value(bc_value_t(value_type, e.second)) });
+				entries2.insert({ bc_to_value(e.first._key), bc_to_value(bc_value_t(value_type, e.second)) });
 			}
 		}
-		return value_t::make_dict_value(value_type, entries2);
+		return value_t::make_dict_value(key_type, value_type, entries2);
 	}
 	else if(basetype == base_type::k_function){
 		return value_t::make_function_value(type, value.get_function_value());
@@ -226,14 +237,21 @@ bc_value_t value_to_bc(const value_t& value){
 	}
 	else if(basetype == base_type::k_dict){
 		const auto dict_type = value.get_type();
-		const auto value_type = dict_type.get_dict_value_type();
-//??? add handling for int, bool, double
 		const auto elements = value.get_dict_value();
-		immer::map<std::string, bc_external_handle_t> entries2;
-		for(const auto& e: elements){
-			entries2 = entries2.insert({e.first, bc_external_handle_t(value_to_bc(e.second))});
+		if(encode_as_dict_w_inplace_values(dict_type)){
+			bc_dict_w_inplace_values_t entries2;
+			for(const auto& e: elements){
+				entries2 = entries2.insert({ bc_dict_key_t(value_to_bc(e.first)), value_to_bc(e.second)._pod._inplace });
+			}
+			return make_dict(dict_type, entries2);
+		}
+		else{
+			bc_dict_w_external_values_t entries2;
+			for(const auto& e: elements){
+				entries2 = entries2.insert({ bc_dict_key_t(value_to_bc(e.first)), bc_external_handle_t(value_to_bc(e.second)) });
+			}
+			return make_dict(dict_type, entries2);
 		}
-		return make_dict(value_type, entries2);
 	}
 	else if(basetype == base_type::k_function){
 		return bc_value_t::make_function_value(value.get_type(), value.get_function_value());
@@ -369,10 +387,18 @@ value_t call_function(interpreter_t& vm, const floyd::value_t& f, const std::vec
 
 
 
-parse_tree_t parse_program__errors(const compilation_unit_t& cu){
+//	Converts each statement to the C++ AST as soon as it has been parsed, the JSON parse tree for the whole program is
+//	never built.
+ast_t parse_program__errors(const compilation_unit_t& cu){
 	try {
-		const auto parse_tree = parse_program2(cu.prefix_source + cu.program_text);
-		return parse_tree;
+		std::vector<statement_t> statements;
+		parse_program_statements(
+			cu.prefix_source + cu.program_text,
+			[&](const json_t& statement){
+				statements.push_back(astjson_to_statement__nonlossy(ast_json_t::make(statement)));
+			}
+		);
+		return ast_t{ body_t{ statements }, {}, {}, {} };
 	}
 	catch(const compiler_error& e){
 		const auto refined = refine_compiler_error_with_loc2(cu, e);
@@ -384,9 +410,30 @@ parse_tree_t parse_program__errors(const compilation_unit_t& cu){
 	}
 }
 
+//	k_builtin_types_and_constants is parsed and analysed once per process, on first use, then shared by all
+//	compilations.
+const semantic_prelude_t& get_builtin_prelude(){
+	static const auto prelude = [](){
+		const auto cu = compilation_unit_t{
+			.prefix_source = k_builtin_types_and_constants,
+			.program_text = "",
+			.source_file_path = ""
+		};
+		const auto pass2 = parse_program__errors(cu);
+		try {
+			return make_semantic_prelude(pass2);
+		}
+		catch(const compiler_error& e){
+			const auto refined = refine_compiler_error_with_loc2(cu, e);
+			throw_compiler_error(refined.first, refined.second);
+		}
+	}();
+	return prelude;
+}
+
 semantic_ast_t run_semantic_analysis__errors(const ast_t& pass2, const compilation_unit_t& cu){
 	try {
-		const auto pass3 = run_semantic_analysis(pass2);
+		const auto pass3 = run_semantic_analysis(pass2, get_builtin_prelude());
 		return pass3;
 	}
 	catch(const compiler_error& e){
@@ -401,45 +448,54 @@ semantic_ast_t run_semantic_analysis__errors(const ast_t& pass2, const compilati
 
 
 bc_program_t compile_to_bytecode(const std::string& program, const std::string& file){
-	const auto pre = k_builtin_types_and_constants;
+	return compile_to_bytecode(program, file, {});
+}
 
+bc_program_t compile_to_bytecode(const std::string& program, const std::string& file, const std::vector<std::string>& memoized_functions){
 	const auto cu = compilation_unit_t{
-		.prefix_source = pre,
+		.prefix_source = "",
 		.program_text = program,
 		.source_file_path = file
 	};
 
-//	QUARK_CONTEXT_TRACE(context._tracer, json_to_pretty_string(statements_pos.first._value));
-	const auto parse_tree = parse_program__errors(cu);
-
-	QUARK_TRACE_SS(		"OUTPUT: " << json_to_pretty_string(parse_tree._value)	);
-
-	const auto pass2 = json_to_ast(ast_json_t::make(parse_tree._value));
-
+	const auto pass2 = parse_program__errors(cu);
 	const auto pass3 = run_semantic_analysis__errors(pass2, cu);
-	const auto bc = generate_bytecode(pass3);
+	const auto pass4 = run_optimization(pass3);
+	const auto bc = generate_bytecode(pass4, k_default_inline_budget, memoized_functions);
 
 	return bc;
 }
 
 
 semantic_ast_t compile_to_sematic_ast(const std::string& program, const std::string& file){
-	const auto pre = k_builtin_types_and_constants + "\n";
-
 	const auto cu = compilation_unit_t{
-		.prefix_source = pre,
+		.prefix_source = "",
 		.program_text = program,
 		.source_file_path = file
 	};
 
-//	QUARK_CONTEXT_TRACE(context._tracer, json_to_pretty_string(statements_pos.first._value));
-	const auto parse_tree = parse_program__errors(cu);
-
-	const auto pass2 = json_to_ast(ast_json_t::make(parse_tree._value));
+	const auto pass2 = parse_program__errors(cu);
 	const auto pass3 = run_semantic_analysis__errors(pass2, cu);
 	return pass3;
 }
 
+QUARK_UNIT_TEST("compile_to_sematic_ast()", "builtin prelude", "", "same globals as analysing prelude + program"){
+	const auto program = "let id = uuid_t(3, 4)\nfunc int f(int a){ return a + 1 }\n";
+	const auto a = compile_to_sematic_ast(program, "");
+
+	const auto cu = compilation_unit_t{ k_builtin_types_and_constants, program, "" };
+	const auto b = run_semantic_analysis(parse_program__errors(cu));
+
+	const auto& a_globals = a._checked_ast._globals;
+	const auto& b_globals = b._checked_ast._globals;
+	QUARK_UT_VERIFY(a_globals._statements.size() == b_globals._statements.size());
+	QUARK_UT_VERIFY(a_globals._symbols._symbols.size() == b_globals._symbols._symbols.size());
+	for(int i = 0 ; i < a_globals._symbols._symbols.size() ; i++){
+		QUARK_UT_VERIFY(a_globals._symbols._symbols[i].first == b_globals._symbols._symbols[i].first);
+	}
+	QUARK_UT_VERIFY(a._checked_ast._function_defs.size() == b._checked_ast._function_defs.size());
+}
+
 
 std::shared_ptr<interpreter_t> run_global(const std::string& source, const std::string& file){
 	auto program = compile_to_bytecode(source, file);
@@ -508,37 +564,138 @@ std::string get_current_thread_name(){
 
 struct process_interface {
 	virtual ~process_interface(){};
-	virtual void on_message(const json_t& message) = 0;
+	virtual void on_message(const bc_value_t& message) = 0;
 	virtual void on_init() = 0;
 };
 
 
-//	NOTICE: Each process inbox has its own mutex + condition variable. No mutex protects cout.
+enum class eclock_bus_state {
+	//	Not on the ready queue, waiting for messages.
+	k_idle,
+
+	//	On the ready queue.
+	k_queued,
+
+	//	A worker is executing the clock bus.
+	k_running
+};
+
+struct process_runtime_t;
+
+//	Each process has its own handler, so on_send() knows who is sending.
+struct process_handler_t : public interpreter_handler_i {
+	process_handler_t(process_runtime_t& runtime, int process_id) :
+		_runtime(runtime),
+		_process_id(process_id)
+	{
+	}
+
+	virtual void on_send(const std::string& dest_process_key, const bc_value_t& message);
+	virtual void on_send(int dest_process_id, const bc_value_t& message);
+	virtual double on_get_inbox_pressure(const std::string& process_key);
+	virtual json_t on_get_inbox_stats(const std::string& process_key);
+	virtual void on_post_at_time(const std::string& dest_process_key, int64_t time_us, const bc_value_t& message);
+
+	process_runtime_t& _runtime;
+	int _process_id;
+};
+
+//	NOTICE: No mutex protects cout.
+//	Only the worker that owns the process' clock bus may touch anything but _inbox and _stopped.
 struct process_t {
-	std::condition_variable _inbox_condition_variable;
-	std::mutex _inbox_mutex;
-	std::deque<json_t> _inbox;
+	//	Messages from processes on other clock busses, or that could not be delivered inline.
+	//	Messages are immutable values shared with the sender, never copied.
+	std::unique_ptr<process_inbox_t> _inbox;
 
 	std::string _name_key;
 	std::string _function_key;
-	std::thread::id _thread_id;
+	int _clock_bus_id = -1;
+
+	bool _initialized = false;
 
+	//	The process' __init or process function is executing. Messages to it must be queued.
+	bool _busy = false;
+
+	//	Received "stop". Never runs again. Read by senders blocked on a full inbox.
+	std::atomic<bool> _stopped { false };
+
+	std::shared_ptr<process_handler_t> _handler;
 	std::shared_ptr<interpreter_t> _interpreter;
 	std::shared_ptr<value_entry_t> _init_function;
 	std::shared_ptr<value_entry_t> _process_function;
-	value_t _process_state;
+	bc_value_t _process_state;
+
+	//	Type of the process function's message argument. In batch mode: the element type of the vector.
+	typeid_t _message_type = typeid_t::make_json_value();
+
+	//	0 or max number of messages per call to the process function, see process_def_t.
+	int _batch_size = 0;
+
+	process_metrics_t _metrics;
 
 
 	std::shared_ptr<process_interface> _processor;
 };
 
+/*
+	All processes on a clock bus run in the same thread of execution, one at a time. A send() between two processes
+	on the same bus is executed inline, like a function call, without any queuing or locking.
+*/
+struct clock_bus_runtime_t {
+	std::string _name;
+	std::vector<int> _process_ids;
+
+	std::atomic<eclock_bus_state> _state { eclock_bus_state::k_idle };
+	bool _initialized = false;
+};
+
+//	Process ID of the timer that reports metrics, see run_container_settings_t.
+const int k_metrics_timer_id = -1;
+
+//	A message waiting in the timer wheel, see post_at_time().
+struct pending_timer_t {
+	int _process_id;
+	bc_value_t _message;
+};
+
+/*
+	Clock busses don't have their own threads. Any number of clock busses are multiplexed over a fixed pool of worker
+	threads (M:N). A clock bus is put on the ready queue when one of its processes has work to do. A worker pops it,
+	runs the __init of all its processes or ONE message per process and then yields: the bus goes back on the end of
+	the ready queue if it has more messages.
+*/
 struct process_runtime_t {
 	container_t _container;
-	std::map<std::string, std::string> _process_infos;
 	std::thread::id _main_thread_id;
 
+	//	Index is the process index from get_process_keys().
 	std::vector<std::shared_ptr<process_t>> _processes;
+	std::vector<std::shared_ptr<clock_bus_runtime_t>> _clock_busses;
+
+	//	For send() calls where the compiler couldn't resolve the process key.
+	std::unordered_map<std::string, int> _process_ids;
+
+	//	Protects _ready_queue, _live_process_count and _exception.
+	std::mutex _ready_mutex;
+	std::condition_variable _ready_condition_variable;
+	std::deque<int> _ready_queue;
+	int _live_process_count = 0;
+	std::exception_ptr _exception;
+
+	//	Set when a timer is added that is due before _next_timer_due was, to wake a sleeping worker.
+	bool _timers_changed = false;
+
+	//	There is no timer thread: idle workers sleep until _next_timer_due and the first one to wake up fires
+	//	the timers. Milliseconds on the get_monotonic_time_us() clock.
+	std::mutex _timer_mutex;
+	timer_wheel_t<pending_timer_t> _timers { get_monotonic_time_us() / 1000 };
+	std::atomic<int64_t> _next_timer_due { timer_wheel_t<pending_timer_t>::k_no_timer };
+
 	std::vector<std::thread> _worker_threads;
+
+	run_container_settings_t _settings;
+	int64_t _start_time_us = 0;
+	int _worker_count = 0;
 };
 
 /*
@@ -546,70 +703,523 @@ struct process_runtime_t {
 ??? Separate system-interpreter (all processes and many clock busses) vs ONE thread of execution?
 */
 
-void send_message(process_runtime_t& runtime, int process_id, const json_t& message){
-	auto& process = *runtime._processes[process_id];
+//	Puts clock bus on the ready queue unless it's already queued or running.
+void schedule_clock_bus(process_runtime_t& runtime, int clock_bus_id){
+	auto& clock_bus = *runtime._clock_busses[clock_bus_id];
 
-    {
-        std::lock_guard<std::mutex> lk(process._inbox_mutex);
-        process._inbox.push_front(message);
-        QUARK_TRACE("Notifying...");
-    }
-    process._inbox_condition_variable.notify_one();
-//    process._inbox_condition_variable.notify_all();
+	auto expected = eclock_bus_state::k_idle;
+	if(clock_bus._state.compare_exchange_strong(expected, eclock_bus_state::k_queued)){
+		{
+			std::lock_guard<std::mutex> lk(runtime._ready_mutex);
+			runtime._ready_queue.push_back(clock_bus_id);
+		}
+		runtime._ready_condition_variable.notify_one();
+	}
+}
+
+void run_clock_bus(process_runtime_t& runtime, int clock_bus_id);
+
+/*
+	The inbox of process is full and uses k_block. Instead of just sleeping, this worker runs other clock busses
+	from the ready queue while it waits, so blocked senders can never use up all workers and deadlock.
+	Returns false if waiting is pointless: the process has stopped or the container is shutting down.
+*/
+static bool wait_for_inbox_room(process_runtime_t& runtime, process_t& process){
+	bool result = true;
+	process._inbox->add_blocked_sender();
+	while(process._inbox->size() >= process._inbox->_capacity){
+		int clock_bus_id = -1;
+		{
+			std::unique_lock<std::mutex> lk(runtime._ready_mutex);
+			if(process._stopped || runtime._exception || runtime._live_process_count == 0){
+				result = false;
+				break;
+			}
+			if(runtime._ready_queue.empty()){
+				//	Consumer notifies when it takes a message, the timeout covers a missed notification.
+				runtime._ready_condition_variable.wait_for(lk, std::chrono::milliseconds(1));
+			}
+			else{
+				clock_bus_id = runtime._ready_queue.front();
+				runtime._ready_queue.pop_front();
+			}
+		}
+		if(clock_bus_id != -1){
+			run_clock_bus(runtime, clock_bus_id);
+		}
+	}
+	process._inbox->remove_blocked_sender();
+	return result;
 }
 
-void process_process(process_runtime_t& runtime, int process_id){
+//	Any thread. may_block is false when the sender can't wait for the receiver, like when they share a clock bus.
+void send_message(process_runtime_t& runtime, int process_id, const bc_value_t& message, bool may_block){
 	auto& process = *runtime._processes[process_id];
-	bool stop = false;
 
-	const auto thread_name = get_current_thread_name();
+	auto result = process._inbox->push(message, may_block);
+	while(result == process_inbox_t::epush_result::k_full){
+		const auto wait = wait_for_inbox_room(runtime, process);
+		result = process._inbox->push(message, wait);
+	}
+
+	//	Only the sender that makes the inbox non-empty needs to wake the clock bus: the others will be picked up
+	//	by the same pop(). If the bus is running right now, it will see the message when it yields.
+	if(result == process_inbox_t::epush_result::k_first){
+		QUARK_TRACE("Notifying...");
+		schedule_clock_bus(runtime, process._clock_bus_id);
+	}
+}
+
+//	Any thread. The message is delivered to the inbox of the process when get_monotonic_time_us() reaches time_us.
+void post_at_time(process_runtime_t& runtime, int process_id, int64_t time_us, const bc_value_t& message){
+	//	Never fire early: round up to the next millisecond.
+	const auto due_ms = (time_us + 999) / 1000;
+
+	bool earlier = false;
+	{
+		std::lock_guard<std::mutex> lk(runtime._timer_mutex);
+		earlier = due_ms < runtime._next_timer_due;
+		runtime._timers.add(due_ms, pending_timer_t{ process_id, message });
+		runtime._next_timer_due = runtime._timers.get_next_due();
+	}
+	if(earlier){
+		{
+			std::lock_guard<std::mutex> lk(runtime._ready_mutex);
+			runtime._timers_changed = true;
+		}
+		runtime._ready_condition_variable.notify_one();
+	}
+}
+
+//	Stops all workers. The first exception is rethrown by run_container().
+static void store_exception(process_runtime_t& runtime){
+	{
+		std::lock_guard<std::mutex> lk(runtime._ready_mutex);
+		if(!runtime._exception){
+			runtime._exception = std::current_exception();
+		}
+	}
+	runtime._ready_condition_variable.notify_all();
+}
+
+static json_t process_runtime_metrics_to_json(const process_runtime_t& runtime){
+	const auto elapsed_seconds = static_cast<double>(get_monotonic_time_us() - runtime._start_time_us) / 1000000.0;
+
+	std::map<std::string, json_t> processes;
+	for(const auto& process: runtime._processes){
+		auto metrics = process_metrics_to_json(process->_metrics, elapsed_seconds);
+		metrics = store_object_member(metrics, "inbox", inbox_stats_to_json(process->_inbox->get_stats()));
+		processes.insert({ process->_name_key, metrics });
+	}
+
+	return json_t::make_object({
+		{ "elapsed_seconds", json_t(elapsed_seconds) },
+		{ "worker_count", json_t(static_cast<double>(runtime._worker_count)) },
+		{ "processes", json_t::make_object(processes) }
+	});
+}
+
+//	Any thread, but never two at a time.
+static void report_metrics(const process_runtime_t& runtime){
+	const auto& settings = runtime._settings;
+	const auto metrics = process_runtime_metrics_to_json(runtime);
+
+	if(settings._on_metrics){
+		settings._on_metrics(metrics);
+	}
+	if(settings._metrics_path.empty() == false){
+		std::ofstream file(settings._metrics_path);
+		if(file.fail()){
+			quark::throw_runtime_error("Cannot write metrics file " + settings._metrics_path);
+		}
+		file << json_to_pretty_string(metrics) << std::endl;
+	}
+}
+
+//	Any thread. Sends the messages of all timers that are due. Cheap when none are.
+static void fire_due_timers(process_runtime_t& runtime){
+	const auto now_ms = get_monotonic_time_us() / 1000;
+	if(runtime._next_timer_due > now_ms){
+		return;
+	}
+
+	std::vector<pending_timer_t> due;
+	{
+		std::lock_guard<std::mutex> lk(runtime._timer_mutex);
+		runtime._timers.advance(now_ms, due);
+		runtime._next_timer_due = runtime._timers.get_next_due();
+	}
+	for(const auto& timer: due){
+		if(timer._process_id == k_metrics_timer_id){
+			try {
+				report_metrics(runtime);
+			}
+			catch(...){
+				store_exception(runtime);
+				return;
+			}
+			post_at_time(runtime, k_metrics_timer_id, get_monotonic_time_us() + runtime._settings._metrics_interval_ms * 1000, bc_value_t());
+		}
+		else if(runtime._processes[timer._process_id]->_stopped == false){
+			send_message(runtime, timer._process_id, timer._message, false);
+		}
+	}
+}
+
+//	Caller must own the process' clock bus.
+static bool pop_message(process_runtime_t& runtime, process_t& process, bc_value_t& message){
+	int64_t push_time_us = 0;
+	const auto result = process._inbox->pop(message, push_time_us);
+	if(result){
+		process._metrics._latency_us.add(get_monotonic_time_us() - push_time_us);
+		if(process._inbox->has_blocked_senders()){
+			runtime._ready_condition_variable.notify_all();
+		}
+	}
+	return result;
+}
+
+static void stop_process(process_runtime_t& runtime, process_t& process){
+	process._stopped = true;
+	process._inbox->clear();
+
+	bool all_stopped = false;
+	{
+		std::lock_guard<std::mutex> lk(runtime._ready_mutex);
+		runtime._live_process_count--;
+		all_stopped = runtime._live_process_count == 0;
+	}
+	if(all_stopped){
+		runtime._ready_condition_variable.notify_all();
+	}
+}
+
+static bool is_stop_message(const bc_value_t& message){
+	if(message._type.is_string()){
+		return message.get_string_value() == "stop";
+	}
+	else if(message._type.is_json_value()){
+		const auto json = message.get_json_value();
+		return json.is_string() && json.get_string() == "stop";
+	}
+	else{
+		return false;
+	}
+}
+
+//	Throws unless process can receive message: a stop message, a message of its process function's message type or
+//	anything if that type is json_value. Called by send() and post_at_time() before the message is queued, so a bad
+//	message fails in the sender, however it is delivered.
+static void check_process_message(const process_t& process, const bc_value_t& message){
+	if(false
+		|| message._type == process._message_type
+		|| process._message_type.is_json_value()
+		|| is_stop_message(message)
+	){
+	}
+	else{
+		quark::throw_runtime_error(
+			"Process \"" + process._name_key + "\" can't receive message of type "
+			+ typeid_to_compact_string(message._type) + ", expected " + typeid_to_compact_string(process._message_type) + "."
+		);
+	}
+}
+
+//	Messages of the process function's message type are passed on as they are. Process functions that take a
+//	json_value can receive any value, it's converted like value_to_jsonvalue(). check_process_message() has already
+//	rejected anything else.
+static bc_value_t make_process_message(const process_t& process, const bc_value_t& message){
+	if(message._type == process._message_type){
+		return message;
+	}
+	else{
+		QUARK_ASSERT(process._message_type.is_json_value());
+		return value_to_bc(value_to_jsonvalue(bc_to_value(message)));
+	}
+}
+
+//	Allocations already charged to a process by the current thread. A process that delivers a message inline runs the
+//	receiver's process function nested in its own: the receiver's allocations must not be charged to it as well.
+static bc_alloc_counters_t& get_thread_charged_allocs(){
+	static thread_local bc_alloc_counters_t charged = { 0, 0 };
+	return charged;
+}
+
+struct alloc_mark_t {
+	bc_alloc_counters_t _counters;
+	bc_alloc_counters_t _charged;
+};
 
+//	Call before running the process' interpreter, pass the result to record_allocations() afterwards.
+static alloc_mark_t mark_allocations(){
+	return alloc_mark_t{ get_thread_alloc_counters(), get_thread_charged_allocs() };
+}
+
+static void record_allocations(process_t& process, const alloc_mark_t& mark){
+	const auto& now = get_thread_alloc_counters();
+	auto& charged = get_thread_charged_allocs();
+	const auto allocations = (now._allocations - mark._counters._allocations) - (charged._allocations - mark._charged._allocations);
+	const auto frees = (now._frees - mark._counters._frees) - (charged._frees - mark._charged._frees);
+	charged._allocations += allocations;
+	charged._frees += frees;
+	add_relaxed(process._metrics._allocations, allocations);
+	add_relaxed(process._metrics._external_values_live, allocations - frees);
+}
+
+//	Caller must own the process' clock bus.
+static void init_process(process_t& process){
+	QUARK_ASSERT(process._initialized == false);
+
+	const auto mark = mark_allocations();
+	process._busy = true;
 	if(process._processor){
 		process._processor->on_init();
 	}
 
 	if(process._init_function != nullptr){
-		const std::vector<value_t> args = {};
-		process._process_state = call_function(*process._interpreter, bc_to_value(process._init_function->_value), args);
+		process._process_state = call_function_bc(*process._interpreter, process._init_function->_value, nullptr, 0);
 	}
+	process._busy = false;
+	process._initialized = true;
+	record_allocations(process, mark);
+}
 
-	while(stop == false){
-		json_t message;
-		{
-			std::unique_lock<std::mutex> lk(process._inbox_mutex);
+//	message_count is more than 1 in batch mode.
+//	Caller must own the process' clock bus.
+static void call_process_function(process_t& process, const bc_value_t& message, int message_count){
+	const auto mark = mark_allocations();
+	const auto start_time = get_monotonic_time_us();
+	process._busy = true;
+	if(process._processor){
+		process._processor->on_message(message);
+	}
 
-        	QUARK_TRACE_SS(thread_name << ": waiting......");
-			process._inbox_condition_variable.wait(lk, [&]{ return process._inbox.empty() == false; });
-        	QUARK_TRACE_SS(thread_name << ": continue");
+	if(process._process_function != nullptr){
+		const bc_value_t args[] = { process._process_state, message };
+		process._process_state = call_function_bc(*process._interpreter, process._process_function->_value, args, 2);
+	}
+	process._busy = false;
 
-			//	Pop message.
-			QUARK_ASSERT(process._inbox.empty() == false);
-			message = process._inbox.back();
-			process._inbox.pop_back();
-		}
-		QUARK_TRACE_SS("RECEIVED: " << json_to_pretty_string(message));
+	process._metrics._execution_us.add(get_monotonic_time_us() - start_time);
+	add_relaxed(process._metrics._messages, message_count);
+	record_allocations(process, mark);
+}
+
+//	Caller must own the process' clock bus.
+static void process_message(process_runtime_t& runtime, process_t& process, const bc_value_t& message){
+	QUARK_ASSERT(process._initialized && process._busy == false && process._stopped == false);
 
-		if(message.is_string() && message.get_string() == "stop"){
+	QUARK_TRACE_SS("RECEIVED: " << json_to_pretty_string(bcvalue_to_json(message)));
+
+	if(is_stop_message(message)){
+		QUARK_TRACE_SS(process._name_key << ": STOP");
+		stop_process(runtime, process);
+	}
+	else{
+		call_process_function(process, make_process_message(process, message), 1);
+	}
+}
+
+//	Batch mode: passes up to _batch_size waiting messages to the process function in one call.
+//	Caller must own the process' clock bus.
+static void process_message_batch(process_runtime_t& runtime, process_t& process){
+	QUARK_ASSERT(process._initialized && process._busy == false && process._stopped == false);
+	QUARK_ASSERT(process._batch_size > 0);
+
+	immer::vector<bc_value_t> batch;
+	bool stop = false;
+	bc_value_t message;
+	while(stop == false && batch.size() < process._batch_size && pop_message(runtime, process, message)){
+		if(is_stop_message(message)){
 			stop = true;
-        	QUARK_TRACE_SS(thread_name << ": STOP");
 		}
 		else{
-			if(process._processor){
-				process._processor->on_message(message);
+			batch = batch.push_back(make_process_message(process, message));
+		}
+	}
+
+	if(batch.size() > 0){
+		call_process_function(process, make_vector(process._message_type, batch), static_cast<int>(batch.size()));
+	}
+	if(stop){
+		QUARK_TRACE_SS(process._name_key << ": STOP");
+		stop_process(runtime, process);
+	}
+}
+
+/*
+	Called by the worker that owns the sender's clock bus.
+
+	Messages within a clock bus are delivered depth-first: the receiver's process function runs before send()
+	returns. If the receiver is already executing further up the call stack, isn't initialized yet or has older
+	messages waiting, the message is queued instead, to keep messages in order. Messages to processes in batch mode
+	are always queued, so they can be batched.
+*/
+void process_handler_t::on_send(const std::string& dest_process_key, const bc_value_t& message){
+	const auto it = _runtime._process_ids.find(dest_process_key);
+	if(it == _runtime._process_ids.end()){
+		quark::throw_runtime_error("Unknown process \"" + dest_process_key + "\" in send().");
+	}
+	on_send(it->second, message);
+}
+
+static int find_process_id(const process_runtime_t& runtime, const std::string& process_key, const std::string& function_name){
+	const auto it = runtime._process_ids.find(process_key);
+	if(it == runtime._process_ids.end()){
+		quark::throw_runtime_error("Unknown process \"" + process_key + "\" in " + function_name + "().");
+	}
+	return it->second;
+}
+
+static process_t& find_process(process_runtime_t& runtime, const std::string& process_key, const std::string& function_name){
+	return *runtime._processes[find_process_id(runtime, process_key, function_name)];
+}
+
+double process_handler_t::on_get_inbox_pressure(const std::string& process_key){
+	return find_process(_runtime, process_key, "get_inbox_pressure")._inbox->get_pressure();
+}
+
+json_t process_handler_t::on_get_inbox_stats(const std::string& process_key){
+	return inbox_stats_to_json(find_process(_runtime, process_key, "get_inbox_stats")._inbox->get_stats());
+}
+
+void process_handler_t::on_post_at_time(const std::string& dest_process_key, int64_t time_us, const bc_value_t& message){
+	const auto process_id = find_process_id(_runtime, dest_process_key, "post_at_time");
+	check_process_message(*_runtime._processes[process_id], message);
+	post_at_time(_runtime, process_id, time_us, message);
+}
+
+void process_handler_t::on_send(int dest_process_id, const bc_value_t& message){
+	auto& runtime = _runtime;
+	QUARK_ASSERT(dest_process_id >= 0 && dest_process_id < runtime._processes.size());
+
+	auto& dest = *runtime._processes[dest_process_id];
+	const auto& source = *runtime._processes[_process_id];
+	check_process_message(dest, message);
+
+	if(dest._clock_bus_id == source._clock_bus_id){
+		if(dest._stopped){
+		}
+		else if(dest._initialized && dest._busy == false && dest._batch_size == 0 && dest._inbox->empty()){
+			dest._metrics._latency_us.add(0);
+			process_message(runtime, dest, message);
+		}
+		else{
+			send_message(runtime, dest_process_id, message, false);
+		}
+	}
+	else{
+		send_message(runtime, dest_process_id, message, true);
+	}
+}
+
+//	Runs __init of all processes or one message per process, then yields.
+void run_clock_bus(process_runtime_t& runtime, int clock_bus_id){
+	auto& clock_bus = *runtime._clock_busses[clock_bus_id];
+	QUARK_ASSERT(clock_bus._state == eclock_bus_state::k_queued);
+
+	clock_bus._state = eclock_bus_state::k_running;
+
+	if(clock_bus._initialized == false){
+		clock_bus._initialized = true;
+		for(const auto process_id: clock_bus._process_ids){
+			init_process(*runtime._processes[process_id]);
+		}
+	}
+	else{
+		for(const auto process_id: clock_bus._process_ids){
+			auto& process = *runtime._processes[process_id];
+
+			if(process._stopped){
+				process._inbox->clear();
 			}
+			else if(process._batch_size > 0){
+				process_message_batch(runtime, process);
+			}
+			else{
+				bc_value_t message;
+				if(pop_message(runtime, process, message)){
+					process_message(runtime, process, message);
+				}
+			}
+		}
+	}
+
+	//	Yield. Messages sent to us while we were running did not schedule us, so check the inboxes AFTER going idle.
+	clock_bus._state = eclock_bus_state::k_idle;
 
-			if(process._process_function != nullptr){
-				const std::vector<value_t> args = { process._process_state, value_t::make_json_value(message) };
-				const auto& state2 = call_function(*process._interpreter, bc_to_value(process._process_function->_value), args);
-				process._process_state = state2;
+	bool more = false;
+	for(const auto process_id: clock_bus._process_ids){
+		more = more || runtime._processes[process_id]->_inbox->empty() == false;
+	}
+	if(more){
+		schedule_clock_bus(runtime, clock_bus_id);
+	}
+}
+
+//	Executes clock busses from the ready queue and fires timers until all processes have stopped or a process
+//	threw an exception.
+void run_process_worker(process_runtime_t& runtime){
+	const simd_serial_scope_t simd_serial;
+	while(true){
+		fire_due_timers(runtime);
+
+		int clock_bus_id = -1;
+		{
+			std::unique_lock<std::mutex> lk(runtime._ready_mutex);
+			const auto wake = [&]{
+				return runtime._ready_queue.empty() == false || runtime._live_process_count == 0 || runtime._exception || runtime._timers_changed;
+			};
+			const int64_t next_due = runtime._next_timer_due;
+			if(next_due == timer_wheel_t<pending_timer_t>::k_no_timer){
+				runtime._ready_condition_variable.wait(lk, wake);
 			}
+			else{
+				const auto due_time = std::chrono::steady_clock::time_point(std::chrono::milliseconds(next_due));
+				runtime._ready_condition_variable.wait_until(lk, due_time, wake);
+			}
+			if(runtime._live_process_count == 0 || runtime._exception){
+				return;
+			}
+			runtime._timers_changed = false;
+
+			//	Timeout or new timer: fire timers, then wait again.
+			if(runtime._ready_queue.empty()){
+				continue;
+			}
+			clock_bus_id = runtime._ready_queue.front();
+			runtime._ready_queue.pop_front();
+		}
+
+		try {
+			run_clock_bus(runtime, clock_bus_id);
+		}
+		catch(...){
+			store_exception(runtime);
+			return;
 		}
 	}
 }
 
-std::map<std::string, value_t> run_container_int(const bc_program_t& program, const std::vector<floyd::value_t>& args, const std::string& container_key){
+//	One worker per hardware thread, but no more than there are clock busses.
+static int calc_worker_count(const hardware_info_t& hardware, size_t clock_bus_count){
+	const int hardware_threads = std::max(1, static_cast<int>(hardware._logical_processor_count));
+	return std::max(1, std::min(hardware_threads, static_cast<int>(clock_bus_count)));
+}
+
+QUARK_UNIT_TEST("process_runtime_t", "calc_worker_count()", "", ""){
+	hardware_info_t hardware = {};
+	hardware._logical_processor_count = 8;
+	QUARK_UT_VERIFY(calc_worker_count(hardware, 500) == 8);
+	QUARK_UT_VERIFY(calc_worker_count(hardware, 3) == 3);
+	hardware._logical_processor_count = 0;
+	QUARK_UT_VERIFY(calc_worker_count(hardware, 500) == 1);
+}
+
+std::map<std::string, value_t> run_container_int(const bc_program_t& program, const std::vector<floyd::value_t>& args, const std::string& container_key, const run_container_settings_t& settings){
 	process_runtime_t runtime;
 	runtime._main_thread_id = std::this_thread::get_id();
+	runtime._settings = settings;
 
 /*
 	if(program._software_system._name == ""){
@@ -630,63 +1240,100 @@ std::map<std::string, value_t> run_container_int(const bc_program_t& program, co
 
 	runtime._container = program._container_def;
 
-	runtime._process_infos = reduce(runtime._container._clock_busses, std::map<std::string, std::string>(), [](const std::map<std::string, std::string>& acc, const std::pair<std::string, clock_bus_t>& e){
-		auto acc2 = acc;
-		acc2.insert(e.second._processes.begin(), e.second._processes.end());
-		return acc2;
-	});
-
-	struct my_interpreter_handler_t : public interpreter_handler_i {
-		my_interpreter_handler_t(process_runtime_t& runtime) : _runtime(runtime) {}
-
-		virtual void on_send(const std::string& process_id, const json_t& message){
-			const auto it = std::find_if(_runtime._processes.begin(), _runtime._processes.end(), [&](const std::shared_ptr<process_t>& process){ return process->_name_key == process_id; });
-			if(it != _runtime._processes.end()){
-				const auto process_index = it - _runtime._processes.begin();
-				send_message(_runtime, static_cast<int>(process_index), message);
+	//	All processes share one copy of the program. Static initialization runs once, then each process
+	//	interpreter starts with the same global values.
+	const auto imm = make_interpreter_imm(program);
+	const auto globals = snapshot_globals(interpreter_t(imm, nullptr));
+
+	for(const auto& bus: runtime._container._clock_busses){
+		auto clock_bus = std::make_shared<clock_bus_runtime_t>();
+		clock_bus->_name = bus.first;
+		const auto clock_bus_id = static_cast<int>(runtime._clock_busses.size());
+
+		for(const auto& t: bus.second._processes){
+			const auto process_id = static_cast<int>(runtime._processes.size());
+			auto process = std::make_shared<process_t>();
+			const auto& function_key = t.second._function_key;
+			process->_name_key = t.first;
+			process->_function_key = function_key;
+			process->_clock_bus_id = clock_bus_id;
+			process->_handler = std::make_shared<process_handler_t>(runtime, process_id);
+			process->_interpreter = std::make_shared<interpreter_t>(imm, globals, process->_handler.get());
+			process->_init_function = find_global_symbol2(*process->_interpreter, function_key + "__init");
+			process->_process_function = find_global_symbol2(*process->_interpreter, function_key);
+			process->_batch_size = t.second._batch_size;
+			process->_inbox = std::make_unique<process_inbox_t>(t.second._inbox_capacity, t.second._inbox_policy, t.second._coalesce_key);
+			if(process->_process_function != nullptr){
+				const auto process_args = process->_process_function->_value._type.get_function_args();
+				if(process_args.size() != 2){
+					quark::throw_runtime_error("Process function \"" + function_key + "\" must take two arguments: state and message.");
+				}
+				if(process->_batch_size > 0){
+					if(process_args[1].is_vector() == false){
+						quark::throw_runtime_error("Process function \"" + function_key + "\" must take a vector of messages, process \"" + t.first + "\" is in batch mode.");
+					}
+					process->_message_type = process_args[1].get_vector_element_type();
+				}
+				else{
+					process->_message_type = process_args[1];
+				}
 			}
-		}
 
-		process_runtime_t& _runtime;
-	};
-	auto my_interpreter_handler = my_interpreter_handler_t{runtime};
-
-
-	for(const auto& t: runtime._process_infos){
-		auto process = std::make_shared<process_t>();
-		process->_name_key = t.first;
-		process->_function_key = t.second;
-		process->_interpreter = std::make_shared<interpreter_t>(program, &my_interpreter_handler);
-		process->_init_function = find_global_symbol2(*process->_interpreter, t.second + "__init");
-		process->_process_function = find_global_symbol2(*process->_interpreter, t.second);
-
-		runtime._processes.push_back(process);
+			runtime._processes.push_back(process);
+			runtime._process_ids.insert({ t.first, process_id });
+			clock_bus->_process_ids.push_back(process_id);
+		}
+		if(clock_bus->_process_ids.empty() == false){
+			runtime._clock_busses.push_back(clock_bus);
+		}
+	}
+	QUARK_ASSERT(runtime._processes.size() == get_process_keys(runtime._container).size());
+	if(runtime._processes.empty()){
+		return {};
 	}
 
-	//	Remember that current thread (main) is also a thread, no need to create a worker thread for one process.
-	runtime._processes[0]->_thread_id = runtime._main_thread_id;
+	//	Every clock bus starts on the ready queue, to run __init of its processes.
+	runtime._live_process_count = static_cast<int>(runtime._processes.size());
+	for(int clock_bus_id = 0 ; clock_bus_id < runtime._clock_busses.size() ; clock_bus_id++){
+		schedule_clock_bus(runtime, clock_bus_id);
+	}
 
-	for(int process_id = 1 ; process_id < runtime._processes.size() ; process_id++){
-		runtime._worker_threads.push_back(std::thread([&](int process_id){
+	//	Remember that current thread (main) is also a worker.
+	const auto worker_count = calc_worker_count(read_hardware_info(), runtime._clock_busses.size());
+	runtime._worker_count = worker_count;
+	runtime._start_time_us = get_monotonic_time_us();
+	if(settings._metrics_interval_ms > 0){
+		post_at_time(runtime, k_metrics_timer_id, runtime._start_time_us + settings._metrics_interval_ms * 1000, bc_value_t());
+	}
+	for(int worker_id = 1 ; worker_id < worker_count ; worker_id++){
+		runtime._worker_threads.push_back(std::thread([&](int worker_id){
 
 //			const auto native_thread = thread::native_handle();
 
 			std::stringstream thread_name;
-			thread_name << std::string() << "process " << process_id << " thread";
+			thread_name << std::string() << "worker " << worker_id << " thread";
 #ifdef __APPLE__
 			pthread_setname_np(/*pthread_self(),*/ thread_name.str().c_str());
 #endif
 
-			process_process(runtime, process_id);
-		}, process_id));
+			run_process_worker(runtime);
+		}, worker_id));
 	}
 
-	process_process(runtime, 0);
+	run_process_worker(runtime);
 
 	for(auto &t: runtime._worker_threads){
 		t.join();
 	}
 
+	if(runtime._exception){
+		std::rethrow_exception(runtime._exception);
+	}
+
+	if(settings._on_metrics || settings._metrics_path.empty() == false){
+		report_metrics(runtime);
+	}
+
 #if 0
 	const auto result_vec = mapf<pair<string, value_t>>(
 		runtime._processes,
@@ -711,6 +1358,10 @@ std::map<std::string, value_t> run_container_int(const bc_program_t& program, co
 */
 
 std::map<std::string, value_t> run_container(const bc_program_t& program, const std::vector<floyd::value_t>& args, const std::string& container_key){
+	return run_container(program, args, container_key, run_container_settings_t());
+}
+
+std::map<std::string, value_t> run_container(const bc_program_t& program, const std::vector<floyd::value_t>& args, const std::string& container_key, const run_container_settings_t& settings){
 	if(container_key.empty()){
 		//	Create interpreter, run global code.
 		auto vm = std::make_shared<interpreter_t>(program);
@@ -729,7 +1380,7 @@ std::map<std::string, value_t> run_container(const bc_program_t& program, const
 		}
 	}
 	else{
-		return run_container_int(program, args, container_key);
+		return run_container_int(program, args, container_key, settings);
 	}
 }
 
@@ -17,12 +17,16 @@
 #include "quark.h"
 
 #include "bytecode_interpreter.h"
+#include <functional>
 #include <string>
 #include <vector>
 
 namespace floyd {
 struct value_t;
 struct semantic_ast_t;
+struct semantic_prelude_t;
+struct ast_t;
+struct compilation_unit_t;
 
 
 //////////////////////////////////////		Helpers for values.
@@ -41,8 +45,16 @@ value_t get_global(const interpreter_t& vm, const std::string& name);
 value_t call_function(interpreter_t& vm, const floyd::value_t& f, const std::vector<value_t>& args);
 
 bc_program_t compile_to_bytecode(const std::string& program, const std::string& file);
+
+//	The functions in memoized_functions are not inlined, so they can be passed to enable_memoization().
+bc_program_t compile_to_bytecode(const std::string& program, const std::string& file, const std::vector<std::string>& memoized_functions);
 semantic_ast_t compile_to_sematic_ast(const std::string& program, const std::string& file);
 
+ast_t parse_program__errors(const compilation_unit_t& cu);
+
+//	k_builtin_types_and_constants, analysed.
+const semantic_prelude_t& get_builtin_prelude();
+
 std::shared_ptr<interpreter_t> run_global(const std::string& source, const std::string& file);
 
 /*
@@ -80,6 +92,32 @@ std::map<std::string, value_t> run_container(
 	const std::vector<value_t>& args,
 	const std::string& container_key
 );
+
+/*
+	Process runtime metrics: per-process message counts and rates, inbox stats, histograms of inbox latency and
+	process function execution time, allocations. As JSON:
+
+	{
+		"elapsed_seconds": 1.5, "worker_count": 4,
+		"processes": { "a": { "messages": 10, "latency_us": { "count": 10, "p50": 3, ... }, "inbox": { ... }, ... } }
+	}
+
+	_on_metrics is called with the metrics when the container has stopped and, if _metrics_interval_ms is more than
+	0, periodically while it runs, from a worker thread. If _metrics_path is set, the metrics are written to that file
+	at the same times.
+*/
+struct run_container_settings_t {
+	int64_t _metrics_interval_ms = 0;
+	std::string _metrics_path;
+	std::function<void (const json_t& metrics)> _on_metrics;
+};
+
+std::map<std::string, value_t> run_container(
+	const bc_program_t& program,
+	const std::vector<value_t>& args,
+	const std::string& container_key,
+	const run_container_settings_t& settings
+);
 std::map<std::string, value_t> run_container2(
 	const std::string& source,
 	const std::vector<value_t>& args,
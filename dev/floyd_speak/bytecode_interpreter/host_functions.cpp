@@ -7,6 +7,7 @@
 //
 
 #include "host_functions.h"
+#include "bc_simd.h"
 
 #include "json_support.h"
 #include "ast_typeid_helpers.h"
@@ -409,21 +410,45 @@ value_t unflatten_json_to_specific_type(const json_t& v, const typeid_t& target_
 		}
 	}
 	else if(target_type.is_dict()){
-		if(v.is_object()){
-			const auto value_type = target_type.get_dict_value_type();
-			const auto source_obj = v.get_object();
-			std::map<std::string, value_t> obj2;
-			for(const auto& member: source_obj){
-				const auto member_name = member.first;
-				const auto member_value0 = member.second;
-				const auto member_value1 = unflatten_json_to_specific_type(member_value0, value_type);
-				obj2[member_name] = member_value1;
+		const auto key_type = target_type.get_dict_key_type();
+		const auto value_type = target_type.get_dict_value_type();
+		if(key_type.is_string()){
+			if(v.is_object()){
+				const auto source_obj = v.get_object();
+				std::map<std::string, value_t> obj2;
+				for(const auto& member: source_obj){
+					const auto member_name = member.first;
+					const auto member_value0 = member.second;
+					const auto member_value1 = unflatten_json_to_specific_type(member_value0, value_type);
+					obj2[member_name] = member_value1;
+				}
+				const auto result = value_t::make_dict_value(value_type, obj2);
+				return result;
+			}
+			else{
+				quark::throw_runtime_error("Invalid json schema, expected JSON object.");
 			}
-			const auto result = value_t::make_dict_value(value_type, obj2);
-			return result;
 		}
+
+		//	Dicts with non-string keys are stored as an array of [key, value] pairs.
 		else{
-			quark::throw_runtime_error("Invalid json schema, expected JSON object.");
+			if(v.is_array()){
+				dict_entries_t entries;
+				for(int i = 0 ; i < v.get_array_size() ; i++){
+					const auto pair = v.get_array_n(i);
+					if(pair.is_array() == false || pair.get_array_size() != 2){
+						quark::throw_runtime_error("Invalid json schema for Floyd dict, expected [key, value] pair.");
+					}
+					const auto key = unflatten_json_to_specific_type(pair.get_array_n(0), key_type);
+					const auto value = unflatten_json_to_specific_type(pair.get_array_n(1), value_type);
+					entries[key] = value;
+				}
+				const auto result = value_t::make_dict_value(key_type, value_type, entries);
+				return result;
+			}
+			else{
+				quark::throw_runtime_error("Invalid json schema, expected JSON array of [key, value] pairs.");
+			}
 		}
 	}
 	else if(target_type.is_function()){
@@ -575,32 +600,17 @@ bc_value_t host__find(interpreter_t& vm, const bc_value_t args[], int arg_count)
 		}
 		else if(obj._type.get_vector_element_type().is_bool()){
 			const auto& vec = obj._pod._external->_vector_w_inplace_elements;
-			int index = 0;
-			const auto size = vec.size();
-			while(index < size && vec[index]._bool != wanted._pod._inplace._bool){
-				index++;
-			}
-			int result = index == size ? -1 : static_cast<int>(index);
+			const auto result = bc_simd_find_bool(vec, wanted._pod._inplace._bool);
 			return bc_value_t::make_int(result);
 		}
 		else if(obj._type.get_vector_element_type().is_int()){
 			const auto& vec = obj._pod._external->_vector_w_inplace_elements;
-			int index = 0;
-			const auto size = vec.size();
-			while(index < size && vec[index]._int64 != wanted._pod._inplace._int64){
-				index++;
-			}
-			int result = index == size ? -1 : static_cast<int>(index);
+			const auto result = bc_simd_find_int(vec, wanted._pod._inplace._int64);
 			return bc_value_t::make_int(result);
 		}
 		else if(obj._type.get_vector_element_type().is_double()){
 			const auto& vec = obj._pod._external->_vector_w_inplace_elements;
-			int index = 0;
-			const auto size = vec.size();
-			while(index < size && vec[index]._double != wanted._pod._inplace._double){
-				index++;
-			}
-			int result = index == size ? -1 : static_cast<int>(index);
+			const auto result = bc_simd_find_double(vec, wanted._pod._inplace._double);
 			return bc_value_t::make_int(result);
 		}
 		else{
@@ -630,19 +640,19 @@ bc_value_t host__exists(interpreter_t& vm, const bc_value_t args[], int arg_coun
 	const auto key = args[1];
 
 	if(obj._type.is_dict()){
-		if(key._type.is_string() == false){
-			quark::throw_runtime_error("Key must be string.");
+		if(key._type != obj._type.get_dict_key_type()){
+			quark::throw_runtime_error("Key must have the dictionary's key type.");
 		}
 
-		const auto key_string = key.get_string_value();
+		const auto dict_key = bc_dict_key_t(key);
 
 		if(encode_as_dict_w_inplace_values(obj._type)){
-			const auto found_ptr = obj._pod._external->_dict_w_inplace_values.find(key_string);
+			const auto found_ptr = obj._pod._external->_dict_w_inplace_values.find(dict_key);
 			return bc_value_t::make_bool(found_ptr != nullptr);
 		}
 		else{
-			const auto entries = get_dict_value(obj);
-			const auto found_ptr = entries.find(key_string);
+			const auto& entries = get_dict_value(obj);
+			const auto found_ptr = entries.find(dict_key);
 			return bc_value_t::make_bool(found_ptr != nullptr);
 		}
 	}
@@ -659,21 +669,20 @@ bc_value_t host__erase(interpreter_t& vm, const bc_value_t args[], int arg_count
 	const auto key = args[1];
 
 	if(obj._type.is_dict()){
-		if(key._type.is_string() == false){
-			quark::throw_runtime_error("Key must be string.");
+		if(key._type != obj._type.get_dict_key_type()){
+			quark::throw_runtime_error("Key must have the dictionary's key type.");
 		}
-		const auto key_string = key.get_string_value();
+		const auto dict_key = bc_dict_key_t(key);
 
-		const auto value_type = obj._type.get_dict_value_type();
 		if(encode_as_dict_w_inplace_values(obj._type)){
-			auto entries2 = obj._pod._external->_dict_w_inplace_values.erase(key_string);
-			const auto value2 = make_dict(value_type, entries2);
+			auto entries2 = obj._pod._external->_dict_w_inplace_values.erase(dict_key);
+			const auto value2 = make_dict(obj._type, entries2);
 			return value2;
 		}
 		else{
 			auto entries2 = get_dict_value(obj);
-			entries2 = entries2.erase(key_string);
-			const auto value2 = make_dict(value_type, entries2);
+			entries2 = entries2.erase(dict_key);
+			const auto value2 = make_dict(obj._type, entries2);
 			return value2;
 		}
 	}
@@ -1446,6 +1455,165 @@ bc_value_t host__supermap2(interpreter_t& vm, const bc_value_t args[], int arg_c
 
 
 
+/////////////////////////////////////////		PURE -- NUMERIC VECTORS
+
+//	Element-wise math on [int] and [double] using the SIMD kernels in bc_simd.h.
+//	Big vectors are split into blocks and processed on several threads.
+
+
+static bool is_numeric_vector(const typeid_t& type){
+	return type.is_vector() && (type.get_vector_element_type().is_int() || type.get_vector_element_type().is_double());
+}
+
+static const immer::vector<bc_inplace_value_t>& get_numeric_vector(const std::string& name, const bc_value_t& value){
+	if(is_numeric_vector(value._type) == false){
+		quark::throw_runtime_error(name + "() requires a vector of int or a vector of double.");
+	}
+	return value._pod._external->_vector_w_inplace_elements;
+}
+
+static void check_numeric_vector_pair(const std::string& name, const bc_value_t& a, const bc_value_t& b){
+	if(is_numeric_vector(a._type) == false || b._type != a._type){
+		quark::throw_runtime_error(name + "() requires two vectors of int or two vectors of double.");
+	}
+	if(a._pod._external->_vector_w_inplace_elements.size() != b._pod._external->_vector_w_inplace_elements.size()){
+		quark::throw_runtime_error(name + "() requires the vectors to have the same size.");
+	}
+}
+
+typedef immer::vector<bc_inplace_value_t> (*SIMD_VECTOR_OP)(const immer::vector<bc_inplace_value_t>& a, const immer::vector<bc_inplace_value_t>& b);
+
+static bc_value_t elementwise_vector_op(const std::string& name, const bc_value_t args[], SIMD_VECTOR_OP int_op, SIMD_VECTOR_OP double_op){
+	check_numeric_vector_pair(name, args[0], args[1]);
+
+	const auto& a = args[0]._pod._external->_vector_w_inplace_elements;
+	const auto& b = args[1]._pod._external->_vector_w_inplace_elements;
+	const auto element_type = args[0]._type.get_vector_element_type();
+	const auto result = element_type.is_int() ? int_op(a, b) : double_op(a, b);
+	return make_vector(element_type, result);
+}
+
+//	assert(vector_add([1, 2, 3], [10, 20, 30]) == [11, 22, 33])
+bc_value_t host__vector_add(interpreter_t& vm, const bc_value_t args[], int arg_count){
+	QUARK_ASSERT(vm.check_invariant());
+	QUARK_ASSERT(arg_count == 2);
+
+	return elementwise_vector_op("vector_add", args, bc_simd_add_int, bc_simd_add_double);
+}
+
+bc_value_t host__vector_sub(interpreter_t& vm, const bc_value_t args[], int arg_count){
+	QUARK_ASSERT(vm.check_invariant());
+	QUARK_ASSERT(arg_count == 2);
+
+	return elementwise_vector_op("vector_sub", args, bc_simd_sub_int, bc_simd_sub_double);
+}
+
+bc_value_t host__vector_mul(interpreter_t& vm, const bc_value_t args[], int arg_count){
+	QUARK_ASSERT(vm.check_invariant());
+	QUARK_ASSERT(arg_count == 2);
+
+	return elementwise_vector_op("vector_mul", args, bc_simd_mul_int, bc_simd_mul_double);
+}
+
+//	assert(vector_scale([1.0, 2.0], 0.5) == [0.5, 1.0])
+bc_value_t host__vector_scale(interpreter_t& vm, const bc_value_t args[], int arg_count){
+	QUARK_ASSERT(vm.check_invariant());
+	QUARK_ASSERT(arg_count == 2);
+
+	const auto& vec = get_numeric_vector("vector_scale", args[0]);
+	const auto element_type = args[0]._type.get_vector_element_type();
+	if(args[1]._type != element_type){
+		quark::throw_runtime_error("vector_scale() requires the factor to have the same type as the elements.");
+	}
+
+	if(element_type.is_int()){
+		return make_vector(element_type, bc_simd_scale_int(vec, args[1].get_int_value()));
+	}
+	else{
+		return make_vector(element_type, bc_simd_scale_double(vec, args[1].get_double_value()));
+	}
+}
+
+bc_value_t host__vector_dot(interpreter_t& vm, const bc_value_t args[], int arg_count){
+	QUARK_ASSERT(vm.check_invariant());
+	QUARK_ASSERT(arg_count == 2);
+
+	check_numeric_vector_pair("vector_dot", args[0], args[1]);
+
+	const auto& a = args[0]._pod._external->_vector_w_inplace_elements;
+	const auto& b = args[1]._pod._external->_vector_w_inplace_elements;
+	if(args[0]._type.get_vector_element_type().is_int()){
+		return bc_value_t::make_int(bc_simd_dot_int(a, b));
+	}
+	else{
+		return bc_value_t::make_double(bc_simd_dot_double(a, b));
+	}
+}
+
+bc_value_t host__vector_sum(interpreter_t& vm, const bc_value_t args[], int arg_count){
+	QUARK_ASSERT(vm.check_invariant());
+	QUARK_ASSERT(arg_count == 1);
+
+	const auto& vec = get_numeric_vector("vector_sum", args[0]);
+	if(args[0]._type.get_vector_element_type().is_int()){
+		return bc_value_t::make_int(bc_simd_sum_int(vec));
+	}
+	else{
+		return bc_value_t::make_double(bc_simd_sum_double(vec));
+	}
+}
+
+bc_value_t host__vector_min(interpreter_t& vm, const bc_value_t args[], int arg_count){
+	QUARK_ASSERT(vm.check_invariant());
+	QUARK_ASSERT(arg_count == 1);
+
+	const auto& vec = get_numeric_vector("vector_min", args[0]);
+	if(vec.size() == 0){
+		quark::throw_runtime_error("vector_min() requires a non-empty vector.");
+	}
+	if(args[0]._type.get_vector_element_type().is_int()){
+		return bc_value_t::make_int(bc_simd_min_int(vec));
+	}
+	else{
+		return bc_value_t::make_double(bc_simd_min_double(vec));
+	}
+}
+
+bc_value_t host__vector_max(interpreter_t& vm, const bc_value_t args[], int arg_count){
+	QUARK_ASSERT(vm.check_invariant());
+	QUARK_ASSERT(arg_count == 1);
+
+	const auto& vec = get_numeric_vector("vector_max", args[0]);
+	if(vec.size() == 0){
+		quark::throw_runtime_error("vector_max() requires a non-empty vector.");
+	}
+	if(args[0]._type.get_vector_element_type().is_int()){
+		return bc_value_t::make_int(bc_simd_max_int(vec));
+	}
+	else{
+		return bc_value_t::make_double(bc_simd_max_double(vec));
+	}
+}
+
+//	assert(vector_prefix_sum([1, 2, 3]) == [1, 3, 6])
+bc_value_t host__vector_prefix_sum(interpreter_t& vm, const bc_value_t args[], int arg_count){
+	QUARK_ASSERT(vm.check_invariant());
+	QUARK_ASSERT(arg_count == 1);
+
+	const auto& vec = get_numeric_vector("vector_prefix_sum", args[0]);
+	const auto element_type = args[0]._type.get_vector_element_type();
+	if(element_type.is_int()){
+		return make_vector(element_type, bc_simd_prefix_sum_int(vec));
+	}
+	else{
+		return make_vector(element_type, bc_simd_prefix_sum_double(vec));
+	}
+}
+
+
+
+
+
 /////////////////////////////////////////		IMPURE -- MISC
 
 
@@ -1468,20 +1636,86 @@ bc_value_t host__send(interpreter_t& vm, const bc_value_t args[], int arg_count)
 	QUARK_ASSERT(vm.check_invariant());
 	QUARK_ASSERT(arg_count == 2);
 	QUARK_ASSERT(args[0]._type.is_string());
-	QUARK_ASSERT(args[1]._type.is_json_value());
 
 	const auto& process_id = args[0].get_string_value();
-	const auto& message_json = args[1].get_json_value();
+	const auto& message = args[1];
+
+	QUARK_TRACE_SS("send(\"" << process_id << "\"," << json_to_pretty_string(bcvalue_to_json(message)) <<")");
+
+	if(vm._handler == nullptr){
+		quark::throw_runtime_error("send() only works inside a container.");
+	}
+
+	vm._handler->on_send(process_id, message);
+
+	return bc_value_t::make_undefined();
+}
+
+bc_value_t host__send_to_process_index(interpreter_t& vm, const bc_value_t args[], int arg_count){
+	QUARK_ASSERT(vm.check_invariant());
+	QUARK_ASSERT(arg_count == 2);
+	QUARK_ASSERT(args[0]._type.is_int());
+
+	if(vm._handler == nullptr){
+		quark::throw_runtime_error("send() only works inside a container.");
+	}
+	const auto process_index = static_cast<int>(args[0].get_int_value());
+	vm._handler->on_send(process_index, args[1]);
+
+	return bc_value_t::make_undefined();
+}
+
+bc_value_t host__get_inbox_pressure(interpreter_t& vm, const bc_value_t args[], int arg_count){
+	QUARK_ASSERT(vm.check_invariant());
+	QUARK_ASSERT(arg_count == 1);
+	QUARK_ASSERT(args[0]._type.is_string());
 
-	QUARK_TRACE_SS("send(\"" << process_id << "\"," << json_to_pretty_string(message_json) <<")");
+	if(vm._handler == nullptr){
+		quark::throw_runtime_error("get_inbox_pressure() only works inside a container.");
+	}
+	const auto pressure = vm._handler->on_get_inbox_pressure(args[0].get_string_value());
+	return bc_value_t::make_double(pressure);
+}
 
+bc_value_t host__get_inbox_stats(interpreter_t& vm, const bc_value_t args[], int arg_count){
+	QUARK_ASSERT(vm.check_invariant());
+	QUARK_ASSERT(arg_count == 1);
+	QUARK_ASSERT(args[0]._type.is_string());
 
-	vm._handler->on_send(process_id, message_json);
+	if(vm._handler == nullptr){
+		quark::throw_runtime_error("get_inbox_stats() only works inside a container.");
+	}
+	const auto stats = vm._handler->on_get_inbox_stats(args[0].get_string_value());
+	return bc_value_t::make_json_value(stats);
+}
 
+bc_value_t host__post_at_time(interpreter_t& vm, const bc_value_t args[], int arg_count){
+	QUARK_ASSERT(vm.check_invariant());
+	QUARK_ASSERT(arg_count == 3);
+	QUARK_ASSERT(args[0]._type.is_string());
+	QUARK_ASSERT(args[1]._type.is_int());
+
+	if(vm._handler == nullptr){
+		quark::throw_runtime_error("post_at_time() only works inside a container.");
+	}
+	vm._handler->on_post_at_time(args[0].get_string_value(), args[1].get_int_value(), args[2]);
 	return bc_value_t::make_undefined();
 }
 
 
+int64_t get_monotonic_time_us(){
+	const auto t = std::chrono::steady_clock::now().time_since_epoch();
+	return std::chrono::duration_cast<std::chrono::microseconds>(t).count();
+}
+
+bc_value_t host__get_monotonic_time(interpreter_t& vm, const bc_value_t args[], int arg_count){
+	QUARK_ASSERT(vm.check_invariant());
+	QUARK_ASSERT(arg_count == 0);
+
+	return bc_value_t::make_int(get_monotonic_time_us());
+}
+
+
 bc_value_t host__get_time_of_day(interpreter_t& vm, const bc_value_t args[], int arg_count){
 	QUARK_ASSERT(vm.check_invariant());
 	QUARK_ASSERT(arg_count == 0);
@@ -1871,6 +2105,15 @@ typeid_t return_type__map(const std::vector<typeid_t>& args){
 	return ret;
 }
 
+typeid_t return_type__vector_element(const std::vector<typeid_t>& args){
+	QUARK_ASSERT(args.size() >= 1);
+
+	if(args[0].is_vector() == false){
+		quark::throw_runtime_error("Function requires a vector of int or a vector of double.");
+	}
+	return args[0].get_vector_element_type();
+}
+
 typeid_t return_type__supermap(const std::vector<typeid_t>& args){
 	const auto f = args[2].get_function_return();
 	const auto ret = typeid_t::make_vector(f);
@@ -1932,9 +2175,24 @@ std::vector<host_function_record_t> get_host_function_records(){
 		make_rec("reduce", host__reduce, 1035, typeid_t::make_function(DYN, { DYN, DYN, DYN }, epure::pure), return_type_sames_as_arg1),
 		make_rec("supermap", host__supermap, 1037, typeid_t::make_function(DYN, { DYN, DYN, DYN }, epure::pure), return_type__supermap),
 
+		make_rec("vector_add", host__vector_add, 1038, typeid_t::make_function(DYN, { DYN, DYN }, epure::pure), return_type_sames_as_arg0),
+		make_rec("vector_sub", host__vector_sub, 1039, typeid_t::make_function(DYN, { DYN, DYN }, epure::pure), return_type_sames_as_arg0),
+		make_rec("vector_mul", host__vector_mul, 1040, typeid_t::make_function(DYN, { DYN, DYN }, epure::pure), return_type_sames_as_arg0),
+		make_rec("vector_scale", host__vector_scale, 1041, typeid_t::make_function(DYN, { DYN, DYN }, epure::pure), return_type_sames_as_arg0),
+		make_rec("vector_dot", host__vector_dot, 1042, typeid_t::make_function(DYN, { DYN, DYN }, epure::pure), return_type__vector_element),
+		make_rec("vector_sum", host__vector_sum, 1043, typeid_t::make_function(DYN, { DYN }, epure::pure), return_type__vector_element),
+		make_rec("vector_min", host__vector_min, 1044, typeid_t::make_function(DYN, { DYN }, epure::pure), return_type__vector_element),
+		make_rec("vector_max", host__vector_max, 1045, typeid_t::make_function(DYN, { DYN }, epure::pure), return_type__vector_element),
+		make_rec("vector_prefix_sum", host__vector_prefix_sum, 1046, typeid_t::make_function(DYN, { DYN }, epure::pure), return_type_sames_as_arg0),
+
 		//	print = impure!
 		make_rec("print", host__print, 1000, typeid_t::make_function(VOID, { DYN }, epure::pure)),
-		make_rec("send", host__send, 1022, typeid_t::make_function(VOID, { typeid_t::make_string(), typeid_t::make_json_value() }, epure::impure)),
+		make_rec("send", host__send, 1022, typeid_t::make_function(VOID, { typeid_t::make_string(), DYN }, epure::impure)),
+		make_rec(k_send_to_process_index_function_name, host__send_to_process_index, 1047, typeid_t::make_function(VOID, { typeid_t::make_int(), DYN }, epure::impure)),
+		make_rec("get_inbox_pressure", host__get_inbox_pressure, 1048, typeid_t::make_function(typeid_t::make_double(), { typeid_t::make_string() }, epure::impure)),
+		make_rec("get_inbox_stats", host__get_inbox_stats, 1049, typeid_t::make_function(typeid_t::make_json_value(), { typeid_t::make_string() }, epure::impure)),
+		make_rec("post_at_time", host__post_at_time, 1050, typeid_t::make_function(VOID, { typeid_t::make_string(), typeid_t::make_int(), DYN }, epure::impure)),
+		make_rec("get_monotonic_time", host__get_monotonic_time, 1051, typeid_t::make_function(typeid_t::make_int(), {}, epure::impure)),
 		make_rec("get_time_of_day", host__get_time_of_day, 1005, typeid_t::make_function(typeid_t::make_int(), {}, epure::impure)),
 
 
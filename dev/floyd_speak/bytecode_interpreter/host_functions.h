@@ -23,9 +23,17 @@
 namespace floyd {
 
 enum class host_function_id {
-	jsonvalue_to_value = 1020
+	to_string = 1002,
+	size = 1007,
+	jsonvalue_to_value = 1020,
+	send = 1022,
+	send_to_process_index = 1047
 };
 
+//	send() with a process index instead of a process key. The compiler converts send() calls with a literal process
+//	key to this function. Floyd code can't use the name.
+const std::string k_send_to_process_index_function_name = "**send_to_process_index**";
+
 
 extern const std::string k_builtin_types_and_constants;
 
@@ -66,6 +74,12 @@ struct host_function_t {
 std::map<int, host_function_t> get_host_functions();
 
 
+value_t value_to_jsonvalue(const value_t& value);
+
+//	Microseconds since some fixed point in time. Never goes backwards, unaffected by changes to the time of day.
+int64_t get_monotonic_time_us();
+
+
 typeid_t get_host_function_return_type(const std::string& function_name, const std::vector<typeid_t>& args);
 
 
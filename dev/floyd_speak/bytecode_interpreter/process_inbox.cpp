@@ -0,0 +1,294 @@
+//
+//  process_inbox.cpp
+//  FloydSpeak
+//
+//  Created by Marcus Zetterquist on 2018-11-12.
+//  Copyright © 2018 Marcus Zetterquist. All rights reserved.
+//
+
+#include "process_inbox.h"
+
+#include "host_functions.h"
+#include "json_support.h"
+#include "quark.h"
+
+
+namespace floyd {
+
+
+//////////////////////////////////////		inbox_stats_t
+
+
+json_t inbox_stats_to_json(const inbox_stats_t& stats){
+	return json_t::make_object({
+		{ "capacity", json_t(static_cast<double>(stats._capacity)) },
+		{ "size", json_t(static_cast<double>(stats._size)) },
+		{ "high_water_mark", json_t(static_cast<double>(stats._high_water_mark)) },
+		{ "sent", json_t(static_cast<double>(stats._sent)) },
+		{ "dropped", json_t(static_cast<double>(stats._dropped)) },
+		{ "coalesced", json_t(static_cast<double>(stats._coalesced)) },
+		{ "blocked", json_t(static_cast<double>(stats._blocked)) }
+	});
+}
+
+
+//////////////////////////////////////		process_inbox_t
+
+
+//	Returns false if the message has no such struct member or JSON object key.
+static bool get_coalesce_key(const bc_value_t& message, const std::string& key, bc_value_t& result){
+	if(message._type.is_struct()){
+		const auto& members = message._type.get_struct()._members;
+		for(int i = 0 ; i < members.size() ; i++){
+			if(members[i]._name == key){
+				result = message.get_struct_value()[i];
+				return true;
+			}
+		}
+		return false;
+	}
+	else if(message._type.is_json_value()){
+		const auto json = message.get_json_value();
+		if(json.is_object() && json.does_object_element_exist(key)){
+			result = bc_value_t::make_json_value(json.get_object_element(key));
+			return true;
+		}
+		return false;
+	}
+	else{
+		return false;
+	}
+}
+
+static bool coalesce_keys_equal(const bc_value_t& a, const bc_value_t& b){
+	return a._type == b._type && bc_values_equal(a, b, a._type);
+}
+
+process_inbox_t::process_inbox_t(int capacity, einbox_policy policy, const std::string& coalesce_key) :
+	_capacity(capacity),
+	_policy(policy),
+	_coalesce_key(coalesce_key)
+{
+	QUARK_ASSERT(capacity >= 0);
+	QUARK_ASSERT(policy != einbox_policy::k_coalesce || coalesce_key.empty() == false);
+}
+
+process_inbox_t::process_inbox_t() :
+	process_inbox_t(0, einbox_policy::k_block, "")
+{
+}
+
+bool process_inbox_t::is_locked() const {
+	return _policy == einbox_policy::k_coalesce || (_capacity > 0 && _policy == einbox_policy::k_drop_oldest);
+}
+
+void process_inbox_t::update_high_water_mark(int64_t size){
+	auto mark = _high_water_mark.load(std::memory_order_relaxed);
+	while(size > mark && _high_water_mark.compare_exchange_weak(mark, size, std::memory_order_relaxed) == false){
+	}
+}
+
+process_inbox_t::epush_result process_inbox_t::push(const bc_value_t& message, bool may_block){
+	const auto push_time = get_monotonic_time_us();
+
+	if(is_locked()){
+		entry_t entry{ message, push_time, false, bc_value_t() };
+		if(_policy == einbox_policy::k_coalesce){
+			entry._has_key = get_coalesce_key(message, _coalesce_key, entry._key);
+		}
+
+		std::lock_guard<std::mutex> lk(_mutex);
+
+		if(entry._has_key){
+			for(auto& e: _entries){
+				//	Keeps the original push time: latency is how long the slot has waited.
+				if(e._has_key && coalesce_keys_equal(e._key, entry._key)){
+					e._message = message;
+					_coalesced.fetch_add(1, std::memory_order_relaxed);
+					return epush_result::k_dropped;
+				}
+			}
+		}
+
+		bool dropped = false;
+		if(_capacity > 0 && _entries.size() >= _capacity){
+			_entries.pop_front();
+			_dropped.fetch_add(1, std::memory_order_relaxed);
+			dropped = true;
+		}
+
+		const bool first = _entries.empty();
+		_entries.push_back(entry);
+		_sent.fetch_add(1, std::memory_order_relaxed);
+		_size.store(_entries.size(), std::memory_order_release);
+		update_high_water_mark(_entries.size());
+		return dropped ? epush_result::k_dropped : (first ? epush_result::k_first : epush_result::k_queued);
+	}
+	else{
+		//	Reserve room first so concurrent senders can't overshoot the capacity.
+		const auto size = _size.fetch_add(1) + 1;
+		if(_capacity > 0 && size > _capacity){
+			if(_policy == einbox_policy::k_drop_newest){
+				_size.fetch_sub(1);
+				_dropped.fetch_add(1, std::memory_order_relaxed);
+				return epush_result::k_dropped;
+			}
+			else if(_policy == einbox_policy::k_block && may_block){
+				_size.fetch_sub(1);
+				return epush_result::k_full;
+			}
+		}
+
+		_sent.fetch_add(1, std::memory_order_relaxed);
+		update_high_water_mark(size);
+		return _queue.push(queued_message_t{ message, push_time }) ? epush_result::k_first : epush_result::k_queued;
+	}
+}
+
+bool process_inbox_t::pop(bc_value_t& result){
+	int64_t push_time_us = 0;
+	return pop(result, push_time_us);
+}
+
+bool process_inbox_t::pop(bc_value_t& result, int64_t& push_time_us){
+	if(is_locked()){
+		std::lock_guard<std::mutex> lk(_mutex);
+		if(_entries.empty()){
+			return false;
+		}
+		result = _entries.front()._message;
+		push_time_us = _entries.front()._push_time_us;
+		_entries.pop_front();
+		_size.store(_entries.size(), std::memory_order_release);
+		return true;
+	}
+	else{
+		if(_received.empty()){
+			_queue.drain(_received);
+		}
+		if(_received.empty()){
+			return false;
+		}
+		result = _received.front()._message;
+		push_time_us = _received.front()._push_time_us;
+		_received.pop_front();
+		_size.fetch_sub(1);
+		return true;
+	}
+}
+
+void process_inbox_t::clear(){
+	if(is_locked()){
+		std::lock_guard<std::mutex> lk(_mutex);
+		_entries.clear();
+		_size.store(0, std::memory_order_release);
+	}
+	else{
+		_queue.drain(_received);
+		const auto count = static_cast<int64_t>(_received.size());
+		_received.clear();
+		_size.fetch_sub(count);
+	}
+}
+
+double process_inbox_t::get_pressure() const {
+	if(_capacity == 0){
+		return 0.0;
+	}
+	else{
+		return static_cast<double>(size()) / static_cast<double>(_capacity);
+	}
+}
+
+inbox_stats_t process_inbox_t::get_stats() const {
+	return inbox_stats_t{
+		_capacity,
+		size(),
+		_high_water_mark.load(std::memory_order_relaxed),
+		_sent.load(std::memory_order_relaxed),
+		_dropped.load(std::memory_order_relaxed),
+		_coalesced.load(std::memory_order_relaxed),
+		_blocked.load(std::memory_order_relaxed)
+	};
+}
+
+
+//////////////////////////////////////		TESTS
+
+
+static std::vector<int64_t> pop_ints(process_inbox_t& inbox){
+	std::vector<int64_t> result;
+	bc_value_t message;
+	while(inbox.pop(message)){
+		result.push_back(message.get_int_value());
+	}
+	return result;
+}
+
+QUARK_UNIT_TEST("process_inbox_t", "push()", "no capacity", "keeps everything"){
+	process_inbox_t inbox;
+	QUARK_UT_VERIFY(inbox.push(bc_value_t::make_int(1), true) == process_inbox_t::epush_result::k_first);
+	QUARK_UT_VERIFY(inbox.push(bc_value_t::make_int(2), true) == process_inbox_t::epush_result::k_queued);
+	QUARK_UT_VERIFY(inbox.push(bc_value_t::make_int(3), true) == process_inbox_t::epush_result::k_queued);
+	QUARK_UT_VERIFY(inbox.size() == 3);
+	QUARK_UT_VERIFY(inbox.get_pressure() == 0.0);
+	QUARK_UT_VERIFY((pop_ints(inbox) == std::vector<int64_t>{ 1, 2, 3 }));
+	QUARK_UT_VERIFY(inbox.empty());
+	QUARK_UT_VERIFY(inbox.get_stats()._high_water_mark == 3);
+}
+
+QUARK_UNIT_TEST("process_inbox_t", "push()", "drop-newest, full", "new message is dropped"){
+	process_inbox_t inbox(2, einbox_policy::k_drop_newest, "");
+	inbox.push(bc_value_t::make_int(1), true);
+	inbox.push(bc_value_t::make_int(2), true);
+	QUARK_UT_VERIFY(inbox.get_pressure() == 1.0);
+	QUARK_UT_VERIFY(inbox.push(bc_value_t::make_int(3), true) == process_inbox_t::epush_result::k_dropped);
+	QUARK_UT_VERIFY((pop_ints(inbox) == std::vector<int64_t>{ 1, 2 }));
+
+	const auto stats = inbox.get_stats();
+	QUARK_UT_VERIFY(stats._sent == 2);
+	QUARK_UT_VERIFY(stats._dropped == 1);
+	QUARK_UT_VERIFY(stats._high_water_mark == 2);
+}
+
+QUARK_UNIT_TEST("process_inbox_t", "push()", "drop-oldest, full", "oldest message is dropped"){
+	process_inbox_t inbox(2, einbox_policy::k_drop_oldest, "");
+	inbox.push(bc_value_t::make_int(1), true);
+	inbox.push(bc_value_t::make_int(2), true);
+	QUARK_UT_VERIFY(inbox.push(bc_value_t::make_int(3), true) == process_inbox_t::epush_result::k_dropped);
+	QUARK_UT_VERIFY((pop_ints(inbox) == std::vector<int64_t>{ 2, 3 }));
+	QUARK_UT_VERIFY(inbox.get_stats()._dropped == 1);
+}
+
+QUARK_UNIT_TEST("process_inbox_t", "push()", "block, full", "k_full unless may_block is false"){
+	process_inbox_t inbox(2, einbox_policy::k_block, "");
+	inbox.push(bc_value_t::make_int(1), true);
+	inbox.push(bc_value_t::make_int(2), true);
+	QUARK_UT_VERIFY(inbox.push(bc_value_t::make_int(3), true) == process_inbox_t::epush_result::k_full);
+	QUARK_UT_VERIFY(inbox.size() == 2);
+	QUARK_UT_VERIFY(inbox.push(bc_value_t::make_int(3), false) == process_inbox_t::epush_result::k_queued);
+	QUARK_UT_VERIFY((pop_ints(inbox) == std::vector<int64_t>{ 1, 2, 3 }));
+}
+
+QUARK_UNIT_TEST("process_inbox_t", "push()", "coalesce", "newer message replaces waiting message with same key"){
+	const auto make_message = [](double id, double value){
+		return bc_value_t::make_json_value(json_t::make_object({ { "id", json_t(id) }, { "value", json_t(value) } }));
+	};
+
+	process_inbox_t inbox(10, einbox_policy::k_coalesce, "id");
+	inbox.push(make_message(1, 100), true);
+	inbox.push(make_message(2, 200), true);
+	QUARK_UT_VERIFY(inbox.push(make_message(1, 101), true) == process_inbox_t::epush_result::k_dropped);
+	QUARK_UT_VERIFY(inbox.size() == 2);
+
+	bc_value_t message;
+	QUARK_UT_VERIFY(inbox.pop(message));
+	QUARK_UT_VERIFY(message.get_json_value().get_object_element("value").get_number() == 101);
+	QUARK_UT_VERIFY(inbox.pop(message));
+	QUARK_UT_VERIFY(message.get_json_value().get_object_element("value").get_number() == 200);
+	QUARK_UT_VERIFY(inbox.pop(message) == false);
+	QUARK_UT_VERIFY(inbox.get_stats()._coalesced == 1);
+}
+
+
+}	//	floyd
@@ -0,0 +1,165 @@
+//
+//  process_inbox.h
+//  FloydSpeak
+//
+//  Created by Marcus Zetterquist on 2018-11-12.
+//  Copyright © 2018 Marcus Zetterquist. All rights reserved.
+//
+
+#ifndef process_inbox_hpp
+#define process_inbox_hpp
+
+/*
+	The inbox of a Floyd process. Any number of threads can push() messages, ONE thread at a time pops them.
+
+	Inboxes without a capacity, or with the block or drop-newest policy, are lock-free: they use an mpsc_queue_t
+	and an atomic message count. Drop-oldest and coalesce need to remove or replace waiting messages, those inboxes
+	use a mutex.
+
+	A message counts as waiting from push() until it's popped, so the capacity is a hard limit on memory use.
+*/
+
+#include "bytecode_interpreter.h"
+#include "software_system.h"
+#include "mpsc_queue.h"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+
+struct json_t;
+
+namespace floyd {
+
+
+//////////////////////////////////////		inbox_stats_t
+
+
+struct inbox_stats_t {
+	int64_t _capacity;
+	int64_t _size;
+	int64_t _high_water_mark;
+
+	//	Messages that got into the inbox.
+	int64_t _sent;
+
+	int64_t _dropped;
+	int64_t _coalesced;
+
+	//	Sends that found the inbox full and had to wait, k_block policy.
+	int64_t _blocked;
+};
+
+json_t inbox_stats_to_json(const inbox_stats_t& stats);
+
+
+//////////////////////////////////////		process_inbox_t
+
+
+struct process_inbox_t {
+	enum class epush_result {
+		//	The inbox was empty: wake the consumer.
+		k_first,
+
+		k_queued,
+
+		//	The message, or an older message, was dropped or replaced. The consumer is already awake.
+		k_dropped,
+
+		//	k_block and full. Nothing was pushed, wait and try again.
+		k_full
+	};
+
+	//	capacity 0 means no limit.
+	public: process_inbox_t(int capacity, einbox_policy policy, const std::string& coalesce_key);
+	public: process_inbox_t();
+
+	process_inbox_t(const process_inbox_t& other) = delete;
+	process_inbox_t& operator=(const process_inbox_t& other) = delete;
+
+
+	//	Any thread. If may_block is false, a full k_block inbox accepts the message anyway.
+	public: epush_result push(const bc_value_t& message, bool may_block);
+
+	//	Consumer only. Returns false if there is no waiting message.
+	public: bool pop(bc_value_t& result);
+
+	//	Also returns when the message was pushed, on the get_monotonic_time_us() clock.
+	public: bool pop(bc_value_t& result, int64_t& push_time_us);
+
+	//	Consumer only. Drops all waiting messages without counting them as dropped.
+	public: void clear();
+
+
+	//	Any thread. Cheap.
+	public: int64_t size() const {
+		return _size.load(std::memory_order_acquire);
+	}
+	public: bool empty() const {
+		return size() == 0;
+	}
+
+	//	Any thread. size / capacity, 0.0 if there is no capacity. Cheap.
+	public: double get_pressure() const;
+
+	//	Any thread.
+	public: inbox_stats_t get_stats() const;
+
+
+	//	Blocked senders use these to say they are waiting, so the consumer can wake them.
+	public: void add_blocked_sender(){
+		_blocked_senders.fetch_add(1);
+		_blocked.fetch_add(1, std::memory_order_relaxed);
+	}
+	public: void remove_blocked_sender(){
+		_blocked_senders.fetch_sub(1);
+	}
+	public: bool has_blocked_senders() const {
+		return _blocked_senders.load() > 0;
+	}
+
+
+	private: bool is_locked() const;
+	private: void update_high_water_mark(int64_t size);
+
+
+	////////////////////////		STATE
+
+	public: const int _capacity;
+	public: const einbox_policy _policy;
+	public: const std::string _coalesce_key;
+
+	private: std::atomic<int64_t> _size { 0 };
+	private: std::atomic<int64_t> _high_water_mark { 0 };
+	private: std::atomic<int64_t> _sent { 0 };
+	private: std::atomic<int64_t> _dropped { 0 };
+	private: std::atomic<int64_t> _coalesced { 0 };
+	private: std::atomic<int64_t> _blocked { 0 };
+	private: std::atomic<int> _blocked_senders { 0 };
+
+	private: struct queued_message_t {
+		bc_value_t _message;
+		int64_t _push_time_us;
+	};
+
+	//	Lock-free inbox. _received is only used by the consumer.
+	private: mpsc_queue_t<queued_message_t> _queue;
+	private: std::deque<queued_message_t> _received;
+
+	//	Locked inbox.
+	private: struct entry_t {
+		bc_value_t _message;
+		int64_t _push_time_us;
+		bool _has_key;
+		bc_value_t _key;
+	};
+	private: std::mutex _mutex;
+	private: std::deque<entry_t> _entries;
+};
+
+
+}	//	floyd
+
+#endif /* process_inbox_hpp */
@@ -0,0 +1,146 @@
+//
+//  process_metrics.cpp
+//  FloydSpeak
+//
+//  Created by Marcus Zetterquist on 2018-11-16.
+//  Copyright © 2018 Marcus Zetterquist. All rights reserved.
+//
+
+#include "process_metrics.h"
+
+#include "json_support.h"
+#include "quark.h"
+
+#include <cmath>
+#include <vector>
+
+
+namespace floyd {
+
+
+void add_relaxed(std::atomic<int64_t>& counter, int64_t value){
+	counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+
+//////////////////////////////////////		histogram_t
+
+
+int histogram_t::get_bucket_index(int64_t value){
+	int index = 0;
+	while(value > 0 && index < k_bucket_count - 1){
+		value = value >> 1;
+		index++;
+	}
+	return index;
+}
+
+void histogram_t::add(int64_t value){
+	add_relaxed(_buckets[get_bucket_index(value)], 1);
+	add_relaxed(_count, 1);
+	add_relaxed(_sum, value);
+	if(value > _max.load(std::memory_order_relaxed)){
+		_max.store(value, std::memory_order_relaxed);
+	}
+}
+
+int64_t histogram_t::get_percentile(double p) const {
+	QUARK_ASSERT(p >= 0.0 && p <= 1.0);
+
+	const auto count = get_count();
+	if(count == 0){
+		return 0;
+	}
+	const auto target = std::max(int64_t(1), static_cast<int64_t>(std::ceil(p * count)));
+	const auto max = _max.load(std::memory_order_relaxed);
+
+	int64_t acc = 0;
+	for(int i = 0 ; i < k_bucket_count ; i++){
+		acc += _buckets[i].load(std::memory_order_relaxed);
+		if(acc >= target){
+			const auto upper = i == 0 ? 0 : (int64_t(1) << i) - 1;
+			return std::min(upper, max);
+		}
+	}
+	return max;
+}
+
+json_t histogram_to_json(const histogram_t& histogram){
+	const auto count = histogram.get_count();
+	const auto sum = histogram._sum.load(std::memory_order_relaxed);
+
+	//	Skip the empty buckets at the end.
+	std::vector<json_t> buckets;
+	int last = -1;
+	for(int i = 0 ; i < histogram_t::k_bucket_count ; i++){
+		if(histogram._buckets[i].load(std::memory_order_relaxed) > 0){
+			last = i;
+		}
+	}
+	for(int i = 0 ; i <= last ; i++){
+		buckets.push_back(json_t(static_cast<double>(histogram._buckets[i].load(std::memory_order_relaxed))));
+	}
+
+	return json_t::make_object({
+		{ "count", json_t(static_cast<double>(count)) },
+		{ "mean", json_t(count > 0 ? static_cast<double>(sum) / static_cast<double>(count) : 0.0) },
+		{ "max", json_t(static_cast<double>(histogram._max.load(std::memory_order_relaxed))) },
+		{ "p50", json_t(static_cast<double>(histogram.get_percentile(0.5))) },
+		{ "p99", json_t(static_cast<double>(histogram.get_percentile(0.99))) },
+		{ "log2_buckets", json_t::make_array(buckets) }
+	});
+}
+
+
+//////////////////////////////////////		process_metrics_t
+
+
+json_t process_metrics_to_json(const process_metrics_t& metrics, double elapsed_seconds){
+	const auto messages = metrics._messages.load(std::memory_order_relaxed);
+	return json_t::make_object({
+		{ "messages", json_t(static_cast<double>(messages)) },
+		{ "messages_per_second", json_t(elapsed_seconds > 0.0 ? static_cast<double>(messages) / elapsed_seconds : 0.0) },
+		{ "latency_us", histogram_to_json(metrics._latency_us) },
+		{ "execution_us", histogram_to_json(metrics._execution_us) },
+		{ "allocations", json_t(static_cast<double>(metrics._allocations.load(std::memory_order_relaxed))) },
+		{ "external_values_live", json_t(static_cast<double>(metrics._external_values_live.load(std::memory_order_relaxed))) }
+	});
+}
+
+
+//////////////////////////////////////		TESTS
+
+
+QUARK_UNIT_TEST("histogram_t", "get_bucket_index()", "", ""){
+	QUARK_UT_VERIFY(histogram_t::get_bucket_index(0) == 0);
+	QUARK_UT_VERIFY(histogram_t::get_bucket_index(1) == 1);
+	QUARK_UT_VERIFY(histogram_t::get_bucket_index(2) == 2);
+	QUARK_UT_VERIFY(histogram_t::get_bucket_index(3) == 2);
+	QUARK_UT_VERIFY(histogram_t::get_bucket_index(4) == 3);
+	QUARK_UT_VERIFY(histogram_t::get_bucket_index(1000) == 10);
+	QUARK_UT_VERIFY(histogram_t::get_bucket_index(int64_t(1) << 62) == histogram_t::k_bucket_count - 1);
+}
+
+QUARK_UNIT_TEST("histogram_t", "get_percentile()", "100 samples", "bucket upper bounds, capped by max"){
+	histogram_t histogram;
+	QUARK_UT_VERIFY(histogram.get_percentile(0.5) == 0);
+
+	for(int i = 0 ; i < 98 ; i++){
+		histogram.add(5);
+	}
+	histogram.add(100);
+	histogram.add(300);
+
+	QUARK_UT_VERIFY(histogram.get_count() == 100);
+	QUARK_UT_VERIFY(histogram.get_percentile(0.5) == 7);
+	QUARK_UT_VERIFY(histogram.get_percentile(0.99) == 127);
+	QUARK_UT_VERIFY(histogram.get_percentile(1.0) == 300);
+
+	const auto json = histogram_to_json(histogram);
+	QUARK_UT_VERIFY(json.get_object_element("max").get_number() == 300);
+	QUARK_UT_VERIFY(json.get_object_element("mean").get_number() == (98 * 5 + 100 + 300) / 100.0);
+	QUARK_UT_VERIFY(json.get_object_element("log2_buckets").get_array_size() == 10);
+}
+
+
+}	//	floyd
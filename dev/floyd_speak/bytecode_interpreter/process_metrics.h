@@ -0,0 +1,90 @@
+//
+//  process_metrics.h
+//  FloydSpeak
+//
+//  Created by Marcus Zetterquist on 2018-11-16.
+//  Copyright © 2018 Marcus Zetterquist. All rights reserved.
+//
+
+#ifndef process_metrics_hpp
+#define process_metrics_hpp
+
+/*
+	Counters and histograms that the process runtime keeps for each process.
+
+	Only the worker that owns a process' clock bus updates its metrics, so updates are plain loads and stores, no
+	read-modify-write. They are still atomics so any thread can read a snapshot while the processes run.
+*/
+
+#include <atomic>
+#include <cstdint>
+
+struct json_t;
+
+namespace floyd {
+
+
+//////////////////////////////////////		histogram_t
+
+/*
+	Log2 histogram. Bucket 0 counts 0, bucket i counts values from 2^(i-1) to 2^i - 1.
+*/
+
+struct histogram_t {
+	public: static constexpr int k_bucket_count = 40;
+
+	//	Single writer.
+	public: void add(int64_t value);
+
+	public: int64_t get_count() const {
+		return _count.load(std::memory_order_relaxed);
+	}
+
+	//	Upper bound of the bucket holding the p-quantile, 0.0 <= p <= 1.0. Never more than the max sample.
+	public: int64_t get_percentile(double p) const;
+
+	public: static int get_bucket_index(int64_t value);
+
+
+	////////////////////////		STATE
+
+	public: std::atomic<int64_t> _buckets[k_bucket_count] = {};
+	public: std::atomic<int64_t> _count { 0 };
+	public: std::atomic<int64_t> _sum { 0 };
+	public: std::atomic<int64_t> _max { 0 };
+};
+
+json_t histogram_to_json(const histogram_t& histogram);
+
+
+//////////////////////////////////////		process_metrics_t
+
+
+struct process_metrics_t {
+	//	Time from send() to the process function picking up the message, microseconds.
+	//	0 for messages delivered inline by a process on the same clock bus.
+	public: histogram_t _latency_us;
+
+	//	Time spent in the process function, microseconds. Includes inline sends to processes on the same clock bus.
+	public: histogram_t _execution_us;
+
+	//	Messages passed to the process function.
+	public: std::atomic<int64_t> _messages { 0 };
+
+	//	External values (strings, structs, vectors etc.) allocated while running the process' __init and process
+	//	function. Not those of processes it delivers messages to inline: they are charged to the receiver.
+	public: std::atomic<int64_t> _allocations { 0 };
+
+	//	Net number of those values still alive: allocations minus frees.
+	public: std::atomic<int64_t> _external_values_live { 0 };
+};
+
+//	Single writer.
+void add_relaxed(std::atomic<int64_t>& counter, int64_t value);
+
+json_t process_metrics_to_json(const process_metrics_t& metrics, double elapsed_seconds);
+
+
+}	//	floyd
+
+#endif /* process_metrics_hpp */
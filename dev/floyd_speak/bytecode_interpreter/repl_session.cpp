@@ -0,0 +1,262 @@
+//
+//  repl_session.cpp
+//  FloydSpeak
+//
+//  Created by Marcus Zetterquist on 2019-03-09.
+//  Copyright © 2019 Marcus Zetterquist. All rights reserved.
+//
+
+#include "repl_session.h"
+
+#include "bytecode_interpreter.h"
+#include "floyd_interpreter.h"
+#include "compiler_basics.h"
+#include "quark.h"
+
+#include <set>
+
+
+namespace floyd {
+
+
+//	Adds the globals the instructions can write to acc: the targets of k_store_global_*, and when they run in the
+//	global frame, all their registers too.
+static void collect_written_globals(const std::vector<bc_instruction_t>& instructions, bool global_frame, std::set<int>& acc){
+	for(const auto& e: instructions){
+		if(e._opcode == bc_opcode::k_store_global_external_value || e._opcode == bc_opcode::k_store_global_inplace_value){
+			acc.insert(e._a);
+		}
+		else if(global_frame){
+			const auto reg_flags = encoding_to_reg_flags(k_opcode_info.at(e._opcode)._encoding);
+			if(reg_flags._a){
+				acc.insert(e._a);
+			}
+			if(reg_flags._b){
+				acc.insert(e._b);
+			}
+			if(reg_flags._c){
+				acc.insert(e._c);
+			}
+		}
+	}
+}
+
+static void collect_written_globals(const std::vector<bc_function_definition_t>& function_defs, std::set<int>& acc){
+	for(const auto& e: function_defs){
+		if(e._frame_ptr){
+			collect_written_globals(e._frame_ptr->_instructions, false, acc);
+		}
+	}
+}
+
+repl_session_t::repl_session_t() :
+	_analyser(get_builtin_prelude())
+{
+	//	The prelude is the first increment: it becomes the static initialization of the first program.
+	const auto& prelude = get_builtin_prelude();
+	const auto code = generate_bytecode_increment(
+		_generator,
+		semantic_increment_t{ prelude._statements, prelude._symbols._symbols, prelude._function_defs }
+	);
+	add_hidden_globals(_analyser, code._hidden_globals);
+	collect_written_globals(code._function_defs, _globals_written_by_functions);
+
+	const auto program = bc_program_t{
+		bc_static_frame_t(code._instructions, code._globals, {}),
+		code._function_defs,
+		code._types,
+		{},
+		{}
+	};
+	_vm = std::make_shared<interpreter_t>(program);
+}
+
+/*
+	The line's globals, functions and types are appended to the live interpreter's program and its code runs in the
+	global frame, see extend_program(). Nothing from the earlier lines is copied or recompiled.
+
+	If the line throws at runtime, the interpreter is put back as it was: the globals the line or the functions can
+	write are saved before it runs and restored, then the line's globals, functions and types are dropped again.
+*/
+repl_result_t run_repl_input(repl_session_t& session, const std::string& source){
+	const auto cu = compilation_unit_t{
+		.prefix_source = "",
+		.program_text = source,
+		.source_file_path = ""
+	};
+	const auto ast = parse_program__errors(cu);
+
+	const auto increment = [&](){
+		try {
+			return analyse_increment(session._analyser, ast);
+		}
+		catch(const compiler_error& e){
+			const auto refined = refine_compiler_error_with_loc2(cu, e);
+			throw_compiler_error(refined.first, refined.second);
+		}
+	}();
+
+	const auto code = [&](){
+		try {
+			return generate_bytecode_increment(session._generator, increment);
+		}
+		catch(...){
+			undo_increment(session._analyser, increment);
+			throw;
+		}
+	}();
+
+	auto& vm = *session._vm;
+	const auto extent = [&](){
+		try {
+			return extend_program(vm, code._globals, code._function_defs, code._types);
+		}
+		catch(...){
+			undo_bytecode_increment(session._generator, code);
+			undo_increment(session._analyser, increment);
+			throw;
+		}
+	}();
+
+	auto written = session._globals_written_by_functions;
+	collect_written_globals(code._instructions, true, written);
+	collect_written_globals(code._function_defs, written);
+
+	const auto& frame = vm._imm->_program._globals;
+	std::vector<std::pair<int, bc_value_t>> saved;
+	for(const auto global_index: written){
+		if(global_index < extent._global_count){
+			saved.push_back({ global_index, vm._stack.load_value(get_global_n_pos(global_index), frame._locals[global_index]._type) });
+		}
+	}
+
+	vm._print_output.clear();
+	try {
+		execute_instructions(vm, code._instructions);
+	}
+	catch(...){
+		unwind_to_global_frame(vm);
+		for(const auto& e: saved){
+			if(frame._exts[e.first]){
+				vm._stack.replace_external_value(get_global_n_pos(e.first), e.second);
+			}
+			else{
+				vm._stack.replace_inplace_value(get_global_n_pos(e.first), e.second);
+			}
+		}
+		truncate_program(vm, extent);
+		undo_bytecode_increment(session._generator, code);
+		undo_increment(session._analyser, increment);
+		throw;
+	}
+
+	add_hidden_globals(session._analyser, code._hidden_globals);
+	collect_written_globals(code._function_defs, session._globals_written_by_functions);
+
+	const auto value = code._result_global_index == -1
+		? value_t::make_void()
+		: bc_to_value(
+			vm._stack.load_value(
+				get_global_n_pos(code._result_global_index),
+				frame._locals[code._result_global_index]._type
+			)
+		);
+	return repl_result_t{ vm._print_output, value };
+}
+
+
+
+QUARK_UNIT_TEST("run_repl_input()", "", "expression", ""){
+	repl_session_t session;
+	const auto r = run_repl_input(session, "1 + 2");
+	QUARK_UT_VERIFY(r._value == value_t::make_int(3));
+}
+
+QUARK_UNIT_TEST("run_repl_input()", "", "global from earlier line", ""){
+	repl_session_t session;
+	run_repl_input(session, "let a = 10");
+	run_repl_input(session, "mutable b = a * 2");
+	const auto r = run_repl_input(session, "b + a");
+	QUARK_UT_VERIFY(r._value == value_t::make_int(30));
+}
+
+QUARK_UNIT_TEST("run_repl_input()", "", "function from earlier line", ""){
+	repl_session_t session;
+	run_repl_input(session, "func int f(int x){ return x * 3 }");
+	const auto r = run_repl_input(session, "f(4)");
+	QUARK_UT_VERIFY(r._value == value_t::make_int(12));
+}
+
+QUARK_UNIT_TEST("run_repl_input()", "", "print", ""){
+	repl_session_t session;
+	run_repl_input(session, "let s = \"hello\"");
+	const auto r = run_repl_input(session, "print(s)");
+	QUARK_UT_VERIFY(r._print_output == std::vector<std::string>{ "hello" });
+	QUARK_UT_VERIFY(r._value == value_t::make_void());
+}
+
+QUARK_UNIT_TEST("run_repl_input()", "", "prelude", ""){
+	repl_session_t session;
+	const auto r = run_repl_input(session, "size([1, 2, 3]) + size(\"abcd\")");
+	QUARK_UT_VERIFY(r._value == value_t::make_int(7));
+}
+
+QUARK_UNIT_TEST("run_repl_input()", "", "error leaves session usable", ""){
+	repl_session_t session;
+	run_repl_input(session, "let a = 1");
+	try {
+		run_repl_input(session, "let b = a + \"x\"");
+		QUARK_UT_VERIFY(false);
+	}
+	catch(const std::runtime_error& e){
+	}
+	try {
+		run_repl_input(session, "let a = 2");
+		QUARK_UT_VERIFY(false);
+	}
+	catch(const std::runtime_error& e){
+	}
+	run_repl_input(session, "let b = a + 4");
+	const auto r = run_repl_input(session, "b");
+	QUARK_UT_VERIFY(r._value == value_t::make_int(5));
+}
+
+QUARK_UNIT_TEST("run_repl_input()", "", "runtime error leaves session as it was", ""){
+	repl_session_t session;
+	run_repl_input(session, "mutable m = 1");
+	try {
+		run_repl_input(session, "m = 7\nlet x = [1][5]");
+		QUARK_UT_VERIFY(false);
+	}
+	catch(const std::runtime_error& e){
+	}
+	run_repl_input(session, "let x = 2");
+	const auto r = run_repl_input(session, "x + m");
+	QUARK_UT_VERIFY(r._value == value_t::make_int(3));
+}
+
+QUARK_UNIT_TEST("run_repl_input()", "", "runtime error inside function", "global it wrote is restored"){
+	repl_session_t session;
+	run_repl_input(session, "mutable g = \"a\"");
+	run_repl_input(session, "func int set_g(int i) impure { g = \"b\" return [1][i] }");
+	try {
+		run_repl_input(session, "let x = set_g(5)");
+		QUARK_UT_VERIFY(false);
+	}
+	catch(const std::runtime_error& e){
+	}
+	QUARK_UT_VERIFY(run_repl_input(session, "g")._value == value_t::make_string("a"));
+	run_repl_input(session, "let x = set_g(0)");
+	QUARK_UT_VERIFY(run_repl_input(session, "g + to_string(x)")._value == value_t::make_string("b1"));
+}
+
+QUARK_UNIT_TEST("run_repl_input()", "", "line", "extends the live interpreter"){
+	repl_session_t session;
+	const auto vm = session._vm.get();
+	const auto global_count = vm->_imm->_program._globals._symbols.size();
+	run_repl_input(session, "let a = 1");
+	QUARK_UT_VERIFY(session._vm.get() == vm);
+	QUARK_UT_VERIFY(vm->_imm->_program._globals._symbols.size() > global_count);
+}
+
+}	//	floyd
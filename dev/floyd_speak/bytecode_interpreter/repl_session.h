@@ -0,0 +1,67 @@
+//
+//  repl_session.h
+//  FloydSpeak
+//
+//  Created by Marcus Zetterquist on 2019-03-09.
+//  Copyright © 2019 Marcus Zetterquist. All rights reserved.
+//
+
+#ifndef repl_session_hpp
+#define repl_session_hpp
+
+/*
+	Runs REPL input one line at a time. Each line is parsed, analysed and compiled on its own, on top of the globals,
+	functions and types of the earlier lines. Its globals, functions and types are then appended to the live
+	interpreter and the line runs against the state the earlier lines left behind. The cost of a line depends on the
+	line, not on the length of the session.
+*/
+
+#include "pass3.h"
+#include "bytecode_generator.h"
+#include "ast_value.h"
+
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace floyd {
+struct interpreter_t;
+
+
+//////////////////////////////////////		repl_session_t
+
+
+struct repl_session_t {
+	public: repl_session_t();
+
+
+	////////////////////////		STATE
+
+	public: incremental_analyser_t _analyser;
+	public: incremental_bcgenerator_t _generator;
+
+	//	Runs the latest program: all the globals, functions and types so far. Extended in place by each line.
+	public: std::shared_ptr<interpreter_t> _vm;
+
+	//	Global indexes of the k_store_global_* instructions of all functions so far. A failing line restores them.
+	public: std::set<int> _globals_written_by_functions;
+};
+
+
+struct repl_result_t {
+	public: std::vector<std::string> _print_output;
+
+	//	Value of the line if it ends with an expression that has a value, else void.
+	public: value_t _value;
+};
+
+/*
+	Throws compiler errors and runtime errors. A line that fails, to compile or at runtime, leaves the session as it
+	was: none of its globals, functions or assignments are kept.
+*/
+repl_result_t run_repl_input(repl_session_t& session, const std::string& source);
+
+}	//	floyd
+
+#endif /* repl_session_hpp */
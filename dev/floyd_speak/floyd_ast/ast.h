@@ -58,6 +58,9 @@ namespace floyd {
 	ast_json_t ast_to_json(const ast_t& ast);
 	ast_t json_to_ast(const ast_json_t& parse_tree);
 
+	//	Converts one statement of the parse tree.
+	statement_t astjson_to_statement__nonlossy(const ast_json_t& statement);
+
 
 
 	ast_json_t body_to_json(const body_t& e);
@@ -77,12 +77,15 @@ bool typeid_t::check_invariant() const{
 	}
 	else if(_base_type == floyd::base_type::k_dict){
 		QUARK_ASSERT(_ext);
-		QUARK_ASSERT(_ext->_parts.size() == 1);
+		QUARK_ASSERT(_ext->_parts.size() == 1 || _ext->_parts.size() == 2);
 		QUARK_ASSERT(_ext->_unresolved_type_identifier.empty());
 		QUARK_ASSERT(!_ext->_struct_def);
 		QUARK_ASSERT(!_ext->_protocol_def);
 
 		QUARK_ASSERT(_ext->_parts[0].check_invariant());
+
+		//	String keys are never stored explicitly, see make_dict().
+		QUARK_ASSERT(_ext->_parts.size() == 1 || (_ext->_parts[1].check_invariant() && _ext->_parts[1].is_string() == false));
 	}
 	else if(_base_type == floyd::base_type::k_function){
 		QUARK_ASSERT(_ext);
@@ -346,6 +349,21 @@ QUARK_UNIT_TESTQ("typeid_t", "get_dict_value_type()"){
 QUARK_UNIT_TESTQ("typeid_t", "get_dict_value_type()"){
 	QUARK_UT_VERIFY(typeid_t::make_dict(typeid_t::make_string()).get_dict_value_type().is_string());
 }
+QUARK_UNIT_TESTQ("typeid_t", "get_dict_key_type()"){
+	QUARK_UT_VERIFY(typeid_t::make_dict(typeid_t::make_double()).get_dict_key_type().is_string());
+}
+QUARK_UNIT_TESTQ("typeid_t", "get_dict_key_type()"){
+	const auto a = typeid_t::make_dict(typeid_t::make_int(), typeid_t::make_double());
+	QUARK_UT_VERIFY(a.get_dict_key_type().is_int());
+	QUARK_UT_VERIFY(a.get_dict_value_type().is_double());
+}
+QUARK_UNIT_TESTQ("typeid_t", "make_dict()"){
+	//	An explicit string key is the same type as the implicit one.
+	QUARK_UT_VERIFY(typeid_t::make_dict(typeid_t::make_string(), typeid_t::make_int()) == typeid_t::make_dict(typeid_t::make_int()));
+}
+QUARK_UNIT_TESTQ("typeid_t", "make_dict()"){
+	QUARK_UT_VERIFY((typeid_t::make_dict(typeid_t::make_int(), typeid_t::make_int()) == typeid_t::make_dict(typeid_t::make_int())) == false);
+}
 
 
 
@@ -478,8 +496,9 @@ std::string typeid_to_compact_string_int(const typeid_t& t){
 		return "[" + typeid_to_compact_string(e) + "]";
 	}
 	else if(basetype == floyd::base_type::k_dict){
+		const auto k = t.get_dict_key_type();
 		const auto e = t.get_dict_value_type();
-		return "[string:" + typeid_to_compact_string(e) + "]";
+		return "[" + typeid_to_compact_string(k) + ":" + typeid_to_compact_string(e) + "]";
 	}
 	else if(basetype == floyd::base_type::k_function){
 		const auto ret = t.get_function_return();
@@ -599,6 +618,20 @@ OFF_QUARK_UNIT_TEST("typeid_to_compact_string", "", "", ""){
 	QUARK_TRACE("OK!");
 }
 
+QUARK_UNIT_TEST("typeid_to_ast_json()", "dict", "string key", "key is implicit"){
+	const auto a = typeid_t::make_dict(typeid_t::make_int());
+	QUARK_UT_VERIFY(typeid_to_ast_json(a, json_tags::k_plain)._value == parse_json(seq_t(R"(["dict", "int"])")).first);
+	QUARK_UT_VERIFY(typeid_from_ast_json(typeid_to_ast_json(a, json_tags::k_tag_resolve_state)) == a);
+	QUARK_UT_VERIFY(typeid_to_compact_string(a) == "[string:int]");
+}
+
+QUARK_UNIT_TEST("typeid_to_ast_json()", "dict", "int key", "key is third element"){
+	const auto a = typeid_t::make_dict(typeid_t::make_int(), typeid_t::make_string());
+	QUARK_UT_VERIFY(typeid_to_ast_json(a, json_tags::k_plain)._value == parse_json(seq_t(R"(["dict", "string", "int"])")).first);
+	QUARK_UT_VERIFY(typeid_from_ast_json(typeid_to_ast_json(a, json_tags::k_tag_resolve_state)) == a);
+	QUARK_UT_VERIFY(typeid_to_compact_string(a) == "[int:string]");
+}
+
 
 
 //////////////////////////////////////////////////		struct_definition_t
@@ -44,6 +44,7 @@
 	}								k_protocol								["protocol", [{"type": ["function", ["vector, "int"]]], "name": "read"}, {"type": "["function", []]", "name": "get_size"}]]
 	[int]							k_vector								["vector", "int"]
 	[string: int]					k_dict									["dict", "int"]
+	[int: string]					k_dict									["dict", "string", "int"]
 	int ()							k_function								["function", "int", []]
 	int (double, [string])			k_function								["function", "int", ["double", ["vector", "string"]]]
 	randomize_player			k_internal_unresolved_type_identifier		["internal_unresolved_type_identifier", "randomize_player"]
@@ -328,11 +329,28 @@ struct typeid_t {
 		const auto ext = std::make_shared<const typeid_ext_imm_t>(typeid_ext_imm_t{ { value_type }, "", {}, {}, epure::pure });
 		return { floyd::base_type::k_dict, ext };
 	}
+
+	//	Dicts use _parts[0] for the value type. A string key is implicit, any other key type is stored in _parts[1].
+	//	This keeps [string: T] normalized: it compares equal however it was made.
+	public: static typeid_t make_dict(const typeid_t& key_type, const typeid_t& value_type){
+		if(key_type.get_base_type() == base_type::k_string){
+			return make_dict(value_type);
+		}
+		else{
+			const auto ext = std::make_shared<const typeid_ext_imm_t>(typeid_ext_imm_t{ { value_type, key_type }, "", {}, {}, epure::pure });
+			return { floyd::base_type::k_dict, ext };
+		}
+	}
 	public: bool is_dict() const {
 		QUARK_ASSERT(check_invariant());
 
 		return _base_type == base_type::k_dict;
 	}
+	public: typeid_t get_dict_key_type() const{
+		QUARK_ASSERT(get_base_type() == base_type::k_dict);
+
+		return _ext->_parts.size() == 2 ? _ext->_parts[1] : make_string();
+	}
 	public: const typeid_t& get_dict_value_type() const{
 		QUARK_ASSERT(get_base_type() == base_type::k_dict);
 
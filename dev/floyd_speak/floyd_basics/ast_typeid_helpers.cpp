@@ -86,11 +86,23 @@ ast_json_t typeid_to_ast_json(const typeid_t& t, json_tags tags){
 		}));
 	}
 	else if(b == base_type::k_dict){
+		const auto k = t.get_dict_key_type();
 		const auto d = t.get_dict_value_type();
-		return ast_json_t::make(json_t::make_array({
-			json_t(basetype_str),
-			typeid_to_ast_json(d, tags)._value
-		}));
+
+		//	String keys are implicit, this keeps the AST JSON of [string: T] unchanged.
+		if(k.is_string()){
+			return ast_json_t::make(json_t::make_array({
+				json_t(basetype_str),
+				typeid_to_ast_json(d, tags)._value
+			}));
+		}
+		else{
+			return ast_json_t::make(json_t::make_array({
+				json_t(basetype_str),
+				typeid_to_ast_json(d, tags)._value,
+				typeid_to_ast_json(k, tags)._value
+			}));
+		}
 	}
 	else if(b == base_type::k_function){
 		return ast_json_t::make(json_t::make_array({
@@ -163,7 +175,10 @@ typeid_t typeid_from_ast_json(const ast_json_t& t2){
 	}
 	else if(t.is_array()){
 		const auto a = t.get_array();
-		const auto s = a[0].get_string();
+
+		//	Struct and protocol names are tagged when written with k_tag_resolve_state.
+		const auto s0 = a[0].get_string();
+		const auto s = s0.empty() == false && s0.front() == tag_resolved_type_char ? s0.substr(1) : s0;
 /*
 		if(s == "typeid"){
 			const auto t3 = typeid_from_ast_json(ast_json_t{a[1]});
@@ -191,7 +206,13 @@ typeid_t typeid_from_ast_json(const ast_json_t& t2){
 		}
 		else if(s == "dict"){
 			const auto value_type = typeid_from_ast_json(ast_json_t::make(a[1]));
-			return typeid_t::make_dict(value_type);
+			if(a.size() > 2){
+				const auto key_type = typeid_from_ast_json(ast_json_t::make(a[2]));
+				return typeid_t::make_dict(key_type, value_type);
+			}
+			else{
+				return typeid_t::make_dict(value_type);
+			}
 		}
 		else if(s == "func"){
 			const auto ret_type = typeid_from_ast_json(ast_json_t::make(a[1]));
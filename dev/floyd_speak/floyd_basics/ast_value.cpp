@@ -104,10 +104,10 @@ namespace floyd {
 	}
 
 
-	std::string dict_instance_to_compact_string(const std::map<std::string, value_t>& entries){
+	std::string dict_instance_to_compact_string(const dict_entries_t& entries){
 		std::vector<std::string> elements;
 		for(const auto& e: entries){
-			const auto& key_str = quote(e.first);
+			const auto& key_str = to_compact_string_quote_strings(e.first);
 			const auto& value_str = to_compact_string_quote_strings(e.second);
 			const auto& es = key_str + ": " + value_str;
 			elements.push_back(es);
@@ -159,7 +159,7 @@ namespace floyd {
 			QUARK_ASSERT(check_invariant());
 		}
 
-		value_ext_t::value_ext_t(const typeid_t& type, const std::map<std::string, value_t>& s) :
+		value_ext_t::value_ext_t(const typeid_t& type, const dict_entries_t& s) :
 			_rc(1),
 			_type(type),
 			_dict_entries(s)
@@ -289,7 +289,7 @@ int compare_vector_true_deep(const std::vector<value_t>& left, const std::vector
 //	QUARK_ASSERT(right.check_invariant());
 //	QUARK_ASSERT(left._element_type == right._element_type);
 
-	const auto& shared_count = std::min(left.size(), right.size());
+	const auto shared_count = std::min(left.size(), right.size());
 	for(int i = 0 ; i < shared_count ; i++){
 		const auto element_result = value_t::compare_value_true_deep(left[i], right[i]);
 		if(element_result != 0){
@@ -316,7 +316,7 @@ bool map_compare (Map const &lhs, Map const &rhs) {
 }
 
 
-int compare_dict_true_deep(const std::map<std::string, value_t>& left, const std::map<std::string, value_t>& right){
+int compare_dict_true_deep(const dict_entries_t& left, const dict_entries_t& right){
 	auto left_it = left.begin();
 	auto left_end_it = left.end();
 
@@ -338,7 +338,7 @@ int compare_dict_true_deep(const std::map<std::string, value_t>& left, const std
 		return -1;
 	}
 	else if(left_it != left_end_it && right_it != right_end_it){
-		int key_diff = compare_string(left_it->first, right_it->first);
+		int key_diff = value_t::compare_value_true_deep(left_it->first, right_it->first);
 		if(key_diff != 0){
 			return key_diff;
 		}
@@ -473,6 +473,10 @@ int value_t::compare_value_true_deep(const value_t& left, const value_t& right){
 	}
 }
 
+bool dict_key_less_t::operator()(const value_t& left, const value_t& right) const{
+	return value_t::compare_value_true_deep(left, right) < 0;
+}
+
 
 bool value_t::check_invariant() const{
 	const auto type_int = _basetype;
@@ -665,7 +669,7 @@ std::string value_and_type_to_string(const value_t& value) {
 		}
 
 
-		const std::map<std::string, value_t>& value_t::get_dict_value() const{
+		const dict_entries_t& value_t::get_dict_value() const{
 			QUARK_ASSERT(check_invariant());
 			if(!is_dict()){
 				quark::throw_runtime_error("Type mismatch!");
@@ -786,10 +790,10 @@ std::string value_and_type_to_string(const value_t& value) {
 			QUARK_ASSERT(check_invariant());
 		}
 
-		value_t::value_t(const typeid_t& value_type, const std::map<std::string, value_t>& entries) :
+		value_t::value_t(const typeid_t& dict_type, const dict_entries_t& entries) :
 			_basetype(base_type::k_dict)
 		{
-			_value_internals._ext = new value_ext_t{typeid_t::make_dict(value_type), entries};
+			_value_internals._ext = new value_ext_t{dict_type, entries};
 			QUARK_ASSERT(_value_internals._ext->_rc == 1);
 
 #if DEBUG
@@ -1096,13 +1100,23 @@ ast_json_t value_to_ast_json(const value_t& v, json_tags tags){
 */
 
 	}
+	//	JSON objects only have string keys: dicts with other keys become an array of [key, value] pairs.
 	else if(v.is_dict()){
 		const auto entries = v.get_dict_value();
-		std::map<string, json_t> result;
-		for(const auto& e: entries){
-			result[e.first] = value_to_ast_json(e.second, tags)._value;
+		if(v.get_type().get_dict_key_type().is_string()){
+			std::map<string, json_t> result;
+			for(const auto& e: entries){
+				result[e.first.get_string_value()] = value_to_ast_json(e.second, tags)._value;
+			}
+			return ast_json_t::make(result);
+		}
+		else{
+			std::vector<json_t> result;
+			for(const auto& e: entries){
+				result.push_back(json_t::make_array({ value_to_ast_json(e.first, tags)._value, value_to_ast_json(e.second, tags)._value }));
+			}
+			return ast_json_t::make(json_t::make_array(result));
 		}
-		return ast_json_t::make(result);
 	}
 	else if(v.is_function()){
 /*
@@ -1143,6 +1157,21 @@ QUARK_UNIT_TESTQ("value_to_ast_json()", ""){
 	ut_verify(QUARK_POS, value_to_ast_json(value_t::make_undefined(), json_tags::k_tag_resolve_state)._value, json_t());
 }
 
+QUARK_UNIT_TEST("value_to_ast_json()", "dict", "string keys", "JSON object"){
+	const auto a = value_t::make_dict_value(typeid_t::make_int(), { { "one", value_t::make_int(1) } });
+	ut_verify(QUARK_POS, value_to_ast_json(a, json_tags::k_tag_resolve_state)._value, parse_json(seq_t(R"({ "one": 1 })")).first);
+}
+
+QUARK_UNIT_TEST("value_to_ast_json()", "dict", "int keys", "array of key-value pairs, ordered by key"){
+	const auto a = value_t::make_dict_value(
+		typeid_t::make_int(),
+		typeid_t::make_string(),
+		{ { value_t::make_int(20), value_t::make_string("twenty") }, { value_t::make_int(3), value_t::make_string("three") } }
+	);
+	ut_verify(QUARK_POS, value_to_ast_json(a, json_tags::k_tag_resolve_state)._value, parse_json(seq_t(R"([[3, "three"], [20, "twenty"]])")).first);
+	ut_verify(QUARK_POS, to_compact_string2(a), R"({3: "three", 20: "twenty"})");
+}
+
 
 		//	Used internally in check_invariant() -- don't call check_invariant().
 		typeid_t value_t::get_type() const{
@@ -1214,7 +1243,23 @@ value_t value_t::make_vector_value(const typeid_t& element_type, const std::vect
 }
 
 value_t value_t::make_dict_value(const typeid_t& value_type, const std::map<std::string, value_t>& entries){
-	return value_t(value_type, entries);
+	dict_entries_t entries2;
+	for(const auto& e: entries){
+		entries2.insert({ value_t::make_string(e.first), e.second });
+	}
+	return value_t(typeid_t::make_dict(value_type), entries2);
+}
+
+value_t value_t::make_dict_value(const typeid_t& key_type, const typeid_t& value_type, const dict_entries_t& entries){
+	QUARK_ASSERT(key_type.check_invariant());
+	QUARK_ASSERT(value_type.check_invariant());
+#if DEBUG
+	for(const auto& e: entries){
+		QUARK_ASSERT(e.first.get_type() == key_type);
+	}
+#endif
+
+	return value_t(typeid_t::make_dict(key_type, value_type), entries);
 }
 
 value_t value_t::make_function_value(const typeid_t& function_type, int function_id){
@@ -107,6 +107,17 @@ std::string make_value_debug_str(const value_t& v);
 	};
 
 
+	//////////////////////////////////////////////////		dict_entries_t
+
+	/*
+		Dictionary keys can be of any type. Entries are ordered using compare_value_true_deep() on the keys.
+	*/
+	struct dict_key_less_t {
+		bool operator()(const value_t& left, const value_t& right) const;
+	};
+	typedef std::map<value_t, value_t, dict_key_less_t> dict_entries_t;
+
+
 	//////////////////////////////////////////////////		value_ext_t
 
 	/*
@@ -220,7 +231,7 @@ std::string make_value_debug_str(const value_t& v);
 		public: value_ext_t(const typeid_t& type, std::shared_ptr<struct_value_t>& s);
 		public: value_ext_t(const typeid_t& type, std::shared_ptr<protocol_value_t>& s);
 		public: value_ext_t(const typeid_t& type, const std::vector<value_t>& s);
-		public: value_ext_t(const typeid_t& type, const std::map<std::string, value_t>& s);
+		public: value_ext_t(const typeid_t& type, const dict_entries_t& s);
 		public: value_ext_t(const typeid_t& type, int function_id);
 
 
@@ -233,7 +244,7 @@ std::string make_value_debug_str(const value_t& v);
 		public: std::shared_ptr<struct_value_t> _struct;
 		public: std::shared_ptr<protocol_value_t> _protocol;
 		public: std::vector<value_t> _vector_elements;
-		public: std::map<std::string, value_t> _dict_entries;
+		public: dict_entries_t _dict_entries;
 		public: int _function_id = -1;
 	};
 
@@ -457,13 +468,15 @@ std::string make_value_debug_str(const value_t& v);
 		//------------------------------------------------		dict
 
 
+		//	Makes a [string: value_type] dict.
 		public: static value_t make_dict_value(const typeid_t& value_type, const std::map<std::string, value_t>& entries);
+		public: static value_t make_dict_value(const typeid_t& key_type, const typeid_t& value_type, const dict_entries_t& entries);
 		public: bool is_dict() const {
 			QUARK_ASSERT(check_invariant());
 
 			return _basetype == base_type::k_dict;
 		}
-		public: const std::map<std::string, value_t>& get_dict_value() const;
+		public: const dict_entries_t& get_dict_value() const;
 
 
 		//------------------------------------------------		function
@@ -654,7 +667,7 @@ std::string make_value_debug_str(const value_t& v);
 		private: explicit value_t(const typeid_t& struct_type, std::shared_ptr<struct_value_t>& instance);
 		private: explicit value_t(const typeid_t& protocol_type, std::shared_ptr<protocol_value_t>& instance);
 		private: explicit value_t(const typeid_t& element_type, const std::vector<value_t>& elements);
-		private: explicit value_t(const typeid_t& value_type, const std::map<std::string, value_t>& entries);
+		private: explicit value_t(const typeid_t& dict_type, const dict_entries_t& entries);
 		private: explicit value_t(const typeid_t& type, int function_id);
 
 
@@ -13,6 +13,8 @@
 #include <string>
 
 #include "floyd_interpreter.h"
+#include "compilation_cache.h"
+#include "bc_program_file.h"
 #include "floyd_parser/floyd_parser.h"
 #include "ast_value.h"
 #include "json_support.h"
@@ -72,6 +74,7 @@ void run_tests(){
 
 			"pass2.cpp",
 			"pass3.cpp",
+			"pass4.cpp",
 
 			"parse_statement.cpp",
 			"floyd_interpreter.cpp",
@@ -205,16 +208,40 @@ R"(
 Usage:
 floyd run mygame.floyd		- compile and run the floyd program "mygame.floyd"
 floyd compile mygame.floyd	- compile the floyd program "mygame.floyd" to an AST, in JSON format
+floyd compile -p mygame.floyd	- only parse "mygame.floyd" and print its parse tree, in JSON format
+floyd compile -b mygame.floyd mygame.floydbc	- compile "mygame.floyd" to bytecode and save it to "mygame.floydbc"
 floyd help					- Show built in help for command line tool
 floyd runtests				- Runs Floyds internal unit tests
 floyd benchmark 			- Runs Floyd built in suite of benchmark tests and prints the results.
 floyd run -t mygame.floyd	- the -t turns on tracing, which shows Floyd compilation steps and internal states
+floyd run mygame.floydbc	- run a program compiled with floyd compile -b
+
+floyd run caches compiled programs in ~/.cache/floyd. Environment:
+FLOYD_CACHE_DIR				- cache directory, set to "" to turn the cache off
+FLOYD_CACHE_MAX_BYTES		- size limit of the cache, default 64 MB
 )";
 }
 
+static bool is_bc_program_path(const std::string& path){
+	const auto& suffix = floyd::k_bc_program_file_suffix;
+	return path.size() > suffix.size() && path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+//	Loads a program compiled with "floyd compile -b" or compiles a source file, using the compilation cache.
+static floyd::bc_program_t load_program(const std::string& path){
+	if(is_bc_program_path(path)){
+		return floyd::load_bc_program_file(path);
+	}
+	else{
+		const auto source = read_text_file(path);
+		const auto cache = floyd::make_default_compilation_cache(floyd_version_string);
+		return floyd::compile_to_bytecode_cached(cache, source, path);
+	}
+}
+
 //	Runs one of the commands, args depends on which command.
 int run_command(const std::vector<std::string>& args){
-	const auto command_line_args = parse_command_line_args_subcommands(args, "t");
+	const auto command_line_args = parse_command_line_args_subcommands(args, "tpb");
 	const auto path_parts = SplitPath(command_line_args.command);
 	QUARK_ASSERT(path_parts.fName == "floyd" || path_parts.fName == "floydut");
 	trace_on = command_line_args.flags.find("t") != command_line_args.flags.end() ? true : false;
@@ -232,12 +259,29 @@ int run_command(const std::vector<std::string>& args){
 		return EXIT_SUCCESS;
 	}
 	else if(command_line_args.subcommand == "compile"){
-		if(command_line_args.extra_arguments.size() == 1){
+		if(command_line_args.flags.find("b") != command_line_args.flags.end()){
+			if(command_line_args.extra_arguments.size() == 2){
+				const auto source_path = command_line_args.extra_arguments[0];
+				const auto source = read_text_file(source_path);
+				const auto program = floyd::compile_to_bytecode(source, source_path);
+				floyd::save_bc_program_file(command_line_args.extra_arguments[1], program);
+			}
+			else{
+				help();
+			}
+		}
+		else if(command_line_args.extra_arguments.size() == 1){
 			const auto source_path = command_line_args.extra_arguments[0];
 			const auto source = read_text_file(source_path);
-			const auto ast = floyd::compile_to_sematic_ast(source, source_path);
-			const auto json = ast_to_json(ast._checked_ast);
-			std::cout << json_to_pretty_string(json._value);
+			if(command_line_args.flags.find("p") != command_line_args.flags.end()){
+				const auto parse_tree = floyd::parse_program2(source);
+				std::cout << json_to_pretty_string(parse_tree._value);
+			}
+			else{
+				const auto ast = floyd::compile_to_sematic_ast(source, source_path);
+				const auto json = ast_to_json(ast._checked_ast);
+				std::cout << json_to_pretty_string(json._value);
+			}
 			std::cout << std::endl;
 		}
 		else{
@@ -254,9 +298,7 @@ int run_command(const std::vector<std::string>& args){
 			const auto source_path = floyd_args[0];
 			const std::vector<std::string> args2(floyd_args.begin() + 1, floyd_args.end());
 
-			const auto source = read_text_file(source_path);
-
-			auto program = floyd::compile_to_bytecode(source, source_path);
+			const auto program = load_program(source_path);
 
 			std::vector<floyd::value_t> args3;
 			for(const auto& e: args2){
@@ -334,7 +376,8 @@ int main(int argc, const char * argv[]) {
 	request:
 		{
 			"command": "run",
-			"source_path": "/mypath/test.floyd"
+			"source_path": "/mypath/test.floyd",
+			"metrics_path": "/mypath/metrics.json"		(optional)
 		}
 
 	reply:
@@ -358,7 +401,14 @@ json_t handle_server_request(const json_t& request) {
 				const auto source = read_text_file(source_path);
 				auto program = floyd::compile_to_bytecode(source, source_path);
 
-				const auto result = floyd::run_container(program, {}, program._container_def._name);
+				//	Optional: write process runtime metrics to this file every second.
+				floyd::run_container_settings_t settings;
+				if(request.does_object_element_exist("metrics_path")){
+					settings._metrics_path = request.get_object_element("metrics_path").get_string();
+					settings._metrics_interval_ms = 1000;
+				}
+
+				const auto result = floyd::run_container(program, {}, program._container_def._name, settings);
 				if(result.size() == 1 && result.find("main()") != result.end()){
 					const auto main_return = *result.begin();
 					const auto error_code = main_return.second.is_int() ? main_return.second.get_int_value() : EXIT_SUCCESS;
@@ -122,17 +122,14 @@ QUARK_UNIT_TEST("", "parse_statement()", "", ""){
 }
 
 
-//	"a = 1; print(a)"
-parse_result_t parse_statements_no_brackets(const seq_t& s){
-	vector<json_t> statements;
-
+//	Calls on_statement() with each statement as soon as it has been parsed. Returns where it stopped reading.
+static seq_t parse_statements_no_brackets(const seq_t& s, const std::function<void (const json_t& statement)>& on_statement){
 	auto pos = skip_whitespace(s);
-
 	while(pos.empty() == false){
 		const auto statement_pos = parse_statement(pos);
 		QUARK_ASSERT(statement_pos.second.pos() >= pos.pos());
 
-		statements.push_back(statement_pos.first);
+		on_statement(statement_pos.first);
 
 		auto pos2 = skip_whitespace(statement_pos.second);
 
@@ -145,6 +142,13 @@ parse_result_t parse_statements_no_brackets(const seq_t& s){
 		QUARK_ASSERT(pos2.pos() >= pos.pos());
 		pos = pos2;
 	}
+	return pos;
+}
+
+//	"a = 1; print(a)"
+parse_result_t parse_statements_no_brackets(const seq_t& s){
+	vector<json_t> statements;
+	const auto pos = parse_statements_no_brackets(s, [&](const json_t& statement){ statements.push_back(statement); });
 	return { statements, pos };
 }
 
@@ -221,6 +225,13 @@ parse_tree_t parse_program2(const string& program){
 	return parse_tree_t{ statements_pos.ast };
 }
 
+void parse_program_statements(const std::string& program, const std::function<void (const json_t& statement)>& on_statement){
+	const auto pos = seq_t(program);
+	check_illegal_chars(pos);
+
+	parse_statements_no_brackets(pos, on_statement);
+}
+
 const std::string k_test_program_0_source = "func int main(){ return 3; }";
 const std::string k_test_program_0_parserout = R"(
 	[
@@ -357,6 +368,22 @@ QUARK_UNIT_TEST("", "parse_program2()", "k_test_program_100_source", ""){
 	);
 }
 
+QUARK_UNIT_TEST("", "parse_program_statements()", "", "Same statements as parse_program2()"){
+	const auto source = R"(
+		struct pixel { double red; double green; double blue; }
+		func double get_grey(pixel p){ return (p.red + p.green + p.blue) / 3.0; }
+
+		func double main(){
+			let pixel p = pixel(1, 0, 0);
+			return get_grey(p);
+		}
+	)";
+
+	std::vector<json_t> statements;
+	parse_program_statements(source, [&](const json_t& statement){ statements.push_back(statement); });
+	ut_verify(QUARK_POS, json_t::make_array(statements), parse_program2(source)._value);
+}
+
 
 //////////////////////////////////////////////////		detect_implicit_statement_lookahead()
 
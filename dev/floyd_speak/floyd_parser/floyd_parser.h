@@ -10,6 +10,7 @@
 
 #include "quark.h"
 #include "json_support.h"
+#include <functional>
 #include <string>
 
 struct seq_t;
@@ -38,6 +39,10 @@ parse_result_t parse_statements_bracketted(const seq_t& s);
 //	returns json-array of statements.
 parse_tree_t parse_program2(const std::string& program);
 
+//	Same as parse_program2() but hands over one top-level statement at a time, as soon as it has been parsed. Lets the
+//	caller convert each statement and drop its JSON instead of building the parse tree for the entire program.
+void parse_program_statements(const std::string& program, const std::function<void (const json_t& statement)>& on_statement);
+
 }	//	floyd
 
 
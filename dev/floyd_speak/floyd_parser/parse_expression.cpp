@@ -264,7 +264,7 @@ std::pair<std::string, seq_t> parse_string_literal(const seq_t& s){
 
 	auto pos = s.rest();
 	std::string result = "";
-	while(pos.empty() == false && pos.first() != "\""){
+	while(pos.empty() == false && pos.first1_char() != '\"'){
 		//	Look for escape char
 		if(pos.first1_char() == 0x5c){
 			if(pos.size() < 2){
@@ -283,11 +283,14 @@ std::pair<std::string, seq_t> parse_string_literal(const seq_t& s){
 			}
 		}
 		else {
-			result += pos.first();
-			pos = pos.rest();
+			//	Copy everything up to the next quote or escape in one go.
+			const auto v = pos.str_view();
+			const auto count = std::min(v.find_first_of("\"\\"), v.size());
+			result.append(v.substr(0, count));
+			pos = pos.rest(count);
 		}
 	}
-	if(pos.first() != "\""){
+	if(pos.first_view(1) != "\""){
 		throw_compiler_error_nopos("Incomplete string literal -- missing ending \"-character in string literal: \"" + result + "\"!");
 	}
 	return { result, pos.rest() };
@@ -516,8 +519,8 @@ std::pair<json_t, seq_t> parse_optional_operation_rightward(const seq_t& p0, con
 		return { lhs, p0 };
 	}
 	else {
-		const auto op1 = p.first();
-		const auto op2 = p.first(2);
+		const auto op1 = p.first_view(1);
+		const auto op2 = p.first_view(2);
 
 		//	Detect end of chain. Notice that we leave the ")" or "]".
 		if(op1 == ")" && precedence > eoperator_precedence::k_parentesis){
@@ -1471,11 +1474,6 @@ std::pair<json_t, seq_t> parse_expression_deep(const seq_t& p, const eoperator_p
 }
 
 std::pair<json_t, seq_t> parse_expression(const seq_t& p){
-#if DEBUG
-	const auto illegal_char = read_while(p, valid_expression_chars);
-	QUARK_ASSERT(illegal_char.second.empty());
-#endif
-
 	try{
 		const auto r = parse_expression_deep(p, eoperator_precedence::k_super_weak);
 		return { r.first, r.second };
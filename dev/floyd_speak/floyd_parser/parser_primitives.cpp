@@ -33,13 +33,6 @@ using std::pair;
 //////////////////////////////////////////////////		Text parsing primitives
 
 
-std::string skip_whitespace(const string& s){
-	return skip_whitespace2(seq_t(s)).second.str();
-}
-seq_t skip_whitespace(const seq_t& s){
-	return skip_whitespace2(s).second;
-}
-
 //	Test where C++ lets you insert comments:
 
 	int my_global1 = 3;/*xyz*/
@@ -51,59 +44,68 @@ seq_t skip_whitespace(const seq_t& s){
 	/*xyz*/int my_global7 = 3;
 
 
-std::pair<std::string, seq_t> while_multicomment(const seq_t& s){
-	QUARK_ASSERT(s.first(2) == "/*");
+//	Returns the position after the closing "*/".
+static seq_t skip_multicomment(const seq_t& s){
+	QUARK_ASSERT(s.first_view(2) == "/*");
 
 	auto p = s.rest(2);
-	string a = "";
 	while(!p.empty()){
 		//	Skip uninteresting chars.
-		while(!p.empty() && p.first(2) != "/*" && p.first(2) != "*/"){
-			a = a + p.first(1);
-			p = p.rest(1);
+		const auto v = p.str_view();
+		auto i = v.find_first_of("/*");
+		while(i != std::string_view::npos && v.substr(i, 2) != "/*" && v.substr(i, 2) != "*/"){
+			i = v.find_first_of("/*", i + 1);
 		}
-
-		if(p.first(2) == "/*"){
-			const auto t = while_multicomment(p);
-			a = a + t.first;
-			p = t.second;
+		if(i == std::string_view::npos){
+			break;
 		}
-		else if(p.first(2) == "*/"){
-			return { a, p.rest(2) };
+		p = p.rest(i);
+
+		if(p.first_view(2) == "/*"){
+			p = skip_multicomment(p);
 		}
 		else{
-			throw_compiler_error_nopos("Unbalanaced comments /* ... */");
+			return p.rest(2);
 		}
 	}
 	throw_compiler_error_nopos("Unbalanaced comments /* ... */");
 }
 
-pair<string, seq_t> skip_whitespace2(const seq_t& s){
-	pair<string, seq_t> p = { "", s };
-
-	while(!p.second.empty()){
-		const auto ch2 = p.second.first(2);
+static seq_t skip_whitespace_and_comments(const seq_t& s){
+	auto p = s;
+	while(!p.empty()){
+		const auto ch2 = p.first_view(2);
 
 		//	Whitespace?
-		if(whitespace_chars.find(p.second.first1_char()) != string::npos){
-			p = { p.first + p.second.first(1), p.second.rest(1) };
+		if(whitespace_chars.find(p.first1_char()) != string::npos){
+			p = skip(p, whitespace_chars);
 		}
 		else if(ch2 == "//"){
-			auto p2 = read_until(p.second.rest(2), "\n");
-			p = { p.first + p2.first, p2.second };
+			const auto v = p.str_view();
+			p = p.rest(std::min(v.find('\n'), v.size()));
 		}
 		else if(ch2 == "/*"){
-			const auto px = while_multicomment(p.second);
-			p = { p.first + px.first, px.second };
+			p = skip_multicomment(p);
 		}
 		else{
 			return p;
 		}
 	}
-
 	return p;
 }
 
+pair<string, seq_t> skip_whitespace2(const seq_t& s){
+	const auto end = skip_whitespace_and_comments(s);
+	return { get_range(s, end), end };
+}
+
+std::string skip_whitespace(const string& s){
+	return skip_whitespace_and_comments(seq_t(s)).str();
+}
+seq_t skip_whitespace(const seq_t& s){
+	return skip_whitespace_and_comments(s);
+}
+
 QUARK_UNIT_TEST("", "skip_whitespace2()", "", ""){
 	QUARK_TEST_VERIFY(skip_whitespace2(seq_t("")).second == seq_t(""));
 }
@@ -269,8 +271,8 @@ const auto open_close2 = deinterleave_string(bracket_pairs);
 
 std::pair<string, seq_t> read_until_toplevel_match(const seq_t& s, const std::string& match_chars){
 	auto pos = s;
-	while(pos.empty() == false && match_chars.find(pos.first1()) == string::npos){
-		const auto ch = pos.first();
+	while(pos.empty() == false && match_chars.find(pos.first1_char()) == string::npos){
+		const auto ch = pos.first1_char();
 		if(open_close2.first.find(ch) != string::npos){
 			const auto end = get_balanced(pos).second;
 			pos = end;
@@ -463,24 +465,22 @@ std::pair<shared_ptr<typeid_t>, seq_t> read_basic_or_vector(const seq_t& s){
 		const auto pos3 = skip_whitespace(element_type_pos.second);
 		if(pos3.first1() == ":"){
 			const auto pos4 = pos3.rest1();
-
-			if(element_type_pos.first.is_string() == false){
-				throw_compiler_error_nopos("Dict only support string as key!");
+			const auto& key_type = element_type_pos.first;
+			if(key_type.is_function() || key_type.is_json_value() || key_type.is_typeid()){
+				throw_compiler_error_nopos("Dictionary key cannot be of type \"" + typeid_to_compact_string(key_type) + "\".");
+			}
+			const auto element_type2_pos = read_required_type(skip_whitespace(pos4));
+
+			if(element_type2_pos.second.first1() == "]"){
+				return {
+					make_shared<typeid_t>(
+						typeid_t::make_dict(element_type_pos.first, element_type2_pos.first)
+					),
+					element_type2_pos.second.rest1()
+				};
 			}
 			else{
-				const auto element_type2_pos = read_required_type(skip_whitespace(pos4));
-
-				if(element_type2_pos.second.first1() == "]"){
-					return {
-						make_shared<typeid_t>(
-							typeid_t::make_dict(element_type2_pos.first)
-						),
-						element_type2_pos.second.rest1()
-					};
-				}
-				else{
-					throw_compiler_error_nopos("unbalanced [].");
-				}
+				throw_compiler_error_nopos("unbalanced [].");
 			}
 		}
 		else if(pos3.first1() == "]"){
@@ -572,6 +572,16 @@ QUARK_UNIT_TEST("", "read_type()", "dict", ""){
 	QUARK_TEST_VERIFY(	*r.first ==  typeid_t::make_dict(typeid_t::make_int())		);
 	QUARK_TEST_VERIFY(r.second == seq_t(""));
 }
+QUARK_UNIT_TEST("", "read_type()", "dict", "int key"){
+	const auto r = read_type(seq_t("[int: string]"));
+	QUARK_TEST_VERIFY(	*r.first ==  typeid_t::make_dict(typeid_t::make_int(), typeid_t::make_string())		);
+	QUARK_TEST_VERIFY(r.second == seq_t(""));
+}
+QUARK_UNIT_TEST("", "read_type()", "dict", "struct key"){
+	const auto r = read_type(seq_t("[pixel_t: int]"));
+	QUARK_TEST_VERIFY(	*r.first ==  typeid_t::make_dict(typeid_t::make_unresolved_type_identifier("pixel_t"), typeid_t::make_int())		);
+	QUARK_TEST_VERIFY(r.second == seq_t(""));
+}
 
 
 QUARK_UNIT_TEST("", "read_type()", "", ""){
@@ -16,6 +16,7 @@
 #include <string>
 
 #include "floyd_interpreter.h"
+#include "repl_session.h"
 #include "floyd_parser/floyd_parser.h"
 #include "ast_value.h"
 #include "json_support.h"
@@ -168,50 +169,20 @@ std::string get_command(){
 
 
 
-#if 0
-int handle_repl_input(int print_pos, std::shared_ptr<floyd::interpreter_t>& vm_mut, const std::string& line){
-	const auto& program1 = vm_mut->_imm->_program;
-
-	const auto blank_program = floyd::compile_to_bytecode("");
-	const auto program2 = floyd::compile_to_bytecode(line);
-
-	//	Copy the new symbols, compared to a blank program.
-	const auto new_symbol_count = program2._globals._symbols.size() - blank_program._globals._symbols.size();
-	const auto new_symbols = std::vector<std::pair<std::string, floyd::symbol_t>>(program2._globals._symbols.end() - new_symbol_count, program2._globals._symbols.end());
-
-	const auto new_instruction_count = program2._globals._instrs2.size() - blank_program._globals._instrs2.size();
-	const auto new_instructions = std::vector<floyd::bc_instruction_t>(program2._globals._instrs2.end() - new_instruction_count, program2._globals._instrs2.end());
-
-	const auto globals2 = floyd::bc_frame_t(
-		program1._globals._instrs2,
-		program1._globals._symbols + new_symbols,
-		program1._globals._args
-	);
-
-	const auto program3 = floyd::bc_program_t{ globals2, program1._function_defs, program1._types };
-	auto imm2 = std::make_shared<floyd::interpreter_imm_t>(floyd::interpreter_imm_t{vm_mut->_imm->_start_time, program3, vm_mut->_imm->_host_functions});
-
-	vm_mut->_imm.swap(imm2);
-
-	const auto b = floyd::execute_instructions(*vm_mut, new_instructions);
-	while(print_pos < vm_mut->_print_output.size()){
-		std::cout << vm_mut->_print_output[print_pos] << std::endl;
-		print_pos++;
+void handle_repl_input(floyd::repl_session_t& session, const std::string& line){
+	const auto result = floyd::run_repl_input(session, line);
+	for(const auto& e: result._print_output){
+		std::cout << e << std::endl;
 	}
-	const auto return_value_type = vm_mut->_imm->_program._types[b.first];
-	if(return_value_type.is_void() == false){
-		const auto result_value = floyd::bc_to_value(b.second, return_value_type);
-		std::cout << to_compact_string2(result_value) << std::endl;
+	if(result._value.is_void() == false){
+		std::cout << to_compact_string2(result._value) << std::endl;
 	}
-	return print_pos;
 }
-#endif
 
 void run_repl(){
 	init_terminal();
 
-	auto program = floyd::compile_to_bytecode("", "");
-	auto vm = std::make_shared<floyd::interpreter_t>(program);
+	floyd::repl_session_t session;
 
 	std::cout << R"(Floyd " << floyd_version_string << " MIT.)" << std::endl;
 	std::cout << R"(Type "help", "copyright" or "license" for more informations!)" << std::endl;
@@ -222,13 +193,12 @@ Python 2.7.10 (default, Jul 15 2017, 17:16:57)
 Type "help", "copyright", "credits" or "license" for more information.
 */
 
-//	int print_pos = 0;
 	while(true){
 		try {
 			const auto line = get_command();
 
 			if(line == "vm"){
-				std::cout << json_to_pretty_string(floyd::interpreter_to_json(*vm)) << std::endl;
+				std::cout << json_to_pretty_string(floyd::interpreter_to_json(*session._vm)) << std::endl;
 			}
 			else if(line == ""){
 			}
@@ -242,8 +212,7 @@ Type "help", "copyright", "credits" or "license" for more information.
 				std::cout << "MIT license." << std::endl;
 			}
 			else{
-//				const auto print_pos2 = handle_repl_input(context, print_pos, vm, line);
-//				print_pos = print_pos2;
+				handle_repl_input(session, line);
 			}
 		}
 		catch(const std::runtime_error& e){
@@ -2061,6 +2061,136 @@ QUARK_UNIT_TEST("dict", "erase()", "", ""){
 }
 
 
+//////////////////////////////////////////		DICT - NON-STRING KEYS
+
+
+QUARK_UNIT_TEST("dict", "int keys", "construct, lookup", ""){
+	ut_verify_printout(
+		QUARK_POS,
+		R"(
+
+			let [int: string] a = {20: "twenty", 3: "three"}
+			print(a[3])
+			print(a[20])
+			print(a)
+			assert(size(a) == 2)
+
+		)",
+		{ "three", "twenty", R"({3: "three", 20: "twenty"})" }
+	);
+}
+
+QUARK_UNIT_TEST("dict", "int keys", "inferred type", ""){
+	ut_verify_global_result(
+		QUARK_POS,
+		R"(
+
+			let a = {1: 10.5, 2: 20.5}
+			let result = typeof(a) == typeof({7: 7.0})
+
+		)",
+		value_t::make_bool(true)
+	);
+}
+
+QUARK_UNIT_TEST("dict", "int keys", "update(), exists(), erase()", ""){
+	run_closed(R"(
+
+		let a = {1: "one", 2: "two"}
+		let b = update(a, 3, "three")
+		assert(b == {1: "one", 2: "two", 3: "three"})
+		assert(exists(b, 3) == true)
+		assert(exists(a, 3) == false)
+		let c = erase(b, 1)
+		assert(c == {2: "two", 3: "three"})
+
+	)");
+}
+
+QUARK_UNIT_TEST("dict", "int keys", "mutable, empty dict", ""){
+	run_closed(R"(
+
+		mutable [int: int] squares = {}
+		for(i in 0 ..< 10){
+			squares = update(squares, i, i * i)
+		}
+		assert(size(squares) == 10)
+		assert(squares[7] == 49)
+
+	)");
+}
+
+QUARK_UNIT_TEST("dict", "struct keys", "construct, lookup, update()", ""){
+	run_closed(R"(
+
+		struct pixel_t { int x int y }
+		let [pixel_t: string] a = { pixel_t(1, 2): "red", pixel_t(3, 4): "green" }
+		assert(a[pixel_t(1, 2)] == "red")
+		assert(a[pixel_t(3, 4)] == "green")
+
+		let b = update(a, pixel_t(1, 2), "blue")
+		assert(b[pixel_t(1, 2)] == "blue")
+		assert(a[pixel_t(1, 2)] == "red")
+		assert(exists(b, pixel_t(5, 6)) == false)
+		assert(size(erase(b, pixel_t(3, 4))) == 1)
+
+	)");
+}
+
+QUARK_UNIT_TEST("dict", "int keys", "value_to_jsonvalue() -> jsonvalue_to_value() roundtrip", "array of [key, value] pairs"){
+	ut_verify_printout(
+		QUARK_POS,
+		R"(
+
+			struct table_t { [int: string] names }
+			let a = table_t({2: "two", 1: "one"})
+			let j = value_to_jsonvalue(a)
+			print(jsonvalue_to_script(j))
+			assert(jsonvalue_to_value(j, table_t) == a)
+
+		)",
+		{ R"({ "names": [[1, "one"], [2, "two"]] })" }
+	);
+}
+
+QUARK_UNIT_TEST("dict", "int keys", "lookup with string key", "exception"){
+	ut_verify_exception(
+		QUARK_POS,
+		R"(
+
+			let a = {1: "one"}
+			print(a["one"])
+
+		)",
+		"Dictionary can only be looked up using int keys, not a \"string\". Line: 4 \"print(a[\"one\"])\""
+	);
+}
+
+QUARK_UNIT_TEST("dict", "int keys", "mixed key types", "exception"){
+	ut_verify_exception(
+		QUARK_POS,
+		R"(
+
+			let a = {1: "one", "two": "two"}
+
+		)",
+		"Dictionary of type [int:string] cannot use a key of type string. Line: 3 \"let a = {1: \"one\", \"two\": \"two\"}\""
+	);
+}
+
+QUARK_UNIT_TEST("dict", "function keys", "", "exception"){
+	ut_verify_exception(
+		QUARK_POS,
+		R"(
+
+			let [int (): int] a = {}
+
+		)",
+		"Dictionary key cannot be of type \"function int() pure\". Line: 3 \"let [int (): int] a = {}\""
+	);
+}
+
+
 //////////////////////////////////////////		STRUCT - TYPE
 
 
@@ -3546,6 +3676,135 @@ QUARK_UNIT_TEST("", "supermap()", "complex", ""){
 
 
 
+//////////////////////////////////////////		HOST FUNCTION - vector_add() etc.
+
+
+
+QUARK_UNIT_TEST("", "vector_add()", "[int]", ""){
+	run_closed(R"(
+
+		assert(vector_add([ 1, 2, 3 ], [ 10, 20, 30 ]) == [ 11, 22, 33 ])
+		assert(vector_sub([ 1, 2, 3 ], [ 10, 20, 30 ]) == [ -9, -18, -27 ])
+		assert(vector_mul([ 1, 2, 3 ], [ 10, 20, 30 ]) == [ 10, 40, 90 ])
+
+	)");
+}
+
+QUARK_UNIT_TEST("", "vector_add()", "[double]", ""){
+	run_closed(R"(
+
+		assert(vector_add([ 1.5, 2.0 ], [ 0.25, 0.5 ]) == [ 1.75, 2.5 ])
+		assert(vector_mul([ 1.5, 2.0 ], [ 2.0, 0.5 ]) == [ 3.0, 1.0 ])
+
+	)");
+}
+
+QUARK_UNIT_TEST("", "vector_add()", "Different sizes", "exception"){
+	ut_verify_exception(
+		QUARK_POS,
+		R"(
+
+			let a = vector_add([ 1, 2, 3 ], [ 10, 20 ])
+
+		)",
+		"vector_add() requires the vectors to have the same size."
+	);
+}
+
+QUARK_UNIT_TEST("", "vector_add()", "[string]", "exception"){
+	ut_verify_exception(
+		QUARK_POS,
+		R"(
+
+			let a = vector_add([ "a" ], [ "b" ])
+
+		)",
+		"vector_add() requires two vectors of int or two vectors of double."
+	);
+}
+
+QUARK_UNIT_TEST("", "vector_scale()", "", ""){
+	run_closed(R"(
+
+		assert(vector_scale([ 1, 2, 3 ], 3) == [ 3, 6, 9 ])
+		assert(vector_scale([ 1.0, 2.0 ], 0.5) == [ 0.5, 1.0 ])
+
+	)");
+}
+
+QUARK_UNIT_TEST("", "vector_dot()", "", ""){
+	run_closed(R"(
+
+		let int a = vector_dot([ 1, 2, 3 ], [ 4, 5, 6 ])
+		assert(a == 32)
+		let double b = vector_dot([ 0.5, 2.0 ], [ 4.0, 3.0 ])
+		assert(b == 8.0)
+
+	)");
+}
+
+QUARK_UNIT_TEST("", "vector_sum()", "", ""){
+	run_closed(R"(
+
+		let int a = vector_sum([ 1, 2, 3 ])
+		assert(a == 6)
+		assert(vector_sum([ 0.5, 0.25 ]) == 0.75)
+
+	)");
+}
+
+QUARK_UNIT_TEST("", "vector_min()", "", ""){
+	run_closed(R"(
+
+		assert(vector_min([ 4, -2, 7 ]) == -2)
+		assert(vector_max([ 4, -2, 7 ]) == 7)
+		assert(vector_min([ 0.5, -0.25 ]) == -0.25)
+		assert(vector_max([ 0.5, -0.25 ]) == 0.5)
+
+	)");
+}
+
+QUARK_UNIT_TEST("", "vector_min()", "Empty vector", "exception"){
+	ut_verify_exception(
+		QUARK_POS,
+		R"(
+
+			let [int] e = []
+			let a = vector_min(e)
+
+		)",
+		"vector_min() requires a non-empty vector."
+	);
+}
+
+QUARK_UNIT_TEST("", "vector_prefix_sum()", "", ""){
+	run_closed(R"(
+
+		assert(vector_prefix_sum([ 1, 2, 3, 4 ]) == [ 1, 3, 6, 10 ])
+		assert(vector_prefix_sum([ 0.5, 0.5, 1.0 ]) == [ 0.5, 1.0, 2.0 ])
+
+	)");
+}
+
+QUARK_UNIT_TEST("", "vector_prefix_sum()", "Big vector, runs on several threads", ""){
+	run_closed(R"(
+
+		mutable [int] a = []
+		for(i in 0 ..< 200000){
+			a = push_back(a, 1)
+		}
+		let b = vector_prefix_sum(a)
+		assert(b[0] == 1)
+		assert(b[199999] == 200000)
+		assert(vector_sum(a) == 200000)
+
+	)");
+}
+
+
+
+
+
 //////////////////////////////////////////		HOST FUNCTION - read_text_file()
 
 /*
@@ -4549,6 +4808,978 @@ QUARK_UNIT_TEST("", "game_of_life.floyd", "", ""){
 	QUARK_UT_VERIFY(result == expected);
 }
 
+//	Many more processes than there are hardware threads, all running the same function.
+QUARK_UNIT_TEST("software-system", "run 200 processes", "", ""){
+	const int process_count = 200;
+
+	std::string clock_processes;
+	std::string sends;
+	for(int i = 0 ; i < process_count ; i++){
+		const auto name = "p" + std::to_string(i);
+		clock_processes += std::string(i == 0 ? "" : ",\n") + "\"" + name + "\": \"my_worker\"";
+		sends += "send(\"" + name + "\", \"work\")\nsend(\"" + name + "\", \"work\")\nsend(\"" + name + "\", \"stop\")\n";
+	}
+
+	const auto program = std::string() + R"(
+		software-system {
+			"name": "Many workers",
+			"desc": "",
+			"people": {},
+			"connections": [],
+			"containers": [
+				"workers"
+			]
+		}
+
+		container-def {
+			"name": "workers",
+			"tech": "",
+			"desc": "",
+			"clocks": {
+				"main": {
+					"main": "my_main",
+)" + clock_processes + R"(
+				}
+			}
+		}
+
+		func int my_main__init() impure {
+)" + sends + R"(
+			send("main", "stop")
+			return 0
+		}
+
+		func int my_main(int state, json_value message) impure {
+			assert(false)
+			return state
+		}
+
+		func int my_worker__init() impure {
+			return 0
+		}
+
+		func int my_worker(int state, json_value message) impure {
+			assert(message == "work")
+			return state + 1
+		}
+	)";
+
+	const auto result = run_container2(program, {}, "workers", "");
+	QUARK_UT_VERIFY(result.empty());
+}
+
+static std::string make_ping_pong_program(const std::string& clocks){
+	return R"(
+		software-system {
+			"name": "Ping pong",
+			"desc": "",
+			"people": {},
+			"connections": [],
+			"containers": [
+				"app"
+			]
+		}
+
+		container-def {
+			"name": "app",
+			"tech": "",
+			"desc": "",
+			"clocks": )" + clocks + R"(
+		}
+
+		func int my_ping__init() impure {
+			send("b", 0)
+			return 0
+		}
+
+		func int my_ping(int state, int message) impure {
+			if(message >= 100){
+				send("a", "stop")
+				send("b", "stop")
+			}
+			else{
+				send("b", message + 1)
+			}
+			return state + 1
+		}
+
+		func int my_pong__init() impure {
+			return 0
+		}
+
+		func int my_pong(int state, int message) impure {
+			send("a", message + 1)
+			return state + 1
+		}
+	)";
+}
+
+QUARK_UNIT_TEST("software-system", "run two processes", "on same clock bus", "sends are executed inline"){
+	const auto program = make_ping_pong_program(R"({ "main": { "a": "my_ping", "b": "my_pong" } })");
+	const auto result = run_container2(program, {}, "app", "");
+	QUARK_UT_VERIFY(result.empty());
+}
+
+QUARK_UNIT_TEST("software-system", "run two processes", "on separate clock busses", "sends go via inboxes"){
+	const auto program = make_ping_pong_program(R"({ "ping_bus": { "a": "my_ping" }, "pong_bus": { "b": "my_pong" } })");
+	const auto result = run_container2(program, {}, "app", "");
+	QUARK_UT_VERIFY(result.empty());
+}
+
+static const std::string k_typed_messages_container = R"(
+	software-system {
+		"name": "Typed messages",
+		"desc": "",
+		"people": {},
+		"connections": [],
+		"containers": [
+			"app"
+		]
+	}
+
+	container-def {
+		"name": "app",
+		"tech": "",
+		"desc": "",
+		"clocks": {
+			"main": {
+				"a": "my_adder"
+			}
+		}
+	}
+)";
+
+QUARK_UNIT_TEST("software-system", "send()", "struct message", "process function gets the struct"){
+	const auto program = k_typed_messages_container + R"(
+		struct message_t {
+			string _cmd
+			[int] _values
+		}
+
+		func int my_adder__init() impure {
+			send("a", message_t("add", [ 1, 2, 3 ]))
+			send("a", message_t("add", [ 10 ]))
+			send("a", message_t("check", []))
+			send("a", "stop")
+			return 0
+		}
+
+		func int my_adder(int state, message_t message) impure {
+			if(message._cmd == "add"){
+				mutable sum = state
+				for(i in 0 ..< size(message._values)){
+					sum = sum + message._values[i]
+				}
+				return sum
+			}
+			else{
+				assert(state == 16)
+				return state
+			}
+		}
+	)";
+	const auto result = run_container2(program, {}, "app", "");
+	QUARK_UT_VERIFY(result.empty());
+}
+
+QUARK_UNIT_TEST("software-system", "send()", "wrong message type", "throws"){
+	const auto program = k_typed_messages_container + R"(
+		func int my_adder__init() impure {
+			send("a", 3.5)
+			send("a", "stop")
+			return 0
+		}
+
+		func int my_adder(int state, [int] message) impure {
+			return state
+		}
+	)";
+	try{
+		run_container2(program, {}, "app", "");
+		QUARK_UT_VERIFY(false);
+	}
+	catch(const std::runtime_error& e){
+		QUARK_UT_VERIFY(std::string(e.what()) == "Process \"a\" can't receive message of type double, expected [int].");
+	}
+}
+
+QUARK_UNIT_TEST("software-system", "send()", "wrong message type to other clock bus", "sender throws, nothing queued"){
+	const auto program = R"(
+		software-system {
+			"name": "Typed messages",
+			"desc": "",
+			"people": {},
+			"connections": [],
+			"containers": [
+				"app"
+			]
+		}
+
+		container-def {
+			"name": "app",
+			"tech": "",
+			"desc": "",
+			"clocks": {
+				"sender": {
+					"a": "my_sender"
+				},
+				"receiver": {
+					"b": "my_receiver"
+				}
+			}
+		}
+
+		func int my_sender__init() impure {
+			send("b", "hello")
+			return 0
+		}
+
+		func int my_sender(int state, json_value message) impure {
+			return state
+		}
+
+		func int my_receiver__init() impure {
+			return 0
+		}
+
+		func int my_receiver(int state, int message) impure {
+			return state
+		}
+	)";
+	try{
+		run_container2(program, {}, "app", "");
+		QUARK_UT_VERIFY(false);
+	}
+	catch(const std::runtime_error& e){
+		QUARK_UT_VERIFY(std::string(e.what()) == "Process \"b\" can't receive message of type string, expected int.");
+	}
+}
+
+QUARK_UNIT_TEST("software-system", "post_at_time()", "wrong message type", "throws in post_at_time()"){
+	const auto program = k_typed_messages_container + R"(
+		func int my_adder__init() impure {
+			post_at_time("a", get_monotonic_time() + 100000000, 3.5)
+			return 0
+		}
+
+		func int my_adder(int state, int message) impure {
+			return state
+		}
+	)";
+	try{
+		run_container2(program, {}, "app", "");
+		QUARK_UT_VERIFY(false);
+	}
+	catch(const std::runtime_error& e){
+		QUARK_UT_VERIFY(std::string(e.what()) == "Process \"a\" can't receive message of type double, expected int.");
+	}
+}
+
+QUARK_UNIT_TEST("software-system", "send()", "unknown literal process key", "compiler error"){
+	const auto program = k_typed_messages_container + R"(
+		func int my_adder__init() impure {
+			send("b", 3)
+			return 0
+		}
+
+		func int my_adder(int state, int message) impure {
+			return state
+		}
+	)";
+	try{
+		run_container2(program, {}, "app", "");
+		QUARK_UT_VERIFY(false);
+	}
+	catch(const std::runtime_error& e){
+		QUARK_UT_VERIFY(std::string(e.what()).find("Unknown process \"b\" in send().") == 0);
+	}
+}
+
+QUARK_UNIT_TEST("software-system", "send()", "process key in variable", "looked up at runtime"){
+	const auto program = k_typed_messages_container + R"(
+		func int my_adder__init() impure {
+			let dest = "a"
+			send(dest, 3)
+			send(dest, 4)
+			send(dest + "", "stop")
+			return 0
+		}
+
+		func int my_adder(int state, json_value message) impure {
+			return state + 1
+		}
+	)";
+	const auto result = run_container2(program, {}, "app", "");
+	QUARK_UT_VERIFY(result.empty());
+}
+
+QUARK_UNIT_TEST("software-system", "send()", "unknown process key in variable", "throws"){
+	const auto program = k_typed_messages_container + R"(
+		func int my_adder__init() impure {
+			let dest = "b"
+			send(dest + "", 3)
+			return 0
+		}
+
+		func int my_adder(int state, int message) impure {
+			return state
+		}
+	)";
+	try{
+		run_container2(program, {}, "app", "");
+		QUARK_UT_VERIFY(false);
+	}
+	catch(const std::runtime_error& e){
+		QUARK_UT_VERIFY(std::string(e.what()) == "Unknown process \"b\" in send().");
+	}
+}
+
+QUARK_UNIT_TEST("software-system", "batch mode", "27 messages, batch size 10", "3 calls"){
+	const auto program = R"(
+		software-system {
+			"name": "Batches",
+			"desc": "",
+			"people": {},
+			"connections": [],
+			"containers": [
+				"app"
+			]
+		}
+
+		container-def {
+			"name": "app",
+			"tech": "",
+			"desc": "",
+			"clocks": {
+				"main": {
+					"a": { "function": "my_batcher", "batch": 10 },
+					"s": "my_sender"
+				}
+			}
+		}
+
+		struct batcher_t {
+			int _sum
+			int _calls
+		}
+
+		func batcher_t my_batcher__init() impure {
+			return batcher_t(0, 0)
+		}
+
+		func batcher_t my_batcher(batcher_t state, [int] messages) impure {
+			assert(size(messages) <= 10)
+			mutable sum = state._sum
+			for(i in 0 ..< size(messages)){
+				if(messages[i] == -1){
+					assert(sum == 325)
+					assert(state._calls == 2)
+				}
+				else{
+					sum = sum + messages[i]
+				}
+			}
+			return batcher_t(sum, state._calls + 1)
+		}
+
+		func int my_sender__init() impure {
+			for(i in 1 ... 25){
+				send("a", i)
+			}
+			send("a", -1)
+			send("a", "stop")
+			send("s", "stop")
+			return 0
+		}
+
+		func int my_sender(int state, json_value message) impure {
+			return state
+		}
+	)";
+	const auto result = run_container2(program, {}, "app", "");
+	QUARK_UT_VERIFY(result.empty());
+}
+
+QUARK_UNIT_TEST("software-system", "parse_container_def_json()", "process with batch size", ""){
+	const auto container = parse_container_def_json(parse_json(seq_t(R"(
+		{
+			"name": "app",
+			"tech": "",
+			"desc": "",
+			"clocks": {
+				"main": {
+					"a": { "function": "my_batcher", "batch": 10 },
+					"b": "my_gui"
+				}
+			}
+		}
+	)")).first);
+	const auto& processes = container._clock_busses.at("main")._processes;
+	QUARK_UT_VERIFY(processes.at("a")._function_key == "my_batcher");
+	QUARK_UT_VERIFY(processes.at("a")._batch_size == 10);
+	QUARK_UT_VERIFY(processes.at("b")._function_key == "my_gui");
+	QUARK_UT_VERIFY(processes.at("b")._batch_size == 0);
+}
+
+QUARK_UNIT_TEST("software-system", "inbox policy", "drop-newest, capacity 3, 10 messages", "first 3 processed"){
+	const auto program = R"(
+		software-system {
+			"name": "Inboxes",
+			"desc": "",
+			"people": {},
+			"connections": [],
+			"containers": [
+				"app"
+			]
+		}
+
+		container-def {
+			"name": "app",
+			"tech": "",
+			"desc": "",
+			"clocks": {
+				"main": {
+					"a": "my_sender",
+					"b": { "function": "my_receiver", "capacity": 3, "policy": "drop-newest" }
+				}
+			}
+		}
+
+		func int my_sender__init() impure {
+			for(i in 1 ... 10){
+				send("b", i)
+			}
+			assert(get_inbox_pressure("b") == 1.0)
+
+			let stats = get_inbox_stats("b")
+			assert(stats["capacity"] == 3)
+			assert(stats["sent"] == 3)
+			assert(stats["dropped"] == 7)
+
+			send("a", "stop")
+			return 0
+		}
+
+		func int my_sender(int state, json_value message) impure {
+			return state
+		}
+
+		func int my_receiver__init() impure {
+			return 0
+		}
+
+		func int my_receiver(int state, int message) impure {
+			assert(message == state + 1)
+			if(message == 3){
+				send("b", "stop")
+			}
+			return message
+		}
+	)";
+	const auto result = run_container2(program, {}, "app", "");
+	QUARK_UT_VERIFY(result.empty());
+}
+
+QUARK_UNIT_TEST("software-system", "inbox policy", "block, capacity 2, sender on other clock bus", "no message lost"){
+	const auto program = R"(
+		software-system {
+			"name": "Inboxes",
+			"desc": "",
+			"people": {},
+			"connections": [],
+			"containers": [
+				"app"
+			]
+		}
+
+		container-def {
+			"name": "app",
+			"tech": "",
+			"desc": "",
+			"clocks": {
+				"sender": {
+					"a": "my_sender"
+				},
+				"receiver": {
+					"b": { "function": "my_receiver", "capacity": 2 }
+				}
+			}
+		}
+
+		func int my_sender__init() impure {
+			for(i in 1 ... 100){
+				send("b", i)
+			}
+			send("b", -1)
+			send("a", "stop")
+			return 0
+		}
+
+		func int my_sender(int state, json_value message) impure {
+			return state
+		}
+
+		func int my_receiver__init() impure {
+			return 0
+		}
+
+		func int my_receiver(int state, int message) impure {
+			if(message == -1){
+				assert(state == 5050)
+				send("b", "stop")
+			}
+			return state + message
+		}
+	)";
+	const auto result = run_container2(program, {}, "app", "");
+	QUARK_UT_VERIFY(result.empty());
+}
+
+QUARK_UNIT_TEST("software-system", "get_inbox_stats()", "unknown process", "exception"){
+	const auto program = R"(
+		software-system {
+			"name": "Inboxes",
+			"desc": "",
+			"people": {},
+			"connections": [],
+			"containers": [
+				"app"
+			]
+		}
+
+		container-def {
+			"name": "app",
+			"tech": "",
+			"desc": "",
+			"clocks": {
+				"main": {
+					"a": "my_sender"
+				}
+			}
+		}
+
+		func int my_sender__init() impure {
+			let stats = get_inbox_stats("x")
+			return 0
+		}
+
+		func int my_sender(int state, json_value message) impure {
+			return state
+		}
+	)";
+	try{
+		run_container2(program, {}, "app", "");
+		QUARK_UT_VERIFY(false);
+	}
+	catch(const std::runtime_error& e){
+		QUARK_UT_VERIFY(std::string(e.what()) == "Unknown process \"x\" in get_inbox_stats().");
+	}
+}
+
+QUARK_UNIT_TEST("software-system", "parse_container_def_json()", "process with inbox policy", ""){
+	const auto container = parse_container_def_json(parse_json(seq_t(R"(
+		{
+			"name": "app",
+			"tech": "",
+			"desc": "",
+			"clocks": {
+				"main": {
+					"a": { "function": "my_mouse", "capacity": 16, "policy": "coalesce", "coalesce_key": "id" },
+					"b": { "function": "my_log", "capacity": 100, "policy": "drop-oldest" }
+				}
+			}
+		}
+	)")).first);
+	const auto& processes = container._clock_busses.at("main")._processes;
+	QUARK_UT_VERIFY(processes.at("a")._inbox_capacity == 16);
+	QUARK_UT_VERIFY(processes.at("a")._inbox_policy == einbox_policy::k_coalesce);
+	QUARK_UT_VERIFY(processes.at("a")._coalesce_key == "id");
+	QUARK_UT_VERIFY(processes.at("b")._inbox_capacity == 100);
+	QUARK_UT_VERIFY(processes.at("b")._inbox_policy == einbox_policy::k_drop_oldest);
+}
+
+QUARK_UNIT_TEST("software-system", "parse_container_def_json()", "coalesce without key", "exception"){
+	try{
+		parse_container_def_json(parse_json(seq_t(R"(
+			{
+				"name": "app",
+				"tech": "",
+				"desc": "",
+				"clocks": {
+					"main": {
+						"a": { "function": "my_mouse", "policy": "coalesce" }
+					}
+				}
+			}
+		)")).first);
+		QUARK_UT_VERIFY(false);
+	}
+	catch(const std::runtime_error& e){
+		QUARK_UT_VERIFY(std::string(e.what()) == "Inbox policy \"coalesce\" needs a \"coalesce_key\".");
+	}
+}
+
+QUARK_UNIT_TEST("software-system", "post_at_time()", "process ticks itself 5 times, 2 ms apart", "never early"){
+	const auto program = R"(
+		software-system {
+			"name": "Timers",
+			"desc": "",
+			"people": {},
+			"connections": [],
+			"containers": [
+				"app"
+			]
+		}
+
+		container-def {
+			"name": "app",
+			"tech": "",
+			"desc": "",
+			"clocks": {
+				"main": {
+					"a": "my_ticker"
+				}
+			}
+		}
+
+		struct ticker_t {
+			int _count
+			int _next_time
+		}
+
+		func ticker_t my_ticker__init() impure {
+			let t = get_monotonic_time() + 2000
+			post_at_time("a", t, "tick")
+			return ticker_t(0, t)
+		}
+
+		func ticker_t my_ticker(ticker_t state, string message) impure {
+			assert(message == "tick")
+			assert(get_monotonic_time() >= state._next_time)
+
+			if(state._count == 4){
+				send("a", "stop")
+				return state
+			}
+			else{
+				let t = state._next_time + 2000
+				post_at_time("a", t, "tick")
+				return ticker_t(state._count + 1, t)
+			}
+		}
+	)";
+	const auto result = run_container2(program, {}, "app", "");
+	QUARK_UT_VERIFY(result.empty());
+}
+
+QUARK_UNIT_TEST("software-system", "post_at_time()", "timers posted out of order, other clock bus", "delivered in time order"){
+	const auto program = R"(
+		software-system {
+			"name": "Timers",
+			"desc": "",
+			"people": {},
+			"connections": [],
+			"containers": [
+				"app"
+			]
+		}
+
+		container-def {
+			"name": "app",
+			"tech": "",
+			"desc": "",
+			"clocks": {
+				"sender": {
+					"a": "my_sender"
+				},
+				"receiver": {
+					"b": "my_receiver"
+				}
+			}
+		}
+
+		func int my_sender__init() impure {
+			let now = get_monotonic_time()
+			post_at_time("b", now + 30000, 3)
+			post_at_time("b", now + 10000, 1)
+			post_at_time("b", now + 20000, 2)
+			send("a", "stop")
+			return 0
+		}
+
+		func int my_sender(int state, json_value message) impure {
+			return state
+		}
+
+		func int my_receiver__init() impure {
+			return 0
+		}
+
+		func int my_receiver(int state, int message) impure {
+			assert(message == state + 1)
+			if(message == 3){
+				send("b", "stop")
+			}
+			return message
+		}
+	)";
+	const auto result = run_container2(program, {}, "app", "");
+	QUARK_UT_VERIFY(result.empty());
+}
+
+QUARK_UNIT_TEST("software-system", "post_at_time()", "unknown process", "exception"){
+	const auto program = R"(
+		software-system {
+			"name": "Timers",
+			"desc": "",
+			"people": {},
+			"connections": [],
+			"containers": [
+				"app"
+			]
+		}
+
+		container-def {
+			"name": "app",
+			"tech": "",
+			"desc": "",
+			"clocks": {
+				"main": {
+					"a": "my_ticker"
+				}
+			}
+		}
+
+		func int my_ticker__init() impure {
+			post_at_time("x", get_monotonic_time(), "tick")
+			return 0
+		}
+
+		func int my_ticker(int state, json_value message) impure {
+			return state
+		}
+	)";
+	try{
+		run_container2(program, {}, "app", "");
+		QUARK_UT_VERIFY(false);
+	}
+	catch(const std::runtime_error& e){
+		QUARK_UT_VERIFY(std::string(e.what()) == "Unknown process \"x\" in post_at_time().");
+	}
+}
+
+QUARK_UNIT_TEST("interpreter_t", "snapshot_globals()", "clone globals into second interpreter", "same values, no static initialization"){
+	const auto program = compile_to_bytecode(R"(
+		let a = [ 1, 2, 3 ]
+		let b = "hello"
+		mutable c = 10
+		c = c + 1
+		print("init")
+	)", "");
+
+	const auto imm = make_interpreter_imm(program);
+	const interpreter_t vm(imm, nullptr);
+	QUARK_UT_VERIFY((vm._print_output == std::vector<std::string>{ "init" }));
+
+	const interpreter_t clone(imm, snapshot_globals(vm), nullptr);
+	QUARK_UT_VERIFY(clone._imm == vm._imm);
+	QUARK_UT_VERIFY(clone._print_output.empty());
+	QUARK_UT_VERIFY(find_global_symbol(clone, "a") == find_global_symbol(vm, "a"));
+	QUARK_UT_VERIFY(find_global_symbol(clone, "b") == value_t::make_string("hello"));
+	QUARK_UT_VERIFY(find_global_symbol(clone, "c") == value_t::make_int(11));
+}
+
+QUARK_UNIT_TEST("software-system", "send()", "outside container", "exception"){
+	try{
+		run_global(R"(
+			let process_key = "a"
+			send(process_key, 1)
+		)", "");
+		QUARK_UT_VERIFY(false);
+	}
+	catch(const std::runtime_error& e){
+		QUARK_UT_VERIFY(std::string(e.what()) == "send() only works inside a container.");
+	}
+}
+
+QUARK_UNIT_TEST("software-system", "run_container()", "metrics", "counts messages per process"){
+	const auto program = compile_to_bytecode(R"(
+		software-system {
+			"name": "Metrics",
+			"desc": "",
+			"people": {},
+			"connections": [],
+			"containers": [
+				"app"
+			]
+		}
+
+		container-def {
+			"name": "app",
+			"tech": "",
+			"desc": "",
+			"clocks": {
+				"sender": {
+					"a": "my_sender"
+				},
+				"receiver": {
+					"b": "my_receiver"
+				}
+			}
+		}
+
+		func int my_sender__init() impure {
+			for(i in 1 ... 10){
+				send("b", [ "message", to_string(i) ])
+			}
+			send("b", "stop")
+			send("a", "stop")
+			return 0
+		}
+
+		func int my_sender(int state, json_value message) impure {
+			return state
+		}
+
+		func int my_receiver__init() impure {
+			return 0
+		}
+
+		func int my_receiver(int state, [string] message) impure {
+			return state + 1
+		}
+	)", "");
+
+	std::vector<json_t> reports;
+	run_container_settings_t settings;
+	settings._on_metrics = [&](const json_t& metrics){ reports.push_back(metrics); };
+	run_container(program, {}, "app", settings);
+
+	QUARK_UT_VERIFY(reports.size() == 1);
+	const auto b = reports[0].get_object_element("processes").get_object_element("b");
+	QUARK_UT_VERIFY(b.get_object_element("messages").get_number() == 10);
+	QUARK_UT_VERIFY(b.get_object_element("execution_us").get_object_element("count").get_number() == 10);
+
+	//	The "stop" message goes through the inbox too.
+	QUARK_UT_VERIFY(b.get_object_element("latency_us").get_object_element("count").get_number() == 11);
+	QUARK_UT_VERIFY(b.get_object_element("inbox").get_object_element("sent").get_number() == 11);
+
+	const auto a = reports[0].get_object_element("processes").get_object_element("a");
+	QUARK_UT_VERIFY(a.get_object_element("messages").get_number() == 0);
+	QUARK_UT_VERIFY(a.get_object_element("allocations").get_number() >= 10);
+}
+
+QUARK_UNIT_TEST("software-system", "run_container()", "metrics, inline send", "receiver's allocations are not charged to the sender"){
+	const auto program = compile_to_bytecode(R"(
+		software-system {
+			"name": "Metrics",
+			"desc": "",
+			"people": {},
+			"connections": [],
+			"containers": [
+				"app"
+			]
+		}
+
+		container-def {
+			"name": "app",
+			"tech": "",
+			"desc": "",
+			"clocks": {
+				"main": {
+					"a": "my_sender",
+					"b": "my_receiver"
+				}
+			}
+		}
+
+		func int my_sender__init() impure {
+			send("a", "go")
+			return 0
+		}
+
+		func int my_sender(int state, json_value message) impure {
+			if(message == "go"){
+				for(i in 1 ... 5){
+					send("b", i)
+				}
+				send("b", "stop")
+				send("a", "stop")
+			}
+			return state
+		}
+
+		func int my_receiver__init() impure {
+			return 0
+		}
+
+		func int my_receiver(int state, int message) impure {
+			mutable [string] v = []
+			for(i in 0 ..< 100){
+				v = push_back(v, "y")
+			}
+			return state + size(v)
+		}
+	)", "");
+
+	std::vector<json_t> reports;
+	run_container_settings_t settings;
+	settings._on_metrics = [&](const json_t& metrics){ reports.push_back(metrics); };
+	run_container(program, {}, "app", settings);
+
+	QUARK_UT_VERIFY(reports.size() == 1);
+	const auto a = reports[0].get_object_element("processes").get_object_element("a");
+	const auto b = reports[0].get_object_element("processes").get_object_element("b");
+	QUARK_UT_VERIFY(b.get_object_element("messages").get_number() == 5);
+	QUARK_UT_VERIFY(b.get_object_element("allocations").get_number() >= 500);
+	QUARK_UT_VERIFY(a.get_object_element("allocations").get_number() < 100);
+
+	//	The receiver's vectors die with each call.
+	QUARK_UT_VERIFY(b.get_object_element("external_values_live").get_number() < 100);
+}
+
+QUARK_UNIT_TEST("software-system", "run_container()", "metrics every 1 ms", "reported while running and at the end"){
+	const auto program = compile_to_bytecode(R"(
+		software-system {
+			"name": "Metrics",
+			"desc": "",
+			"people": {},
+			"connections": [],
+			"containers": [
+				"app"
+			]
+		}
+
+		container-def {
+			"name": "app",
+			"tech": "",
+			"desc": "",
+			"clocks": {
+				"main": {
+					"a": "my_ticker"
+				}
+			}
+		}
+
+		func int my_ticker__init() impure {
+			post_at_time("a", get_monotonic_time() + 10000, "stop")
+			return 0
+		}
+
+		func int my_ticker(int state, json_value message) impure {
+			return state
+		}
+	)", "");
+
+	int report_count = 0;
+	run_container_settings_t settings;
+	settings._metrics_interval_ms = 1;
+	settings._on_metrics = [&](const json_t& metrics){ report_count++; };
+	run_container(program, {}, "app", settings);
+
+	QUARK_UT_VERIFY(report_count >= 3);
+}
+
 QUARK_UNIT_TEST("", "process_test1.floyd", "", ""){
 	const auto path = get_working_dir() + "/process_test1.floyd";
 	const auto program = read_text_file(path);
@@ -9,8 +9,23 @@
 #include "interpretator_benchmark.h"
 
 #include "benchmark_basics.h"
-
+#include "bc_simd.h"
+#include "floyd_parser.h"
+#include "pass3.h"
+#include "bytecode_generator.h"
+#include "bytecode_interpreter.h"
+#include "floyd_interpreter.h"
+#include "json_support.h"
+#include "mpsc_queue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
 #include <string>
+#include <thread>
 
 using std::string;
 
@@ -127,6 +142,356 @@ OFF_QUARK_UNIT_TEST_VIP("Basic performance", "Text metrics", "", ""){
 
 #endif
 
+//////////////////////////////////////////		VECTOR KERNELS
+
+//	Compares the SIMD kernels in bc_simd.h with the element-by-element loops they replaced.
+
+static immer::vector<bc_inplace_value_t> make_benchmark_ints(int64_t count){
+	immer::vector<bc_inplace_value_t> result;
+	for(int64_t i = 0 ; i < count ; i++){
+		bc_inplace_value_t e;
+		e._int64 = i;
+		result = result.push_back(e);
+	}
+	return result;
+}
+
+static void vector_kernel_benchmark(){
+	const int64_t count = 1000000;
+	const auto a = make_benchmark_ints(count);
+	const auto b = make_benchmark_ints(count);
+
+	std::cout << "SIMD level: " << simd_level_to_string(get_simd_level()) << std::endl;
+
+	if(1){
+		const auto scalar_func = [&] {
+			volatile int result = 0;
+			int index = 0;
+			const auto size = a.size();
+			while(index < size && a[index]._int64 != count - 1){
+				index++;
+			}
+			result = index == size ? -1 : index;
+		};
+		const auto simd_func = [&] {
+			volatile int result = bc_simd_find_int(a, count - 1);
+		};
+		trace_speedup(bench_speedup_t{ "find() in [int] with 1M elements",
+			measure_execution_time_ns(scalar_func, k_repeats),
+			measure_execution_time_ns(simd_func, k_repeats)
+		});
+	}
+
+	if(1){
+		const auto scalar_func = [&] {
+			volatile int result = 0;
+			for(int i = 0 ; i < a.size() ; i++){
+				if(a[i]._int64 != b[i]._int64){
+					result = a[i]._int64 < b[i]._int64 ? -1 : 1;
+					break;
+				}
+			}
+		};
+		const auto simd_func = [&] {
+			volatile size_t result = bc_simd_mismatch_int(a, b, 0, a.size());
+		};
+		trace_speedup(bench_speedup_t{ "== on two [int] with 1M elements",
+			measure_execution_time_ns(scalar_func, k_repeats),
+			measure_execution_time_ns(simd_func, k_repeats)
+		});
+	}
+
+	if(1){
+		const auto scalar_func = [&] {
+			int64_t acc = a[0]._int64;
+			for(int i = 1 ; i < a.size() ; i++){
+				acc = a[i]._int64 > acc ? a[i]._int64 : acc;
+			}
+			volatile int64_t result = acc;
+		};
+		const auto simd_func = [&] {
+			volatile int64_t result = bc_simd_max_int(a);
+		};
+		trace_speedup(bench_speedup_t{ "max of [int] with 1M elements",
+			measure_execution_time_ns(scalar_func, k_repeats),
+			measure_execution_time_ns(simd_func, k_repeats)
+		});
+	}
+
+	if(1){
+		const auto scalar_func = [&] {
+			int64_t acc = 0;
+			for(int i = 0 ; i < a.size() ; i++){
+				acc = acc + a[i]._int64 * b[i]._int64;
+			}
+			volatile int64_t result = acc;
+		};
+		const auto simd_func = [&] {
+			volatile int64_t result = bc_simd_dot_int(a, b);
+		};
+		trace_speedup(bench_speedup_t{ "vector_dot() of two [int] with 1M elements, SIMD + threads",
+			measure_execution_time_ns(scalar_func, k_repeats),
+			measure_execution_time_ns(simd_func, k_repeats)
+		});
+	}
+}
+
+
+//////////////////////////////////////////		PROCESS INBOX
+
+//	Fan-in: many threads sending to one process. Compares the old inbox (mutex + deque + condition variable)
+//	with mpsc_queue_t.
+
+struct mutex_inbox_t {
+	bool push(const json_t& message){
+		{
+			std::lock_guard<std::mutex> lk(_mutex);
+			_inbox.push_front(message);
+		}
+		_condition_variable.notify_one();
+		return true;
+	}
+
+	size_t drain(std::deque<json_t>& result){
+		std::unique_lock<std::mutex> lk(_mutex);
+		_condition_variable.wait_for(lk, std::chrono::milliseconds(1), [&]{ return _inbox.empty() == false; });
+		if(_inbox.empty()){
+			return 0;
+		}
+		result.push_back(_inbox.back());
+		_inbox.pop_back();
+		return 1;
+	}
+
+	std::mutex _mutex;
+	std::condition_variable _condition_variable;
+	std::deque<json_t> _inbox;
+};
+
+struct mpsc_inbox_t {
+	bool push(const json_t& message){
+		return _inbox.push(message);
+	}
+
+	size_t drain(std::deque<json_t>& result){
+		const auto count = _inbox.drain(result);
+		if(count == 0){
+			std::this_thread::yield();
+		}
+		return count;
+	}
+
+	mpsc_queue_t<json_t> _inbox;
+};
+
+struct inbox_bench_t {
+	double _messages_per_second;
+	int64_t _p99_enqueue_ns;
+};
+
+template <typename INBOX> inbox_bench_t measure_inbox(int sender_count, int message_count){
+	INBOX inbox;
+	const json_t message("work");
+	std::vector<std::vector<int64_t>> latencies(sender_count);
+
+	const auto t0 = std::chrono::steady_clock::now();
+
+	std::vector<std::thread> senders;
+	for(int s = 0 ; s < sender_count ; s++){
+		senders.push_back(std::thread([&](int s){
+			auto& latency = latencies[s];
+			latency.reserve(message_count);
+			for(int i = 0 ; i < message_count ; i++){
+				const auto a = std::chrono::steady_clock::now();
+				inbox.push(message);
+				const auto b = std::chrono::steady_clock::now();
+				latency.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(b - a).count());
+			}
+		}, s));
+	}
+
+	int64_t received = 0;
+	std::deque<json_t> batch;
+	while(received < sender_count * message_count){
+		received += inbox.drain(batch);
+		batch.clear();
+	}
+
+	const auto t1 = std::chrono::steady_clock::now();
+	for(auto& t: senders){
+		t.join();
+	}
+
+	std::vector<int64_t> all;
+	for(const auto& e: latencies){
+		all.insert(all.end(), e.begin(), e.end());
+	}
+	const auto p99_it = all.begin() + (all.size() * 99) / 100;
+	std::nth_element(all.begin(), p99_it, all.end());
+
+	const double seconds = std::chrono::duration<double>(t1 - t0).count();
+	return inbox_bench_t{ static_cast<double>(received) / seconds, *p99_it };
+}
+
+static void process_inbox_benchmark(){
+	const int message_count = 250000;
+	const int sender_counts[] = { 1, 4, 8 };
+
+	for(const auto sender_count: sender_counts){
+		const auto before = measure_inbox<mutex_inbox_t>(sender_count, message_count);
+		const auto after = measure_inbox<mpsc_inbox_t>(sender_count, message_count);
+
+		std::cout << "Test: process inbox, " << sender_count << " senders x " << message_count << " messages" << std::endl;
+		std::cout << "\tBefore : " << static_cast<int64_t>(before._messages_per_second) << " msg/s, p99 enqueue " << before._p99_enqueue_ns << " ns" << std::endl;
+		std::cout << "\tAfter  : " << static_cast<int64_t>(after._messages_per_second) << " msg/s, p99 enqueue " << after._p99_enqueue_ns << " ns" << std::endl;
+	}
+}
+
+
+//////////////////////////////////////////		PARSER
+
+
+//	About 20k lines of typical Floyd code: comments, string literals, expressions and nested blocks.
+static std::string make_parser_benchmark_program(){
+	std::string result;
+	for(int i = 0 ; i < 1000 ; i++){
+		const auto n = std::to_string(i);
+		result += R"(
+			/*
+				Function number )" + n + R"(, /* nested */ block comment.
+			*/
+			struct point_)" + n + R"(_t { double x; double y; string label; }
+
+			//	Line comment.
+			func int f_)" + n + R"((int a, string s){
+				mutable sum = a * 3 + (a - 1) / 2;
+				for(i in 0 ..< 10){
+					if(i % 2 == 0 && sum > 10){
+						sum = sum + i;
+					}
+					else{
+						sum = sum - 1;
+					}
+				}
+				let p = point_)" + n + R"(_t(1.0, 2.0, "A \"quoted\" label with some text in it")
+				let v = [ 1, 2, 3, sum, size(s) ]
+				return sum + v[2] + size(p.label);
+			}
+		)";
+	}
+	return result;
+}
+
+static void parser_benchmark(){
+	const auto program = make_parser_benchmark_program();
+	const auto line_count = std::count(program.begin(), program.end(), '\n');
+
+	const auto ns = measure_execution_time_ns(
+		[&] {
+			const auto result = parse_program2(program);
+		},
+		k_repeats
+	);
+	const double seconds = static_cast<double>(ns) / 1000000000.0;
+	std::cout << "Test: parse " << line_count << " lines" << std::endl;
+	std::cout << "\t" << static_cast<int64_t>(ns / 1000000) << " ms, "
+		<< static_cast<int64_t>(static_cast<double>(program.size()) / seconds / 1000000.0) << " MB/s" << std::endl;
+}
+
+//	statement_count global statements. Every 10th defines a small function, the others bind globals that use the
+//	previous global.
+static std::string make_analyser_benchmark_program(int statement_count){
+	std::string result = "let int g_0 = 1\n";
+	for(int i = 1 ; i < statement_count ; i++){
+		const auto n = std::to_string(i);
+		const auto prev = std::to_string(i - 1);
+		if(i % 10 == 0){
+			result += "func int f_" + n + "(int a){ let b = a * 2 + g_" + prev + " return b + 1 }\n";
+			result += "let int g_" + n + " = f_" + n + "(g_" + prev + ")\n";
+		}
+		else{
+			result += "let int g_" + n + " = g_" + prev + " + " + n + " * 3\n";
+		}
+	}
+	return result;
+}
+
+//	Semantic analysis only. Time per statement should stay flat as the program grows.
+static void analyser_benchmark(){
+	for(const auto statement_count: { 10000, 30000, 100000 }){
+		const auto program = make_analyser_benchmark_program(statement_count);
+		const auto ast = json_to_ast(ast_json_t::make(parse_program2(program)._value));
+
+		const auto ns = measure_execution_time_ns(
+			[&] {
+				const auto result = run_semantic_analysis(ast);
+			},
+			1
+		);
+		std::cout << "Test: analyse " << statement_count << " statements" << std::endl;
+		std::cout << "\t" << static_cast<int64_t>(ns / 1000000) << " ms, "
+			<< static_cast<int64_t>(ns / statement_count) << " ns/statement" << std::endl;
+	}
+}
+
+//	Bytecode generation only. Function bodies are generated in parallel, so this should get faster with more cores.
+//	Registers are 16 bits, which limits how many globals the program can have.
+static void bytecode_generator_benchmark(){
+	for(const auto statement_count: { 1000, 3000, 5000 }){
+		const auto program = make_analyser_benchmark_program(statement_count);
+		const auto ast = json_to_ast(ast_json_t::make(parse_program2(program)._value));
+		const auto semantic_ast = run_semantic_analysis(ast);
+
+		const auto ns = measure_execution_time_ns(
+			[&] {
+				const auto result = generate_bytecode(semantic_ast);
+			},
+			1
+		);
+		std::cout << "Test: generate bytecode for " << statement_count << " statements" << std::endl;
+		std::cout << "\t" << static_cast<int64_t>(ns / 1000000) << " ms, "
+			<< static_cast<int64_t>(ns / statement_count) << " ns/statement" << std::endl;
+	}
+}
+
+//////////////////////////////////////////		INLINING
+
+//	The same call-heavy program, generated with inlining off and with the default inline budget.
+
+static int64_t measure_floyd_program_f(const bc_program_t& program, int count){
+	interpreter_t vm(program);
+	const auto f = find_global_symbol2(vm, "f");
+	QUARK_ASSERT(f != nullptr);
+
+	return measure_execution_time_ns(
+		[&] {
+			const auto result = call_function(vm, bc_to_value(f->_value), {});
+		},
+		count
+	);
+}
+
+static void inlining_benchmark(){
+	const std::string floyd_str = R"(
+		func int square(int x){ return x * x }
+		func int clamp(int v, int lo, int hi){ return v < lo ? lo : (v > hi ? hi : v) }
+		func int f(){
+			mutable acc = 0
+			for(i in 0 ..< 1000000){
+				acc = clamp(acc + square(i % 100), 0, 1000000)
+			}
+			return acc
+		}
+	)";
+	const auto ast = compile_to_sematic_ast(floyd_str, "");
+
+	trace_speedup(bench_speedup_t{ "Calls to small pure functions, inlined",
+		measure_floyd_program_f(generate_bytecode(ast, 0), k_repeats),
+		measure_floyd_program_f(generate_bytecode(ast, k_default_inline_budget), k_repeats)
+	});
+}
+
+
 void floyd_benchmark(){
 //OFF_QUARK_UNIT_TEST_VIP("Basic performance", "", "", ""){
 //	interpreter_context_t context = make_benchmark_context();
@@ -261,6 +626,13 @@ void floyd_benchmark(){
 
 	}
 
+	inlining_benchmark();
+	vector_kernel_benchmark();
+	process_inbox_benchmark();
+	parser_benchmark();
+	analyser_benchmark();
+	bytecode_generator_benchmark();
+
 }
 
 
@@ -973,8 +973,7 @@ std::vector<TDirEntry> GetDirItems(const std::string& inDir){
 #ifdef __APPLE__
 		const std::string name(&e.d_name[0], &e.d_name[e.d_namlen]);
 #else
-		const std::string name(&e.d_name[0], &e.d_name[256]);
-
+		const std::string name(&e.d_name[0]);
 #endif
 
 		if(name == "." || name == ".."){
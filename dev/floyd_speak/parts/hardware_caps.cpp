@@ -17,7 +17,9 @@
 
 #include <stdio.h>
 #include <sys/types.h>
+#ifdef __APPLE__
 #include <sys/sysctl.h>
+#endif
 
 using namespace std;
 
@@ -211,6 +213,38 @@ int sched_getaffinity(pid_t pid, size_t cpu_size, cpu_set_t *cpu_set){
 
   return 0;
 }
+
+#else
+
+#include <unistd.h>
+
+namespace floyd {
+
+//	Fallback for platforms without sysctlbyname(). Fields we can't read are 0.
+hardware_info_t read_hardware_info(){
+	const auto thread_count = std::thread::hardware_concurrency();
+	const auto page_size = sysconf(_SC_PAGESIZE);
+	const auto page_count = sysconf(_SC_PHYS_PAGES);
+
+	hardware_info_t result = {};
+	result._processor_packages = 1;
+	result._physical_processor_count = thread_count;
+	result._logical_processor_count = thread_count;
+	result._mem_size = page_size > 0 && page_count > 0 ? static_cast<std::size_t>(page_size) * static_cast<std::size_t>(page_count) : 0;
+	result._page_size = page_size > 0 ? static_cast<std::size_t>(page_size) : 4096;
+	result._cacheline_size = 64;
+	result._scalar_align = alignof(std::max_align_t);
+	return result;
+}
+
+QUARK_UNIT_TEST("","read_hardware_info()", "", ""){
+	const auto a = read_hardware_info();
+	QUARK_UT_VERIFY(a._cacheline_size >= 16);
+	QUARK_UT_VERIFY(a._page_size > 0);
+}
+
+}
+
 #endif
 
 /*
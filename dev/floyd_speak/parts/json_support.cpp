@@ -54,43 +54,32 @@ void ut_verify(const quark::call_context_t& context, const std::pair<json_t, seq
 
 bool json_t::check_invariant() const {
 	if(_type == k_object){
+		QUARK_ASSERT(_object != nullptr);
+		QUARK_ASSERT(_array == nullptr);
 		QUARK_ASSERT(_string.empty());
 		QUARK_ASSERT(_number == 0.0);
-		QUARK_ASSERT(_array.empty());
 	}
 	else if(_type == k_array){
-		QUARK_ASSERT(_object.empty());
-//		QUARK_ASSERT(_array.empty());
+		QUARK_ASSERT(_object == nullptr);
+		QUARK_ASSERT(_array != nullptr);
 		QUARK_ASSERT(_string.empty());
 		QUARK_ASSERT(_number == 0.0);
 	}
 	else if(_type == k_string){
-		QUARK_ASSERT(_object.empty());
-		QUARK_ASSERT(_array.empty());
+		QUARK_ASSERT(_object == nullptr);
+		QUARK_ASSERT(_array == nullptr);
 //		QUARK_ASSERT(_string.empty());
 		QUARK_ASSERT(_number == 0.0);
 	}
 	else if(_type == k_number){
-		QUARK_ASSERT(_object.empty());
-		QUARK_ASSERT(_array.empty());
+		QUARK_ASSERT(_object == nullptr);
+		QUARK_ASSERT(_array == nullptr);
 		QUARK_ASSERT(_string.empty());
 //		QUARK_ASSERT(_number == 0.0);
 	}
-	else if(_type == k_true){
-		QUARK_ASSERT(_object.empty());
-		QUARK_ASSERT(_array.empty());
-		QUARK_ASSERT(_string.empty());
-		QUARK_ASSERT(_number == 0.0);
-	}
-	else if(_type == k_false){
-		QUARK_ASSERT(_object.empty());
-		QUARK_ASSERT(_array.empty());
-		QUARK_ASSERT(_string.empty());
-		QUARK_ASSERT(_number == 0.0);
-	}
-	else if(_type == k_null){
-		QUARK_ASSERT(_object.empty());
-		QUARK_ASSERT(_array.empty());
+	else if(_type == k_true || _type == k_false || _type == k_null){
+		QUARK_ASSERT(_object == nullptr);
+		QUARK_ASSERT(_array == nullptr);
 		QUARK_ASSERT(_string.empty());
 		QUARK_ASSERT(_number == 0.0);
 	}
@@ -101,7 +90,6 @@ bool json_t::check_invariant() const {
 }
 
 json_t::json_t(const json_t& other) :
-	__debug(other.__debug),
 	_type(other._type),
 	_object(other._object),
 	_array(other._array),
@@ -113,6 +101,19 @@ json_t::json_t(const json_t& other) :
 	QUARK_ASSERT(check_invariant());
 }
 
+json_t::json_t(json_t&& other) noexcept :
+	_type(other._type),
+	_object(std::move(other._object)),
+	_array(std::move(other._array)),
+	_string(std::move(other._string)),
+	_number(other._number)
+{
+	//	Leave other as a valid null.
+	other._type = k_null;
+	other._string.clear();
+	other._number = 0.0;
+}
+
 json_t& json_t::operator=(const json_t& other){
 	QUARK_ASSERT(check_invariant());
 	QUARK_ASSERT(other.check_invariant());
@@ -125,11 +126,15 @@ json_t& json_t::operator=(const json_t& other){
 	return *this;
 }
 
+json_t& json_t::operator=(json_t&& other) noexcept {
+	swap(other);
+	return *this;
+}
+
 void json_t::swap(json_t& other){
 	QUARK_ASSERT(check_invariant());
 	QUARK_ASSERT(other.check_invariant());
 
-	std::swap(__debug, other.__debug);
 	std::swap(_type, other._type);
 	_object.swap(other._object);
 	_array.swap(other._array);
@@ -144,7 +149,18 @@ bool json_t::operator==(const json_t& other) const{
 	QUARK_ASSERT(check_invariant());
 	QUARK_ASSERT(other.check_invariant());
 
-	return _type == other._type && _object == other._object && _array == other._array && _string == other._string && _number == other._number;
+	if(_type != other._type){
+		return false;
+	}
+	else if(_type == k_object){
+		return _object == other._object || *_object == *other._object;
+	}
+	else if(_type == k_array){
+		return _array == other._array || *_array == *other._array;
+	}
+	else{
+		return _string == other._string && _number == other._number;
+	}
 }
 
 
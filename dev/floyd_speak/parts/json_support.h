@@ -20,6 +20,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
 #include "quark.h"
 
 struct seq_t;
@@ -57,17 +58,15 @@ struct json_t {
 
 	public: json_t(const std::map<std::string, json_t>& object) :
 		_type(k_object),
-		_object(object)
+		_object(std::make_shared<const std::map<std::string, json_t>>(object))
 	{
-		__debug = json_to_compact_string(*this);
 		QUARK_ASSERT(check_invariant());
 	}
 
 	public: json_t(const std::vector<json_t>& array) :
 		_type(k_array),
-		_array(array)
+		_array(std::make_shared<const std::vector<json_t>>(array))
 	{
-		__debug = json_to_compact_string(*this);
 		QUARK_ASSERT(check_invariant());
 	}
 
@@ -75,7 +74,6 @@ struct json_t {
 		_type(k_string),
 		_string(s)
 	{
-		__debug = json_to_compact_string(*this);
 		QUARK_ASSERT(check_invariant());
 	}
 
@@ -84,7 +82,6 @@ struct json_t {
 		_string(std::string(s))
 	{
 		QUARK_ASSERT(s != nullptr);
-		__debug = json_to_compact_string(*this);
 		QUARK_ASSERT(check_invariant());
 	}
 
@@ -92,7 +89,6 @@ struct json_t {
 		_type(k_number),
 		_number(number)
 	{
-		__debug = json_to_compact_string(*this);
 		QUARK_ASSERT(check_invariant());
 	}
 
@@ -100,34 +96,32 @@ struct json_t {
 		_type(k_number),
 		_number((double)number)
 	{
-		__debug = json_to_compact_string(*this);
 		QUARK_ASSERT(check_invariant());
 	}
 	public: json_t(int64_t number) :
 		_type(k_number),
 		_number((double)number)
 	{
-		__debug = json_to_compact_string(*this);
 		QUARK_ASSERT(check_invariant());
 	}
 
 	public: json_t(bool value) :
 		_type(value ? k_true : k_false)
 	{
-		__debug = json_to_compact_string(*this);
 		QUARK_ASSERT(check_invariant());
 	}
 
 	public: json_t() :
 		_type(k_null)
 	{
-		__debug = json_to_compact_string(*this);
 		QUARK_ASSERT(check_invariant());
 	}
 
 	bool check_invariant() const;
 	public: json_t(const json_t& other);
+	public: json_t(json_t&& other) noexcept;
 	public: json_t& operator=(const json_t& other);
+	public: json_t& operator=(json_t&& other) noexcept;
 	public: void swap(json_t& other);
 
 	//	Deep equality compare.
@@ -168,7 +162,7 @@ struct json_t {
 		if(!is_object()){
 			quark::throw_runtime_error("Wrong type of JSON value");
 		}
-		return _object;
+		return *_object;
 	}
 
 	/*
@@ -181,7 +175,7 @@ struct json_t {
 		if(!is_object()){
 			quark::throw_runtime_error("Wrong type of JSON value");
 		}
-		return _object.at(key);
+		return _object->at(key);
 	}
 
 	/*
@@ -208,7 +202,7 @@ struct json_t {
 		if(!is_object()){
 			quark::throw_runtime_error("Wrong type of JSON value");
 		}
-		return _object.find(key) != _object.end();
+		return _object->find(key) != _object->end();
 	}
 
 	size_t get_object_size() const {
@@ -217,7 +211,7 @@ struct json_t {
 		if(!is_object()){
 			quark::throw_runtime_error("Wrong type of JSON value");
 		}
-		return _object.size();
+		return _object->size();
 	}
 
 
@@ -236,7 +230,7 @@ struct json_t {
 		if(!is_array()){
 			quark::throw_runtime_error("Wrong type of JSON value");
 		}
-		return _array;
+		return *_array;
 	}
 
 	const json_t& get_array_n(size_t index) const {
@@ -246,8 +240,8 @@ struct json_t {
 		if(!is_array()){
 			quark::throw_runtime_error("Wrong type of JSON value");
 		}
-		QUARK_ASSERT(index < _array.size());
-		return _array[index];
+		QUARK_ASSERT(index < _array->size());
+		return (*_array)[index];
 	}
 
 	size_t get_array_size() const {
@@ -256,7 +250,7 @@ struct json_t {
 		if(!is_array()){
 			quark::throw_runtime_error("Wrong type of JSON value");
 		}
-		return _array.size();
+		return _array->size();
 	}
 
 	bool is_string() const {
@@ -309,12 +303,11 @@ struct json_t {
 
 
 	/////////////////////////////////////		STATE
-	//	??? Make this fast to copy = move map/ vector into shared_ptr.
 	//	??? Should use std::variant.
-	private: std::string __debug;
+	//	Objects and arrays are immutable and shared between copies, copying a json_t never copies a tree.
 	private: etype _type = k_null;
-	private: std::map<std::string, json_t> _object;
-	private: std::vector<json_t> _array;
+	private: std::shared_ptr<const std::map<std::string, json_t>> _object;
+	private: std::shared_ptr<const std::vector<json_t>> _array;
 	private: std::string _string;
 	private: double _number = 0.0;
 };
@@ -0,0 +1,78 @@
+//
+//  mpsc_queue.cpp
+//  floyd_speak
+//
+//  Created by Marcus Zetterquist on 2018-11-05.
+//  Copyright © 2018 Marcus Zetterquist. All rights reserved.
+//
+
+#include "mpsc_queue.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+
+QUARK_UNIT_TEST("mpsc_queue_t", "drain()", "empty queue", "nothing"){
+	mpsc_queue_t<int> queue;
+	std::deque<int> result;
+	QUARK_UT_VERIFY(queue.empty());
+	QUARK_UT_VERIFY(queue.drain(result) == 0);
+	QUARK_UT_VERIFY(result.empty());
+}
+
+QUARK_UNIT_TEST("mpsc_queue_t", "push()", "3 elements", "drained in push order"){
+	mpsc_queue_t<std::string> queue;
+	QUARK_UT_VERIFY(queue.push("a") == true);
+	QUARK_UT_VERIFY(queue.push("b") == false);
+	QUARK_UT_VERIFY(queue.push("c") == false);
+	QUARK_UT_VERIFY(queue.empty() == false);
+
+	std::deque<std::string> result = { "x" };
+	QUARK_UT_VERIFY(queue.drain(result) == 3);
+	QUARK_UT_VERIFY((result == std::deque<std::string>{ "x", "a", "b", "c" }));
+	QUARK_UT_VERIFY(queue.empty());
+
+	QUARK_UT_VERIFY(queue.push("d") == true);
+}
+
+QUARK_UNIT_TEST("mpsc_queue_t", "~mpsc_queue_t()", "undrained elements", "no leak"){
+	mpsc_queue_t<std::string> queue;
+	queue.push("a");
+	queue.push("b");
+}
+
+QUARK_UNIT_TEST("mpsc_queue_t", "push()", "4 producers", "every element once, per-producer order kept"){
+	const int producer_count = 4;
+	const int count = 20000;
+	mpsc_queue_t<int> queue;
+
+	std::vector<std::thread> producers;
+	for(int p = 0 ; p < producer_count ; p++){
+		producers.push_back(std::thread([&](int p){
+			for(int i = 0 ; i < count ; i++){
+				queue.push(p * count + i);
+			}
+		}, p));
+	}
+
+	std::vector<int> next(producer_count, 0);
+	int received = 0;
+	std::deque<int> batch;
+	while(received < producer_count * count){
+		queue.drain(batch);
+		while(batch.empty() == false){
+			const auto v = batch.front();
+			batch.pop_front();
+			const auto p = v / count;
+			QUARK_UT_VERIFY(v % count == next[p]);
+			next[p]++;
+			received++;
+		}
+	}
+
+	for(auto& t: producers){
+		t.join();
+	}
+	QUARK_UT_VERIFY(queue.empty());
+}
@@ -0,0 +1,96 @@
+//
+//  mpsc_queue.h
+//  floyd_speak
+//
+//  Created by Marcus Zetterquist on 2018-11-05.
+//  Copyright © 2018 Marcus Zetterquist. All rights reserved.
+//
+
+#ifndef mpsc_queue_h
+#define mpsc_queue_h
+
+/*
+	Lock-free multi-producer, single-consumer queue.
+
+	Any number of threads can push() at the same time. Only ONE thread at a time may drain(). Producers never
+	wait for each other or for the consumer.
+
+	push() prepends a node to a singly linked list using compare-and-swap. drain() takes the entire list
+	with one atomic exchange and reverses it, so the consumer gets a batch of elements in the order they were pushed.
+	Since the consumer never removes single nodes there is no ABA problem.
+
+	There is no blocking in here: the caller decides how an idle consumer is parked and woken up, using the return
+	value of push().
+*/
+
+#include <atomic>
+#include <deque>
+
+#include "quark.h"
+
+
+template <typename T> struct mpsc_queue_t {
+	public: mpsc_queue_t() = default;
+
+	public: ~mpsc_queue_t(){
+		auto node = _head.load(std::memory_order_acquire);
+		while(node != nullptr){
+			const auto next = node->_next;
+			delete node;
+			node = next;
+		}
+	}
+
+	mpsc_queue_t(const mpsc_queue_t& other) = delete;
+	mpsc_queue_t& operator=(const mpsc_queue_t& other) = delete;
+
+
+	//	Any thread. Returns true if the queue was empty before, that is, this element starts a new batch.
+	public: bool push(const T& value){
+		auto node = new node_t{ value, _head.load(std::memory_order_relaxed) };
+		while(_head.compare_exchange_weak(node->_next, node, std::memory_order_release, std::memory_order_relaxed) == false){
+		}
+		return node->_next == nullptr;
+	}
+
+	//	Consumer only. Appends all elements to the back of result, oldest first. Returns number of elements appended.
+	public: size_t drain(std::deque<T>& result){
+		auto node = _head.exchange(nullptr, std::memory_order_acquire);
+
+		//	Reverse the list: it has the newest element first.
+		node_t* oldest = nullptr;
+		while(node != nullptr){
+			const auto next = node->_next;
+			node->_next = oldest;
+			oldest = node;
+			node = next;
+		}
+
+		size_t count = 0;
+		while(oldest != nullptr){
+			const auto next = oldest->_next;
+			result.push_back(std::move(oldest->_value));
+			delete oldest;
+			oldest = next;
+			count++;
+		}
+		return count;
+	}
+
+	//	Any thread. The answer can be out of date as soon as it is returned, unless you are the only producer.
+	public: bool empty() const {
+		return _head.load(std::memory_order_acquire) == nullptr;
+	}
+
+
+	////////////////////////		STATE
+	private: struct node_t {
+		T _value;
+		node_t* _next;
+	};
+
+	//	Newest element.
+	private: std::atomic<node_t*> _head { nullptr };
+};
+
+#endif /* mpsc_queue_h */
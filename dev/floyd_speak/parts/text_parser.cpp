@@ -227,27 +227,16 @@ QUARK_UNIT_TESTQ("double_to_string_always_decimals()", ""){
 ///////////////////////////////		seq_t
 
 
-std::string make_debug_str(const std::string& internal_string, size_t pos){
-	const auto pre_count = std::min(pos, (size_t)30);
-
-	const auto pre_str = internal_string.substr(pos - pre_count, pre_count);
-	const auto post_str = internal_string.substr(pos, 100);
-	return pre_str + "•••" + post_str;
-}
-
 seq_t::seq_t(const std::string& s) :
 	_str(make_shared<string>(s)),
 	_pos(0)
 {
-	FIRST_debug = make_debug_str(*_str, _pos);
-
 	QUARK_ASSERT(check_invariant());
 }
 
 seq_t::seq_t(const seq_t& s) :
 	_str(s._str),
-	_pos(s._pos),
-	FIRST_debug(s.FIRST_debug)
+	_pos(s._pos)
 {
 	QUARK_ASSERT(check_invariant());
 }
@@ -258,10 +247,15 @@ seq_t& seq_t::operator=(const seq_t& other){
 	return *this;
 }
 
+//	Swapping keeps other valid and avoids touching the reference count, pos = pos.rest1() is the parser's inner loop.
+seq_t& seq_t::operator=(seq_t&& other) noexcept {
+	swap(other);
+	return *this;
+}
+
 void seq_t::swap(seq_t& other) throw(){
 	this->_str.swap(other._str);
 	std::swap(this->_pos, other._pos);
-	std::swap(this->FIRST_debug, other.FIRST_debug);
 }
 
 
@@ -272,8 +266,6 @@ seq_t::seq_t(const std::shared_ptr<const std::string>& str, std::size_t pos) :
 	QUARK_ASSERT(str);
 	QUARK_ASSERT(pos <= str->size());
 
-	FIRST_debug = make_debug_str(*_str, _pos);
-
 	QUARK_ASSERT(check_invariant());
 }
 
@@ -281,7 +273,10 @@ bool seq_t::operator==(const seq_t& other) const {
 	QUARK_ASSERT(check_invariant());
 	QUARK_ASSERT(other.check_invariant());
 
-	return first(1) == other.first(1) && get_s() == other.get_s();
+	if(_str == other._str && _pos == other._pos){
+		return true;
+	}
+	return str_view() == other.str_view();
 }
 
 bool seq_t::check_invariant() const {
@@ -311,6 +306,12 @@ std::string seq_t::first(size_t chars) const{
 	return _pos < _str->size() ? _str->substr(_pos, chars) : string();
 }
 
+std::string_view seq_t::first_view(size_t chars) const{
+	QUARK_ASSERT(check_invariant());
+
+	return str_view().substr(0, chars);
+}
+
 seq_t seq_t::rest1() const{
 	QUARK_ASSERT(check_invariant());
 
@@ -337,6 +338,12 @@ std::string seq_t::str() const{
 	return _str->substr(_pos);
 }
 
+std::string_view seq_t::str_view() const{
+	QUARK_ASSERT(check_invariant());
+
+	return std::string_view(*_str).substr(_pos);
+}
+
 std::size_t seq_t::size() const{
 	QUARK_ASSERT(check_invariant());
 
@@ -368,6 +375,15 @@ const char* seq_t::c_str() const{
 	return empty() ? nullptr : _str->c_str() + _pos;
 }
 
+std::string seq_t::debug_str() const{
+	QUARK_ASSERT(check_invariant());
+
+	const auto pre_count = std::min(_pos, (size_t)30);
+	const auto pre_str = _str->substr(_pos - pre_count, pre_count);
+	const auto post_str = _str->substr(_pos, 100);
+	return pre_str + "•••" + post_str;
+}
+
 
 QUARK_UNIT_TESTQ("seq_t()", ""){
 	seq_t("");
@@ -413,6 +429,24 @@ QUARK_UNIT_TESTQ("first(n)", ""){
 }
 
 
+QUARK_UNIT_TESTQ("first_view()", ""){
+	QUARK_TEST_VERIFY(seq_t("abc").rest1().first_view(5) == "bc");
+}
+QUARK_UNIT_TESTQ("first_view()", ""){
+	QUARK_TEST_VERIFY(seq_t("").first_view(1) == "");
+}
+
+
+QUARK_UNIT_TESTQ("operator==()", "Different strings, same characters left"){
+	QUARK_TEST_VERIFY(seq_t("xabc").rest1() == seq_t("abc"));
+}
+QUARK_UNIT_TESTQ("operator==()", ""){
+	const auto a = seq_t("abab");
+	QUARK_TEST_VERIFY(a.rest(2) == a.rest(2));
+	QUARK_TEST_VERIFY(a.rest(1) != a.rest(2));
+}
+
+
 QUARK_UNIT_TESTQ("rest()", ""){
 	QUARK_TEST_VERIFY(seq_t("abc").rest1().first1() == "b");
 }
@@ -433,24 +467,15 @@ QUARK_UNIT_TESTQ("rest(n)", ""){
 
 
 seq_t skip(const seq_t& s, const std::string& chars){
-	auto pos = s;
-	while(!pos.empty() && chars.find(pos.first1_char()) != string::npos){
-		pos = pos.rest1();
-	}
-	return pos;
+	const auto v = s.str_view();
+	return s.rest(std::min(v.find_first_not_of(chars), v.size()));
 }
 
 
 pair<string, seq_t> read_while(const seq_t& p1, const string& chars){
-	string a;
-	seq_t p2 = p1;
-
-	while(!p2.empty() && chars.find(p2.first1_char()) != string::npos){
-		a = a + p2.first1_char();
-		p2 = p2.rest1();
-	}
-
-	return { a, p2 };
+	const auto s = p1.str_view();
+	const auto count = std::min(s.find_first_not_of(chars), s.size());
+	return { string(s.substr(0, count)), p1.rest(count) };
 }
 
 QUARK_UNIT_TEST("", "read_while()", "", ""){
@@ -475,15 +500,9 @@ QUARK_UNIT_TEST("", "read_while()", "", ""){
 
 
 pair<string, seq_t> read_until(const seq_t& p1, const string& chars){
-	string a;
-	seq_t p2 = p1;
-
-	while(!p2.empty() && chars.find(p2.first1_char()) == string::npos){
-		a = a + p2.first1_char();
-		p2 = p2.rest1();
-	}
-
-	return { a, p2 };
+	const auto s = p1.str_view();
+	const auto count = std::min(s.find_first_of(chars), s.size());
+	return { string(s.substr(0, count)), p1.rest(count) };
 }
 
 pair<string, seq_t> split_at(const seq_t& p1, const string& str){
@@ -507,7 +526,7 @@ QUARK_UNIT_TEST("", "split_at()", "", ""){
 
 std::pair<bool, seq_t> if_first(const seq_t& p, const std::string& wanted_string){
 	const auto size = wanted_string.size();
-	if(p.first(size) == wanted_string){
+	if(p.first_view(size) == wanted_string){
 		return { true, p.rest(size) };
 	}
 	else{
@@ -529,14 +548,15 @@ bool is_first(const seq_t& p, const std::string& wanted_string){
 
 std::string get_range(const seq_t& a, const seq_t& b){
 	QUARK_ASSERT(seq_t::related(a, b));
+	QUARK_ASSERT(a.pos() <= b.pos());
 
-	std::string result;
-	auto t = a;
-	while(t != b){
-		result.append(t.first1());
-		t = t.rest1();
-	}
-	return result;
+	return string(a.first_view(b.pos() - a.pos()));
+}
+
+QUARK_UNIT_TESTQ("get_range()", ""){
+	const auto a = seq_t("hello, world!");
+	QUARK_TEST_VERIFY(get_range(a.rest(7), a.rest(12)) == "world");
+	QUARK_TEST_VERIFY(get_range(a, a) == "");
 }
 
 
@@ -555,8 +575,7 @@ seq_t read_required_char(const seq_t& s, char ch){
 
 seq_t read_required(const seq_t& s, const std::string& req){
 	const auto count = req.size();
-	const auto peek = s.first(count);
-	if(peek != req){
+	if(s.first_view(count) != req){
 		quark::throw_runtime_error("Expected '" + req  + "' character.");
 	}
 	return s.rest(count);
@@ -593,7 +612,6 @@ std::pair<std::string, seq_t> read_balanced2(const seq_t& s, const std::string&
 	const auto closing_index = open_close.first.find(s.first1_char());
 	QUARK_ASSERT(closing_index != string::npos);
 
-	string result = s.first1();
 	auto pos = s.rest1();
 	while(pos.empty() == false && open_close.second.find(pos.first1_char()) != closing_index){
 		const auto ch = pos.first1_char();
@@ -610,12 +628,10 @@ std::pair<std::string, seq_t> read_balanced2(const seq_t& s, const std::string&
 				return {"", s};
 			}
 			else{
-				result = result + r2.first;
 				pos = r2.second;
 			}
 		}
 		else {
-			result = result + pos.first1();
 			pos = pos.rest1();
 		}
 	}
@@ -623,7 +639,8 @@ std::pair<std::string, seq_t> read_balanced2(const seq_t& s, const std::string&
 		return { "", s };
 	}
 	else{
-		return { result + pos.first1(), pos.rest1() };
+		const auto end = pos.rest1();
+		return { get_range(s, end), end };
 	}
 }
 
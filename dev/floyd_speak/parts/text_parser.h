@@ -14,6 +14,7 @@
 	Check out seq_t.
 */
 #include <string>
+#include <string_view>
 #include <memory>
 #include <vector>
 #include <cmath>
@@ -78,6 +79,9 @@ std::string double_to_string_always_decimals(double value);
 
 	This is a magic string were you can easily peek into the beginning and
 	also get a new string without the first character(s).
+
+	A seq_t is only a shared pointer and an offset: stepping and peeking never allocates. Use first_view() / str_view()
+	to look at the characters without copying them and get_range() to copy out a token in one go.
 */
 
 struct seq_t {
@@ -103,6 +107,9 @@ struct seq_t {
 	//	Won't throw.
 	public: std::string first(size_t chars) const;
 
+	//	Same as first(chars) but points into the internal string. Valid as long as any seq_t of this string lives.
+	public: std::string_view first_view(size_t chars) const;
+
 	//	Skips n characters.
 	//	Limited to rest_size().
 	public: seq_t rest(size_t count) const;
@@ -114,6 +121,7 @@ struct seq_t {
 	//	Notice: these returns what's left to consume of the original string, not the full original string.
 	public: std::string get_s() const { return str(); }
 	public: std::string str() const;
+	public: std::string_view str_view() const;
 	public: std::size_t size() const;
 	public: std::size_t pos() const;
 
@@ -125,6 +133,7 @@ struct seq_t {
 
 	private: seq_t(const std::shared_ptr<const std::string>& str, std::size_t pos);
 	public: seq_t& operator=(const seq_t& other);
+	public: seq_t& operator=(seq_t&& other) noexcept;
 	public: void swap(seq_t& other) throw();
 
 	public: bool operator==(const seq_t& other) const;
@@ -133,9 +142,11 @@ struct seq_t {
 	//	Returns pointer to entire string *following* the current pos. Never characters *before* current read pos.
 	const char* c_str() const;
 
+	//	Some characters before and after the read position, for looking at in the debugger or printing.
+	public: std::string debug_str() const;
+
 
 	/////////////		STATE
-	private: std::string FIRST_debug;
 	private: std::shared_ptr<const std::string> _str;
 	private: std::size_t _pos;
 };
@@ -153,6 +164,7 @@ std::pair<bool, seq_t> if_first(const seq_t& p, const std::string& wanted_string
 bool is_first(const seq_t& p, const std::string& wanted_string);
 
 
+//	Returns the characters from a up to b. b must be a or a position after a, in the same string.
 std::string get_range(const seq_t& a, const seq_t& b);
 
 std::pair<char, seq_t> read_char(const seq_t& s);
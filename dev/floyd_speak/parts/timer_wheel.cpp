@@ -0,0 +1,95 @@
+//
+//  timer_wheel.cpp
+//  floyd_speak
+//
+//  Created by Marcus Zetterquist on 2018-11-14.
+//  Copyright © 2018 Marcus Zetterquist. All rights reserved.
+//
+
+#include "timer_wheel.h"
+
+#include <random>
+#include <string>
+
+
+QUARK_UNIT_TEST("timer_wheel_t", "advance()", "no timers", "nothing, clock moves"){
+	timer_wheel_t<int> wheel(1000);
+	std::vector<int> result;
+	QUARK_UT_VERIFY(wheel.get_next_due() == timer_wheel_t<int>::k_no_timer);
+	QUARK_UT_VERIFY(wheel.advance(5000, result) == 0);
+	QUARK_UT_VERIFY(wheel.get_current() == 5000);
+}
+
+QUARK_UNIT_TEST("timer_wheel_t", "advance()", "3 timers", "fire in due-order, not before"){
+	timer_wheel_t<std::string> wheel(0);
+	wheel.add(300, "c");
+	wheel.add(10, "a");
+	wheel.add(70000, "d");
+	wheel.add(255, "b");
+	QUARK_UT_VERIFY(wheel.size() == 4);
+	QUARK_UT_VERIFY(wheel.get_next_due() == 10);
+
+	std::vector<std::string> result;
+	QUARK_UT_VERIFY(wheel.advance(9, result) == 0);
+	QUARK_UT_VERIFY(wheel.advance(10, result) == 1);
+	QUARK_UT_VERIFY(wheel.get_next_due() == 255);
+	wheel.advance(69999, result);
+	QUARK_UT_VERIFY((result == std::vector<std::string>{ "a", "b", "c" }));
+	QUARK_UT_VERIFY(wheel.get_next_due() == 70000);
+	wheel.advance(70000, result);
+	QUARK_UT_VERIFY((result == std::vector<std::string>{ "a", "b", "c", "d" }));
+	QUARK_UT_VERIFY(wheel.size() == 0);
+}
+
+QUARK_UNIT_TEST("timer_wheel_t", "add()", "due in the past", "fires on next advance()"){
+	timer_wheel_t<int> wheel(500);
+	wheel.add(400, 1);
+	wheel.add(500, 2);
+	QUARK_UT_VERIFY(wheel.get_next_due() == 500);
+
+	std::vector<int> result;
+	QUARK_UT_VERIFY(wheel.advance(500, result) == 2);
+}
+
+QUARK_UNIT_TEST("timer_wheel_t", "add()", "more than 2^32 ms away", "overflow list"){
+	const int64_t far = (int64_t(1) << 33) + 17;
+	timer_wheel_t<int> wheel(3);
+	wheel.add(far, 1);
+	QUARK_UT_VERIFY(wheel.get_next_due() == far);
+
+	std::vector<int> result;
+	wheel.advance(far - 1, result);
+	QUARK_UT_VERIFY(result.empty());
+	wheel.advance(far, result);
+	QUARK_UT_VERIFY(result.size() == 1);
+}
+
+QUARK_UNIT_TEST("timer_wheel_t", "advance()", "20000 random timers, advanced in random steps", "each fires once, exactly on time"){
+	std::mt19937 random(1234);
+	const int64_t start = 123456;
+	timer_wheel_t<int64_t> wheel(start);
+	for(int i = 0 ; i < 20000 ; i++){
+		const int64_t due = start + 1 + random() % 300000;
+		wheel.add(due, due);
+	}
+
+	std::vector<int64_t> result;
+	int64_t now = start;
+	int64_t fired = 0;
+	while(wheel.size() > 0){
+		const auto next_due = wheel.get_next_due();
+		QUARK_UT_VERIFY(next_due > now);
+
+		//	Land exactly on next_due sometimes, jump past it sometimes.
+		const auto prev = now;
+		now = (random() % 2) ? next_due : now + 1 + random() % 2000;
+		result.clear();
+		wheel.advance(now, result);
+		for(const auto due: result){
+			QUARK_UT_VERIFY(due > prev && due <= now && due >= next_due);
+		}
+		QUARK_UT_VERIFY(now < next_due || result.empty() == false);
+		fired += result.size();
+	}
+	QUARK_UT_VERIFY(fired == 20000);
+}
@@ -0,0 +1,211 @@
+//
+//  timer_wheel.h
+//  floyd_speak
+//
+//  Created by Marcus Zetterquist on 2018-11-14.
+//  Copyright © 2018 Marcus Zetterquist. All rights reserved.
+//
+
+#ifndef timer_wheel_h
+#define timer_wheel_h
+
+/*
+	Hierarchical timer wheel with 1 ms ticks. Holds any number of pending timers, add() is O(1) and advancing
+	the clock is amortized O(1) per tick and per timer, no matter how many timers are pending.
+
+	There are 4 levels of 256 slots each. A timer goes into the lowest level where its due time and the current
+	time only differ in that level's 8 bits: level 0 holds timers due within the current 256 ms block, level 1
+	timers due in a later 256 ms block of the current 65536 ms block and so on. When the clock enters a new block,
+	the timers of that block's slot are moved down one or more levels. Timers more than 2^32 ms (49 days) away wait
+	in an overflow list.
+
+	This means all timers in level 0 are due before all timers in level 1, which are due before level 2 etc.
+	get_next_due() only needs to find the first non-empty slot.
+
+	Not thread safe. Times are milliseconds on any monotonic clock, the caller decides which.
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "quark.h"
+
+
+template <typename T> struct timer_wheel_t {
+	public: static constexpr int64_t k_no_timer = std::numeric_limits<int64_t>::max();
+
+	public: explicit timer_wheel_t(int64_t now_ms) :
+		_current(now_ms)
+	{
+	}
+
+
+	//	Timers due now or in the past fire on the next advance().
+	public: void add(int64_t due_ms, const T& value){
+		//	The slot for _current has already fired.
+		if(due_ms <= _current){
+			_overdue.push_back(entry_t{ due_ms, value });
+		}
+		else{
+			insert(entry_t{ due_ms, value });
+		}
+		_count++;
+	}
+
+	//	Moves the clock forward to now_ms. Appends the values of all timers that are due, in due-order, to result.
+	//	Returns number of values appended.
+	public: size_t advance(int64_t now_ms, std::vector<T>& result){
+		const auto size0 = result.size();
+
+		for(const auto& e: _overdue){
+			result.push_back(e._value);
+		}
+		_count -= _overdue.size();
+		_overdue.clear();
+
+		while(_current < now_ms){
+			if(_count == 0){
+				_current = now_ms;
+				break;
+			}
+
+			//	Jump over ticks where nothing can happen: to the last tick before the next block of the lowest
+			//	non-empty level.
+			int empty_levels = 0;
+			while(empty_levels < k_level_count && _level_counts[empty_levels] == 0){
+				empty_levels++;
+			}
+			if(empty_levels > 0){
+				const int64_t mask = (int64_t(1) << (k_bits * empty_levels)) - 1;
+				const auto last = _current | mask;
+				if(last > _current){
+					_current = std::min(last, now_ms);
+					if(_current == now_ms){
+						break;
+					}
+				}
+			}
+
+			_current++;
+
+			//	Entered a new block? Move its timers down, highest level first.
+			if((_current & k_top_mask) == 0){
+				auto overflow = std::move(_overflow);
+				_overflow.clear();
+				for(const auto& e: overflow){
+					insert(e);
+				}
+			}
+			for(int level = k_level_count - 1 ; level > 0 ; level--){
+				if((_current & ((int64_t(1) << (k_bits * level)) - 1)) == 0){
+					cascade(level, get_slot_index(_current, level));
+				}
+			}
+
+			auto& slot = _slots[0][get_slot_index(_current, 0)];
+			for(const auto& e: slot){
+				QUARK_ASSERT(e._due == _current);
+				result.push_back(e._value);
+			}
+			_level_counts[0] -= slot.size();
+			_count -= slot.size();
+			slot.clear();
+		}
+
+		return result.size() - size0;
+	}
+
+	//	Returns k_no_timer if there are no pending timers.
+	public: int64_t get_next_due() const {
+		if(_overdue.empty() == false){
+			return _current;
+		}
+		for(int level = 0 ; level < k_level_count ; level++){
+			if(_level_counts[level] > 0){
+				//	Level 0 slot at _current was already fired. At higher levels it holds no timers.
+				for(int index = get_slot_index(_current, level) + (level == 0 ? 1 : 0) ; index < k_slot_count ; index++){
+					const auto& slot = _slots[level][index];
+					if(slot.empty() == false){
+						auto due = k_no_timer;
+						for(const auto& e: slot){
+							due = std::min(due, e._due);
+						}
+						return due;
+					}
+				}
+				QUARK_ASSERT(false);
+			}
+		}
+		auto due = k_no_timer;
+		for(const auto& e: _overflow){
+			due = std::min(due, e._due);
+		}
+		return due;
+	}
+
+	public: size_t size() const {
+		return _count;
+	}
+
+	public: int64_t get_current() const {
+		return _current;
+	}
+
+
+	////////////////////////		INTERNALS
+
+	private: struct entry_t {
+		int64_t _due;
+		T _value;
+	};
+
+	private: static constexpr int k_bits = 8;
+	private: static constexpr int k_slot_count = 1 << k_bits;
+	private: static constexpr int k_level_count = 4;
+	private: static constexpr int64_t k_top_mask = (int64_t(1) << (k_bits * k_level_count)) - 1;
+
+	private: static int get_slot_index(int64_t time, int level){
+		return static_cast<int>((time >> (k_bits * level)) & (k_slot_count - 1));
+	}
+
+	//	Cascaded timers can be due at _current, their level 0 slot is fired right after the cascade.
+	private: void insert(const entry_t& e){
+		QUARK_ASSERT(e._due >= _current);
+
+		//	Highest bit where due and current differ decides the level.
+		const auto diff = e._due ^ _current;
+		if((diff & ~k_top_mask) != 0){
+			_overflow.push_back(e);
+			return;
+		}
+		int level = 0;
+		while((diff >> (k_bits * (level + 1))) != 0){
+			level++;
+		}
+		_slots[level][get_slot_index(e._due, level)].push_back(e);
+		_level_counts[level]++;
+	}
+
+	private: void cascade(int level, int index){
+		auto entries = std::move(_slots[level][index]);
+		_slots[level][index].clear();
+		_level_counts[level] -= entries.size();
+		for(const auto& e: entries){
+			insert(e);
+		}
+	}
+
+
+	////////////////////////		STATE
+
+	private: int64_t _current;
+	private: size_t _count = 0;
+	private: std::vector<entry_t> _slots[k_level_count][k_slot_count];
+	private: size_t _level_counts[k_level_count] = {};
+	private: std::vector<entry_t> _overflow;
+	private: std::vector<entry_t> _overdue;
+};
+
+#endif /* timer_wheel_h */
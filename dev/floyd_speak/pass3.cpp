@@ -17,6 +17,8 @@
 #include "host_functions.h"
 #include "text_parser.h"
 
+#include <unordered_map>
+
 namespace floyd {
 
 using namespace std;
@@ -58,22 +60,23 @@ struct analyzer_imm_t {
 //////////////////////////////////////		analyser_t
 
 /*
-	Value object (MUTABLE!) that represents one step of the semantic analysis. It is passed around.
+	The state of the semantic analysis. There is one analyser_t per analysis, it is passed by reference and mutated
+	in place: entering a lexical scope pushes a lexical_scope_t, leaving it pops it again.
 */
 
 struct lexical_scope_t {
 	symbol_table_t symbols;
 	epure pure;
+
+	//	Index of each name in symbols. If a name appears several times, this is the first one.
+	std::unordered_map<std::string, int> symbol_indexes;
 };
 
 struct analyser_t {
 	public: analyser_t(const ast_t& ast);
-	public: analyser_t(const analyser_t& other);
-	public: const analyser_t& operator=(const analyser_t& other);
 #if DEBUG
 	public: bool check_invariant() const;
 #endif
-	public: void swap(analyser_t& other) throw();
 
 
 
@@ -97,8 +100,8 @@ struct analyser_t {
 //////////////////////////////////////		forward
 
 
-std::pair<analyser_t, shared_ptr<statement_t>> analyse_statement(const analyser_t& a, const statement_t& statement, const typeid_t& return_type);
-floyd::semantic_ast_t analyse(const analyser_t& a);
+shared_ptr<statement_t> analyse_statement(analyser_t& a, const statement_t& statement, const typeid_t& return_type);
+floyd::semantic_ast_t analyse(analyser_t& a, const semantic_prelude_t& prelude);
 typeid_t resolve_type(const analyser_t& a, const location_t& loc, const typeid_t& type);
 
 /*
@@ -106,7 +109,7 @@ typeid_t resolve_type(const analyser_t& a, const location_t& loc, const typeid_t
 		null = statements were all executed through.
 		value = return statement returned a value.
 */
-std::pair<analyser_t, std::vector<std::shared_ptr<floyd::statement_t>> > analyse_statements(const analyser_t& a, const std::vector<std::shared_ptr<floyd::statement_t>>& statements, const typeid_t& return_type);
+std::vector<statement_t> analyse_statements(analyser_t& a, const std::vector<statement_t>& statements, const typeid_t& return_type);
 
 
 
@@ -115,8 +118,8 @@ std::pair<analyser_t, std::vector<std::shared_ptr<floyd::statement_t>> > analyse
 	return == _constant != nullptr:	the expression was completely analysed and resulted in a constant value.
 	return == _constant == nullptr: the expression was partially analyse.
 */
-std::pair<analyser_t, floyd::expression_t> analyse_expression_to_target(const analyser_t& a, const statement_t& parent, const floyd::expression_t& e, const floyd::typeid_t& target_type);
-std::pair<analyser_t, floyd::expression_t> analyse_expression_no_target(const analyser_t& a, const statement_t& parent, const floyd::expression_t& e);
+floyd::expression_t analyse_expression_to_target(analyser_t& a, const statement_t& parent, const floyd::expression_t& e, const floyd::typeid_t& target_type);
+floyd::expression_t analyse_expression_no_target(analyser_t& a, const statement_t& parent, const floyd::expression_t& e);
 
 
 
@@ -143,16 +146,12 @@ std::pair<const symbol_t*, floyd::variable_address_t> resolve_env_variable_deep(
 	QUARK_ASSERT(depth >= 0 && depth < a._lexical_scope_stack.size());
 	QUARK_ASSERT(s.size() > 0);
 
-    const auto it = std::find_if(
-    	a._lexical_scope_stack[depth].symbols._symbols.begin(),
-    	a._lexical_scope_stack[depth].symbols._symbols.end(),
-    	[&s](const std::pair<std::string, floyd::symbol_t>& e) { return e.first == s; }
-	);
-
-	if(it != a._lexical_scope_stack[depth].symbols._symbols.end()){
+	const auto& scope = a._lexical_scope_stack[depth];
+	const auto it = scope.symbol_indexes.find(s);
+	if(it != scope.symbol_indexes.end()){
 		const auto parent_index = depth == 0 ? -1 : (int)(a._lexical_scope_stack.size() - depth - 1);
-		const auto variable_index = (int)(it - a._lexical_scope_stack[depth].symbols._symbols.begin());
-		return { &it->second, floyd::variable_address_t::make_variable_address(parent_index, variable_index) };
+		const auto variable_index = it->second;
+		return { &scope.symbols._symbols[variable_index].second, floyd::variable_address_t::make_variable_address(parent_index, variable_index) };
 	}
 	else if(depth > 0){
 		return resolve_env_variable_deep(a, depth - 1, s);
@@ -170,8 +169,37 @@ std::pair<const symbol_t*, floyd::variable_address_t> find_symbol_by_name(const
 }
 
 bool does_symbol_exist_shallow(const analyser_t& a, const std::string& s){
-    const auto it = std::find_if(a._lexical_scope_stack.back().symbols._symbols.begin(), a._lexical_scope_stack.back().symbols._symbols.end(),  [&s](const std::pair<std::string, floyd::symbol_t>& e) { return e.first == s; });
-	return it != a._lexical_scope_stack.back().symbols._symbols.end();
+	return a._lexical_scope_stack.back().symbol_indexes.count(s) > 0;
+}
+
+lexical_scope_t make_lexical_scope(const symbol_table_t& symbols, epure pure){
+	auto result = lexical_scope_t{ symbols, pure, {} };
+	for(int i = 0 ; i < symbols._symbols.size() ; i++){
+		result.symbol_indexes.insert({ symbols._symbols[i].first, i });
+	}
+	return result;
+}
+
+//	Adds symbol to the current lexical scope, returns its index.
+int add_symbol(analyser_t& a, const std::string& name, const symbol_t& symbol){
+	auto& scope = a._lexical_scope_stack.back();
+	const auto index = static_cast<int>(scope.symbols._symbols.size());
+	scope.symbols._symbols.push_back({ name, symbol });
+	scope.symbol_indexes.insert({ name, index });
+	return index;
+}
+
+//	Removes the latest symbol added to the current lexical scope.
+void remove_last_symbol(analyser_t& a){
+	auto& scope = a._lexical_scope_stack.back();
+	QUARK_ASSERT(scope.symbols._symbols.empty() == false);
+
+	const auto index = static_cast<int>(scope.symbols._symbols.size() - 1);
+	const auto it = scope.symbol_indexes.find(scope.symbols._symbols.back().first);
+	if(it != scope.symbol_indexes.end() && it->second == index){
+		scope.symbol_indexes.erase(it);
+	}
+	scope.symbols._symbols.pop_back();
 }
 
 //	Warning: returns reference to the found value-entry -- this could be in any environment in the call stack.
@@ -183,6 +211,13 @@ const symbol_t* resolve_symbol_by_address(const analyser_t& a, const floyd::vari
 	return &env.symbols._symbols[s._index].second;
 }
 
+//	Dictionary keys must be ordered and hashed, see bc_dict_key_t.
+static void check_dict_key_type(const location_t& loc, const typeid_t& key_type){
+	if(key_type.is_function() || key_type.is_json_value() || key_type.is_typeid() || key_type.is_protocol()){
+		throw_compiler_error(loc, "Dictionary key cannot be of type \"" + typeid_to_compact_string(key_type) + "\".");
+	}
+}
+
 typeid_t resolve_type_internal(const analyser_t& a, const location_t& loc, const typeid_t& type){
 	QUARK_ASSERT(a.check_invariant());
 	QUARK_ASSERT(type.check_invariant());
@@ -239,7 +274,9 @@ typeid_t resolve_type_internal(const analyser_t& a, const location_t& loc, const
 		return typeid_t::make_vector(resolve_type(a, loc, type.get_vector_element_type()));
 	}
 	else if(basetype == base_type::k_dict){
-		return typeid_t::make_dict(resolve_type(a, loc, type.get_dict_value_type()));
+		const auto key_type = resolve_type(a, loc, type.get_dict_key_type());
+		check_dict_key_type(loc, key_type);
+		return typeid_t::make_dict(key_type, resolve_type(a, loc, type.get_dict_value_type()));
 	}
 	else if(basetype == base_type::k_function){
 		const auto ret = type.get_function_return();
@@ -288,57 +325,49 @@ typeid_t resolve_type(const analyser_t& a, const location_t& loc, const typeid_t
 
 
 
-std::pair<analyser_t, vector<statement_t>> analyse_statements(const analyser_t& a, const vector<statement_t>& statements, const typeid_t& return_type){
+vector<statement_t> analyse_statements(analyser_t& a, const vector<statement_t>& statements, const typeid_t& return_type){
 	QUARK_ASSERT(a.check_invariant());
 	for(const auto& i: statements){ QUARK_ASSERT(i.check_invariant()); };
 
-	auto a_acc = a;
-
 	vector<statement_t> statements2;
-	int statement_index = 0;
-	while(statement_index < statements.size()){
-		const auto statement = statements[statement_index];
-		const auto& r = analyse_statement(a_acc, statement, return_type);
-		a_acc = r.first;
-
-		if(r.second){
-			QUARK_ASSERT(r.second->check_types_resolved());
-			statements2.push_back(*r.second);
+	statements2.reserve(statements.size());
+	for(const auto& statement: statements){
+		const auto r = analyse_statement(a, statement, return_type);
+		if(r){
+			QUARK_ASSERT(r->check_types_resolved());
+			statements2.push_back(*r);
 		}
-		statement_index++;
 	}
-	return { a_acc, statements2 };
+	return statements2;
 }
 
-std::pair<analyser_t, body_t > analyse_body(const analyser_t& a, const floyd::body_t& body, epure pure, const typeid_t& return_type){
+body_t analyse_body(analyser_t& a, const floyd::body_t& body, epure pure, const typeid_t& return_type){
 	QUARK_ASSERT(a.check_invariant());
 
-	auto a_acc = a;
-
-	auto new_environment = symbol_table_t{ body._symbols };
-	const auto lexical_scope = lexical_scope_t{new_environment, pure};
-	a_acc._lexical_scope_stack.push_back(lexical_scope);
-
-	const auto result = analyse_statements(a_acc, body._statements, return_type);
-	a_acc = result.first;
-
-	const auto body2 = body_t(result.second, result.first._lexical_scope_stack.back().symbols);
+	a._lexical_scope_stack.push_back(make_lexical_scope(body._symbols, pure));
+	try {
+		const auto statements = analyse_statements(a, body._statements, return_type);
+		const auto body2 = body_t(statements, a._lexical_scope_stack.back().symbols);
 
-	a_acc._lexical_scope_stack.pop_back();
-	return { a_acc, body2 };
+		a._lexical_scope_stack.pop_back();
+		return body2;
+	}
+	catch(...){
+		a._lexical_scope_stack.pop_back();
+		throw;
+	}
 }
 
 /*
 	- Can update an existing local (if local is mutable).
 	- Can implicitly create a new local
 */
-std::pair<analyser_t, statement_t> analyse_store_statement(const analyser_t& a, const statement_t& s){
+statement_t analyse_store_statement(analyser_t& a, const statement_t& s){
 	QUARK_ASSERT(a.check_invariant());
 
-	auto a_acc = a;
 	const auto statement = std::get<statement_t::store_t>(s._contents);
 	const auto local_name = statement._local_name;
-	const auto existing_value_deep_ptr = find_symbol_by_name(a_acc, local_name);
+	const auto existing_value_deep_ptr = find_symbol_by_name(a, local_name);
 
 	//	Attempt to mutate existing value!
 	if(existing_value_deep_ptr.first != nullptr){
@@ -347,11 +376,10 @@ std::pair<analyser_t, statement_t> analyse_store_statement(const analyser_t& a,
 		}
 		else{
 			const auto lhs_type = existing_value_deep_ptr.first->get_type();
+			const auto address = existing_value_deep_ptr.second;
 			QUARK_ASSERT(lhs_type.check_types_resolved());
 
-			const auto rhs_expr2 = analyse_expression_to_target(a_acc, s, statement._expression, lhs_type);
-			a_acc = rhs_expr2.first;
-			const auto rhs_expr3 = rhs_expr2.second;
+			const auto rhs_expr3 = analyse_expression_to_target(a, s, statement._expression, lhs_type);
 
 			if(lhs_type != rhs_expr3.get_output_type()){
 				std::stringstream what;
@@ -360,20 +388,18 @@ std::pair<analyser_t, statement_t> analyse_store_statement(const analyser_t& a,
 				throw_compiler_error(s.location, what.str());
 			}
 			else{
-				return { a_acc, statement_t::make__store2(s.location, existing_value_deep_ptr.second, rhs_expr3) };
+				return statement_t::make__store2(s.location, address, rhs_expr3);
 			}
 		}
 	}
 
 	//	Bind new value -- infer type.
 	else{
-		const auto rhs_expr2 = analyse_expression_no_target(a_acc, s, statement._expression);
-		a_acc = rhs_expr2.first;
-		const auto rhs_expr2_type = rhs_expr2.second.get_output_type();
+		const auto rhs_expr2 = analyse_expression_no_target(a, s, statement._expression);
+		const auto rhs_expr2_type = rhs_expr2.get_output_type();
 
-		a_acc._lexical_scope_stack.back().symbols._symbols.push_back({local_name, symbol_t::make_immutable_local(rhs_expr2_type)});
-		int variable_index = (int)(a_acc._lexical_scope_stack.back().symbols._symbols.size() - 1);
-		return { a_acc, statement_t::make__store2(s.location, floyd::variable_address_t::make_variable_address(0, variable_index), rhs_expr2.second) };
+		const auto variable_index = add_symbol(a, local_name, symbol_t::make_immutable_local(rhs_expr2_type));
+		return statement_t::make__store2(s.location, floyd::variable_address_t::make_variable_address(0, variable_index), rhs_expr2);
 	}
 }
 
@@ -386,19 +412,18 @@ Ex:
 	mutable a = 10
 	mutable = 10
 */
-std::pair<analyser_t, statement_t> analyse_bind_local_statement(const analyser_t& a, const statement_t& s){
+statement_t analyse_bind_local_statement(analyser_t& a, const statement_t& s){
 	QUARK_ASSERT(a.check_invariant());
 
 	const auto statement = std::get<statement_t::bind_local_t>(s._contents);
-	auto a_acc = a;
 
 	const auto new_local_name = statement._new_local_name;
 	const auto lhs_type0 = statement._bindtype;
-	const auto lhs_type = lhs_type0.check_types_resolved() == false && lhs_type0.is_undefined() == false ? resolve_type(a_acc, s.location, lhs_type0) : lhs_type0;
+	const auto lhs_type = lhs_type0.check_types_resolved() == false && lhs_type0.is_undefined() == false ? resolve_type(a, s.location, lhs_type0) : lhs_type0;
 
 	const auto bind_statement_mutable_tag_flag = statement._locals_mutable_mode == statement_t::bind_local_t::k_mutable;
 
-	const auto value_exists_in_env = does_symbol_exist_shallow(a_acc, new_local_name);
+	const auto value_exists_in_env = does_symbol_exist_shallow(a, new_local_name);
 	if(value_exists_in_env){
 		std::stringstream what;
 		what << "Local identifier \"" << new_local_name << "\" already exists.";
@@ -408,21 +433,20 @@ std::pair<analyser_t, statement_t> analyse_bind_local_statement(const analyser_t
 	//	Setup temporary simply so function definition can find itself = recursive.
 	//	Notice: the final type may not be correct yet, but for function defintions it is.
 	//	This logic should be available for infered binds too, in analyse_store_statement().
-	a_acc._lexical_scope_stack.back().symbols._symbols.push_back({
+	const auto local_name_index = add_symbol(
+		a,
 		new_local_name,
 		bind_statement_mutable_tag_flag ? symbol_t::make_mutable_local(lhs_type) : symbol_t::make_immutable_local(lhs_type)
-	});
-	const auto local_name_index = a_acc._lexical_scope_stack.back().symbols._symbols.size() - 1;
+	);
 
 	try {
-		const auto rhs_expr_pair = lhs_type.is_undefined()
-			? analyse_expression_no_target(a_acc, s, statement._expression)
-			: analyse_expression_to_target(a_acc, s, statement._expression, lhs_type);
-		a_acc = rhs_expr_pair.first;
+		const auto rhs_expr = lhs_type.is_undefined()
+			? analyse_expression_no_target(a, s, statement._expression)
+			: analyse_expression_to_target(a, s, statement._expression, lhs_type);
 
 		//??? if expression is a k_define_struct, k_define_function -- make it a constant in symbol table and emit no store-statement!
 
-		const auto rhs_type = rhs_expr_pair.second.get_output_type();
+		const auto rhs_type = rhs_expr.get_output_type();
 		const auto lhs_type2 = lhs_type.is_undefined() ? rhs_type : lhs_type;
 
 		//??? always true?
@@ -434,94 +458,78 @@ std::pair<analyser_t, statement_t> analyse_bind_local_statement(const analyser_t
 		}
 		else{
 			//	Updated the symbol with the real function defintion.
-			a_acc._lexical_scope_stack.back().symbols._symbols[local_name_index] = {new_local_name, bind_statement_mutable_tag_flag ? symbol_t::make_mutable_local(lhs_type2) : symbol_t::make_immutable_local(lhs_type2)};
-			return {
-				a_acc,
-				statement_t::make__store2(s.location, floyd::variable_address_t::make_variable_address(0, (int)local_name_index), rhs_expr_pair.second)
-			};
+			a._lexical_scope_stack.back().symbols._symbols[local_name_index] = {new_local_name, bind_statement_mutable_tag_flag ? symbol_t::make_mutable_local(lhs_type2) : symbol_t::make_immutable_local(lhs_type2)};
+			return statement_t::make__store2(s.location, floyd::variable_address_t::make_variable_address(0, local_name_index), rhs_expr);
 		}
 	}
 	catch(...){
 
 		//	Erase temporary symbol.
-		a_acc._lexical_scope_stack.back().symbols._symbols.pop_back();
+		remove_last_symbol(a);
 
 		throw;
 	}
 }
 
-std::pair<analyser_t, statement_t> analyse_block_statement(const analyser_t& a, const statement_t& s, const typeid_t& return_type){
+statement_t analyse_block_statement(analyser_t& a, const statement_t& s, const typeid_t& return_type){
 	QUARK_ASSERT(a.check_invariant());
 
 	const auto statement = std::get<statement_t::block_statement_t>(s._contents);
 	const auto e = analyse_body(a, statement._body, a._lexical_scope_stack.back().pure, return_type);
-	return {e.first, statement_t::make__block_statement(s.location, e.second)};
+	return statement_t::make__block_statement(s.location, e);
 }
 
-std::pair<analyser_t, statement_t> analyse_return_statement(const analyser_t& a, const statement_t& s, const typeid_t& return_type){
+statement_t analyse_return_statement(analyser_t& a, const statement_t& s, const typeid_t& return_type){
 	QUARK_ASSERT(a.check_invariant());
 
 	const auto statement = std::get<statement_t::return_statement_t>(s._contents);
-	auto a_acc = a;
 	const auto expr = statement._expression;
-	const auto result = analyse_expression_to_target(a_acc, s, expr, return_type);
-		
-	a_acc = result.first;
-
-	const auto result_value = result.second;
+	const auto result = analyse_expression_to_target(a, s, expr, return_type);
 
 	//	Check that return value's type matches function's return type. Cannot be done here since we don't know who called us.
 	//	Instead calling code must check.
-	return { a_acc, statement_t::make__return_statement(s.location, result.second) };
+	return statement_t::make__return_statement(s.location, result);
 }
 
-analyser_t analyse_def_struct_statement(const analyser_t& a, const statement_t& s){
+void analyse_def_struct_statement(analyser_t& a, const statement_t& s){
 	QUARK_ASSERT(a.check_invariant());
 
 	const auto statement = std::get<statement_t::define_struct_statement_t>(s._contents);
-	auto a_acc = a;
 	const auto struct_name = statement._name;
-	if(does_symbol_exist_shallow(a_acc, struct_name)){
+	if(does_symbol_exist_shallow(a, struct_name)){
 		std::stringstream what;
 		what << "Name \"" << struct_name << "\" already used in current lexical scope.";
 		throw_compiler_error(s.location, what.str());
 	}
 
 	const auto struct_typeid1 = typeid_t::make_struct2(statement._def->_members);
-	const auto struct_typeid2 = resolve_type(a_acc, s.location, struct_typeid1);
+	const auto struct_typeid2 = resolve_type(a, s.location, struct_typeid1);
 	const auto struct_typeid_value = value_t::make_typeid_value(struct_typeid2);
-	a_acc._lexical_scope_stack.back().symbols._symbols.push_back({struct_name, symbol_t::make_constant(struct_typeid_value)});
-
-	return a_acc;
+	add_symbol(a, struct_name, symbol_t::make_constant(struct_typeid_value));
 }
 
-analyser_t analyse_def_protocol_statement(const analyser_t& a, const statement_t& s){
+void analyse_def_protocol_statement(analyser_t& a, const statement_t& s){
 	QUARK_ASSERT(a.check_invariant());
 
 	const auto statement = std::get<statement_t::define_protocol_statement_t>(s._contents);
-	auto a_acc = a;
 	const auto protocol_name = statement._name;
-	if(does_symbol_exist_shallow(a_acc, protocol_name)){
+	if(does_symbol_exist_shallow(a, protocol_name)){
 		std::stringstream what;
 		what << "Name \"" << protocol_name << "\" already used in current lexical scope.";
 		throw_compiler_error(s.location, what.str());
 	}
 
 	const auto protocol_typeid1 = typeid_t::make_protocol(statement._def->_members);
-	const auto protocol_typeid2 = resolve_type(a_acc, s.location, protocol_typeid1);
+	const auto protocol_typeid2 = resolve_type(a, s.location, protocol_typeid1);
 	const auto protocol_typeid_value = value_t::make_typeid_value(protocol_typeid2);
-	a_acc._lexical_scope_stack.back().symbols._symbols.push_back({protocol_name, symbol_t::make_constant(protocol_typeid_value)});
-
-	return a_acc;
+	add_symbol(a, protocol_name, symbol_t::make_constant(protocol_typeid_value));
 }
 
-std::pair<analyser_t, statement_t> analyse_def_function_statement(const analyser_t& a, const statement_t& s){
+statement_t analyse_def_function_statement(analyser_t& a, const statement_t& s){
 	QUARK_ASSERT(a.check_invariant());
 
 	const auto statement = std::get<statement_t::define_function_statement_t>(s._contents);
 
-	auto a_acc = a;
-
 	//	Translates into:  bind-local, "myfunc", function_definition_expr_t
 	const auto function_def_expr = expression_t::make_function_definition(statement._def);
 	const auto& s2 = statement_t::make__bind_local(
@@ -531,52 +539,47 @@ std::pair<analyser_t, statement_t> analyse_def_function_statement(const analyser
 		function_def_expr,
 		statement_t::bind_local_t::k_immutable
 	);
-	const auto s3 = analyse_bind_local_statement(a_acc, s2);
-	return s3;
+	return analyse_bind_local_statement(a, s2);
 }
 
-std::pair<analyser_t, statement_t> analyse_ifelse_statement(const analyser_t& a, const statement_t& s, const typeid_t& return_type){
+statement_t analyse_ifelse_statement(analyser_t& a, const statement_t& s, const typeid_t& return_type){
 	QUARK_ASSERT(a.check_invariant());
 
 	const auto statement = std::get<statement_t::ifelse_statement_t>(s._contents);
-	auto a_acc = a;
 
-	const auto condition2 = analyse_expression_no_target(a_acc, s, statement._condition);
-	a_acc = condition2.first;
+	const auto condition2 = analyse_expression_no_target(a, s, statement._condition);
 
-	const auto condition_type = condition2.second.get_output_type();
+	const auto condition_type = condition2.get_output_type();
 	if(condition_type.is_bool() == false){
 		std::stringstream what;
 		what << "Boolean condition required.";
 		throw_compiler_error(s.location, what.str());
 	}
 
-	const auto then2 = analyse_body(a_acc, statement._then_body, a._lexical_scope_stack.back().pure, return_type);
-	const auto else2 = analyse_body(a_acc, statement._else_body, a._lexical_scope_stack.back().pure, return_type);
-	return { a_acc, statement_t::make__ifelse_statement(s.location, condition2.second, then2.second, else2.second) };
+	const auto pure = a._lexical_scope_stack.back().pure;
+	const auto then2 = analyse_body(a, statement._then_body, pure, return_type);
+	const auto else2 = analyse_body(a, statement._else_body, pure, return_type);
+	return statement_t::make__ifelse_statement(s.location, condition2, then2, else2);
 }
 
-std::pair<analyser_t, statement_t> analyse_for_statement(const analyser_t& a, const statement_t& s, const typeid_t& return_type){
+statement_t analyse_for_statement(analyser_t& a, const statement_t& s, const typeid_t& return_type){
 	QUARK_ASSERT(a.check_invariant());
 
 	const auto statement = std::get<statement_t::for_statement_t>(s._contents);
-	auto a_acc = a;
 
-	const auto start_expr2 = analyse_expression_no_target(a_acc, s, statement._start_expression);
-	a_acc = start_expr2.first;
+	const auto start_expr2 = analyse_expression_no_target(a, s, statement._start_expression);
 
-	if(start_expr2.second.get_output_type().is_int() == false){
+	if(start_expr2.get_output_type().is_int() == false){
 		std::stringstream what;
-		what << "For-loop requires integer iterator, start type is " <<  typeid_to_compact_string(start_expr2.second.get_output_type()) << ".";
+		what << "For-loop requires integer iterator, start type is " <<  typeid_to_compact_string(start_expr2.get_output_type()) << ".";
 		throw_compiler_error(s.location, what.str());
 	}
 
-	const auto end_expr2 = analyse_expression_no_target(a_acc, s, statement._end_expression);
-	a_acc = end_expr2.first;
+	const auto end_expr2 = analyse_expression_no_target(a, s, statement._end_expression);
 
-	if(end_expr2.second.get_output_type().is_int() == false){
+	if(end_expr2.get_output_type().is_int() == false){
 		std::stringstream what;
-		what << "For-loop requires integer iterator, end type is " <<  typeid_to_compact_string(end_expr2.second.get_output_type()) << ".";
+		what << "For-loop requires integer iterator, end type is " <<  typeid_to_compact_string(end_expr2.get_output_type()) << ".";
 		throw_compiler_error(s.location, what.str());
 	}
 
@@ -586,78 +589,71 @@ std::pair<analyser_t, statement_t> analyse_for_statement(const analyser_t& a, co
 	auto symbols = statement._body._symbols;
 	symbols._symbols.push_back({ statement._iterator_name, iterator_symbol});
 	const auto body_injected = body_t(statement._body._statements, symbols);
-	const auto result = analyse_body(a_acc, body_injected, a._lexical_scope_stack.back().pure, return_type);
-	a_acc = result.first;
+	const auto result = analyse_body(a, body_injected, a._lexical_scope_stack.back().pure, return_type);
 
-	return { a_acc, statement_t::make__for_statement(s.location, statement._iterator_name, start_expr2.second, end_expr2.second, result.second, statement._range_type) };
+	return statement_t::make__for_statement(s.location, statement._iterator_name, start_expr2, end_expr2, result, statement._range_type);
 }
 
-std::pair<analyser_t, statement_t> analyse_while_statement(const analyser_t& a, const statement_t& s, const typeid_t& return_type){
+statement_t analyse_while_statement(analyser_t& a, const statement_t& s, const typeid_t& return_type){
 	QUARK_ASSERT(a.check_invariant());
 
 	const auto statement = std::get<statement_t::while_statement_t>(s._contents);
-	auto a_acc = a;
-
-	const auto condition2_expr = analyse_expression_no_target(a_acc, s, statement._condition);
-	a_acc = condition2_expr.first;
 
-	const auto result = analyse_body(a_acc, statement._body, a._lexical_scope_stack.back().pure, return_type);
-	a_acc = result.first;
+	const auto condition2_expr = analyse_expression_no_target(a, s, statement._condition);
+	const auto result = analyse_body(a, statement._body, a._lexical_scope_stack.back().pure, return_type);
 
-	return { a_acc, statement_t::make__while_statement(s.location, condition2_expr.second, result.second) };
+	return statement_t::make__while_statement(s.location, condition2_expr, result);
 }
 
-std::pair<analyser_t, statement_t> analyse_expression_statement(const analyser_t& a, const statement_t& s){
+statement_t analyse_expression_statement(analyser_t& a, const statement_t& s){
 	QUARK_ASSERT(a.check_invariant());
 
 	const auto statement = std::get<statement_t::expression_statement_t>(s._contents);
-	auto a_acc = a;
-	const auto expr2 = analyse_expression_no_target(a_acc, s, statement._expression);
-	a_acc = expr2.first;
+	const auto expr2 = analyse_expression_no_target(a, s, statement._expression);
 
-	return { a_acc, statement_t::make__expression_statement(s.location, expr2.second) };
+	return statement_t::make__expression_statement(s.location, expr2);
 }
 
 //	Output is the RETURN VALUE of the analysed statement, if any.
-std::pair<analyser_t, shared_ptr<statement_t>> analyse_statement(const analyser_t& a, const statement_t& statement, const typeid_t& return_type){
+shared_ptr<statement_t> analyse_statement(analyser_t& a, const statement_t& statement, const typeid_t& return_type){
 	QUARK_ASSERT(a.check_invariant());
 	QUARK_ASSERT(statement.check_invariant());
 
-	typedef std::pair<analyser_t, shared_ptr<statement_t>> return_type_t;
+	typedef shared_ptr<statement_t> return_type_t;
 
 	struct visitor_t {
-		const analyser_t& a;
+		analyser_t& a;
 		const statement_t& statement;
 		const typeid_t return_type;
 
 
 		return_type_t operator()(const statement_t::return_statement_t& s) const{
 			const auto e = analyse_return_statement(a, statement, return_type);
-			QUARK_ASSERT(e.second.check_types_resolved());
-			return { e.first, std::make_shared<statement_t>(e.second) };
+			QUARK_ASSERT(e.check_types_resolved());
+			return std::make_shared<statement_t>(e);
 		}
 		return_type_t operator()(const statement_t::define_struct_statement_t& s) const{
-			const auto e = analyse_def_struct_statement(a, statement);
-			return { e, {} };
+			analyse_def_struct_statement(a, statement);
+			return {};
 		}
 		return_type_t operator()(const statement_t::define_protocol_statement_t& s) const{
-			const auto e = analyse_def_protocol_statement(a, statement);
-			return { e, {} };
+			analyse_def_protocol_statement(a, statement);
+			return {};
 		}
 		return_type_t operator()(const statement_t::define_function_statement_t& s) const{
 			const auto e = analyse_def_function_statement(a, statement);
-			return { e.first, std::make_shared<statement_t>(e.second) };
+			return std::make_shared<statement_t>(e);
 		}
 
 		return_type_t operator()(const statement_t::bind_local_t& s) const{
 			const auto e = analyse_bind_local_statement(a, statement);
-			QUARK_ASSERT(e.second.check_types_resolved());
-			return { e.first, std::make_shared<statement_t>(e.second) };
+			QUARK_ASSERT(e.check_types_resolved());
+			return std::make_shared<statement_t>(e);
 		}
 		return_type_t operator()(const statement_t::store_t& s) const{
 			const auto e = analyse_store_statement(a, statement);
-			QUARK_ASSERT(e.second.check_types_resolved());
-			return { e.first, std::make_shared<statement_t>(e.second) };
+			QUARK_ASSERT(e.check_types_resolved());
+			return std::make_shared<statement_t>(e);
 		}
 		return_type_t operator()(const statement_t::store2_t& s) const{
 			QUARK_ASSERT(false);
@@ -665,41 +661,39 @@ std::pair<analyser_t, shared_ptr<statement_t>> analyse_statement(const analyser_
 		}
 		return_type_t operator()(const statement_t::block_statement_t& s) const{
 			const auto e = analyse_block_statement(a, statement, return_type);
-			QUARK_ASSERT(e.second.check_types_resolved());
-			return { e.first, std::make_shared<statement_t>(e.second) };
+			QUARK_ASSERT(e.check_types_resolved());
+			return std::make_shared<statement_t>(e);
 		}
 
 		return_type_t operator()(const statement_t::ifelse_statement_t& s) const{
 			const auto e = analyse_ifelse_statement(a, statement, return_type);
-			QUARK_ASSERT(e.second.check_types_resolved());
-			return { e.first, std::make_shared<statement_t>(e.second) };
+			QUARK_ASSERT(e.check_types_resolved());
+			return std::make_shared<statement_t>(e);
 		}
 		return_type_t operator()(const statement_t::for_statement_t& s) const{
 			const auto e = analyse_for_statement(a, statement, return_type);
-			QUARK_ASSERT(e.second.check_types_resolved());
-			return { e.first, std::make_shared<statement_t>(e.second) };
+			QUARK_ASSERT(e.check_types_resolved());
+			return std::make_shared<statement_t>(e);
 		}
 		return_type_t operator()(const statement_t::while_statement_t& s) const{
 			const auto e = analyse_while_statement(a, statement, return_type);
-			QUARK_ASSERT(e.second.check_types_resolved());
-			return { e.first, std::make_shared<statement_t>(e.second) };
+			QUARK_ASSERT(e.check_types_resolved());
+			return std::make_shared<statement_t>(e);
 		}
 
 
 		return_type_t operator()(const statement_t::expression_statement_t& s) const{
 			const auto e = analyse_expression_statement(a, statement);
-			QUARK_ASSERT(e.second.check_types_resolved());
-			return { e.first, std::make_shared<statement_t>(e.second) };
+			QUARK_ASSERT(e.check_types_resolved());
+			return std::make_shared<statement_t>(e);
 		}
 		return_type_t operator()(const statement_t::software_system_statement_t& s) const{
-			analyser_t temp = a;
-			temp._software_system = parse_software_system_json(s._json_data);
-			return { temp, std::make_shared<statement_t>(statement) };
+			a._software_system = parse_software_system_json(s._json_data);
+			return std::make_shared<statement_t>(statement);
 		}
 		return_type_t operator()(const statement_t::container_def_statement_t& s) const{
-			analyser_t temp = a;
-			temp._container_def = parse_container_def_json(s._json_data);
-			return { temp, std::make_shared<statement_t>(statement) };
+			a._container_def = parse_container_def_json(s._json_data);
+			return std::make_shared<statement_t>(statement);
 		}
 	};
 
@@ -712,14 +706,12 @@ std::pair<analyser_t, shared_ptr<statement_t>> analyse_statement(const analyser_
 
 
 
-std::pair<analyser_t, expression_t> analyse_resolve_member_expression(const analyser_t& a, const statement_t& parent, const expression_t& e){
+expression_t analyse_resolve_member_expression(analyser_t& a, const statement_t& parent, const expression_t& e){
 	QUARK_ASSERT(a.check_invariant());
 
-	auto a_acc = a;
-	const auto parent_expr = analyse_expression_no_target(a_acc, parent, e._input_exprs[0]);
-	a_acc = parent_expr.first;
+	const auto parent_expr = analyse_expression_no_target(a, parent, e._input_exprs[0]);
 
-	const auto parent_type = parent_expr.second.get_output_type();
+	const auto parent_type = parent_expr.get_output_type();
 
 	if(parent_type.is_struct()){
 		const auto struct_def = parent_type.get_struct();
@@ -732,7 +724,7 @@ std::pair<analyser_t, expression_t> analyse_resolve_member_expression(const anal
 			throw_compiler_error(parent.location, what.str());
 		}
 		const auto member_type = struct_def._members[index]._type;
-		return { a_acc, expression_t::make_resolve_member(parent_expr.second, e._variable_name, make_shared<typeid_t>(member_type))};
+		return expression_t::make_resolve_member(parent_expr, e._variable_name, make_shared<typeid_t>(member_type));
 	}
 	else{
 		std::stringstream what;
@@ -741,18 +733,15 @@ std::pair<analyser_t, expression_t> analyse_resolve_member_expression(const anal
 	}
 }
 
-std::pair<analyser_t, expression_t> analyse_lookup_element_expression(const analyser_t& a, const statement_t& parent, const expression_t& e){
+expression_t analyse_lookup_element_expression(analyser_t& a, const statement_t& parent, const expression_t& e){
 	QUARK_ASSERT(a.check_invariant());
 
-	auto a_acc = a;
-	const auto parent_expr = analyse_expression_no_target(a_acc, parent, e._input_exprs[0]);
-	a_acc = parent_expr.first;
+	const auto parent_expr = analyse_expression_no_target(a, parent, e._input_exprs[0]);
 
-	const auto key_expr = analyse_expression_no_target(a_acc, parent, e._input_exprs[1]);
-	a_acc = key_expr.first;
+	const auto key_expr = analyse_expression_no_target(a, parent, e._input_exprs[1]);
 
-	const auto parent_type = parent_expr.second.get_output_type();
-	const auto key_type = key_expr.second.get_output_type();
+	const auto parent_type = parent_expr.get_output_type();
+	const auto key_type = key_expr.get_output_type();
 
 	if(parent_type.is_string()){
 		if(key_type.is_int() == false){
@@ -761,11 +750,11 @@ std::pair<analyser_t, expression_t> analyse_lookup_element_expression(const anal
 			throw_compiler_error(parent.location, what.str());
 		}
 		else{
-			return { a_acc, expression_t::make_lookup(parent_expr.second, key_expr.second, make_shared<typeid_t>(typeid_t::make_int())) };
+			return expression_t::make_lookup(parent_expr, key_expr, make_shared<typeid_t>(typeid_t::make_int()));
 		}
 	}
 	else if(parent_type.is_json_value()){
-		return { a_acc, expression_t::make_lookup(parent_expr.second, key_expr.second, make_shared<typeid_t>(typeid_t::make_json_value())) };
+		return expression_t::make_lookup(parent_expr, key_expr, make_shared<typeid_t>(typeid_t::make_json_value()));
 	}
 	else if(parent_type.is_vector()){
 		if(key_type.is_int() == false){
@@ -774,17 +763,17 @@ std::pair<analyser_t, expression_t> analyse_lookup_element_expression(const anal
 			throw_compiler_error(parent.location, what.str());
 		}
 		else{
-			return { a_acc, expression_t::make_lookup(parent_expr.second, key_expr.second, make_shared<typeid_t>(parent_type.get_vector_element_type())) };
+			return expression_t::make_lookup(parent_expr, key_expr, make_shared<typeid_t>(parent_type.get_vector_element_type()));
 		}
 	}
 	else if(parent_type.is_dict()){
-		if(key_type.is_string() == false){
+		if(key_type != parent_type.get_dict_key_type()){
 			std::stringstream what;
-			what << "Dictionary can only be looked up using string keys, not a \"" + typeid_to_compact_string(key_type) + "\".";
+			what << "Dictionary can only be looked up using " + typeid_to_compact_string(parent_type.get_dict_key_type()) + " keys, not a \"" + typeid_to_compact_string(key_type) + "\".";
 			throw_compiler_error(parent.location, what.str());
 		}
 		else{
-			return { a_acc, expression_t::make_lookup(parent_expr.second, key_expr.second, make_shared<typeid_t>(parent_type.get_dict_value_type())) };
+			return expression_t::make_lookup(parent_expr, key_expr, make_shared<typeid_t>(parent_type.get_dict_value_type()));
 		}
 	}
 	else {
@@ -794,13 +783,12 @@ std::pair<analyser_t, expression_t> analyse_lookup_element_expression(const anal
 	}
 }
 
-std::pair<analyser_t, expression_t> analyse_load(const analyser_t& a, const statement_t& parent,const expression_t& e){
+expression_t analyse_load(analyser_t& a, const statement_t& parent,const expression_t& e){
 	QUARK_ASSERT(a.check_invariant());
 
-	auto a_acc = a;
-	const auto found = find_symbol_by_name(a_acc, e._variable_name);
+	const auto found = find_symbol_by_name(a, e._variable_name);
 	if(found.first != nullptr){
-		return {a_acc, expression_t::make_load2(found.second, make_shared<typeid_t>(found.first->_value_type)) };
+		return expression_t::make_load2(found.second, make_shared<typeid_t>(found.first->_value_type));
 	}
 	else{
 		std::stringstream what;
@@ -809,10 +797,10 @@ std::pair<analyser_t, expression_t> analyse_load(const analyser_t& a, const stat
 	}
 }
 
-std::pair<analyser_t, expression_t> analyse_load2(const analyser_t& a, const expression_t& e){
+expression_t analyse_load2(analyser_t& a, const expression_t& e){
 	QUARK_ASSERT(a.check_invariant());
 
-	return { a, e };
+	return e;
 }
 
 /*
@@ -827,11 +815,9 @@ std::pair<analyser_t, expression_t> analyse_load2(const analyser_t& a, const exp
 
 	rhs is an invalid dict construction -- you can't mix string/int values in a floyd dict. BUT: it's a valid JSON!
 */
-std::pair<analyser_t, expression_t> analyse_construct_value_expression(const analyser_t& a, const statement_t& parent, const expression_t& e, const typeid_t& target_type){
+expression_t analyse_construct_value_expression(analyser_t& a, const statement_t& parent, const expression_t& e, const typeid_t& target_type){
 	QUARK_ASSERT(a.check_invariant());
 
-	auto a_acc = a;
-
 	const auto current_type = *e._output_type;
 	if(current_type.is_vector()){
 		//	JSON constants supports mixed element types: convert each element into a json_value.
@@ -841,9 +827,7 @@ std::pair<analyser_t, expression_t> analyse_construct_value_expression(const ana
 
 			std::vector<expression_t> elements2;
 			for(const auto& m: e._input_exprs){
-				const auto element_expr = analyse_expression_to_target(a_acc, parent, m, element_type);
-				a_acc = element_expr.first;
-				elements2.push_back(element_expr.second);
+				elements2.push_back(analyse_expression_to_target(a, parent, m, element_type));
 			}
 			const auto result_type = typeid_t::make_vector(typeid_t::make_json_value());
 			if(result_type.check_types_resolved() == false){
@@ -851,21 +835,16 @@ std::pair<analyser_t, expression_t> analyse_construct_value_expression(const ana
 				what << "Cannot infer vector element type, add explicit type.";
 				throw_compiler_error(parent.location, what.str());
 			}
-			return {
-				a_acc,
-				expression_t::make_construct_value_expr(
-					typeid_t::make_json_value(),
-					{ expression_t::make_construct_value_expr(typeid_t::make_vector(typeid_t::make_json_value()), elements2) }
-				)
-			};
+			return expression_t::make_construct_value_expr(
+				typeid_t::make_json_value(),
+				{ expression_t::make_construct_value_expr(typeid_t::make_vector(typeid_t::make_json_value()), elements2) }
+			);
 		}
 		else {
 			const auto element_type = current_type.get_vector_element_type();
 			std::vector<expression_t> elements2;
 			for(const auto& m: e._input_exprs){
-				const auto element_expr = analyse_expression_no_target(a_acc, parent, m);
-				a_acc = element_expr.first;
-				elements2.push_back(element_expr.second);
+				elements2.push_back(analyse_expression_no_target(a, parent, m));
 			}
 
 			const auto element_type2 = element_type.is_undefined() && elements2.size() > 0 ? elements2[0].get_output_type() : element_type;
@@ -886,11 +865,11 @@ std::pair<analyser_t, expression_t> analyse_construct_value_expression(const ana
 				}
 			}
 			QUARK_ASSERT(result_type.check_types_resolved());
-			return { a_acc, expression_t::make_construct_value_expr(result_type, elements2) };
+			return expression_t::make_construct_value_expr(result_type, elements2);
 		}
 	}
 
-	//	Dicts uses pairs of (string,value). This is stored in _args as interleaved expression: string0, value0, string1, value1.
+	//	Dicts uses pairs of (key,value). This is stored in _args as interleaved expression: key0, value0, key1, value1.
 	else if(current_type.is_dict()){
 		//	JSON constants supports mixed element types: convert each element into a json_value.
 		//	Encode as [string:json_value]
@@ -901,10 +880,9 @@ std::pair<analyser_t, expression_t> analyse_construct_value_expression(const ana
 			for(int i = 0 ; i < e._input_exprs.size() / 2 ; i++){
 				const auto& key = e._input_exprs[i * 2 + 0].get_literal().get_string_value();
 				const auto& value = e._input_exprs[i * 2 + 1];
-				const auto element_expr = analyse_expression_to_target(a_acc, parent, value, element_type);
-				a_acc = element_expr.first;
+				const auto element_expr = analyse_expression_to_target(a, parent, value, element_type);
 				elements2.push_back(expression_t::make_literal_string(key));
-				elements2.push_back(element_expr.second);
+				elements2.push_back(element_expr);
 			}
 
 			const auto result_type = typeid_t::make_dict(typeid_t::make_json_value());
@@ -913,13 +891,10 @@ std::pair<analyser_t, expression_t> analyse_construct_value_expression(const ana
 				what << "Cannot infer dictionary element type, add explicit type.";
 				throw_compiler_error(parent.location, what.str());
 			}
-			return {
-				a_acc,
-				expression_t::make_construct_value_expr(
-					typeid_t::make_json_value(),
-					{ expression_t::make_construct_value_expr(typeid_t::make_dict(typeid_t::make_json_value()), elements2) }
-				)
-			};
+			return expression_t::make_construct_value_expr(
+				typeid_t::make_json_value(),
+				{ expression_t::make_construct_value_expr(typeid_t::make_dict(typeid_t::make_json_value()), elements2) }
+			);
 		}
 		else {
 			QUARK_ASSERT(e._input_exprs.size() % 2 == 0);
@@ -928,21 +903,29 @@ std::pair<analyser_t, expression_t> analyse_construct_value_expression(const ana
 
 			std::vector<expression_t> elements2;
 			for(int i = 0 ; i < e._input_exprs.size() / 2 ; i++){
-				const auto& key = e._input_exprs[i * 2 + 0].get_literal().get_string_value();
+				const auto& key = e._input_exprs[i * 2 + 0];
 				const auto& value = e._input_exprs[i * 2 + 1];
-				const auto element_expr = analyse_expression_no_target(a_acc, parent, value);
-				a_acc = element_expr.first;
-				elements2.push_back(expression_t::make_literal_string(key));
-				elements2.push_back(element_expr.second);
+				const auto key_expr = analyse_expression_no_target(a, parent, key);
+				const auto element_expr = analyse_expression_no_target(a, parent, value);
+				elements2.push_back(key_expr);
+				elements2.push_back(element_expr);
 			}
 
-			//	Infer type of dictionary based on first value.
+			//	Infer type of dictionary based on first key and first value.
+			const auto key_type2 = elements2.size() > 0 ? elements2[0 * 2 + 0].get_output_type() : current_type.get_dict_key_type();
 			const auto element_type2 = element_type.is_undefined() && elements2.size() > 0 ? elements2[0 * 2 + 1].get_output_type() : element_type;
-			const auto result_type0 = typeid_t::make_dict(element_type2);
+			check_dict_key_type(parent.location, key_type2);
+			const auto result_type0 = typeid_t::make_dict(key_type2, element_type2);
 			const auto result_type = result_type0.check_types_resolved() == false && target_type.is_internal_dynamic() == false ? target_type : result_type0;
 
-			//	Make sure all elements have the correct type.
+			//	Make sure all keys and elements have the correct type.
 			for(int i = 0 ; i < elements2.size() / 2 ; i++){
+				const auto key_type0 = elements2[i * 2 + 0].get_output_type();
+				if(key_type0 != key_type2){
+					std::stringstream what;
+					what << "Dictionary of type " << typeid_to_compact_string(result_type) << " cannot use a key of type " << typeid_to_compact_string(key_type0) << ".";
+					throw_compiler_error(parent.location, what.str());
+				}
 				const auto element_type0 = elements2[i * 2 + 1].get_output_type();
 				if(element_type0 != element_type2){
 					std::stringstream what;
@@ -950,7 +933,7 @@ std::pair<analyser_t, expression_t> analyse_construct_value_expression(const ana
 					throw_compiler_error(parent.location, what.str());
 				}
 			}
-			return {a_acc, expression_t::make_construct_value_expr(result_type, elements2)};
+			return expression_t::make_construct_value_expr(result_type, elements2);
 		}
 	}
 	else{
@@ -959,17 +942,15 @@ std::pair<analyser_t, expression_t> analyse_construct_value_expression(const ana
 	quark::throw_exception();
 }
 
-std::pair<analyser_t, expression_t> analyse_arithmetic_unary_minus_expression(const analyser_t& a, const statement_t& parent, const expression_t& e){
+expression_t analyse_arithmetic_unary_minus_expression(analyser_t& a, const statement_t& parent, const expression_t& e){
 	QUARK_ASSERT(a.check_invariant());
 
-	auto a_acc = a;
-	const auto& expr2 = analyse_expression_no_target(a_acc, parent, e._input_exprs[0]);
-	a_acc = expr2.first;
+	const auto& expr2 = analyse_expression_no_target(a, parent, e._input_exprs[0]);
 
 	//??? We could simplify here and return [ "-", 0, expr]
-	const auto type = expr2.second.get_output_type();
+	const auto type = expr2.get_output_type();
 	if(type.is_int() || type.is_double()){
-		return {a_acc, expression_t::make_unary_minus(expr2.second, make_shared<typeid_t>(type))  };
+		return expression_t::make_unary_minus(expr2, make_shared<typeid_t>(type));
 	}
 	else{
 		std::stringstream what;
@@ -978,63 +959,51 @@ std::pair<analyser_t, expression_t> analyse_arithmetic_unary_minus_expression(co
 	}
 }
 
-std::pair<analyser_t, expression_t> analyse_conditional_operator_expression(const analyser_t& analyser, const statement_t& parent, const expression_t& e){
+expression_t analyse_conditional_operator_expression(analyser_t& analyser, const statement_t& parent, const expression_t& e){
 	QUARK_ASSERT(analyser.check_invariant());
 
-	auto analyser_acc = analyser;
-
 	//	Special-case since it uses 3 expressions & uses shortcut evaluation.
-	const auto cond_result = analyse_expression_no_target(analyser_acc, parent, e._input_exprs[0]);
-	analyser_acc = cond_result.first;
+	const auto cond_result = analyse_expression_no_target(analyser, parent, e._input_exprs[0]);
 
-	const auto a = analyse_expression_no_target(analyser_acc, parent, e._input_exprs[1]);
-	analyser_acc = a.first;
+	const auto a = analyse_expression_no_target(analyser, parent, e._input_exprs[1]);
 
-	const auto b = analyse_expression_no_target(analyser_acc, parent, e._input_exprs[2]);
-	analyser_acc = b.first;
+	const auto b = analyse_expression_no_target(analyser, parent, e._input_exprs[2]);
 
-	const auto type = cond_result.second.get_output_type();
+	const auto type = cond_result.get_output_type();
 	if(type.is_bool() == false){
 		std::stringstream what;
 		what << "Conditional expression needs to be a bool, not a " << typeid_to_compact_string(type) << ".";
 		throw_compiler_error(parent.location, what.str());
 	}
-	else if(a.second.get_output_type() != b.second.get_output_type()){
+	else if(a.get_output_type() != b.get_output_type()){
 		std::stringstream what;
-		what << "Conditional expression requires true/false expressions to have the same type, currently " << typeid_to_compact_string(a.second.get_output_type()) << " : " << typeid_to_compact_string(b.second.get_output_type()) << ".";
+		what << "Conditional expression requires true/false expressions to have the same type, currently " << typeid_to_compact_string(a.get_output_type()) << " : " << typeid_to_compact_string(b.get_output_type()) << ".";
 		throw_compiler_error(parent.location, what.str());
 	}
 	else{
-		const auto final_expression_type = a.second.get_output_type();
-		return {
-			analyser_acc,
-			expression_t::make_conditional_operator(
-				cond_result.second,
-				a.second,
-				b.second,
-				make_shared<typeid_t>(final_expression_type)
-			)
-		};
+		const auto final_expression_type = a.get_output_type();
+		return expression_t::make_conditional_operator(
+			cond_result,
+			a,
+			b,
+			make_shared<typeid_t>(final_expression_type)
+		);
 	}
 }
 
 //	Term: Type inference
 
-std::pair<analyser_t, expression_t> analyse_comparison_expression(const analyser_t& a, const statement_t& parent, expression_type op, const expression_t& e){
+expression_t analyse_comparison_expression(analyser_t& a, const statement_t& parent, expression_type op, const expression_t& e){
 	QUARK_ASSERT(a.check_invariant());
 
-	auto a_acc = a;
-
 	//	First analyse all inputs to our operation.
-	const auto left_expr = analyse_expression_no_target(a_acc, parent, e._input_exprs[0]);
-	a_acc = left_expr.first;
+	const auto left_expr = analyse_expression_no_target(a, parent, e._input_exprs[0]);
 
-	const auto lhs_type = left_expr.second.get_output_type();
+	const auto lhs_type = left_expr.get_output_type();
 
 	//	Make rhs match left if needed/possible.
-	const auto right_expr = analyse_expression_to_target(a_acc, parent, e._input_exprs[1], lhs_type);
-	a_acc = right_expr.first;
-	const auto rhs_type = right_expr.second.get_output_type();
+	const auto right_expr = analyse_expression_to_target(a, parent, e._input_exprs[1], lhs_type);
+	const auto rhs_type = right_expr.get_output_type();
 
 	if(lhs_type != rhs_type || (lhs_type.is_undefined() == true || rhs_type.is_undefined() == true)){
 		std::stringstream what;
@@ -1060,34 +1029,27 @@ std::pair<analyser_t, expression_t> analyse_comparison_expression(const analyser
 		else{
 			quark::throw_exception();
 		}
-		return {
-			a_acc,
-			expression_t::make_simple_expression__2(
-				e.get_operation(),
-				left_expr.second,
-				right_expr.second,
-				make_shared<typeid_t>(typeid_t::make_bool())
-			)
-		};
+		return expression_t::make_simple_expression__2(
+			e.get_operation(),
+			left_expr,
+			right_expr,
+			make_shared<typeid_t>(typeid_t::make_bool())
+		);
 	}
 }
 
-std::pair<analyser_t, expression_t> analyse_arithmetic_expression(const analyser_t& a, const statement_t& parent, expression_type op, const expression_t& e){
+expression_t analyse_arithmetic_expression(analyser_t& a, const statement_t& parent, expression_type op, const expression_t& e){
 	QUARK_ASSERT(a.check_invariant());
 
-	auto a_acc = a;
-
 	//	First analyse both inputs to our operation.
-	const auto left_expr = analyse_expression_no_target(a_acc, parent, e._input_exprs[0]);
-	a_acc = left_expr.first;
+	const auto left_expr = analyse_expression_no_target(a, parent, e._input_exprs[0]);
 
-	const auto lhs_type = left_expr.second.get_output_type();
+	const auto lhs_type = left_expr.get_output_type();
 
 	//	Make rhs match lhs if needed/possible.
-	const auto right_expr = analyse_expression_to_target(a_acc, parent, e._input_exprs[1], lhs_type);
-	a_acc = right_expr.first;
+	const auto right_expr = analyse_expression_to_target(a, parent, e._input_exprs[1], lhs_type);
 
-	const auto rhs_type = right_expr.second.get_output_type();
+	const auto rhs_type = right_expr.get_output_type();
 
 
 	if(lhs_type != rhs_type){
@@ -1124,7 +1086,7 @@ std::pair<analyser_t, expression_t> analyse_arithmetic_expression(const analyser
 				quark::throw_exception();
 			}
 
-			return {a_acc, expression_t::make_simple_expression__2(e.get_operation(), left_expr.second, right_expr.second, make_shared<typeid_t>(shared_type)) };
+			return expression_t::make_simple_expression__2(e.get_operation(), left_expr, right_expr, make_shared<typeid_t>(shared_type));
 		}
 
 		//	int
@@ -1149,7 +1111,7 @@ std::pair<analyser_t, expression_t> analyse_arithmetic_expression(const analyser
 				quark::throw_exception();
 			}
 
-			return {a_acc, expression_t::make_simple_expression__2(e.get_operation(), left_expr.second, right_expr.second, make_shared<typeid_t>(shared_type)) };
+			return expression_t::make_simple_expression__2(e.get_operation(), left_expr, right_expr, make_shared<typeid_t>(shared_type));
 		}
 
 		//	double
@@ -1175,7 +1137,7 @@ std::pair<analyser_t, expression_t> analyse_arithmetic_expression(const analyser
 				quark::throw_exception();
 			}
 
-			return {a_acc, expression_t::make_simple_expression__2(e.get_operation(), left_expr.second, right_expr.second, make_shared<typeid_t>(shared_type)) };
+			return expression_t::make_simple_expression__2(e.get_operation(), left_expr, right_expr, make_shared<typeid_t>(shared_type));
 		}
 
 		//	string
@@ -1207,7 +1169,7 @@ std::pair<analyser_t, expression_t> analyse_arithmetic_expression(const analyser
 				quark::throw_exception();
 			}
 
-			return {a_acc, expression_t::make_simple_expression__2(e.get_operation(), left_expr.second, right_expr.second, make_shared<typeid_t>(shared_type)) };
+			return expression_t::make_simple_expression__2(e.get_operation(), left_expr, right_expr, make_shared<typeid_t>(shared_type));
 		}
 
 		//	struct
@@ -1241,7 +1203,7 @@ std::pair<analyser_t, expression_t> analyse_arithmetic_expression(const analyser
 				quark::throw_exception();
 			}
 
-			return {a_acc, expression_t::make_simple_expression__2(e.get_operation(), left_expr.second, right_expr.second, make_shared<typeid_t>(shared_type)) };
+			return expression_t::make_simple_expression__2(e.get_operation(), left_expr, right_expr, make_shared<typeid_t>(shared_type));
 		}
 
 		//	vector
@@ -1274,7 +1236,7 @@ std::pair<analyser_t, expression_t> analyse_arithmetic_expression(const analyser
 				QUARK_ASSERT(false);
 				quark::throw_exception();
 			}
-			return {a_acc, expression_t::make_simple_expression__2(e.get_operation(), left_expr.second, right_expr.second, make_shared<typeid_t>(shared_type)) };
+			return expression_t::make_simple_expression__2(e.get_operation(), left_expr, right_expr, make_shared<typeid_t>(shared_type));
 		}
 
 		//	function
@@ -1294,16 +1256,13 @@ std::pair<analyser_t, expression_t> analyse_arithmetic_expression(const analyser
 /*
 	Magic support variable argument functions ,like c-lang (...). Use a function taking ONE argument of type internal_dynamic.
 */
-std::pair<analyser_t, vector<expression_t>> analyze_call_args(const analyser_t& a, const statement_t& parent, const vector<expression_t>& call_args, const std::vector<typeid_t>& callee_args){
+vector<expression_t> analyze_call_args(analyser_t& a, const statement_t& parent, const vector<expression_t>& call_args, const std::vector<typeid_t>& callee_args){
 	if(callee_args.size() == 1 && callee_args[0].is_internal_dynamic()){
-		auto a_acc = a;
 		vector<expression_t> call_args2;
 		for(int i = 0 ; i < call_args.size() ; i++){
-			const auto call_arg_pair = analyse_expression_no_target(a_acc, parent, call_args[i]);
-			a_acc = call_arg_pair.first;
-			call_args2.push_back(call_arg_pair.second);
+			call_args2.push_back(analyse_expression_no_target(a, parent, call_args[i]));
 		}
-		return { a_acc, call_args2 };
+		return call_args2;
 	}
 	else{
 		//	arity
@@ -1313,16 +1272,13 @@ std::pair<analyser_t, vector<expression_t>> analyze_call_args(const analyser_t&
 			throw_compiler_error(parent.location, what.str());
 		}
 
-		auto a_acc = a;
 		vector<expression_t> call_args2;
 		for(int i = 0 ; i < callee_args.size() ; i++){
 			const auto callee_arg = callee_args[i];
 
-			const auto call_arg_pair = analyse_expression_to_target(a_acc, parent, call_args[i], callee_arg);
-			a_acc = call_arg_pair.first;
-			call_args2.push_back(call_arg_pair.second);
+			call_args2.push_back(analyse_expression_to_target(a, parent, call_args[i], callee_arg));
 		}
-		return { a_acc, call_args2 };
+		return call_args2;
 	}
 }
 
@@ -1401,21 +1357,57 @@ typeid_t get_host_function_return_type(const analyser_t& a, const statement_t& p
 	}
 }
 
+/*
+	send() with a literal process key is converted to a call to k_send_to_process_index_function_name, with the
+	process index as a literal, so the runtime never has to look up the process. Unknown process keys are errors.
+	Programs without processes are left alone.
+*/
+expression_t resolve_send_call(const analyser_t& a, const statement_t& parent, const expression_t& callee_expr, const vector<expression_t>& args, const typeid_t& return_type){
+	const auto call = expression_t::make_call(callee_expr, args, make_shared<typeid_t>(return_type));
+	if(callee_expr.get_operation() != expression_type::k_load2){
+		return call;
+	}
+	const auto callee = resolve_symbol_by_address(a, callee_expr._address);
+	if(callee == nullptr || callee->_const_value.is_function() == false){
+		return call;
+	}
+	const auto& function_def = function_id_to_def(a, callee->_const_value.get_function_value());
+	if(function_def._host_function_id != static_cast<int>(host_function_id::send)){
+		return call;
+	}
+
+	const auto process_keys = get_process_keys(a._container_def);
+	if(process_keys.empty() || args[0].is_literal() == false){
+		return call;
+	}
+
+	const auto process_key = args[0].get_literal().get_string_value();
+	const auto it = std::find(process_keys.begin(), process_keys.end(), process_key);
+	if(it == process_keys.end()){
+		std::stringstream what;
+		what << "Unknown process \"" << process_key << "\" in send().";
+		throw_compiler_error(parent.location, what.str());
+	}
+
+	const auto found = find_symbol_by_name(a, k_send_to_process_index_function_name);
+	QUARK_ASSERT(found.first != nullptr);
+	const auto callee2 = expression_t::make_load2(found.second, make_shared<typeid_t>(found.first->_value_type));
+	const auto process_index = static_cast<int>(it - process_keys.begin());
+	const auto args2 = vector<expression_t>{ expression_t::make_literal_int(process_index), args[1] };
+	return expression_t::make_call(callee2, args2, make_shared<typeid_t>(return_type));
+}
+
 /*
 	Notice: e._input_expr[0] is callee, the remaining are arguments.
 */
-std::pair<analyser_t, expression_t> analyse_call_expression(const analyser_t& a, const statement_t& parent, const expression_t& e){
+expression_t analyse_call_expression(analyser_t& a, const statement_t& parent, const expression_t& e){
 	QUARK_ASSERT(a.check_invariant());
 
-	auto a_acc = a;
-
-	const auto callee_expr0 = analyse_expression_no_target(a_acc, parent, e._input_exprs[0]);
-	a_acc = callee_expr0.first;
-	const auto callee_expr = callee_expr0.second;
+	const auto callee_expr = analyse_expression_no_target(a, parent, e._input_exprs[0]);
 
 	const auto args0 = vector<expression_t>(e._input_exprs.begin() + 1, e._input_exprs.end());
 
-	const auto callsite_pure = a_acc._lexical_scope_stack.back().pure;
+	const auto callsite_pure = a._lexical_scope_stack.back().pure;
 
 	//	This is a call to a function-value. Callee is a function-type.
 	const auto callee_type = callee_expr.get_output_type();
@@ -1429,21 +1421,20 @@ std::pair<analyser_t, expression_t> analyse_call_expression(const analyser_t& a,
 		}
 
 
-		const auto call_args_pair = analyze_call_args(a_acc, parent, args0, callee_args);
-		a_acc = call_args_pair.first;
+		const auto call_args2 = analyze_call_args(a, parent, args0, callee_args);
 		if(is_host_function_call(a, callee_expr)){
-			const auto return_type = get_host_function_return_type(a, parent, callee_expr, call_args_pair.second);
-			return { a_acc, expression_t::make_call(callee_expr, call_args_pair.second, make_shared<typeid_t>(return_type)) };
+			const auto return_type = get_host_function_return_type(a, parent, callee_expr, call_args2);
+			return resolve_send_call(a, parent, callee_expr, call_args2, return_type);
 		}
 		else{
-			return { a_acc, expression_t::make_call(callee_expr, call_args_pair.second, make_shared<typeid_t>(callee_return_value)) };
+			return expression_t::make_call(callee_expr, call_args2, make_shared<typeid_t>(callee_return_value));
 		}
 	}
 
 	//	Attempting to call a TYPE? Then this may be a constructor call.
 	//	Converts these calls to construct-value-expressions.
 	else if(callee_type.is_typeid() && callee_expr.get_operation() == expression_type::k_load2){
-		const auto found_symbol_ptr = resolve_symbol_by_address(a_acc, callee_expr._address);
+		const auto found_symbol_ptr = resolve_symbol_by_address(a, callee_expr._address);
 		QUARK_ASSERT(found_symbol_ptr != nullptr);
 
 		if(found_symbol_ptr->_const_value.is_undefined()){
@@ -1456,19 +1447,17 @@ std::pair<analyser_t, expression_t> analyse_call_expression(const analyser_t& a,
 			if(callee_type2.is_struct()){
 				const auto& def = callee_type2.get_struct();
 				const auto callee_args = get_member_types(def._members);
-				const auto call_args_pair = analyze_call_args(a_acc, parent, args0, callee_args);
-				a_acc = call_args_pair.first;
+				const auto call_args2 = analyze_call_args(a, parent, args0, callee_args);
 
-				return { a_acc, expression_t::make_construct_value_expr(callee_type2, call_args_pair.second) };
+				return expression_t::make_construct_value_expr(callee_type2, call_args2);
 			}
 
 			//	One argument for primitive types.
 			else{
 				const auto callee_args = vector<typeid_t>{ callee_type2 };
 				QUARK_ASSERT(callee_args.size() == 1);
-				const auto call_args_pair = analyze_call_args(a_acc, parent, args0, callee_args);
-				a_acc = call_args_pair.first;
-				return { a_acc, expression_t::make_construct_value_expr(callee_type2, call_args_pair.second) };
+				const auto call_args2 = analyze_call_args(a, parent, args0, callee_args);
+				return expression_t::make_construct_value_expr(callee_type2, call_args2);
 			}
 		}
 	}
@@ -1479,10 +1468,9 @@ std::pair<analyser_t, expression_t> analyse_call_expression(const analyser_t& a,
 	}
 }
 
-std::pair<analyser_t, expression_t> analyse_struct_definition_expression(const analyser_t& a, const statement_t& parent, const expression_t& e0){
+expression_t analyse_struct_definition_expression(analyser_t& a, const statement_t& parent, const expression_t& e0){
 	QUARK_ASSERT(a.check_invariant());
 
-	auto a_acc = a;
 	const auto& struct_def = *e0._struct_def;
 
 	//	Resolve member types in this scope.
@@ -1490,27 +1478,25 @@ std::pair<analyser_t, expression_t> analyse_struct_definition_expression(const a
 	for(const auto& e: struct_def._members){
 		const auto name = e._name;
 		const auto type = e._type;
-		const auto type2 = resolve_type(a_acc, parent.location, type);
+		const auto type2 = resolve_type(a, parent.location, type);
 		const auto e2 = member_t(type2, name);
 		members2.push_back(e2);
 	}
 	const auto resolved_struct_def = std::make_shared<struct_definition_t>(struct_definition_t(members2));
-	return {a_acc, expression_t::make_struct_definition(resolved_struct_def) };
+	return expression_t::make_struct_definition(resolved_struct_def);
 }
 
 // ??? Check that function returns a value, if so specified.
-std::pair<analyser_t, expression_t> analyse_function_definition_expression(const analyser_t& a, const statement_t& parent, const expression_t& e){
+expression_t analyse_function_definition_expression(analyser_t& a, const statement_t& parent, const expression_t& e){
 	QUARK_ASSERT(a.check_invariant());
 
-	auto a_acc = a;
-
 	const auto function_def = e._function_def;
-	const auto function_type2 = resolve_type(a_acc, parent.location, function_def->_function_type);
+	const auto function_type2 = resolve_type(a, parent.location, function_def->_function_type);
 	const auto function_pure = function_type2.get_function_pure();
 
 	vector<member_t> args2;
 	for(const auto& arg: function_def->_args){
-		const auto arg_type2 = resolve_type(a_acc, parent.location, arg._type);
+		const auto arg_type2 = resolve_type(a, parent.location, arg._type);
 		args2.push_back(member_t(arg_type2, arg._name));
 	}
 
@@ -1525,31 +1511,29 @@ std::pair<analyser_t, expression_t> analyse_function_definition_expression(const
 	//??? Can there be a pure function inside an impure lexical scope?
 	const auto pure = function_pure;
 
-	const auto function_body_pair = analyse_body(a_acc, function_body2, pure, function_type2.get_function_return());
-	a_acc = function_body_pair.first;
-	const auto function_body3 = function_body_pair.second;
+	const auto function_body3 = analyse_body(a, function_body2, pure, function_type2.get_function_return());
 
 	const auto function_def2 = function_definition_t{ k_no_location, function_type2, args2, make_shared<body_t>(function_body3), 0 };
 
 	QUARK_ASSERT(function_def2.check_types_resolved());
 
-	a_acc._function_defs.push_back(make_shared<function_definition_t>(function_def2));
+	a._function_defs.push_back(make_shared<function_definition_t>(function_def2));
 
-	const int function_id = static_cast<int>(a_acc._function_defs.size() - 1);
+	const int function_id = static_cast<int>(a._function_defs.size() - 1);
 	const auto r = expression_t::make_literal(value_t::make_function_value(function_type2, function_id));
 
-	return {a_acc, r };
+	return r;
 }
 
 
-std::pair<analyser_t, expression_t> analyse_expression__operation_specific(const analyser_t& a, const statement_t& parent, const expression_t& e, const typeid_t& target_type){
+expression_t analyse_expression__operation_specific(analyser_t& a, const statement_t& parent, const expression_t& e, const typeid_t& target_type){
 	QUARK_ASSERT(a.check_invariant());
 	QUARK_ASSERT(e.check_invariant());
 
 	const auto op = e.get_operation();
 
 	if(op == expression_type::k_literal){
-		return { a, e };
+		return e;
 	}
 	else if(op == expression_type::k_resolve_member){
 		return analyse_resolve_member_expression(a, parent, e);
@@ -1642,17 +1626,14 @@ expression_t auto_cast_expression_type(const expression_t& e, const floyd::typei
 }
 
 //	Returned expression is guaranteed to be deep-resolved.
-std::pair<analyser_t, expression_t> analyse_expression_to_target(const analyser_t& a, const statement_t& parent, const expression_t& e, const typeid_t& target_type){
+expression_t analyse_expression_to_target(analyser_t& a, const statement_t& parent, const expression_t& e, const typeid_t& target_type){
 	QUARK_ASSERT(a.check_invariant());
 	QUARK_ASSERT(parent.check_invariant());
 	QUARK_ASSERT(e.check_invariant());
 	QUARK_ASSERT(target_type.is_void() == false && target_type.is_undefined() == false);
 	QUARK_ASSERT(target_type.check_types_resolved());
 
-	auto a_acc = a;
-	const auto e2_pair = analyse_expression__operation_specific(a_acc, parent, e, target_type);
-	a_acc = e2_pair.first;
-	const auto e2b = e2_pair.second;
+	const auto e2b = analyse_expression__operation_specific(a, parent, e, target_type);
 	if(e2b.check_types_resolved() == false){
 		std::stringstream what;
 		what << "Cannot infer type in " << expression_type_to_token(e2b.get_operation()) << "-expression.";
@@ -1680,20 +1661,20 @@ std::pair<analyser_t, expression_t> analyse_expression_to_target(const analyser_
 		throw_compiler_error(parent.location, "Cannot resolve type.");
 	}
 	QUARK_ASSERT(e3.check_types_resolved());
-	return { a_acc, e3 };
+	return e3;
 }
 
 //	Returned expression is guaranteed to be deep-resolved.
-std::pair<analyser_t, expression_t> analyse_expression_no_target(const analyser_t& a, const statement_t& parent, const expression_t& e){
+expression_t analyse_expression_no_target(analyser_t& a, const statement_t& parent, const expression_t& e){
 	return analyse_expression_to_target(a, parent, e, typeid_t::make_internal_dynamic());
 }
 
 void test__analyse_expression(const statement_t& parent, const expression_t& e, const expression_t& expected){
 	const ast_t ast;
-	const analyser_t interpreter(ast);
+	analyser_t interpreter(ast);
 	const auto e3 = analyse_expression_no_target(interpreter, parent, e);
 
-	ut_verify(QUARK_POS, expression_to_json(e3.second)._value, expression_to_json(expected)._value);
+	ut_verify(QUARK_POS, expression_to_json(e3)._value, expression_to_json(expected)._value);
 }
 
 
@@ -1707,7 +1688,7 @@ QUARK_UNIT_TEST("analyse_expression_no_target()", "literal 1234 == 1234", "", ""
 
 QUARK_UNIT_TEST("analyse_expression_no_target()", "1 + 2 == 3", "", "") {
 	const ast_t ast;
-	const analyser_t interpreter(ast);
+	analyser_t interpreter(ast);
 	const auto e3 = analyse_expression_no_target(
 		interpreter,
 		statement_t::make__bind_local(k_no_location, "xyz", typeid_t::make_string(), expression_t::make_literal_string("abc"), statement_t::bind_local_t::mutable_mode::k_immutable),
@@ -1720,7 +1701,7 @@ QUARK_UNIT_TEST("analyse_expression_no_target()", "1 + 2 == 3", "", "") {
 	);
 
 	ut_verify(QUARK_POS,
-		expression_to_json(e3.second)._value,
+		expression_to_json(e3)._value,
 		parse_json(seq_t(R"(   ["+", ["k", 1, "^int"], ["k", 2, "^int"], "^int"]   )")).first
 	);
 }
@@ -1739,15 +1720,12 @@ bool check_types_resolved(const ast_t& ast){
 	return true;
 }
 
-semantic_ast_t analyse(const analyser_t& a){
+//	Built-in types and constants + host functions. Host functions get function ids from 0 and up.
+semantic_prelude_t make_root_scope(const analyser_t& a){
 	QUARK_ASSERT(a.check_invariant());
 
-	/*
-		Create built-in globla symbol map: built in data types, built-in functions (host functions).
-	*/
 	std::vector<std::pair<std::string, symbol_t>> symbol_map;
-
-	auto function_defs = a._imm->_ast._function_defs;
+	std::vector<std::shared_ptr<const function_definition_t>> function_defs;
 
 	//	Insert built-in functions.
 	for(auto hf_kv: a._imm->_host_functions){
@@ -1794,17 +1772,40 @@ semantic_ast_t analyse(const analyser_t& a){
 	symbol_map.push_back({keyword_t::k_json_false, symbol_t::make_constant(value_t::make_int(6))});
 	symbol_map.push_back({keyword_t::k_json_null, symbol_t::make_constant(value_t::make_int(7))});
 
-	auto analyser2 = a;
-	analyser2._function_defs.swap(function_defs);
+	return semantic_prelude_t{ {}, symbol_table_t{symbol_map}, function_defs };
+}
+
+/*
+	The global statements are analysed in the prelude's root scope, as if they followed the prelude's statements.
+*/
+semantic_ast_t analyse(analyser_t& a, const semantic_prelude_t& prelude){
+	QUARK_ASSERT(a.check_invariant());
+	QUARK_ASSERT(a._imm->_ast._function_defs.empty());
+	QUARK_ASSERT(a._lexical_scope_stack.empty());
+
+	a._function_defs = prelude._function_defs;
+
+	//	send() calls are checked against the container's processes, so we need the container-def before analysing
+	//	any function, wherever it is in the source.
+	for(const auto& statement: a._imm->_ast._globals._statements){
+		if(const auto container_def = std::get_if<statement_t::container_def_statement_t>(&statement._contents)){
+			a._container_def = parse_container_def_json(container_def->_json_data);
+		}
+	}
+
+	a._lexical_scope_stack.push_back(make_lexical_scope(prelude._symbols, epure::impure));
+	const auto result = analyse_statements(a, a._imm->_ast._globals._statements, typeid_t::make_undefined());
+
+	auto statements = prelude._statements;
+	statements.insert(statements.end(), result.begin(), result.end());
 
-	const auto body = body_t(analyser2._imm->_ast._globals._statements, symbol_table_t{symbol_map});
-	const auto result = analyse_body(analyser2, body, epure::impure, typeid_t::make_undefined());
 	const auto result_ast0 = ast_t{
-		._globals = result. second,
-		._function_defs = result.first._function_defs,
-		._software_system = result.first._software_system,
-		._container_def = result.first._container_def
+		._globals = body_t(statements, a._lexical_scope_stack.back().symbols),
+		._function_defs = a._function_defs,
+		._software_system = a._software_system,
+		._container_def = a._container_def
 	};
+	a._lexical_scope_stack.pop_back();
 
 	const auto result_ast1 = semantic_ast_t(result_ast0);
 	QUARK_ASSERT(result_ast1._checked_ast.check_invariant());
@@ -1825,34 +1826,13 @@ analyser_t::analyser_t(const ast_t& ast){
 	_imm = make_shared<analyzer_imm_t>(analyzer_imm_t{ast, host_functions});
 }
 
-analyser_t::analyser_t(const analyser_t& other) :
-	_imm(other._imm),
-	_lexical_scope_stack(other._lexical_scope_stack),
-	_function_defs(other._function_defs),
-	_software_system(other._software_system),
-	_container_def(other._container_def)
-{
-	QUARK_ASSERT(other.check_invariant());
-	QUARK_ASSERT(check_invariant());
-}
-
-void analyser_t::swap(analyser_t& other) throw() {
-	_imm.swap(other._imm);
-	_lexical_scope_stack.swap(other._lexical_scope_stack);
-	_function_defs.swap(other._function_defs);
-	std::swap(_software_system, other._software_system);
-	std::swap(_container_def, other._container_def);
-}
-
-const analyser_t& analyser_t::operator=(const analyser_t& other){
-	auto temp = other;
-	swap(temp);
-	return *this;
-}
-
 #if DEBUG
+//	The input AST is checked once, by the constructor. This is called for every statement and expression.
 bool analyser_t::check_invariant() const {
-	QUARK_ASSERT(_imm->_ast.check_invariant());
+	QUARK_ASSERT(_imm != nullptr);
+	for(const auto& e: _lexical_scope_stack){
+		QUARK_ASSERT(e.symbol_indexes.size() <= e.symbols._symbols.size());
+	}
 	return true;
 }
 #endif
@@ -1861,13 +1841,104 @@ bool analyser_t::check_invariant() const {
 //////////////////////////////////////		run_semantic_analysis()
 
 
+semantic_prelude_t make_semantic_prelude(const ast_t& prelude){
+	QUARK_ASSERT(prelude.check_invariant());
+
+	analyser_t a(prelude);
+	const auto root = make_root_scope(a);
+	const auto result = analyse(a, root);
+
+	const auto& checked = result._checked_ast;
+	if(checked._software_system._name.empty() == false || checked._container_def._name.empty() == false){
+		quark::throw_runtime_error("Prelude cannot define a software-system or container.");
+	}
+	return semantic_prelude_t{ checked._globals._statements, checked._globals._symbols, checked._function_defs };
+}
+
+semantic_ast_t run_semantic_analysis(const ast_t& ast, const semantic_prelude_t& prelude){
+	QUARK_ASSERT(ast.check_invariant());
+
+	analyser_t a(ast);
+	const auto result = analyse(a, prelude);
+	return result;
+}
+
 semantic_ast_t run_semantic_analysis(const ast_t& ast){
 	QUARK_ASSERT(ast.check_invariant());
 
 	analyser_t a(ast);
-	const auto result = analyse(a);
+	const auto result = analyse(a, make_root_scope(a));
 	return result;
 }
 
 
+//////////////////////////////////////		incremental_analyser_t
+
+
+incremental_analyser_t::incremental_analyser_t(const semantic_prelude_t& prelude) :
+	_analyser(std::make_unique<analyser_t>(ast_t{ body_t{}, {}, {}, {} }))
+{
+	_analyser->_function_defs = prelude._function_defs;
+	_analyser->_lexical_scope_stack.push_back(make_lexical_scope(prelude._symbols, epure::impure));
+}
+
+incremental_analyser_t::~incremental_analyser_t(){
+}
+
+//	Drops everything added to the global scope after it had global_count globals and function_count functions.
+static void truncate_globals(analyser_t& a, size_t global_count, size_t function_count){
+	a._lexical_scope_stack.erase(a._lexical_scope_stack.begin() + 1, a._lexical_scope_stack.end());
+	while(a._lexical_scope_stack[0].symbols._symbols.size() > global_count){
+		remove_last_symbol(a);
+	}
+	a._function_defs.erase(a._function_defs.begin() + function_count, a._function_defs.end());
+}
+
+semantic_increment_t analyse_increment(incremental_analyser_t& session, const ast_t& ast){
+	QUARK_ASSERT(ast.check_invariant());
+
+	auto& a = *session._analyser;
+	QUARK_ASSERT(a._lexical_scope_stack.size() == 1);
+
+	a._imm = make_shared<analyzer_imm_t>(analyzer_imm_t{ ast, a._imm->_host_functions });
+
+	const auto global_count = a._lexical_scope_stack[0].symbols._symbols.size();
+	const auto function_count = a._function_defs.size();
+	try {
+		const auto statements = analyse_statements(a, ast._globals._statements, typeid_t::make_undefined());
+		const auto& globals = a._lexical_scope_stack[0].symbols._symbols;
+		return semantic_increment_t{
+			statements,
+			{ globals.begin() + global_count, globals.end() },
+			{ a._function_defs.begin() + function_count, a._function_defs.end() }
+		};
+	}
+	catch(...){
+		truncate_globals(a, global_count, function_count);
+		throw;
+	}
+}
+
+void undo_increment(incremental_analyser_t& session, const semantic_increment_t& increment){
+	auto& a = *session._analyser;
+	QUARK_ASSERT(a._lexical_scope_stack.size() == 1);
+	QUARK_ASSERT(a._lexical_scope_stack[0].symbols._symbols.size() >= increment._globals.size());
+	QUARK_ASSERT(a._function_defs.size() >= increment._function_defs.size());
+
+	truncate_globals(
+		a,
+		a._lexical_scope_stack[0].symbols._symbols.size() - increment._globals.size(),
+		a._function_defs.size() - increment._function_defs.size()
+	);
+}
+
+void add_hidden_globals(incremental_analyser_t& session, const std::vector<std::pair<std::string, symbol_t>>& symbols){
+	auto& a = *session._analyser;
+	QUARK_ASSERT(a._lexical_scope_stack.size() == 1);
+
+	auto& globals = a._lexical_scope_stack[0].symbols._symbols;
+	globals.insert(globals.end(), symbols.begin(), symbols.end());
+}
+
+
 }	//	floyd
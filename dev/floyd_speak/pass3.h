@@ -26,6 +26,7 @@
 
 #include "quark.h"
 
+#include <memory>
 #include <string>
 #include "ast.h"
 
@@ -50,12 +51,74 @@ struct semantic_ast_t {
 };
 
 
+//////////////////////////////////////		semantic_prelude_t
+
+/*
+	The root scope programs are analysed in: built-in types, host functions and the analysed statements of a
+	prelude program, like k_builtin_types_and_constants.
+
+	Analysing a program in a prelude gives the same semantic_ast_t as analysing the prelude's source followed by the
+	program's source, but the prelude is only parsed and analysed once. Immutable, share it between threads.
+*/
+struct semantic_prelude_t {
+	public: std::vector<statement_t> _statements;
+	public: symbol_table_t _symbols;
+	public: std::vector<std::shared_ptr<const floyd::function_definition_t>> _function_defs;
+};
+
+//	The prelude cannot have a software-system or container-def.
+semantic_prelude_t make_semantic_prelude(const ast_t& prelude);
+
+
 /*
 	Semantic Analysis -> SYMBOL TABLE + annotated AST
 */
+semantic_ast_t run_semantic_analysis(const ast_t& ast, const semantic_prelude_t& prelude);
+
+//	Uses an empty prelude: only built-in types and host functions.
 semantic_ast_t run_semantic_analysis(const ast_t& ast);
 
 
+//////////////////////////////////////		incremental_analyser_t
+
+/*
+	Analyses a program a few global statements at a time, for the REPL. The global scope and the function
+	definitions are kept between calls, so a call only analyses its own statements and costs the same no matter how
+	many statements came before it.
+*/
+
+struct analyser_t;
+
+struct semantic_increment_t {
+	public: std::vector<statement_t> _statements;
+
+	//	Globals added by the statements. They follow the globals of the earlier increments.
+	public: std::vector<std::pair<std::string, symbol_t>> _globals;
+
+	//	Functions defined by the statements. Their function ids follow the earlier increments' functions.
+	public: std::vector<std::shared_ptr<const floyd::function_definition_t>> _function_defs;
+};
+
+struct incremental_analyser_t {
+	public: explicit incremental_analyser_t(const semantic_prelude_t& prelude);
+	public: ~incremental_analyser_t();
+
+
+	////////////////////////////////	STATE
+	public: std::unique_ptr<analyser_t> _analyser;
+};
+
+//	If the analysis fails, the analyser is left as it was before the call.
+semantic_increment_t analyse_increment(incremental_analyser_t& a, const ast_t& ast);
+
+//	Removes the increment returned by the latest analyse_increment(), for when it cannot be used after all.
+void undo_increment(incremental_analyser_t& a, const semantic_increment_t& increment);
+
+//	Appends globals that programs cannot see by name, like the code generator's temporaries, so the next increment's
+//	globals get indexes after them.
+void add_hidden_globals(incremental_analyser_t& a, const std::vector<std::pair<std::string, symbol_t>>& symbols);
+
+
 }	// Floyd
 #endif /* pass3_hpp */
 
@@ -0,0 +1,880 @@
+//
+//  pass4.cpp
+//  FloydSpeak
+//
+//  Created by Marcus Zetterquist on 2019-03-16.
+//  Copyright © 2019 Marcus Zetterquist. All rights reserved.
+//
+
+#include "pass4.h"
+
+#include "statement.h"
+#include "ast_value.h"
+#include "json_support.h"
+#include "host_functions.h"
+#include "floyd_interpreter.h"
+#include "text_parser.h"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace floyd {
+
+using namespace std;
+
+
+//////////////////////////////////////		optimizer_t
+
+
+struct optimizer_scope_t {
+	const symbol_table_t* _symbols;
+
+	//	Values of immutable locals bound to a literal, by symbol index. Undefined = not known.
+	vector<value_t> _known_values;
+};
+
+struct optimizer_t {
+	const vector<shared_ptr<const function_definition_t>>& _function_defs;
+
+	//	[0] is the global scope. Empty when there are no symbols at all.
+	vector<optimizer_scope_t> _scopes;
+};
+
+
+static optimizer_scope_t make_optimizer_scope(const symbol_table_t& symbols){
+	return optimizer_scope_t{ &symbols, vector<value_t>(symbols._symbols.size(), value_t::make_undefined()) };
+}
+
+//	Returns -1 if the address can't be resolved to one of the optimizer's scopes.
+static int resolve_scope_index(const optimizer_t& o, const variable_address_t& address){
+	if(o._scopes.empty()){
+		return -1;
+	}
+	else if(address._parent_steps == -1){
+		return 0;
+	}
+	else{
+		const auto index = static_cast<int>(o._scopes.size()) - 1 - address._parent_steps;
+
+		//	Function bodies reach globals with -1. Other steps to the global scope comes from enclosing blocks, that we
+		//	don't track.
+		if(index < 0 || (index == 0 && o._scopes.size() > 1)){
+			return -1;
+		}
+		return index;
+	}
+}
+
+static const symbol_t* resolve_symbol(const optimizer_t& o, const variable_address_t& address){
+	const auto scope_index = resolve_scope_index(o, address);
+	if(scope_index == -1){
+		return nullptr;
+	}
+	const auto& symbols = o._scopes[scope_index]._symbols->_symbols;
+	if(address._index < 0 || address._index >= symbols.size()){
+		return nullptr;
+	}
+	return &symbols[address._index].second;
+}
+
+static bool is_foldable_type(const typeid_t& type){
+	return type.is_bool() || type.is_int() || type.is_double() || type.is_string();
+}
+
+static expression_t replace_inputs(const expression_t& e, const vector<expression_t>& inputs){
+	return expression_t(e._operation, inputs, e._output_type, e._value, e._struct_def, e._function_def, e._variable_name, e._address);
+}
+
+
+
+//////////////////////////////////////		SIDE EFFECTS
+
+
+static bool is_nonzero_literal(const expression_t& e){
+	if(e.is_literal() == false){
+		return false;
+	}
+	const auto& value = e.get_literal();
+	if(value.is_int()){
+		return value.get_int_value() != 0 && value.get_int_value() != -1;
+	}
+	else if(value.is_double()){
+		return value.get_double_value() != 0.0;
+	}
+	else{
+		return false;
+	}
+}
+
+/*
+	True if evaluating the expression can't be observed: it can't print, throw, fail an assert or loop forever.
+	Calls and lookups are never side effect free, even calls to pure functions.
+*/
+static bool is_side_effect_free(const expression_t& e){
+	const auto op = e.get_operation();
+	const auto inputs_free = [&](){
+		for(const auto& input: e._input_exprs){
+			if(is_side_effect_free(input) == false){
+				return false;
+			}
+		}
+		return true;
+	};
+
+	if(false
+		|| op == expression_type::k_literal
+		|| op == expression_type::k_load
+		|| op == expression_type::k_load2
+		|| op == expression_type::k_struct_def
+		|| op == expression_type::k_function_def
+	){
+		return true;
+	}
+	else if(op == expression_type::k_arithmetic_divide__2 || op == expression_type::k_arithmetic_remainder__2){
+		return is_nonzero_literal(e._input_exprs[1]) && inputs_free();
+	}
+	else if(false
+		|| is_arithmetic_expression(op)
+		|| is_comparison_expression(op)
+		|| op == expression_type::k_arithmetic_unary_minus__1
+		|| op == expression_type::k_conditional_operator3
+		|| op == expression_type::k_value_constructor
+	){
+		return inputs_free();
+	}
+	else if(op == expression_type::k_resolve_member){
+		return e._input_exprs[0].get_output_type().is_struct() && inputs_free();
+	}
+	else{
+		return false;
+	}
+}
+
+
+
+//////////////////////////////////////		FOLDING
+
+
+//	Returns undefined if the operation can't be folded, for example division by zero, which must fail at runtime.
+static value_t fold_arithmetic(expression_type op, const value_t& left, const value_t& right){
+	const auto type = left.get_type();
+	if(type != right.get_type()){
+		return value_t::make_undefined();
+	}
+
+	if(type.is_int()){
+		//	Wraps around like the interpreter's int64 arithmetic, without C++ signed overflow.
+		const auto l = left.get_int_value();
+		const auto r = right.get_int_value();
+		const auto lu = static_cast<uint64_t>(l);
+		const auto ru = static_cast<uint64_t>(r);
+		const auto div_ok = r != 0 && !(l == std::numeric_limits<int64_t>::min() && r == -1);
+
+		if(op == expression_type::k_arithmetic_add__2){
+			return value_t::make_int(static_cast<int64_t>(lu + ru));
+		}
+		else if(op == expression_type::k_arithmetic_subtract__2){
+			return value_t::make_int(static_cast<int64_t>(lu - ru));
+		}
+		else if(op == expression_type::k_arithmetic_multiply__2){
+			return value_t::make_int(static_cast<int64_t>(lu * ru));
+		}
+		else if(op == expression_type::k_arithmetic_divide__2){
+			return div_ok ? value_t::make_int(l / r) : value_t::make_undefined();
+		}
+		else if(op == expression_type::k_arithmetic_remainder__2){
+			return div_ok ? value_t::make_int(l % r) : value_t::make_undefined();
+		}
+		else if(op == expression_type::k_logical_and__2){
+			return value_t::make_bool(l != 0 && r != 0);
+		}
+		else if(op == expression_type::k_logical_or__2){
+			return value_t::make_bool(l != 0 || r != 0);
+		}
+	}
+	else if(type.is_double()){
+		const auto l = left.get_double_value();
+		const auto r = right.get_double_value();
+		if(op == expression_type::k_arithmetic_add__2){
+			return value_t::make_double(l + r);
+		}
+		else if(op == expression_type::k_arithmetic_subtract__2){
+			return value_t::make_double(l - r);
+		}
+		else if(op == expression_type::k_arithmetic_multiply__2){
+			return value_t::make_double(l * r);
+		}
+		else if(op == expression_type::k_arithmetic_divide__2){
+			return r != 0.0 ? value_t::make_double(l / r) : value_t::make_undefined();
+		}
+		else if(op == expression_type::k_logical_and__2){
+			return value_t::make_bool(l != 0.0 && r != 0.0);
+		}
+		else if(op == expression_type::k_logical_or__2){
+			return value_t::make_bool(l != 0.0 || r != 0.0);
+		}
+	}
+	else if(type.is_bool()){
+		if(op == expression_type::k_logical_and__2){
+			return value_t::make_bool(left.get_bool_value() && right.get_bool_value());
+		}
+		else if(op == expression_type::k_logical_or__2){
+			return value_t::make_bool(left.get_bool_value() || right.get_bool_value());
+		}
+	}
+	else if(type.is_string()){
+		if(op == expression_type::k_arithmetic_add__2){
+			return value_t::make_string(left.get_string_value() + right.get_string_value());
+		}
+	}
+	return value_t::make_undefined();
+}
+
+static value_t fold_comparison(expression_type op, const value_t& left, const value_t& right){
+	if(left.get_type() != right.get_type()){
+		return value_t::make_undefined();
+	}
+
+	const auto diff = value_t::compare_value_true_deep(left, right);
+	if(op == expression_type::k_comparison_smaller_or_equal__2){
+		return value_t::make_bool(diff <= 0);
+	}
+	else if(op == expression_type::k_comparison_smaller__2){
+		return value_t::make_bool(diff < 0);
+	}
+	else if(op == expression_type::k_comparison_larger_or_equal__2){
+		return value_t::make_bool(diff >= 0);
+	}
+	else if(op == expression_type::k_comparison_larger__2){
+		return value_t::make_bool(diff > 0);
+	}
+	else if(op == expression_type::k_logical_equal__2){
+		return value_t::make_bool(diff == 0);
+	}
+	else if(op == expression_type::k_logical_nonequal__2){
+		return value_t::make_bool(diff != 0);
+	}
+	else{
+		return value_t::make_undefined();
+	}
+}
+
+//	Returns the host function id of the callee or k_no_host_function_id.
+static int get_callee_host_function_id(const optimizer_t& o, const expression_t& callee){
+	if(callee.get_operation() != expression_type::k_load2 || callee._address._parent_steps != -1){
+		return k_no_host_function_id;
+	}
+	const auto symbol = resolve_symbol(o, callee._address);
+	if(symbol == nullptr || symbol->_const_value.is_function() == false){
+		return k_no_host_function_id;
+	}
+	const auto function_id = symbol->_const_value.get_function_value();
+	if(function_id < 0 || function_id >= o._function_defs.size()){
+		return k_no_host_function_id;
+	}
+	return o._function_defs[function_id]->_host_function_id;
+}
+
+//	Only a few pure host functions are folded: the ones with an obvious result on literals.
+static value_t fold_host_call(int host_function_id, const vector<expression_t>& args){
+	if(args.size() != 1){
+		return value_t::make_undefined();
+	}
+	const auto& arg = args[0];
+
+	if(host_function_id == static_cast<int>(host_function_id::size)){
+		if(arg.is_literal() && arg.get_literal().is_string()){
+			return value_t::make_int(static_cast<int64_t>(arg.get_literal().get_string_value().size()));
+		}
+
+		//	Vector constructor: one input per element.
+		else if(arg.get_operation() == expression_type::k_value_constructor && arg.get_output_type().is_vector() && is_side_effect_free(arg)){
+			return value_t::make_int(static_cast<int64_t>(arg._input_exprs.size()));
+		}
+	}
+	else if(host_function_id == static_cast<int>(host_function_id::to_string)){
+		if(arg.is_literal() && is_foldable_type(arg.get_output_type())){
+			return value_t::make_string(to_compact_string2(arg.get_literal()));
+		}
+	}
+	return value_t::make_undefined();
+}
+
+//	Returns folded if it has the expression's type, else e.
+static expression_t make_folded(const expression_t& e, const value_t& folded){
+	if(folded.is_undefined() == false && folded.get_type() == e.get_output_type()){
+		return expression_t::make_literal(folded);
+	}
+	else{
+		return e;
+	}
+}
+
+static expression_t optimize_expression(optimizer_t& o, const expression_t& e){
+	QUARK_ASSERT(e.check_invariant());
+
+	const auto op = e.get_operation();
+	if(op == expression_type::k_literal){
+		return e;
+	}
+	else if(op == expression_type::k_load2){
+		const auto scope_index = resolve_scope_index(o, e._address);
+		if(scope_index > 0 && e._address._index < o._scopes[scope_index]._known_values.size()){
+			return make_folded(e, o._scopes[scope_index]._known_values[e._address._index]);
+		}
+		return e;
+	}
+
+	vector<expression_t> inputs;
+	for(const auto& input: e._input_exprs){
+		inputs.push_back(optimize_expression(o, input));
+	}
+	const auto e2 = replace_inputs(e, inputs);
+
+	if(is_arithmetic_expression(op)){
+		const auto& left = inputs[0];
+		const auto& right = inputs[1];
+		if(left.is_literal() && right.is_literal()){
+			return make_folded(e2, fold_arithmetic(op, left.get_literal(), right.get_literal()));
+		}
+
+		//	&& and || evaluate both sides, so a literal side decides the result only if the other side is side
+		//	effect free.
+		const auto is_bool_op = (op == expression_type::k_logical_and__2 || op == expression_type::k_logical_or__2)
+			&& left.get_output_type().is_bool() && right.get_output_type().is_bool();
+		if(is_bool_op && (left.is_literal() || right.is_literal())){
+			const auto& literal = left.is_literal() ? left : right;
+			const auto& other = left.is_literal() ? right : left;
+			const auto decides = op == expression_type::k_logical_and__2 ? false : true;
+			if(literal.get_literal().get_bool_value() == decides){
+				return is_side_effect_free(other) ? expression_t::make_literal_bool(decides) : e2;
+			}
+			else{
+				return other;
+			}
+		}
+		return e2;
+	}
+	else if(is_comparison_expression(op)){
+		const auto& left = inputs[0];
+		const auto& right = inputs[1];
+		if(left.is_literal() && right.is_literal() && is_foldable_type(left.get_output_type())){
+			return make_folded(e2, fold_comparison(op, left.get_literal(), right.get_literal()));
+		}
+		return e2;
+	}
+	else if(op == expression_type::k_arithmetic_unary_minus__1){
+		const auto& input = inputs[0];
+		if(input.is_literal() && input.get_literal().is_int()){
+			return make_folded(e2, value_t::make_int(static_cast<int64_t>(0 - static_cast<uint64_t>(input.get_literal().get_int_value()))));
+		}
+		//	The interpreter computes 0.0 - v, not -v: they differ for v == 0.0.
+		else if(input.is_literal() && input.get_literal().is_double()){
+			return make_folded(e2, value_t::make_double(0.0 - input.get_literal().get_double_value()));
+		}
+		return e2;
+	}
+	else if(op == expression_type::k_conditional_operator3){
+		const auto& condition = inputs[0];
+		if(condition.is_literal() && condition.get_literal().is_bool()){
+			const auto& picked = condition.get_literal().get_bool_value() ? inputs[1] : inputs[2];
+			return picked.get_output_type() == e.get_output_type() ? picked : e2;
+		}
+		return e2;
+	}
+	else if(op == expression_type::k_call){
+		const auto host_function_id = get_callee_host_function_id(o, inputs[0]);
+		if(host_function_id != k_no_host_function_id){
+			return make_folded(e2, fold_host_call(host_function_id, { inputs.begin() + 1, inputs.end() }));
+		}
+		return e2;
+	}
+	else{
+		return e2;
+	}
+}
+
+expression_t optimize_expression(const expression_t& e){
+	const vector<shared_ptr<const function_definition_t>> function_defs;
+	optimizer_t o{ function_defs, {} };
+	return optimize_expression(o, e);
+}
+
+
+
+//////////////////////////////////////		STATEMENTS
+
+
+static body_t optimize_body(optimizer_t& o, const body_t& body);
+
+
+//	Counts the loads of the symbols of the body at depth 0, from its statements and nested bodies.
+static void count_loads(const expression_t& e, int depth, vector<int>& counts){
+	if(e.get_operation() == expression_type::k_load2 && e._address._parent_steps == depth){
+		counts[e._address._index]++;
+	}
+	for(const auto& input: e._input_exprs){
+		count_loads(input, depth, counts);
+	}
+}
+
+static void count_loads(const vector<statement_t>& statements, int depth, vector<int>& counts){
+	for(const auto& statement: statements){
+		struct visitor_t {
+			int depth;
+			vector<int>& counts;
+
+			void operator()(const statement_t::return_statement_t& s) const{
+				count_loads(s._expression, depth, counts);
+			}
+			void operator()(const statement_t::define_struct_statement_t& s) const{
+			}
+			void operator()(const statement_t::define_protocol_statement_t& s) const{
+			}
+			void operator()(const statement_t::define_function_statement_t& s) const{
+			}
+			void operator()(const statement_t::bind_local_t& s) const{
+				count_loads(s._expression, depth, counts);
+			}
+			void operator()(const statement_t::store_t& s) const{
+				count_loads(s._expression, depth, counts);
+			}
+			void operator()(const statement_t::store2_t& s) const{
+				count_loads(s._expression, depth, counts);
+			}
+			void operator()(const statement_t::block_statement_t& s) const{
+				count_loads(s._body._statements, depth + 1, counts);
+			}
+			void operator()(const statement_t::ifelse_statement_t& s) const{
+				count_loads(s._condition, depth, counts);
+				count_loads(s._then_body._statements, depth + 1, counts);
+				count_loads(s._else_body._statements, depth + 1, counts);
+			}
+			void operator()(const statement_t::for_statement_t& s) const{
+				count_loads(s._start_expression, depth, counts);
+				count_loads(s._end_expression, depth, counts);
+				count_loads(s._body._statements, depth + 1, counts);
+			}
+			void operator()(const statement_t::while_statement_t& s) const{
+				count_loads(s._condition, depth, counts);
+				count_loads(s._body._statements, depth + 1, counts);
+			}
+			void operator()(const statement_t::expression_statement_t& s) const{
+				count_loads(s._expression, depth, counts);
+			}
+			void operator()(const statement_t::software_system_statement_t& s) const{
+			}
+			void operator()(const statement_t::container_def_statement_t& s) const{
+			}
+		};
+		std::visit(visitor_t{ depth, counts }, statement._contents);
+	}
+}
+
+//	Removes the body's stores to its own locals that are never read. Repeats since removing a store can make
+//	another local unread.
+static vector<statement_t> remove_dead_stores(const body_t& body){
+	auto statements = body._statements;
+	while(true){
+		vector<int> counts(body._symbols._symbols.size(), 0);
+		count_loads(statements, 0, counts);
+
+		vector<statement_t> result;
+		for(const auto& statement: statements){
+			const auto store = std::get_if<statement_t::store2_t>(&statement._contents);
+			const auto dead = store != nullptr
+				&& store->_dest_variable._parent_steps == 0
+				&& counts[store->_dest_variable._index] == 0
+				&& is_side_effect_free(store->_expression);
+			if(dead == false){
+				result.push_back(statement);
+			}
+		}
+		if(result.size() == statements.size()){
+			return result;
+		}
+		statements = result;
+	}
+}
+
+static bool is_empty_range(const statement_t::for_statement_t& s){
+	if(s._start_expression.is_literal() == false || s._end_expression.is_literal() == false){
+		return false;
+	}
+	const auto start = s._start_expression.get_literal().get_int_value();
+	const auto end = s._end_expression.get_literal().get_int_value();
+	return s._range_type == statement_t::for_statement_t::k_open_range ? start >= end : start > end;
+}
+
+//	True if running the statement always ends with a return.
+static bool always_returns(const statement_t& statement){
+	const auto body_returns = [](const body_t& body){
+		return body._statements.empty() == false && always_returns(body._statements.back());
+	};
+
+	if(std::get_if<statement_t::return_statement_t>(&statement._contents)){
+		return true;
+	}
+	else if(const auto s = std::get_if<statement_t::block_statement_t>(&statement._contents)){
+		return body_returns(s->_body);
+	}
+	else if(const auto s = std::get_if<statement_t::ifelse_statement_t>(&statement._contents)){
+		return body_returns(s->_then_body) && body_returns(s->_else_body);
+	}
+	else{
+		return false;
+	}
+}
+
+//	Appends the body as a block statement, unless it's empty.
+static void push_block(vector<statement_t>& acc, const location_t& location, const body_t& body){
+	if(body._statements.empty() == false){
+		acc.push_back(statement_t::make__block_statement(location, body));
+	}
+}
+
+static vector<statement_t> optimize_statements(optimizer_t& o, const vector<statement_t>& statements){
+	vector<statement_t> acc;
+	for(const auto& statement: statements){
+		QUARK_ASSERT(statement.check_invariant());
+
+		const auto& loc = statement.location;
+		//	The rest of the statements are unreachable.
+		if(acc.empty() == false && always_returns(acc.back())){
+			return acc;
+		}
+
+		if(const auto s = std::get_if<statement_t::return_statement_t>(&statement._contents)){
+			acc.push_back(statement_t::make__return_statement(loc, optimize_expression(o, s->_expression)));
+		}
+		else if(const auto s = std::get_if<statement_t::store2_t>(&statement._contents)){
+			const auto e = optimize_expression(o, s->_expression);
+
+			//	Remember immutable locals bound to a literal. Never globals: they can be read before they are bound.
+			const auto scope_index = resolve_scope_index(o, s->_dest_variable);
+			if(scope_index > 0 && e.is_literal() && is_foldable_type(e.get_output_type())){
+				const auto symbol = resolve_symbol(o, s->_dest_variable);
+				if(symbol != nullptr && symbol->_symbol_type == symbol_t::immutable_local){
+					o._scopes[scope_index]._known_values[s->_dest_variable._index] = e.get_literal();
+				}
+			}
+			acc.push_back(statement_t::make__store2(loc, s->_dest_variable, e));
+		}
+		else if(const auto s = std::get_if<statement_t::block_statement_t>(&statement._contents)){
+			push_block(acc, loc, optimize_body(o, s->_body));
+		}
+		else if(const auto s = std::get_if<statement_t::ifelse_statement_t>(&statement._contents)){
+			const auto condition = optimize_expression(o, s->_condition);
+
+			//	The picked body becomes a block: it has its own scope, just like the branch did.
+			if(condition.is_literal()){
+				push_block(acc, loc, optimize_body(o, condition.get_literal().get_bool_value() ? s->_then_body : s->_else_body));
+			}
+			else{
+				const auto then_body = optimize_body(o, s->_then_body);
+				const auto else_body = optimize_body(o, s->_else_body);
+				acc.push_back(statement_t::make__ifelse_statement(loc, condition, then_body, else_body));
+			}
+		}
+		else if(const auto s = std::get_if<statement_t::for_statement_t>(&statement._contents)){
+			const auto s2 = statement_t::for_statement_t{
+				s->_iterator_name,
+				optimize_expression(o, s->_start_expression),
+				optimize_expression(o, s->_end_expression),
+				s->_body,
+				s->_range_type
+			};
+			if(is_empty_range(s2) == false){
+				acc.push_back(
+					statement_t::make__for_statement(loc, s2._iterator_name, s2._start_expression, s2._end_expression, optimize_body(o, s2._body), s2._range_type)
+				);
+			}
+		}
+		else if(const auto s = std::get_if<statement_t::while_statement_t>(&statement._contents)){
+			const auto condition = optimize_expression(o, s->_condition);
+			if(condition.is_literal() == false || condition.get_literal().get_bool_value() == true){
+				acc.push_back(statement_t::make__while_statement(loc, condition, optimize_body(o, s->_body)));
+			}
+		}
+		else if(const auto s = std::get_if<statement_t::expression_statement_t>(&statement._contents)){
+			const auto e = optimize_expression(o, s->_expression);
+			if(is_side_effect_free(e) == false){
+				acc.push_back(statement_t::make__expression_statement(loc, e));
+			}
+		}
+		else{
+			acc.push_back(statement);
+		}
+	}
+	return acc;
+}
+
+static body_t optimize_body(optimizer_t& o, const body_t& body){
+	QUARK_ASSERT(body.check_invariant());
+
+	o._scopes.push_back(make_optimizer_scope(body._symbols));
+	const auto statements = optimize_statements(o, body._statements);
+	const auto is_global = o._scopes.size() == 1;
+	o._scopes.pop_back();
+
+	const auto body2 = body_t(statements, body._symbols);
+	return is_global ? body2 : body_t(remove_dead_stores(body2), body._symbols);
+}
+
+semantic_ast_t run_optimization(const semantic_ast_t& ast){
+	QUARK_ASSERT(ast.check_invariant());
+
+	const auto& a = ast._checked_ast;
+	optimizer_t o{ a._function_defs, {} };
+	const auto globals = optimize_body(o, a._globals);
+
+	vector<shared_ptr<const function_definition_t>> function_defs;
+	for(const auto& f: a._function_defs){
+		if(f->_body){
+			o._scopes = { make_optimizer_scope(a._globals._symbols) };
+			const auto body = optimize_body(o, *f->_body);
+			function_defs.push_back(
+				make_shared<function_definition_t>(
+					function_definition_t{ f->_location, f->_function_type, f->_args, make_shared<body_t>(body), f->_host_function_id }
+				)
+			);
+		}
+		else{
+			function_defs.push_back(f);
+		}
+	}
+	return semantic_ast_t(ast_t{ globals, function_defs, a._software_system, a._container_def });
+}
+
+
+
+//////////////////////////////////////		TESTS
+
+
+void test__optimize_expression(const expression_t& e, const expression_t& expected){
+	const auto e2 = optimize_expression(e);
+	ut_verify(QUARK_POS, expression_to_json(e2)._value, expression_to_json(expected)._value);
+}
+
+static const auto k_int = std::make_shared<typeid_t>(typeid_t::make_int());
+static const auto k_bool = std::make_shared<typeid_t>(typeid_t::make_bool());
+
+QUARK_UNIT_TEST("optimize_expression()", "1 + 2", "", "3"){
+	test__optimize_expression(
+		expression_t::make_simple_expression__2(
+			expression_type::k_arithmetic_add__2,
+			expression_t::make_literal_int(1),
+			expression_t::make_literal_int(2),
+			k_int
+		),
+		expression_t::make_literal_int(3)
+	);
+}
+
+QUARK_UNIT_TEST("optimize_expression()", "(1 + 2) * -4", "", "-12"){
+	test__optimize_expression(
+		expression_t::make_simple_expression__2(
+			expression_type::k_arithmetic_multiply__2,
+			expression_t::make_simple_expression__2(
+				expression_type::k_arithmetic_add__2,
+				expression_t::make_literal_int(1),
+				expression_t::make_literal_int(2),
+				k_int
+			),
+			expression_t::make_unary_minus(expression_t::make_literal_int(4), k_int),
+			k_int
+		),
+		expression_t::make_literal_int(-12)
+	);
+}
+
+QUARK_UNIT_TEST("optimize_expression()", "-0.0", "", "+0.0, same as the interpreter"){
+	const auto e2 = optimize_expression(
+		expression_t::make_unary_minus(expression_t::make_literal_double(0.0), std::make_shared<typeid_t>(typeid_t::make_double()))
+	);
+	QUARK_UT_VERIFY(e2.is_literal());
+	QUARK_UT_VERIFY(std::signbit(e2.get_literal().get_double_value()) == false);
+}
+
+QUARK_UNIT_TEST("optimize_expression()", "-2.5", "", "-2.5"){
+	test__optimize_expression(
+		expression_t::make_unary_minus(expression_t::make_literal_double(2.5), std::make_shared<typeid_t>(typeid_t::make_double())),
+		expression_t::make_literal_double(-2.5)
+	);
+}
+
+QUARK_UNIT_TEST("optimize_expression()", "\"a\" + \"b\"", "", "\"ab\""){
+	test__optimize_expression(
+		expression_t::make_simple_expression__2(
+			expression_type::k_arithmetic_add__2,
+			expression_t::make_literal_string("a"),
+			expression_t::make_literal_string("b"),
+			std::make_shared<typeid_t>(typeid_t::make_string())
+		),
+		expression_t::make_literal_string("ab")
+	);
+}
+
+QUARK_UNIT_TEST("optimize_expression()", "10 / 0", "", "not folded, fails at runtime"){
+	const auto e = expression_t::make_simple_expression__2(
+		expression_type::k_arithmetic_divide__2,
+		expression_t::make_literal_int(10),
+		expression_t::make_literal_int(0),
+		k_int
+	);
+	test__optimize_expression(e, e);
+}
+
+QUARK_UNIT_TEST("optimize_expression()", "3 < 4", "", "true"){
+	test__optimize_expression(
+		expression_t::make_simple_expression__2(
+			expression_type::k_comparison_smaller__2,
+			expression_t::make_literal_int(3),
+			expression_t::make_literal_int(4),
+			k_bool
+		),
+		expression_t::make_literal_bool(true)
+	);
+}
+
+QUARK_UNIT_TEST("optimize_expression()", "\"b\" == \"b\"", "", "true"){
+	test__optimize_expression(
+		expression_t::make_simple_expression__2(
+			expression_type::k_logical_equal__2,
+			expression_t::make_literal_string("b"),
+			expression_t::make_literal_string("b"),
+			k_bool
+		),
+		expression_t::make_literal_bool(true)
+	);
+}
+
+QUARK_UNIT_TEST("optimize_expression()", "false ? 1 : 2", "", "2"){
+	test__optimize_expression(
+		expression_t::make_conditional_operator(
+			expression_t::make_literal_bool(false),
+			expression_t::make_literal_int(1),
+			expression_t::make_literal_int(2),
+			k_int
+		),
+		expression_t::make_literal_int(2)
+	);
+}
+
+QUARK_UNIT_TEST("optimize_expression()", "false && a", "", "false"){
+	test__optimize_expression(
+		expression_t::make_simple_expression__2(
+			expression_type::k_logical_and__2,
+			expression_t::make_literal_bool(false),
+			expression_t::make_load2(variable_address_t::make_variable_address(0, 0), k_bool),
+			k_bool
+		),
+		expression_t::make_literal_bool(false)
+	);
+}
+
+QUARK_UNIT_TEST("optimize_expression()", "true && a", "", "a"){
+	const auto a = expression_t::make_load2(variable_address_t::make_variable_address(0, 0), k_bool);
+	test__optimize_expression(
+		expression_t::make_simple_expression__2(expression_type::k_logical_and__2, expression_t::make_literal_bool(true), a, k_bool),
+		a
+	);
+}
+
+
+//	Optimizes the program and returns the expression of its last global statement.
+static expression_t optimize_last_statement(const std::string& program){
+	const auto ast = run_optimization(compile_to_sematic_ast(program, ""));
+	const auto& statements = ast._checked_ast._globals._statements;
+	QUARK_ASSERT(statements.empty() == false);
+
+	const auto& last = statements.back()._contents;
+	if(const auto store = std::get_if<statement_t::store2_t>(&last)){
+		return store->_expression;
+	}
+	else{
+		return std::get<statement_t::expression_statement_t>(last)._expression;
+	}
+}
+
+static const function_definition_t& find_function_def(const semantic_ast_t& ast, const std::string& name){
+	const auto& symbols = ast._checked_ast._globals._symbols._symbols;
+	const auto it = std::find_if(symbols.begin(), symbols.end(), [&](const std::pair<std::string, symbol_t>& e){ return e.first == name; });
+	QUARK_ASSERT(it != symbols.end());
+
+	//	The function's global is bound by a store2 of a function value literal.
+	for(const auto& s: ast._checked_ast._globals._statements){
+		const auto store = std::get_if<statement_t::store2_t>(&s._contents);
+		if(store != nullptr && store->_dest_variable._index == it - symbols.begin()){
+			return *ast._checked_ast._function_defs[store->_expression.get_literal().get_function_value()];
+		}
+	}
+	quark::throw_exception();
+}
+
+QUARK_UNIT_TEST("run_optimization()", "global", "", "folded"){
+	ut_verify(
+		QUARK_POS,
+		expression_to_json(optimize_last_statement("let result = 1 + 2 * 3"))._value,
+		expression_to_json(expression_t::make_literal_int(7))._value
+	);
+}
+
+QUARK_UNIT_TEST("run_optimization()", "host functions", "", "folded"){
+	ut_verify(
+		QUARK_POS,
+		expression_to_json(optimize_last_statement("let result = size(\"hello\") + size([1, 2, 3])"))._value,
+		expression_to_json(expression_t::make_literal_int(8))._value
+	);
+	ut_verify(
+		QUARK_POS,
+		expression_to_json(optimize_last_statement("let result = to_string(13) + \"!\""))._value,
+		expression_to_json(expression_t::make_literal_string("13!"))._value
+	);
+}
+
+QUARK_UNIT_TEST("run_optimization()", "if(false)", "", "pruned"){
+	const auto ast = run_optimization(compile_to_sematic_ast("if(false){ print(1) } else { print(2) }", ""));
+	const auto& last = ast._checked_ast._globals._statements.back();
+	const auto block = std::get_if<statement_t::block_statement_t>(&last._contents);
+	QUARK_UT_VERIFY(block != nullptr);
+	QUARK_UT_VERIFY(block->_body._statements.size() == 1);
+}
+
+QUARK_UNIT_TEST("run_optimization()", "function", "", "locals propagated, dead stores removed"){
+	const auto ast = run_optimization(compile_to_sematic_ast(R"(
+		func int f(int x){
+			let a = 2 * 3
+			let unused = x + 100
+			if(a > 5){
+				return x * a
+			}
+			else{
+				return 0
+			}
+			print("unreachable")
+		}
+	)", ""));
+	const auto& body = *find_function_def(ast, "f")._body;
+
+	//	Only the return from the picked branch remains, a is folded into it.
+	QUARK_UT_VERIFY(body._statements.size() == 1);
+	const auto& block = std::get<statement_t::block_statement_t>(body._statements[0]._contents);
+	QUARK_UT_VERIFY(block._body._statements.size() == 1);
+	const auto& ret = std::get<statement_t::return_statement_t>(block._body._statements[0]._contents);
+	QUARK_UT_VERIFY(ret._expression._input_exprs[1] == expression_t::make_literal_int(6));
+}
+
+QUARK_UNIT_TEST("run_optimization()", "side effects", "", "kept"){
+	const auto ast = run_optimization(compile_to_sematic_ast(R"(
+		func int f(int x){
+			let unused = 10 / x
+			return x
+		}
+	)", ""));
+	const auto& body = *find_function_def(ast, "f")._body;
+	QUARK_UT_VERIFY(body._statements.size() == 2);
+}
+
+}	//	floyd
@@ -0,0 +1,42 @@
+//
+//  pass4.h
+//  FloydSpeak
+//
+//  Created by Marcus Zetterquist on 2019-03-16.
+//  Copyright © 2019 Marcus Zetterquist. All rights reserved.
+//
+
+#ifndef pass4_hpp
+#define pass4_hpp
+
+/*
+	Optimizes a semantic_ast_t before code generation. The optimized program behaves the same as the original.
+
+	- Folds operations on literals: 1 + 2, "a" + "b", 3 < 4, -(5), cond ? a : b with a literal condition.
+	- Folds calls to pure host functions on literals: size("abc"), size([1, 2, 3]), to_string(13).
+	- Replaces loads of immutable locals that are bound to a literal with the literal.
+	- Prunes unreachable code: if / else and while on literal conditions, for-loops with literal empty ranges and
+		statements after a return.
+	- Removes stores to locals that are never read, and expression statements, when the expression has no side
+		effects.
+
+	Globals are never removed or replaced with their values, since the host can read them and functions can run
+	before they are initialized. Symbol tables are left as they are, so all variable addresses stay valid.
+*/
+
+#include "quark.h"
+
+#include "pass3.h"
+
+namespace floyd {
+struct expression_t;
+
+
+semantic_ast_t run_optimization(const semantic_ast_t& ast);
+
+//	Folds an expression without any symbols: only operations on literals.
+expression_t optimize_expression(const expression_t& e);
+
+}	//	floyd
+
+#endif /* pass4_hpp */
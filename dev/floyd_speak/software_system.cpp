@@ -26,14 +26,73 @@ vector<person_t> unpack_persons(const json_t& persons_obj){
 }
 
 
+std::string inbox_policy_to_string(einbox_policy policy){
+	if(policy == einbox_policy::k_block){
+		return "block";
+	}
+	else if(policy == einbox_policy::k_drop_oldest){
+		return "drop-oldest";
+	}
+	else if(policy == einbox_policy::k_drop_newest){
+		return "drop-newest";
+	}
+	else if(policy == einbox_policy::k_coalesce){
+		return "coalesce";
+	}
+	else{
+		QUARK_ASSERT(false);
+		throw std::exception();
+	}
+}
+
+einbox_policy string_to_inbox_policy(const std::string& s){
+	if(s == "block"){
+		return einbox_policy::k_block;
+	}
+	else if(s == "drop-oldest"){
+		return einbox_policy::k_drop_oldest;
+	}
+	else if(s == "drop-newest"){
+		return einbox_policy::k_drop_newest;
+	}
+	else if(s == "coalesce"){
+		return einbox_policy::k_coalesce;
+	}
+	else{
+		quark::throw_runtime_error("Unknown inbox policy \"" + s + "\".");
+	}
+}
+
+process_def_t unpack_process_def(const json_t& process_obj){
+	if(process_obj.is_string()){
+		return process_def_t{ process_obj.get_string(), 0, 0, einbox_policy::k_block, "" };
+	}
+	else{
+		const auto function_key = process_obj.get_object_element("function").get_string();
+		const auto batch_size = process_obj.get_optional_object_element("batch", json_t(0.0)).get_number();
+		if(batch_size < 0){
+			quark::throw_runtime_error("Process batch size must be 0 or more.");
+		}
+		const auto capacity = process_obj.get_optional_object_element("capacity", json_t(0.0)).get_number();
+		if(capacity < 0){
+			quark::throw_runtime_error("Process inbox capacity must be 0 or more.");
+		}
+		const auto policy = string_to_inbox_policy(process_obj.get_optional_object_element("policy", json_t("block")).get_string());
+		const auto coalesce_key = process_obj.get_optional_object_element("coalesce_key", json_t("")).get_string();
+		if(policy == einbox_policy::k_coalesce && coalesce_key.empty()){
+			quark::throw_runtime_error("Inbox policy \"coalesce\" needs a \"coalesce_key\".");
+		}
+		return process_def_t{ function_key, static_cast<int>(batch_size), static_cast<int>(capacity), policy, coalesce_key };
+	}
+}
+
 clock_bus_t unpack_clock_bus(const json_t& clock_bus_obj){
-	std::map<std::string, std::string> processes;
+	std::map<std::string, process_def_t> processes;
 
 	const auto processes_map = clock_bus_obj.get_object();
 	for(const auto& process_pair: processes_map){
 		const auto name_key = process_pair.first;
-		const auto process_function_key = process_pair.second.get_string();
-		processes.insert({name_key, process_function_key} );
+		processes.insert({name_key, unpack_process_def(process_pair.second)} );
 	}
 	return clock_bus_t{._processes = processes};
 }
@@ -89,3 +148,13 @@ software_system_t parse_software_system_json(const json_t& value){
 container_t parse_container_def_json(const json_t& value){
 	return unpack_container(value);
 }
+
+std::vector<std::string> get_process_keys(const container_t& container){
+	std::vector<std::string> result;
+	for(const auto& clock_bus: container._clock_busses){
+		for(const auto& process: clock_bus.second._processes){
+			result.push_back(process.first);
+		}
+	}
+	return result;
+}
@@ -31,9 +31,47 @@ struct connection_t {
 	std::string _tech_desc;
 };
 
+//	What happens when a message is sent to a process whose inbox is full.
+enum class einbox_policy {
+	//	Sender waits until there is room.
+	k_block,
+
+	k_drop_oldest,
+	k_drop_newest,
+
+	//	A message replaces the waiting message with the same value for the coalesce key, full or not.
+	//	If there is none and the inbox is full, the oldest message is dropped.
+	k_coalesce
+};
+
+std::string inbox_policy_to_string(einbox_policy policy);
+
+//	Throws if s isn't "block", "drop-oldest", "drop-newest" or "coalesce".
+einbox_policy string_to_inbox_policy(const std::string& s);
+
+/*
+	In the container-def a process is either just the name of its process-function:
+		"a": "my_gui"
+	...or an object:
+		"a": { "function": "my_audio", "batch": 64, "capacity": 1000, "policy": "drop-oldest" }
+*/
+struct process_def_t {
+	std::string _function_key;
+
+	//	0: the process function gets one message per call.
+	//	> 0: the process function gets a vector of up to this many messages per call.
+	int _batch_size;
+
+	//	Max number of waiting messages. 0 means no limit.
+	int _inbox_capacity;
+	einbox_policy _inbox_policy;
+
+	//	Only for k_coalesce: name of the struct member or JSON object key that identifies a message.
+	std::string _coalesce_key;
+};
+
 struct clock_bus_t {
-	//	Right now an process is the name of the process-function, will probably get more members.
-	std::map<std::string, std::string> _processes;
+	std::map<std::string, process_def_t> _processes;
 };
 
 struct container_t {
@@ -56,6 +94,10 @@ struct software_system_t {
 software_system_t parse_software_system_json(const json_t& value);
 container_t parse_container_def_json(const json_t& value);
 
+//	All processes of the container, ordered by clock bus then by process key.
+//	A process' position in this vector is its process index: the runtime and the compiler must agree on it.
+std::vector<std::string> get_process_keys(const container_t& container);
+
 
 
 #endif /* software_system_hpp */